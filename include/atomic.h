@@ -0,0 +1,267 @@
+/**
+ * @file atomic.h
+ * @brief LDREX/STREX atomics: counters, exchange, compare-and-swap and bit operations.
+ *
+ * Every read-modify-write is a single LDREX/STREX loop in one asm block,
+ * so the compiler cannot put a spill between the pair. irq_entry ends
+ * with CLREX, so an interrupt that lands inside a loop makes its STREX
+ * fail and the loop retry: the operations are atomic against IRQ
+ * handlers on this CPU and against other bus masters alike.
+ *
+ * Ordering follows the Linux convention:
+ * - void operations (atomic_add(), set_bit(), ...) and `_relaxed`
+ *   variants are atomic but unordered; they only act as compiler barriers;
+ * - operations that return a value (atomic_add_return(), atomic_cmpxchg(),
+ *   test_and_set_bit(), ...) are fully ordered: a DMB before the loop
+ *   and one after it, so no access moves across them in either direction.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "barrier.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief A 32-bit counter only touched through the functions below.
+     */
+    typedef struct
+    {
+        volatile int32_t counter;
+    } atomic_t;
+
+#define ATOMIC_INIT(v) { (v) }
+
+    /*
+     * Word primitives. atomic32_fetch_<op>() returns the old value and is
+     * fully ordered, atomic32_fetch_<op>_relaxed() is not ordered.
+     */
+#define ATOMIC32_FETCH_OP(op, insn)                                                     \
+    static inline uint32_t atomic32_fetch_##op##_relaxed(volatile uint32_t *p, uint32_t v) \
+    {                                                                                   \
+        uint32_t old, tmp, failed;                                                      \
+        __asm__ volatile("1: ldrex   %0, [%3]\n\t"                                      \
+                         "   " insn "     %1, %0, %4\n\t"                               \
+                         "   strex   %2, %1, [%3]\n\t"                                  \
+                         "   teq     %2, #0\n\t"                                        \
+                         "   bne     1b"                                                \
+                         : "=&r"(old), "=&r"(tmp), "=&r"(failed)                        \
+                         : "r"(p), "r"(v)                                               \
+                         : "cc", "memory");                                             \
+        return old;                                                                     \
+    }                                                                                   \
+                                                                                        \
+    static inline uint32_t atomic32_fetch_##op(volatile uint32_t *p, uint32_t v)         \
+    {                                                                                   \
+        dmb();                                                                          \
+        const uint32_t old = atomic32_fetch_##op##_relaxed(p, v);                       \
+        dmb();                                                                          \
+        return old;                                                                     \
+    }
+
+    ATOMIC32_FETCH_OP(add, "add")
+    ATOMIC32_FETCH_OP(sub, "sub")
+    ATOMIC32_FETCH_OP(or, "orr")
+    ATOMIC32_FETCH_OP(andnot, "bic")
+    ATOMIC32_FETCH_OP(xor, "eor")
+
+#undef ATOMIC32_FETCH_OP
+
+    /**
+     * @brief Store `v` in `*p` if it holds `old`; unordered.
+     *
+     * @return The value found in `*p`: the swap happened iff it equals `old`.
+     */
+    static inline uint32_t atomic32_cmpxchg_relaxed(volatile uint32_t *p, uint32_t old, uint32_t v)
+    {
+        uint32_t seen, failed;
+        __asm__ volatile("1: ldrex   %0, [%2]\n\t"
+                         "   mov     %1, #0\n\t"
+                         "   teq     %0, %3\n\t"
+                         "   strexeq %1, %4, [%2]\n\t"
+                         "   teq     %1, #0\n\t"
+                         "   bne     1b"
+                         : "=&r"(seen), "=&r"(failed)
+                         : "r"(p), "r"(old), "r"(v)
+                         : "cc", "memory");
+        return seen;
+    }
+
+    /**
+     * @brief Fully ordered atomic32_cmpxchg_relaxed().
+     */
+    static inline uint32_t atomic32_cmpxchg(volatile uint32_t *p, uint32_t old, uint32_t v)
+    {
+        dmb();
+        const uint32_t seen = atomic32_cmpxchg_relaxed(p, old, v);
+        dmb();
+        return seen;
+    }
+
+    /**
+     * @brief Store `v` in `*p` and return the previous value; fully ordered.
+     */
+    static inline uint32_t atomic32_xchg(volatile uint32_t *p, uint32_t v)
+    {
+        uint32_t old, failed;
+        dmb();
+        __asm__ volatile("1: ldrex   %0, [%2]\n\t"
+                         "   strex   %1, %3, [%2]\n\t"
+                         "   teq     %1, #0\n\t"
+                         "   bne     1b"
+                         : "=&r"(old), "=&r"(failed)
+                         : "r"(p), "r"(v)
+                         : "cc", "memory");
+        dmb();
+        return old;
+    }
+
+    // --- Counters ---
+
+    static inline int32_t atomic_read(const atomic_t *a)
+    {
+        return a->counter;
+    }
+
+    static inline void atomic_set(atomic_t *a, int32_t v)
+    {
+        a->counter = v;
+    }
+
+    static inline volatile uint32_t *atomic_word(atomic_t *a)
+    {
+        return (volatile uint32_t *)&a->counter;
+    }
+
+    /** @brief Add `v`; unordered. */
+    static inline void atomic_add(atomic_t *a, int32_t v)
+    {
+        (void)atomic32_fetch_add_relaxed(atomic_word(a), (uint32_t)v);
+    }
+
+    /** @brief Subtract `v`; unordered. */
+    static inline void atomic_sub(atomic_t *a, int32_t v)
+    {
+        (void)atomic32_fetch_sub_relaxed(atomic_word(a), (uint32_t)v);
+    }
+
+    static inline void atomic_inc(atomic_t *a)
+    {
+        atomic_add(a, 1);
+    }
+
+    static inline void atomic_dec(atomic_t *a)
+    {
+        atomic_sub(a, 1);
+    }
+
+    /** @brief Add `v` and return the old value; fully ordered. */
+    static inline int32_t atomic_fetch_add(atomic_t *a, int32_t v)
+    {
+        return (int32_t)atomic32_fetch_add(atomic_word(a), (uint32_t)v);
+    }
+
+    /** @brief Add `v` and return the new value; fully ordered. */
+    static inline int32_t atomic_add_return(atomic_t *a, int32_t v)
+    {
+        return atomic_fetch_add(a, v) + v;
+    }
+
+    /** @brief Subtract `v` and return the new value; fully ordered. */
+    static inline int32_t atomic_sub_return(atomic_t *a, int32_t v)
+    {
+        return (int32_t)atomic32_fetch_sub(atomic_word(a), (uint32_t)v) - v;
+    }
+
+    static inline int32_t atomic_inc_return(atomic_t *a)
+    {
+        return atomic_add_return(a, 1);
+    }
+
+    /** @brief Decrement and report whether the counter reached zero; fully ordered. */
+    static inline bool atomic_dec_and_test(atomic_t *a)
+    {
+        return atomic_sub_return(a, 1) == 0;
+    }
+
+    /** @brief See atomic32_cmpxchg(). */
+    static inline int32_t atomic_cmpxchg(atomic_t *a, int32_t old, int32_t v)
+    {
+        return (int32_t)atomic32_cmpxchg(atomic_word(a), (uint32_t)old, (uint32_t)v);
+    }
+
+    /** @brief See atomic32_xchg(). */
+    static inline int32_t atomic_xchg(atomic_t *a, int32_t v)
+    {
+        return (int32_t)atomic32_xchg(atomic_word(a), (uint32_t)v);
+    }
+
+    // --- Pointers ---
+
+    /** @brief Pointer atomic32_cmpxchg(): returns the pointer found in `*p`. */
+    static inline void *atomic_cmpxchg_ptr(void *volatile *p, void *old, void *v)
+    {
+        return (void *)(uintptr_t)atomic32_cmpxchg((volatile uint32_t *)p,
+                                                   (uint32_t)(uintptr_t)old, (uint32_t)(uintptr_t)v);
+    }
+
+    /** @brief Pointer atomic32_xchg(). */
+    static inline void *atomic_xchg_ptr(void *volatile *p, void *v)
+    {
+        return (void *)(uintptr_t)atomic32_xchg((volatile uint32_t *)p, (uint32_t)(uintptr_t)v);
+    }
+
+    // --- Bits (bit `nr` of a word array, 32 bits per word) ---
+
+    static inline bool test_bit(uint32_t nr, const volatile uint32_t *addr)
+    {
+        return (addr[nr >> 5] >> (nr & 31u)) & 1u;
+    }
+
+    /** @brief Set bit `nr`; unordered. */
+    static inline void set_bit(uint32_t nr, volatile uint32_t *addr)
+    {
+        (void)atomic32_fetch_or_relaxed(&addr[nr >> 5], 1u << (nr & 31u));
+    }
+
+    /** @brief Clear bit `nr`; unordered. */
+    static inline void clear_bit(uint32_t nr, volatile uint32_t *addr)
+    {
+        (void)atomic32_fetch_andnot_relaxed(&addr[nr >> 5], 1u << (nr & 31u));
+    }
+
+    /** @brief Flip bit `nr`; unordered. */
+    static inline void change_bit(uint32_t nr, volatile uint32_t *addr)
+    {
+        (void)atomic32_fetch_xor_relaxed(&addr[nr >> 5], 1u << (nr & 31u));
+    }
+
+    /** @brief Set bit `nr` and return its old value; fully ordered. */
+    static inline bool test_and_set_bit(uint32_t nr, volatile uint32_t *addr)
+    {
+        const uint32_t mask = 1u << (nr & 31u);
+        return (atomic32_fetch_or(&addr[nr >> 5], mask) & mask) != 0;
+    }
+
+    /** @brief Clear bit `nr` and return its old value; fully ordered. */
+    static inline bool test_and_clear_bit(uint32_t nr, volatile uint32_t *addr)
+    {
+        const uint32_t mask = 1u << (nr & 31u);
+        return (atomic32_fetch_andnot(&addr[nr >> 5], mask) & mask) != 0;
+    }
+
+    /** @brief Flip bit `nr` and return its old value; fully ordered. */
+    static inline bool test_and_change_bit(uint32_t nr, volatile uint32_t *addr)
+    {
+        const uint32_t mask = 1u << (nr & 31u);
+        return (atomic32_fetch_xor(&addr[nr >> 5], mask) & mask) != 0;
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file barrier.h
+ * @brief ARMv7-A memory and instruction barrier helpers.
+ *
+ * Thin wrappers around `dmb`, `dsb` and `isb`. Every helper also acts as a
+ * compiler barrier (`memory` clobber), so the compiler never moves memory
+ * accesses across it.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Compiler-only barrier, emits no instruction.
+ */
+static inline void barrier(void)
+{
+    __asm__ volatile("" ::: "memory");
+}
+
+/**
+ * @brief Data Memory Barrier: orders memory accesses before/after it.
+ */
+static inline void dmb(void)
+{
+    __asm__ volatile("dmb" ::: "memory");
+}
+
+/**
+ * @brief Data Synchronization Barrier: waits for all memory accesses to complete.
+ */
+static inline void dsb(void)
+{
+    __asm__ volatile("dsb" ::: "memory");
+}
+
+/**
+ * @brief Instruction Synchronization Barrier: flushes the pipeline.
+ */
+static inline void isb(void)
+{
+    __asm__ volatile("isb" ::: "memory");
+}
+
+#ifdef __cplusplus
+}
+#endif
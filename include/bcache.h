@@ -0,0 +1,83 @@
+/**
+ * @file bcache.h
+ * @brief Write-back buffer cache of 4 KiB blocks in front of the SD card.
+ *
+ * BCACHE_BUFFERS blocks are held in a hash table keyed by block number
+ * and in an LRU list; a miss recycles the least recently used buffer.
+ * Writes only dirty the buffer. Dirty blocks reach the card when they
+ * are evicted or on bcache_sync(), and neighbouring dirty blocks go
+ * together in one multi-block write.
+ *
+ * A reader that walks blocks in order gets sequential read-ahead: each
+ * miss in the stream fetches a growing window of the following blocks
+ * (2, 4, ... BCACHE_READAHEAD_MAX) in the same multi-block command.
+ * Any other access resets the window.
+ *
+ * Calls sleep on the card and on an internal lock; not for IRQ context.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "errno.h"
+#include "mmci.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BCACHE_BLOCK_SIZE     4096u
+#define BCACHE_BLOCK_SECTORS  (BCACHE_BLOCK_SIZE / MMCI_SECTOR_SIZE)
+#define BCACHE_BUFFERS        64u                                      /**< 256 KiB of blocks. */
+#define BCACHE_HASH_SIZE      128u                                     /**< Buckets, a power of two. */
+#define BCACHE_READAHEAD_MAX  (MMCI_MAX_SECTORS / BCACHE_BLOCK_SECTORS) /**< Blocks per fetch. */
+#define BCACHE_RUN_MAX        (MMCI_MAX_SECTORS / BCACHE_BLOCK_SECTORS) /**< Dirty blocks per write. */
+
+    /**
+     * @brief Allocate the buffers, or drop every cached block on later calls.
+     *
+     * Dirty blocks are discarded: sync first if they matter.
+     *
+     * @return KERR_NOT_FOUND without a card (mmci_init() failed),
+     *         KERR_NOMEM if the buffers cannot be allocated.
+     */
+    kerror_t bcache_init(void);
+
+    /**
+     * @brief Number of 4 KiB blocks on the card, 0 before bcache_init().
+     */
+    uint32_t bcache_blocks(void);
+
+    /**
+     * @brief Copy block `block` to `dst` (BCACHE_BLOCK_SIZE bytes).
+     *
+     * @return KERR_INVAL past the end of the card, or the error of the
+     *         card read on a miss.
+     */
+    kerror_t bcache_read(uint32_t block, void *dst);
+
+    /**
+     * @brief Replace block `block` with `src` (BCACHE_BLOCK_SIZE bytes).
+     *
+     * The block is only marked dirty; a card error can surface later,
+     * from the eviction or the bcache_sync() that writes it.
+     */
+    kerror_t bcache_write(uint32_t block, const void *src);
+
+    /**
+     * @brief Write every dirty block back to the card.
+     *
+     * @return The first card error, which stops the sync; unwritten blocks stay dirty.
+     */
+    kerror_t bcache_sync(void);
+
+    /**
+     * @brief Sync, then forget every cached block.
+     */
+    kerror_t bcache_invalidate(void);
+
+#ifdef __cplusplus
+}
+#endif
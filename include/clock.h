@@ -0,0 +1,84 @@
+/**
+ * @file clock.h
+ * @brief Monotonic clocksource built on SP804 Timer1.
+ *
+ * Timer1 (second channel of the Timer0/1 block) runs as a free-running
+ * 32-bit down-counter. Each wrap raises an interrupt which bumps a 32-bit
+ * overflow epoch; the pair (epoch, counter) forms a 64-bit cycle count.
+ *
+ * Readers never take a lock and never disable interrupts: the epoch is
+ * published under a sequence counter and readers simply retry when the
+ * overflow interrupt ran in the middle of their read.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Start the clocksource.
+     *
+     * Programs Timer1 as a free-running counter, enables its wrap interrupt
+     * at the VIC and precomputes the cycle to ns/us conversion factors.
+     *
+     * @param timer_clk_hz Input clock of the SP804 (1 MHz on QEMU Versatile).
+     *                     0 falls back to 1 MHz.
+     *
+     * @note Wrap accounting needs IRQs unmasked at least once per counter
+     *       period (~71 minutes at 1 MHz). A single pending wrap is still
+     *       accounted for while IRQs are masked.
+     */
+    void clock_init(uint32_t timer_clk_hz);
+
+    /**
+     * @brief Number of clocksource cycles elapsed since clock_init().
+     *
+     * Tear-free 64-bit read, safe from both thread and IRQ context.
+     */
+    uint64_t clock_cycles(void);
+
+    /**
+     * @brief Low 32 bits of clock_cycles(): one register read, no epoch.
+     *
+     * For intervals well below one counter period; take differences with
+     * unsigned arithmetic.
+     */
+    uint32_t clock_cycles32(void);
+
+    /**
+     * @brief Monotonic time in nanoseconds since clock_init().
+     */
+    uint64_t clock_monotonic_ns(void);
+
+    /**
+     * @brief Monotonic time in microseconds since clock_init().
+     */
+    uint64_t clock_monotonic_us(void);
+
+    /**
+     * @brief Convert a clocksource cycle count to nanoseconds.
+     */
+    uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+    /**
+     * @brief Convert a clocksource cycle count to microseconds.
+     */
+    uint64_t clock_cycles_to_us(uint64_t cycles);
+
+    /**
+     * @brief Input frequency of the clocksource in Hz.
+     */
+    uint32_t clock_hz(void);
+
+    /**
+     * @brief Timer1 wrap handler, called from irq_handler().
+     */
+    void clock_handle_wrap(void);
+
+#ifdef __cplusplus
+}
+#endif
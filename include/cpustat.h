@@ -0,0 +1,107 @@
+/**
+ * @file cpustat.h
+ * @brief CPU time accounting: thread, deferred work, IRQ handlers and idle.
+ *
+ * The CPU is always in exactly one cpu_state_t. Every transition charges
+ * the clocksource cycles since the previous one to the state being left,
+ * so the buckets add up to wall time with nothing sampled or lost:
+ * - irq_handler() enters CPU_IRQ and charges each VIC line it services;
+ * - klog_drain() and the kmalloc IRQ-cache refill run as CPU_DEFERRED;
+ * - every `wfi` goes through cpustat_wfi() and counts as CPU_IDLE, so a
+ *   context waiting for an interrupt never looks busy;
+ * - everything else is CPU_THREAD, also charged to the running thread.
+ *
+ * The clock is the free-running SP804 Timer1 (clock_cycles32()), which
+ * keeps counting through `wfi`, unlike the PMU cycle counter. At 1 MHz a
+ * single short handler may read as 0 or 1 cycle; the totals are exact.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CPUSTAT_IRQ_LINES 32u /**< PL190 VIC lines. */
+
+    struct thread;
+
+    /**
+     * @enum cpu_state_t
+     * @brief What the CPU is doing.
+     */
+    typedef enum cpu_state : uint8_t
+    {
+        CPU_THREAD,   /**< Foreground thread code (default for new threads). */
+        CPU_DEFERRED, /**< Work pushed out of IRQ handlers. */
+        CPU_IRQ,      /**< irq_handler(). */
+        CPU_IDLE,     /**< Sleeping in `wfi`. */
+        CPU_STATES
+    } cpu_state_t;
+
+    /**
+     * @brief Accumulated clocksource cycles since cpustat_init().
+     */
+    struct cpustat
+    {
+        uint64_t state[CPU_STATES];
+        uint64_t irq_cycles[CPUSTAT_IRQ_LINES]; /**< Time in each line's handler. */
+        uint32_t irq_count[CPUSTAT_IRQ_LINES];  /**< Interrupts serviced per line. */
+    };
+
+    /**
+     * @brief Reset the counters and start charging CPU_THREAD. Needs clock_init().
+     */
+    void cpustat_init(void);
+
+    /**
+     * @brief Charge the time so far to the current state and switch to `state`.
+     *
+     * @return The state left, for cpustat_leave().
+     */
+    cpu_state_t cpustat_enter(cpu_state_t state);
+
+    /**
+     * @brief Go back to the state returned by cpustat_enter().
+     */
+    void cpustat_leave(cpu_state_t prev);
+
+    /**
+     * @brief Clock reading to pass to cpustat_irq_line().
+     */
+    uint32_t cpustat_now(void);
+
+    /**
+     * @brief Charge the time since `start` to VIC line `line`. IRQ context.
+     */
+    void cpustat_irq_line(uint32_t line, uint32_t start);
+
+    /**
+     * @brief `wfi`, accounted as CPU_IDLE.
+     *
+     * Masks IRQs around the instruction so the handler of the waking
+     * interrupt runs, and is charged, after the idle period is closed.
+     * Callers that check a condition before sleeping mask IRQs themselves.
+     */
+    void cpustat_wfi(void);
+
+    /**
+     * @brief Move the accounting state from `prev` to `next`. Called by schedule().
+     */
+    void cpustat_switch(struct thread *prev, struct thread *next);
+
+    /**
+     * @brief Copy the counters, charging the current state up to now.
+     */
+    void cpustat_sample(struct cpustat *out);
+
+    /**
+     * @brief Short name of `state` ("thread", "deferred", "irq", "idle").
+     */
+    const char *cpustat_state_str(cpu_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,3 +1,12 @@
+/**
+ * @file datetime.h
+ * @brief Wall-clock time from a cached RTC base and the monotonic clock.
+ *
+ * The PL031 RTC only counts whole seconds and costs an MMIO read, so it is
+ * read once by datetime_init() and then every DATETIME_RESYNC_S seconds
+ * from a kernel timer. In between, the time is the cached base plus the
+ * monotonic clock elapsed since it was taken; queries touch no device.
+ */
 #pragma once
 
 #include <stdint.h>
@@ -7,6 +16,11 @@ extern "C"
 {
 #endif
 
+#define RTCDR (*(volatile uint32_t *)0x101e8000) // PL031 data register: seconds since the epoch
+
+/** Seconds between RTC resyncs. */
+#define DATETIME_RESYNC_S 600u
+
     typedef struct
     {
         uint32_t hrs;
@@ -22,10 +36,50 @@ extern "C"
 
     } dateval;
 
+    /**
+     * @brief Read the RTC into the base and start the resync timer.
+     *
+     * Needs clock_init() first. Before it runs, the time reads as the epoch.
+     */
+    void datetime_init(void);
+
+    /**
+     * @brief Re-read the RTC and correct the base if it drifted.
+     *
+     * The base is only moved when the cached time left the RTC's current
+     * second, so the sub-second phase found so far is kept. Runs from the
+     * resync timer; callable directly.
+     */
+    void datetime_resync(void);
+
+    /**
+     * @brief Current wall-clock time in microseconds since the Unix epoch.
+     */
+    uint64_t datetime_now_us(void);
+
+    /**
+     * @brief Current wall-clock time in seconds since the Unix epoch.
+     */
+    uint32_t datetime_now(void);
+
+    /**
+     * @brief Split seconds since the epoch into a UTC date and time.
+     *
+     * Either output may be NULL. Exact for the whole 32-bit range
+     * (1970-01-01 to 2106-02-07).
+     */
+    void datetime_from_epoch(uint32_t since_epoch, dateval *date, timeval *time);
+
+    /**
+     * @brief Current date and time from a single clock read.
+     *
+     * @return Seconds since the epoch the fields were computed from.
+     */
+    uint32_t getdatetime(dateval *date, timeval *time);
+
     uint32_t getdate(dateval *date);
     uint32_t gettime(timeval *time_struct);
 
 #ifdef __cplusplus
 }
 #endif
-
@@ -0,0 +1,183 @@
+/**
+ * @file dma.h
+ * @brief PL080 DMA controller driver for QEMU VersatileAB/PB.
+ *
+ * Eight channels, allocated with dma_channel_alloc(). A transfer is a
+ * chain of linked-list items (LLIs), each moving up to 4095 units of the
+ * source width; dma_lli_chain() splits a buffer into such a chain. The
+ * terminal-count interrupt of the last item calls the channel's
+ * completion callback from IRQ context.
+ *
+ * @note Buffers must not be cached while a transfer runs. The D-cache is
+ *       off while the MMU is off; once it is on, clean (to device) or
+ *       invalidate (from device) the buffer around the transfer.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errno.h"
+
+// Memory-mapped PL080 registers on QEMU VersatileAB/PB.
+// ref: PrimeCell DMA Controller (PL080) TRM, register summary
+#define DMAC_BASE           0x10130000u
+#define DMAC_INTSTATUS      (*(volatile uint32_t *)(DMAC_BASE + 0x000))
+#define DMAC_INTTCSTATUS    (*(volatile uint32_t *)(DMAC_BASE + 0x004))
+#define DMAC_INTTCCLEAR     (*(volatile uint32_t *)(DMAC_BASE + 0x008))
+#define DMAC_INTERRSTATUS   (*(volatile uint32_t *)(DMAC_BASE + 0x00C))
+#define DMAC_INTERRCLR      (*(volatile uint32_t *)(DMAC_BASE + 0x010))
+#define DMAC_ENBLDCHNS      (*(volatile uint32_t *)(DMAC_BASE + 0x01C))
+#define DMAC_CONFIG         (*(volatile uint32_t *)(DMAC_BASE + 0x030))
+
+// Per-channel registers, channel n at 0x100 + n * 0x20.
+#define DMAC_CH_BASE(n)     (DMAC_BASE + 0x100u + (uint32_t)(n) * 0x20u)
+#define DMAC_CH_SRC(n)      (*(volatile uint32_t *)(DMAC_CH_BASE(n) + 0x00))
+#define DMAC_CH_DST(n)      (*(volatile uint32_t *)(DMAC_CH_BASE(n) + 0x04))
+#define DMAC_CH_LLI(n)      (*(volatile uint32_t *)(DMAC_CH_BASE(n) + 0x08))
+#define DMAC_CH_CONTROL(n)  (*(volatile uint32_t *)(DMAC_CH_BASE(n) + 0x0C))
+#define DMAC_CH_CONFIG(n)   (*(volatile uint32_t *)(DMAC_CH_BASE(n) + 0x10))
+
+#define DMAC_CONFIG_E       (1u << 0)  // controller enable
+
+// Channel control word (also the last word of an LLI).
+#define DMA_CTRL_SIZE_MAX   0xFFFu             // transfer size field, in source units
+#define DMA_CTRL_SBSIZE(b)  ((uint32_t)(b) << 12)
+#define DMA_CTRL_DBSIZE(b)  ((uint32_t)(b) << 15)
+#define DMA_CTRL_SWIDTH(w)  ((uint32_t)(w) << 18)
+#define DMA_CTRL_DWIDTH(w)  ((uint32_t)(w) << 21)
+#define DMA_CTRL_SI         (1u << 26)         // increment source
+#define DMA_CTRL_DI         (1u << 27)         // increment destination
+#define DMA_CTRL_I          (1u << 31)         // terminal count interrupt
+
+// Burst sizes and widths for the fields above.
+#define DMA_BURST_1         0u
+#define DMA_BURST_4         1u
+#define DMA_BURST_8         2u
+#define DMA_BURST_16        3u
+#define DMA_WIDTH_8         0u
+#define DMA_WIDTH_16        1u
+#define DMA_WIDTH_32        2u
+
+// Channel configuration.
+#define DMA_CFG_E           (1u << 0)          // channel enable
+#define DMA_CFG_SRCPERIPH(p) ((uint32_t)(p) << 1)
+#define DMA_CFG_DSTPERIPH(p) ((uint32_t)(p) << 6)
+#define DMA_CFG_FLOW_M2M    (0u << 11)
+#define DMA_CFG_FLOW_M2P    (1u << 11)
+#define DMA_CFG_FLOW_P2M    (2u << 11)
+#define DMA_CFG_IE          (1u << 14)         // unmask error interrupt
+#define DMA_CFG_ITC         (1u << 15)         // unmask terminal count interrupt
+#define DMA_CFG_ACTIVE      (1u << 17)
+#define DMA_CFG_HALT        (1u << 18)
+
+/** Number of PL080 channels; channel 0 has the highest priority. */
+#define DMA_CHANNELS        8
+
+/** Versatile DMA request lines. */
+#define DMA_REQ_UART0_RX    14u
+#define DMA_REQ_UART0_TX    15u
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief One linked-list item, in the layout the PL080 fetches.
+     *
+     * Must be word aligned and stay untouched until the transfer ends.
+     */
+    typedef struct dma_lli
+    {
+        uint32_t src;     /**< Source address. */
+        uint32_t dst;     /**< Destination address. */
+        uint32_t next;    /**< Next item, 0 ends the chain. */
+        uint32_t control; /**< Control word, including the transfer size. */
+    } dma_lli_t;
+
+    /**
+     * @brief Completion callback, runs in IRQ context.
+     *
+     * @param channel Channel that finished.
+     * @param status  KERR_OK, or KERR_IO on a bus error.
+     * @param arg     Argument given to dma_start().
+     */
+    typedef void (*dma_callback_t)(int channel, kerror_t status, void *arg);
+
+    /**
+     * @brief Enable the controller and its interrupt.
+     */
+    void dma_init(void);
+
+    /**
+     * @brief Claim a free channel.
+     *
+     * @return Channel number, or -1 if all channels are taken.
+     */
+    int dma_channel_alloc(void);
+
+    /**
+     * @brief Abort anything running on `channel` and release it.
+     */
+    void dma_channel_free(int channel);
+
+    /**
+     * @brief Build an LLI chain moving `units` source-width units.
+     *
+     * Splits at DMA_CTRL_SIZE_MAX units per item, links the items, and
+     * sets the terminal count interrupt on the last one only. Addresses
+     * advance only where `control` has DMA_CTRL_SI / DMA_CTRL_DI.
+     *
+     * @param lli     Item storage.
+     * @param max     Number of items in `lli`.
+     * @param src     Source address.
+     * @param dst     Destination address.
+     * @param units   Units to move (bytes for DMA_WIDTH_8).
+     * @param control Control word without size and interrupt bits.
+     *
+     * @return Items used, or 0 if `max` is too small or `units` is 0.
+     */
+    uint32_t dma_lli_chain(dma_lli_t *lli, uint32_t max, uintptr_t src, uintptr_t dst,
+                           size_t units, uint32_t control);
+
+    /**
+     * @brief Start a chain on an allocated channel.
+     *
+     * @param channel Channel from dma_channel_alloc().
+     * @param chain   First item of the chain; the controller loads the rest.
+     * @param config  Peripherals and flow control (DMA_CFG_*), without E.
+     * @param cb      Completion callback, may be NULL.
+     * @param arg     Passed to `cb`.
+     *
+     * @return KERR_OK, KERR_INVAL for a bad channel, KERR_BUSY if it is running.
+     */
+    kerror_t dma_start(int channel, const dma_lli_t *chain, uint32_t config,
+                       dma_callback_t cb, void *arg);
+
+    /**
+     * @brief Stop a channel without calling its callback.
+     *
+     * Halts the channel and waits for in-flight data before disabling it.
+     */
+    void dma_abort(int channel);
+
+    /**
+     * @brief Whether `channel` is still enabled (transfer not finished).
+     */
+    bool dma_busy(int channel);
+
+    /**
+     * @brief Current source address of `channel`, for progress checks.
+     */
+    uint32_t dma_current_src(int channel);
+
+    /**
+     * @brief PL080 interrupt handler, called from irq_handler().
+     */
+    void dma_irq_handler(void);
+
+#ifdef __cplusplus
+}
+#endif
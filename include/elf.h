@@ -0,0 +1,107 @@
+/**
+ * @file elf.h
+ * @brief ELF32 ARM executables: header layout, validation and loading into a task.
+ *
+ * elf_load() never copies a segment up front. Read-only PT_LOAD pages
+ * whose bytes sit page-aligned inside the image are mapped straight onto
+ * it, so an image that is itself page-aligned in RAM (e.g. embedded in
+ * the kernel) is shared by every task running it. Every other page
+ * (writable data, .bss, pages straddling the end of the file bytes) is
+ * recorded as a lazy segment of the task and filled by task_abort() the
+ * first time the program touches it.
+ *
+ * The image must therefore stay in place until task_join().
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errno.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EI_NIDENT      16u
+#define ELFMAG         "\177ELF"
+#define ELFCLASS32     1u
+#define ELFDATA2LSB    1u
+#define EV_CURRENT     1u
+#define ET_EXEC        2u
+#define EM_ARM         40u
+
+#define PT_NULL        0u
+#define PT_LOAD        1u
+
+#define PF_X           (1u << 0)
+#define PF_W           (1u << 1)
+#define PF_R           (1u << 2)
+
+#define ELF_PHNUM_MAX  8u   /**< Program headers accepted per image. */
+
+    /**
+     * @brief ELF32 file header.
+     */
+    struct elf32_ehdr
+    {
+        uint8_t  e_ident[EI_NIDENT];
+        uint16_t e_type;
+        uint16_t e_machine;
+        uint32_t e_version;
+        uint32_t e_entry;
+        uint32_t e_phoff;
+        uint32_t e_shoff;
+        uint32_t e_flags;
+        uint16_t e_ehsize;
+        uint16_t e_phentsize;
+        uint16_t e_phnum;
+        uint16_t e_shentsize;
+        uint16_t e_shnum;
+        uint16_t e_shstrndx;
+    };
+
+    /**
+     * @brief ELF32 program header.
+     */
+    struct elf32_phdr
+    {
+        uint32_t p_type;
+        uint32_t p_offset;
+        uint32_t p_vaddr;
+        uint32_t p_paddr;
+        uint32_t p_filesz;
+        uint32_t p_memsz;
+        uint32_t p_flags;
+        uint32_t p_align;
+    };
+
+    _Static_assert(sizeof(struct elf32_ehdr) == 52, "ELF32 header layout");
+    _Static_assert(sizeof(struct elf32_phdr) == 32, "ELF32 program header layout");
+
+    struct task;
+
+    /**
+     * @brief Check that `image` is a loadable ELF32 ARM executable.
+     *
+     * Every PT_LOAD must lie inside the file, below the task stack in the
+     * user window, with p_vaddr and p_offset congruent modulo PAGE_SIZE
+     * and no page shared with another segment; the entry point must be in
+     * an executable one.
+     *
+     * @return KERR_INVAL for a malformed or foreign header or segment,
+     *         KERR_NO_SPACE for more segments than a task can track.
+     */
+    kerror_t elf_check(const void *image, size_t size);
+
+    /**
+     * @brief Map the PT_LOAD segments of a checked image into `task`.
+     *
+     * Sets task->entry. Pages mapped in place stay owned by the image.
+     */
+    kerror_t elf_load(struct task *task, const void *image, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
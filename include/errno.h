@@ -23,6 +23,10 @@ typedef enum kerror_code : int32_t
     KERR_NOMEM     = -2,  /**< code -2 if out of memory**/
     KERR_NO_SPACE  = -3,  /**< code -3 if out of space**/
     KERR_INVAL     = -4,  /**< code -4 if invalid request**/
+    KERR_BUSY      = -5,  /**< code -5 if resource busy**/
+    KERR_IO        = -6,  /**< code -6 if hardware I/O error**/
+    KERR_NOSYS     = -7,  /**< code -7 if no such system call**/
+    KERR_FAULT     = -8,  /**< code -8 if bad address**/
 } kerror_t;
 
 /**
@@ -0,0 +1,140 @@
+/**
+ * @file fiber.h
+ * @brief Stackful cooperative fibers for I/O-bound kernel tasks.
+ *
+ * Fibers run inside one host thread, the one that calls fiber_run(), and
+ * only switch when they call fiber_yield(), fiber_await() or return. A
+ * switch saves the callee-saved registers and moves the stack pointer
+ * (the same code as context_switch()); it never enters the thread
+ * scheduler.
+ *
+ * A fiber waiting on a fiber_event is off the ready list. When every
+ * fiber waits, the host thread blocks, so idle fibers cost nothing until
+ * an interrupt signals their event: UART receive (uart_rx_event()) and
+ * kernel timers (fiber_sleep_ms(), or fiber_event_signal() from any
+ * ktimer callback) are the usual sources.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ktimer.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Default fiber stack. IRQs run on the interrupted stack, so keep ~1 KiB spare. */
+#define FIBER_STACK_DEFAULT 2048u
+#define FIBER_STACK_MIN     1024u
+#define FIBER_NAME_MAX      12u
+
+    /**
+     * @enum fiber_state_t
+     * @brief Life cycle of a fiber.
+     */
+    typedef enum fiber_state : uint8_t
+    {
+        FIBER_READY,    /**< On the ready list. */
+        FIBER_RUNNING,  /**< Executing. */
+        FIBER_WAITING,  /**< Parked on a fiber_event. */
+        FIBER_DEAD      /**< Returned; freed by fiber_run(). */
+    } fiber_state_t;
+
+    typedef void (*fiber_fn_t)(void *arg);
+
+    struct fiber_event;
+
+    /**
+     * @brief Fiber control block.
+     */
+    struct fiber
+    {
+        uint32_t          *sp;    /**< Saved stack pointer (must stay first, used by context.s). */
+        struct fiber      *next;  /**< Ready list or event waiter link. */
+        fiber_state_t      state;
+        fiber_fn_t         fn;
+        void              *arg;
+        void              *stack;
+        size_t             stack_size;
+        struct ktimer      timer; /**< Drives fiber_sleep_ms(). */
+        char               name[FIBER_NAME_MAX];
+    };
+
+    /**
+     * @brief Something fibers wait for, signaled from IRQ or thread context.
+     *
+     * A signal wakes every waiting fiber. With no waiter it is latched and
+     * the next fiber_await() returns at once, so a signal that races ahead
+     * of the wait is never lost.
+     */
+    struct fiber_event
+    {
+        struct fiber *waiters;
+        volatile bool pending;
+    };
+
+#define FIBER_EVENT_INIT { .waiters = NULL, .pending = false }
+
+    /**
+     * @brief Create a ready fiber.
+     *
+     * @param name       Name, truncated to FIBER_NAME_MAX - 1 characters.
+     * @param fn         Entry point; returning from it ends the fiber.
+     * @param arg        Passed to `fn`.
+     * @param stack_size Stack bytes, 0 for FIBER_STACK_DEFAULT; at least FIBER_STACK_MIN.
+     *
+     * @return The fiber. It is freed by fiber_run() once it returns.
+     */
+    struct fiber *fiber_create(const char *name, fiber_fn_t fn, void *arg, size_t stack_size);
+
+    /**
+     * @brief Run fibers on the calling thread until all of them have returned.
+     *
+     * Blocks the thread while every fiber is waiting.
+     */
+    void fiber_run(void);
+
+    /**
+     * @brief The running fiber, NULL outside fibers.
+     */
+    struct fiber *fiber_current(void);
+
+    /**
+     * @brief Switch to the next ready fiber, if any. The caller stays ready.
+     */
+    void fiber_yield(void);
+
+    /**
+     * @brief Wait until `ev` is signaled, or consume a latched signal.
+     */
+    void fiber_await(struct fiber_event *ev);
+
+    /**
+     * @brief Wake every fiber waiting on `ev`, or latch the signal. IRQ-safe.
+     */
+    void fiber_event_signal(struct fiber_event *ev);
+
+    /**
+     * @brief Wait for at least `ms` milliseconds on the kernel timer wheel.
+     */
+    void fiber_sleep_ms(uint32_t ms);
+
+    /**
+     * @brief Read UART input, waiting on the RX interrupt while none is pending.
+     *
+     * @return Number of bytes copied into `buf` (at least 1).
+     */
+    size_t fiber_uart_read(char *buf, size_t len);
+
+    /**
+     * @brief Fiber switch, shares its code with context_switch() in context.s.
+     */
+    void fiber_switch(struct fiber *prev, struct fiber *next);
+
+#ifdef __cplusplus
+}
+#endif
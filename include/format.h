@@ -0,0 +1,158 @@
+/**
+ * @file format.h
+ * @brief printf-style formatting core with pluggable output sinks.
+ *
+ * vsnformat() parses a format string once and hands its output to a sink
+ * in chunks of up to FMT_CHUNK bytes, so a UART sink pays one ring write
+ * per chunk instead of one per character and a buffer sink is a plain copy.
+ *
+ * Supported conversions: `%d %i %u %x %X %p %s %c %%`, with flags `-` and
+ * `0`, a field width, a precision (`.N`, or `*` for either taken from the
+ * arguments) and the length modifiers `hh h l ll z t`.
+ */
+#pragma once
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Bytes staged before the sink is called. */
+#define FMT_CHUNK 64u
+
+    struct ringbuf;
+
+    /**
+     * @enum fmt_flag_t
+     * @brief Flags of one conversion specification.
+     */
+    typedef enum fmt_flag : uint32_t
+    {
+        FLAG_LONG      = 1u << 0, /**< 'l' length modifier. */
+        FLAG_LONGLONG  = 1u << 1, /**< 'll' length modifier. */
+        FLAG_SIZE      = 1u << 2, /**< 'z' / 't' length modifier. */
+        FLAG_UPPERCASE = 1u << 3, /**< Uppercase hex digits (for %X). */
+        FLAG_LEFT      = 1u << 4, /**< '-': left-justify in the field. */
+        FLAG_ZERO      = 1u << 5, /**< '0': pad numbers with zeros. */
+        FLAG_PRECISION = 1u << 6, /**< A precision was given. */
+        FLAG_CHAR      = 1u << 7, /**< 'hh' length modifier. */
+        FLAG_SHORT     = 1u << 8  /**< 'h' length modifier. */
+    } fmt_flag_t;
+
+    /**
+     * @struct fmt_spec_t
+     * @brief One parsed conversion specification.
+     */
+    typedef struct
+    {
+        fmt_flag_t flags;     /**< Flags and length modifiers. */
+        uint32_t   width;     /**< Minimum field width. */
+        uint32_t   precision; /**< Digits for numbers, max bytes for %s. */
+    } fmt_spec_t;
+
+    typedef struct fmt_sink fmt_sink_t;
+
+    /**
+     * @brief Sink callback: consume `len` formatted bytes.
+     */
+    typedef void (*fmt_write_fn_t)(fmt_sink_t *sink, const char *data, size_t len);
+
+    /**
+     * @struct fmt_sink
+     * @brief Destination of formatted output.
+     *
+     * Build one with fmt_sink_buffer(), fmt_sink_uart() or fmt_sink_ring(),
+     * or fill in `write` (and `ctx`) for a custom destination.
+     */
+    struct fmt_sink
+    {
+        fmt_write_fn_t write;   /**< Chunk consumer. */
+        void          *ctx;     /**< Sink-specific destination. */
+        size_t         size;    /**< Buffer sink: capacity including the NUL. */
+        size_t         pos;     /**< Buffer sink: bytes stored so far. */
+        size_t         dropped; /**< Bytes the sink could not take. */
+    };
+
+    /**
+     * @brief Sink that stores into `buf`, truncating to `size - 1` bytes.
+     *
+     * The caller terminates the string (snprintf() does).
+     */
+    fmt_sink_t fmt_sink_buffer(char *buf, size_t size);
+
+    /**
+     * @brief Sink that queues output on the UART0 TX ring.
+     */
+    fmt_sink_t fmt_sink_uart(void);
+
+    /**
+     * @brief Sink that appends to a ring buffer as a multi-producer writer.
+     *
+     * Each chunk is written whole or counted in `dropped`.
+     */
+    fmt_sink_t fmt_sink_ring(struct ringbuf *ring);
+
+    /**
+     * @brief Convert an unsigned value to text without dividing.
+     *
+     * Digits are written backwards ending just before `end`; no NUL is
+     * added. 24 bytes always suffice.
+     *
+     * @param end       One past the last byte of the output buffer.
+     * @param value     Value to convert.
+     * @param base      10 or 16.
+     * @param uppercase Uppercase hex digits.
+     *
+     * @return Pointer to the first digit.
+     */
+    char *fmt_utoa(char *end, unsigned long long value, unsigned base, bool uppercase);
+
+    /**
+     * @brief Format into a sink.
+     *
+     * @param sink Output destination.
+     * @param fmt  Format string.
+     * @param args Arguments matching the conversions in `fmt`.
+     *
+     * @return Number of bytes produced, whether or not the sink kept them.
+     */
+    int vsnformat(fmt_sink_t *sink, const char *fmt, va_list args);
+
+    /**
+     * @brief vsnformat() with variadic arguments.
+     */
+    int snformat(fmt_sink_t *sink, const char *fmt, ...);
+
+    /**
+     * @brief Format from raw argument words instead of a `va_list`.
+     *
+     * Each argument occupies one 32-bit word, except `ll` integers which
+     * take two (low word first). Used to format deferred log records.
+     * Missing words read as 0.
+     *
+     * @param sink   Output destination.
+     * @param fmt    Format string.
+     * @param words  Argument words.
+     * @param nwords Number of words in `words`.
+     *
+     * @return Number of bytes produced.
+     */
+    int vsnformat_words(fmt_sink_t *sink, const char *fmt, const uint32_t *words, uint32_t nwords);
+
+    /**
+     * @brief Work out how many arguments `fmt` consumes and which are 64-bit.
+     *
+     * @param fmt       Format string.
+     * @param wide_mask Receives bit i set if argument i is 64-bit (first 32 arguments).
+     *
+     * @return Number of arguments, `*` widths and precisions included.
+     */
+    uint32_t fmt_arg_layout(const char *fmt, uint32_t *wide_mask);
+
+#ifdef __cplusplus
+}
+#endif
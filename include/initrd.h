@@ -0,0 +1,71 @@
+/**
+ * @file initrd.h
+ * @brief Read-only initial ramdisk linked into the kernel image.
+ *
+ * The Makefile packs the `initrd/` directory into a ustar archive and
+ * objcopy turns it into a `.initrd` section, placed by kernel.ld between
+ * __initrd_start and __initrd_end. initrd_init() walks the archive once
+ * and builds an open-addressing hash index over the regular files, so
+ * initrd_open() is O(1) on average instead of a scan of the headers.
+ *
+ * Nothing is copied: file names and contents are read where they sit in
+ * the image, and initrd_map() hands out a pointer straight into it.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errno.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief One regular file of the archive.
+     */
+    struct initrd_file
+    {
+        const char *name;  /**< Path without a leading "./", inside the image. */
+        const void *data;  /**< Contents, inside the image (512-byte aligned). */
+        uint32_t    size;
+        uint32_t    hash;  /**< FNV-1a of `name`. */
+    };
+
+    /**
+     * @brief Validate the archive and build the file index. Needs kmalloc.
+     *
+     * @return KERR_IO for a corrupt archive (bad magic or checksum),
+     *         KERR_NOMEM if the index cannot be allocated.
+     */
+    kerror_t initrd_init(void);
+
+    /**
+     * @brief Look a file up by path; a leading '/' is ignored.
+     *
+     * @return The file, or NULL if there is no such regular file.
+     */
+    const struct initrd_file *initrd_open(const char *path);
+
+    /**
+     * @brief Contents of `file`, in place.
+     *
+     * @param size Set to the file size if not NULL.
+     */
+    const void *initrd_map(const struct initrd_file *file, size_t *size);
+
+    /**
+     * @brief Number of indexed files.
+     */
+    uint32_t initrd_count(void);
+
+    /**
+     * @brief File `i` in archive order (sorted by path), NULL past the end.
+     */
+    const struct initrd_file *initrd_at(uint32_t i);
+
+#ifdef __cplusplus
+}
+#endif
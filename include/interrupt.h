@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -8,6 +9,7 @@ extern "C"
 #endif
 
 extern volatile uint64_t systicks;
+extern volatile uint32_t irq_nesting; // > 0 while irq_handler() runs
 
 // PL190 VIC (interrupt controller)
 // ref: PrimeCell Vectored Interrupt Controller (PL190) TRM (Page3-7)
@@ -22,6 +24,13 @@ extern volatile uint64_t systicks;
 #define VIC_VECTADDR    (*(volatile uint32_t *)(VIC_BASE + 0x030))
 #define VIC_DEFVECTADDR (*(volatile uint32_t *)(VIC_BASE + 0x034))
 
+// Versatile secondary interrupt controller, cascaded into VIC line 31
+#define SIC_BASE        0x10003000u
+#define SIC_STATUS      (*(volatile uint32_t *)(SIC_BASE + 0x000)) // masked status
+#define SIC_ENSET       (*(volatile uint32_t *)(SIC_BASE + 0x008))
+#define SIC_ENCLR       (*(volatile uint32_t *)(SIC_BASE + 0x00C))
+#define SIC_PICENCLR    (*(volatile uint32_t *)(SIC_BASE + 0x024)) // 21-30: no direct VIC route
+
 // SP804 Timer0 in the 0/1 block
 // ref: ARM Dual-Time Module (SP804) TRM (Page 3-2)
 #define T01_BASE    0x101E2000u
@@ -29,26 +38,139 @@ extern volatile uint64_t systicks;
 #define T0_VALUE    (*(volatile uint32_t *)(T01_BASE + 0x04))
 #define T0_CONTROL  (*(volatile uint32_t *)(T01_BASE + 0x08))
 #define T0_INTCLR   (*(volatile uint32_t *)(T01_BASE + 0x0C))
+#define T0_RIS      (*(volatile uint32_t *)(T01_BASE + 0x10))
 #define T0_MIS      (*(volatile uint32_t *)(T01_BASE + 0x14))
 
+// SP804 Timer1, second channel of the same block (shares IRQ line with Timer0)
+#define T1_LOAD     (*(volatile uint32_t *)(T01_BASE + 0x20))
+#define T1_VALUE    (*(volatile uint32_t *)(T01_BASE + 0x24))
+#define T1_CONTROL  (*(volatile uint32_t *)(T01_BASE + 0x28))
+#define T1_INTCLR   (*(volatile uint32_t *)(T01_BASE + 0x2C))
+#define T1_RIS      (*(volatile uint32_t *)(T01_BASE + 0x30))
+#define T1_MIS      (*(volatile uint32_t *)(T01_BASE + 0x34))
+
 // Bits for CONTROL (SP804)
 // ref: ARM Dual-Time Module (SP804) TRM (Page 3-5)
 #define TCTRL_ENABLE    (1u << 7)   // EN=bit7
 #define TCTRL_PERIODIC  (1u << 6)   // PERIODIC=bit6
 #define TCTRL_INTEN     (1u << 5)   // INTEN=bit5
 #define TCTRL_32BIT     (1u << 1)   // 32BIT=bit1
+#define TCTRL_ONESHOT   (1u << 0)   // ONESHOT=bit0
 
-// VIC line number for Timer0/1 on Versatile
+// VIC line numbers on Versatile
 #define IRQ_TIMER01 4
+#define IRQ_UART0   12
+#define IRQ_DMA     17
+#define IRQ_SIC     31
+
+// SIC line numbers on Versatile
+#define SIC_IRQ_MMCI0 22
+
+// CPSR interrupt mask bits
+#define CPSR_IRQ_MASK (1u << 7)
+#define CPSR_FIQ_MASK (1u << 6)
 
     /**
      * @brief C-level IRQ handler called from assembly stub in start.s
      *   Must clear the source interrupt and (for VIC) write VIC_VECTADDR to ack end of interrupt.
     */
     void irq_handler(void);
+
+    /**
+     * @brief C-level prefetch/data abort handler, called on the ABT stack from start.s.
+     *
+     * Only for aborts taken in a privileged mode; USR-mode aborts go to
+     * task_abort() (task.h).
+     *
+     * Reports the fault, naming the stack when the address falls in a
+     * guard page (kstack.h), and panics.
+     *
+     * @param is_data 1 for a data abort, 0 for a prefetch abort.
+     * @param spsr    CPSR of the aborted code.
+     * @param frame   Saved R0-R12, then the address of the aborting instruction.
+     */
+    [[noreturn]] void abort_handler(uint32_t is_data, uint32_t spsr, const uint32_t *frame);
     void irq_enable(void);
     void irq_disable(void);
 
+    /**
+     * @brief Mask IRQs and return the previous CPSR so it can be restored.
+     *
+     * Unlike irq_disable()/irq_enable(), save/restore pairs nest correctly:
+     * an inner pair never unmasks IRQs that an outer caller had masked.
+     *
+     * @return The CPSR value before masking.
+     */
+    static inline uint32_t irq_save(void)
+    {
+        uint32_t flags;
+        __asm__ volatile(
+            "mrs    %0, cpsr\n\t"
+            "cpsid  i"
+            : "=r"(flags)
+            :
+            : "memory");
+        return flags;
+    }
+
+    /**
+     * @brief Restore the IRQ mask state saved by irq_save().
+     *
+     * @param flags Value returned by the matching irq_save().
+     */
+    static inline void irq_restore(uint32_t flags)
+    {
+        __asm__ volatile("msr cpsr_c, %0" : : "r"(flags) : "memory");
+    }
+
+    /**
+     * @brief Whether IRQs are currently masked on this CPU.
+     */
+    static inline bool irq_masked(void)
+    {
+        uint32_t cpsr;
+        __asm__ volatile("mrs %0, cpsr" : "=r"(cpsr) : : "memory");
+        return (cpsr & CPSR_IRQ_MASK) != 0;
+    }
+
+    /**
+     * @brief Whether the caller runs inside irq_handler().
+     *
+     * IRQs are serviced in SVC mode on the interrupted stack, so the CPSR
+     * mode cannot tell; irq_handler() keeps a nesting count instead.
+     */
+    static inline bool in_irq(void)
+    {
+        return irq_nesting != 0;
+    }
+
+    /**
+     * @brief Whether IRQs were masked in a value returned by irq_save().
+     */
+    static inline bool irq_flags_masked(uint32_t flags)
+    {
+        return (flags & CPSR_IRQ_MASK) != 0;
+    }
+
+    /**
+     * @brief Hook that takes over Timer0 interrupts from the kernel tick.
+     *
+     * @param entry_value  T0_VALUE sampled on entry to irq_handler(), before
+     *                     any other work, so `LOAD - entry_value` is the
+     *                     expiry-to-handler latency in timer ticks.
+     * @param entry_cycles PMU cycle counter (pmu.h) sampled just before it.
+     */
+    typedef void (*timer0_hook_t)(uint32_t entry_value, uint32_t entry_cycles);
+
+    /**
+     * @brief Route Timer0 interrupts to `hook` instead of the kernel tick.
+     *
+     * While a hook is installed systicks and ktimers do not advance.
+     * Pass NULL to give Timer0 back to the tick (re-arm it with
+     * interrupts_init_timer0()).
+     */
+    void interrupts_set_timer0_hook(timer0_hook_t hook);
+
     /**
      * @brief VersatilePB SP804 timer clock is typically 1 MHz (can be overridden)
      *
@@ -65,6 +187,22 @@ extern volatile uint64_t systicks;
         T0_CONTROL  = TCTRL_32BIT | TCTRL_PERIODIC | TCTRL_INTEN | TCTRL_ENABLE;
     }
 
+    static inline void vic_enable_irq(uint32_t line)
+    {
+        VIC_INTSELECT   &= ~(1u << line);  // route to IRQ
+        VIC_INTENABLE   |=  (1u << line);
+    }
+
+    /**
+     * @brief Enable a SIC line through the cascade into VIC line IRQ_SIC.
+     */
+    static inline void sic_enable_irq(uint32_t line)
+    {
+        SIC_PICENCLR = 1u << line;
+        SIC_ENSET    = 1u << line;
+        vic_enable_irq(IRQ_SIC);
+    }
+
     static inline void vic_enable_timer01_irq(void)
     {
         VIC_INTSELECT   &= ~(1u << IRQ_TIMER01);  // route to IRQ
@@ -0,0 +1,102 @@
+/**
+ * @file klog.h
+ * @brief Deferred binary kernel log.
+ *
+ * A deferred log call does not format anything. It appends a binary record
+ * to a lock-free multi-producer ring: the format string pointer, a
+ * clocksource timestamp, the level and the raw argument words. The ring is
+ * formatted later by klog_drain(), off the hot path, and flushed by
+ * kernel_panic().
+ *
+ * Each call site owns a small static descriptor holding the argument
+ * layout of its format string (which arguments are 64-bit), computed on
+ * first use. Recording then only copies words.
+ *
+ * When the ring is full the record is dropped and counted; logging never
+ * blocks.
+ *
+ * @note `%s` records the pointer, not the characters: only pass strings
+ *       that outlive the record (literals, static tables).
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of the record ring in bytes (power of two). */
+#ifndef KLOG_RING_SIZE
+#define KLOG_RING_SIZE 8192u
+#endif
+
+/** Most argument words one record carries; extra arguments read as 0. */
+#define KLOG_MAX_WORDS 16u
+
+/** `nargs` value of a site whose layout has not been computed yet. */
+#define KLOG_SITE_UNKNOWN 0xFFu
+
+    /**
+     * @brief Per call site argument layout, filled in on first use.
+     */
+    struct klog_site
+    {
+        const char      *fmt;   /**< Format string of the call site. */
+        uint32_t         wide;  /**< Bit i set if argument i is 64-bit. */
+        volatile uint8_t nargs; /**< Argument count, or KLOG_SITE_UNKNOWN. */
+    };
+
+    /**
+     * @brief Binary record header, followed by `nwords` argument words.
+     */
+    typedef struct
+    {
+        const char *fmt;    /**< Format string (in the kernel image). */
+        uint32_t    ts_lo;  /**< Clocksource cycles, low word. */
+        uint32_t    ts_hi;  /**< Clocksource cycles, high word. */
+        uint8_t     level;  /**< klog_level_t. */
+        uint8_t     nwords; /**< Argument words that follow. */
+        uint16_t    reserved;
+    } klog_rec_t;
+
+    /**
+     * @brief Append a record for `site`. Use KLOG_DEFER() instead.
+     */
+    void klog_record(struct klog_site *site, uint32_t level, ...);
+
+    /**
+     * @brief Format up to `max` pending records to the UART.
+     *
+     * Reports how many records were dropped since the last drain. Single
+     * consumer: call from one context only.
+     *
+     * @return Number of records formatted.
+     */
+    uint32_t klog_drain(uint32_t max);
+
+    /**
+     * @brief Drain everything, with output forced synchronous. Panic path.
+     */
+    void klog_flush(void);
+
+    /**
+     * @brief Records dropped because the ring was full, since boot.
+     */
+    uint32_t klog_dropped(void);
+
+/**
+ * @brief Record a deferred log entry. `format` must be a string literal.
+ */
+#define KLOG_DEFER(level, format, ...)                                        \
+    do                                                                        \
+    {                                                                         \
+        static struct klog_site klog_site_ = {                                \
+            .fmt = (format), .nargs = KLOG_SITE_UNKNOWN                       \
+        };                                                                    \
+        klog_record(&klog_site_, (uint32_t)(level), ##__VA_ARGS__);           \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file kstack.h
+ * @brief Processor-mode stacks: canary fill, high-water marks and guard pages.
+ *
+ * kernel.ld lays out one stack per processor mode: the SVC stack at the
+ * top of RAM and the IRQ, FIQ, ABT and UND stacks in `.stacks`. Each one
+ * starts on a page boundary right above a 4 KiB guard page, and its size
+ * budget is rounded up to whole pages; the slack above the budget absorbs
+ * a small overrun before the guard does.
+ *
+ * start.s fills every stack with KSTACK_CANARY before kernel_main(), so
+ * the deepest word ever written is the lowest one that no longer holds
+ * the pattern. mmu_init() unmaps the guard pages, after which an overflow
+ * takes a data abort (reported by abort_handler()) instead of running
+ * into `.bss` or the heap.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Fill pattern of unused stack words; start.s writes the same literal. */
+#define KSTACK_CANARY 0x57AC57ACu
+
+    /**
+     * @enum kstack_id_t
+     * @brief The stack of each processor mode the kernel uses.
+     */
+    typedef enum kstack_id : uint8_t
+    {
+        KSTACK_SVC,  /**< Boot thread and exception entry (irq_entry runs here). */
+        KSTACK_IRQ,
+        KSTACK_FIQ,
+        KSTACK_ABT,  /**< abort_handler() runs here. */
+        KSTACK_UND,
+        KSTACK_COUNT
+    } kstack_id_t;
+
+    /**
+     * @brief Layout and usage of one stack.
+     */
+    struct kstack_usage
+    {
+        const char *name;
+        uintptr_t   bottom;  /**< Lowest address; the guard page sits below it. */
+        uintptr_t   top;     /**< Initial stack pointer. */
+        uint32_t    budget;  /**< Size reserved by kernel.ld. */
+        uint32_t    used;    /**< High-water mark in bytes. */
+        bool        guarded; /**< Guard page unmapped. */
+    };
+
+    /**
+     * @brief Unmap the guard page below every stack. Called by mmu_init().
+     */
+    void kstack_guard_init(void);
+
+    /**
+     * @brief Scan stack `id` for its high-water mark.
+     *
+     * @return false for an invalid `id`.
+     */
+    bool kstack_usage(kstack_id_t id, struct kstack_usage *out);
+
+    /**
+     * @brief Stack whose guard page contains `addr`, KSTACK_COUNT if none.
+     */
+    kstack_id_t kstack_guarding(uintptr_t addr);
+
+    /**
+     * @brief Print the usage of every stack.
+     */
+    void kstack_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
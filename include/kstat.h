@@ -0,0 +1,110 @@
+/**
+ * @file kstat.h
+ * @brief Kernel statistics registry: named counters and gauges in a linker section.
+ *
+ * A subsystem defines its statistics at file scope,
+ *
+ *     KSTAT_DEFINE(irq_timer_count);
+ *     KSTAT_GAUGE_DEFINE(mem_used_bytes);
+ *
+ * and bumps them with kstat_inc(irq_timer_count). Each definition is a
+ * struct kstat placed in its own `.kstat.<name>` input section; kernel.ld
+ * gathers them, sorted by name, between __kstat_start and __kstat_end,
+ * so the registry is a plain array that needs no registration call and
+ * no lookup on the update path.
+ *
+ * kstat_inc()/kstat_add() are a single non-atomic add: use them where a
+ * statistic has one writer (one IRQ handler, code that runs with IRQs
+ * masked or preemption off). Statistics bumped from both thread and IRQ
+ * context take kstat_add_atomic(). Values are 32 bits, so reads never
+ * tear and deltas survive wrap-around.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "atomic.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @enum kstat_kind_t
+     * @brief How a statistic is read.
+     */
+    typedef enum kstat_kind : uint8_t
+    {
+        KSTAT_COUNTER, /**< Only grows; dumps can show the change since the last one. */
+        KSTAT_GAUGE    /**< Current level, may go down; shown signed. */
+    } kstat_kind_t;
+
+    /**
+     * @brief One registered statistic.
+     */
+    struct kstat
+    {
+        volatile uint32_t value;
+        uint32_t          last;  /**< Value at the previous kstat_delta(). */
+        const char       *name;
+        kstat_kind_t      kind;
+    };
+
+    _Static_assert(sizeof(struct kstat) == 16, "kstat entries are packed back to back by kernel.ld");
+
+#define KSTAT_DEFINE_KIND(name_, kind_)                                            \
+    __attribute__((section(".kstat." #name_), used, aligned(4))) struct kstat kstat_##name_ = \
+        { .value = 0, .last = 0, .name = #name_, .kind = (kind_) }
+
+/** Define a counter named `name_`. */
+#define KSTAT_DEFINE(name_)       KSTAT_DEFINE_KIND(name_, KSTAT_COUNTER)
+
+/** Define a gauge named `name_`. */
+#define KSTAT_GAUGE_DEFINE(name_) KSTAT_DEFINE_KIND(name_, KSTAT_GAUGE)
+
+/** Use a statistic defined in another file. */
+#define KSTAT_DECLARE(name_)      extern struct kstat kstat_##name_
+
+#define kstat_inc(name_)          ((void)(kstat_##name_.value += 1u))
+#define kstat_add(name_, n_)      ((void)(kstat_##name_.value += (uint32_t)(n_)))
+#define kstat_sub(name_, n_)      ((void)(kstat_##name_.value -= (uint32_t)(n_)))
+#define kstat_set(name_, v_)      ((void)(kstat_##name_.value = (uint32_t)(v_)))
+#define kstat_read(name_)         (kstat_##name_.value)
+
+/** Add from any context: LDREX/STREX, no ordering. */
+#define kstat_add_atomic(name_, n_) \
+    ((void)atomic32_fetch_add_relaxed(&kstat_##name_.value, (uint32_t)(n_)))
+
+    /**
+     * @brief Number of registered statistics.
+     */
+    uint32_t kstat_count(void);
+
+    /**
+     * @brief Statistic `i` in name order, NULL past the end.
+     */
+    struct kstat *kstat_at(uint32_t i);
+
+    /**
+     * @brief Look a statistic up by name (binary search).
+     */
+    struct kstat *kstat_find(const char *name);
+
+    /**
+     * @brief Change of a counter since the previous call, which it records.
+     */
+    uint32_t kstat_delta(struct kstat *k);
+
+    /**
+     * @brief Print every statistic whose name starts with `prefix`.
+     *
+     * @param delta  Also show, and record, each counter's change since the last delta dump.
+     * @param prefix Name filter, NULL or "" for all.
+     */
+    void kstat_dump(bool delta, const char *prefix);
+
+#ifdef __cplusplus
+}
+#endif
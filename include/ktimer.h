@@ -0,0 +1,132 @@
+/**
+ * @file ktimer.h
+ * @brief Kernel timers backed by a hierarchical timing wheel.
+ *
+ * Timers are expressed in ticks of the Timer0 periodic interrupt
+ * (KTIMER_HZ per second). Insertion and cancellation are O(1): a timer is
+ * hashed into one of five wheels by how far in the future it expires, and
+ * far-away timers are cascaded into finer wheels as time advances.
+ *
+ * Callbacks run from the tick interrupt (IRQ context, IRQs masked) and
+ * must therefore be short and must not block.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Frequency of the kernel tick driving the timing wheel. */
+#define KTIMER_HZ 100u
+
+    struct ktimer;
+
+    /**
+     * @brief Timer expiry callback.
+     *
+     * @param timer The timer that expired.
+     * @param arg   User argument given to ktimer_init().
+     */
+    typedef void (*ktimer_fn_t)(struct ktimer *timer, void *arg);
+
+    /**
+     * @brief Intrusive list link used by the timing wheel slots.
+     */
+    struct ktimer_link
+    {
+        struct ktimer_link *next;
+        struct ktimer_link *prev;
+    };
+
+    /**
+     * @brief A kernel timer. Embed it in the owning object; no allocation.
+     */
+    struct ktimer
+    {
+        struct ktimer_link link;    /**< Wheel slot linkage (must stay first). */
+        uint32_t           expires; /**< Absolute expiry tick. */
+        uint32_t           period;  /**< Re-arm interval in ticks, 0 for one-shot. */
+        ktimer_fn_t        fn;      /**< Expiry callback. */
+        void              *arg;     /**< Callback argument. */
+    };
+
+    /**
+     * @brief Initialize a timer before first use.
+     *
+     * @param timer Timer to initialize.
+     * @param fn    Callback run on expiry.
+     * @param arg   Argument passed to the callback.
+     */
+    void ktimer_init(struct ktimer *timer, ktimer_fn_t fn, void *arg);
+
+    /**
+     * @brief Arm a one-shot timer `delay` ticks from now.
+     *
+     * @note A delay of 0 fires on the next tick. Arming an already pending
+     *       timer re-arms it (same as ktimer_mod()).
+     */
+    void ktimer_add(struct ktimer *timer, uint32_t delay);
+
+    /**
+     * @brief Arm a periodic timer firing every `period` ticks.
+     *
+     * The timer is re-armed relative to its previous expiry, so it does not
+     * drift when a callback runs late.
+     */
+    void ktimer_add_periodic(struct ktimer *timer, uint32_t period);
+
+    /**
+     * @brief Change the expiry of a timer to `delay` ticks from now.
+     *
+     * Keeps the timer's period. Works on both pending and idle timers.
+     *
+     * @return true if the timer was pending before the call.
+     */
+    bool ktimer_mod(struct ktimer *timer, uint32_t delay);
+
+    /**
+     * @brief Cancel a timer.
+     *
+     * Safe to call from the timer's own callback to stop a periodic timer.
+     *
+     * @return true if the timer was pending.
+     */
+    bool ktimer_del(struct ktimer *timer);
+
+    /**
+     * @brief Whether the timer is currently armed.
+     */
+    static inline bool ktimer_pending(const struct ktimer *timer)
+    {
+        return timer->link.next != NULL;
+    }
+
+    /**
+     * @brief Current wheel time in ticks.
+     */
+    uint32_t ktimer_now(void);
+
+    /**
+     * @brief Convert milliseconds to ticks, rounding up.
+     */
+    static inline uint32_t ktimer_ms_to_ticks(uint32_t ms)
+    {
+        // Split into whole seconds and remainder to stay in 32-bit math
+        return (ms / 1000u) * KTIMER_HZ + ((ms % 1000u) * KTIMER_HZ + 999u) / 1000u;
+    }
+
+    /**
+     * @brief Advance the wheel and run expired timers.
+     *
+     * Called by irq_handler() on every Timer0 tick.
+     */
+    void ktimer_tick(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,97 +1,153 @@
+/**
+ * @file math.h
+ * @brief Integer division without a hardware divider.
+ *
+ * The Cortex-A8 has no UDIV, so every `/` and `%` on a variable divisor
+ * becomes a call into the run-time helpers below (`__aeabi_uidivmod`,
+ * `__aeabi_uldivmod`, ...). They normalize with CLZ and only iterate over
+ * the quotient bits that can be set, so small quotients are cheap.
+ *
+ * udiv32() and udiv64() additionally take a reciprocal-multiply path when
+ * the divisor is a compile-time constant: 32-bit constants are left to
+ * the compiler (it already emits a multiply), 64-bit ones use
+ * udiv64_recip() with the reciprocal folded at compile time.
+ */
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include "panic.h"
 
-/**
- * @brief Unsigned 32-bit integer division: n / d
- *
- * @param n Numerator.
- * @param d Denominator.
- * 
- * @return uint32_t Quotient, discards remainder.
- *
- * @note If d == 0: kernel panic.
- *       Otherwise, returns the quotient and discards the remainder.
- */
-static inline uint32_t _udiv32(uint32_t n, uint32_t d)
+#ifdef __cplusplus
+extern "C"
 {
-    if (d == 0)
+#endif
+
+    /**
+     * @brief Unsigned 32-bit division with remainder.
+     *
+     * @param n   Dividend.
+     * @param d   Divisor; 0 is a kernel panic.
+     * @param rem Receives `n % d`, may be NULL.
+     *
+     * @return `n / d`.
+     */
+    uint32_t udivmod32(uint32_t n, uint32_t d, uint32_t *rem);
+
+    /**
+     * @brief Unsigned 64-bit division with remainder.
+     *
+     * Falls back to udivmod32() when both operands fit in 32 bits.
+     *
+     * @param n   Dividend.
+     * @param d   Divisor; 0 is a kernel panic.
+     * @param rem Receives `n % d`, may be NULL.
+     *
+     * @return `n / d`.
+     */
+    uint64_t udivmod64(uint64_t n, uint64_t d, uint64_t *rem);
+
+    // EABI run-time helpers the compiler calls for `/` and `%`.
+    // ref: Run-time ABI for the ARM Architecture, 4.3.1 Integer division
+    uint32_t __aeabi_uidiv(uint32_t n, uint32_t d);
+    uint64_t __aeabi_uidivmod(uint32_t n, uint32_t d); // r0 = quotient, r1 = remainder
+    int32_t  __aeabi_idiv(int32_t n, int32_t d);
+    uint64_t __aeabi_idivmod(int32_t n, int32_t d);   // r0 = quotient, r1 = remainder
+    void     __aeabi_uldivmod(void);                  // r0:r1 = quotient, r2:r3 = remainder
+
+    /**
+     * @brief High 64 bits of the 128-bit product `a * b`.
+     */
+    static inline uint64_t umulh64(uint64_t a, uint64_t b)
     {
-        kernel_panic("Division by zero in udiv32.", KERR_INVAL);
+        const uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+        const uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+
+        const uint64_t lo_lo = a_lo * b_lo;
+        const uint64_t lo_hi = a_lo * b_hi;
+        const uint64_t hi_lo = a_hi * b_lo;
+        const uint64_t mid   = (lo_lo >> 32) + (uint32_t)lo_hi + (uint32_t)hi_lo;
+
+        return a_hi * b_hi + (lo_hi >> 32) + (hi_lo >> 32) + (mid >> 32);
     }
 
-    uint32_t quotient  = 0;
-    uint32_t remainder = 0;
-    for (int i = 31; i >= 0; --i)
+    /**
+     * @brief Divide by `d` through its reciprocal `m = UINT64_MAX / d`.
+     *
+     * The estimate `umulh64(n, m)` is at most two below the quotient, so at
+     * most two correction steps follow. Pays off when `m` is a constant or
+     * is reused across many divisions by the same `d`.
+     */
+    static inline uint64_t udiv64_recip(uint64_t n, uint64_t d, uint64_t m)
     {
-        remainder = (remainder << 1) | ((n >> i) & 1u);
-        if (remainder >= d)
+        uint64_t q = umulh64(n, m);
+        uint64_t r = n - q * d;
+
+        while (r >= d)
         {
-            remainder -= d;
-            quotient  |= (1u << i);
+            q++;
+            r -= d;
         }
+        return q;
     }
-    return quotient;
-}
-// Note: This is a simple implementation and may not be the most efficient.
-// It is intended for educational purposes and may be replaced with
-// architecture-specific optimizations if needed.
 
-/**
- * @brief Perform division and return quotient and remainder.
- *
- * @note Kernel panic if division by zero
- * 
- * @param n Dividend.
- * @param d Divisor.
- * @param r Output parameter for remainder.
- * @return Quotient of n / d.
- */
-static inline unsigned long long _divmod(unsigned long long n, unsigned long long d, unsigned long long *r)
-{
-    if (d == 0)
+    /**
+     * @brief `n / d`, by multiplication when `d` is a compile-time constant.
+     */
+    static inline __attribute__((always_inline)) uint32_t udiv32(uint32_t n, uint32_t d)
     {
-        kernel_panic("_divmod: Division by zero", KERR_INVAL);
+        if (__builtin_constant_p(d) && d != 0)
+        {
+            return n / d; // folded into umull + shift by the compiler
+        }
+        return udivmod32(n, d, NULL);
     }
 
-    *r = n % d;
-    return n / d;
-}
-
-/**
- * @brief Perform binary long division on unsigned long long integers.
- *
- * @param dividend The number to be divided.
- * @param divisor The number to divide by.
- * @param remainder Pointer to store the remainder of the division.
- * @return The quotient of the division.
- *
- * @note Kernel panic if division by zero.
- */
-// unsigned long long _bdiv(unsigned long long dividend, unsigned long long divisor, unsigned long long *remainder)
-// {
-//     // TO-DO: Design a faster division algorithm
-//     if (divisor == 0)
-//     {
-//         kernel_panic("_bdiv: Division by zero", KERR_INVAL);
-//     }
-//     *remainder = 0;
-//     unsigned long long quotient = 0;
+    /**
+     * @brief `n / d`, by multiplication when `d` is a compile-time constant.
+     */
+    static inline __attribute__((always_inline)) uint64_t udiv64(uint64_t n, uint64_t d)
+    {
+        if (__builtin_constant_p(d) && d != 0)
+        {
+            return udiv64_recip(n, d, UINT64_MAX / d); // reciprocal folded at compile time
+        }
+        return udivmod64(n, d, NULL);
+    }
 
-//     for (int i = 63; i >= 0; i--)
-//     {
-//         quotient <<= 1;
-//         *remainder <<= 1;
-//         unsigned long long temp = (unsigned long long)1 << i; // Without this cast, the type is misinterpreted leading to UB
-//         *remainder |= (dividend & temp) >> i;
+    /**
+     * @brief Unsigned 32-bit integer division: n / d
+     *
+     * @param n Numerator.
+     * @param d Denominator.
+     *
+     * @return uint32_t Quotient, discards remainder.
+     *
+     * @note If d == 0: kernel panic.
+     */
+    static inline uint32_t _udiv32(uint32_t n, uint32_t d)
+    {
+        return udiv32(n, d);
+    }
 
-//         if (*remainder >= divisor)
-//         {
-//             *remainder -= divisor;
-//             quotient |= 1;
-//         }
-//     }
+    /**
+     * @brief Perform division and return quotient and remainder.
+     *
+     * @note Kernel panic if division by zero
+     *
+     * @param n Dividend.
+     * @param d Divisor.
+     * @param r Output parameter for remainder.
+     * @return Quotient of n / d.
+     */
+    static inline unsigned long long _divmod(unsigned long long n, unsigned long long d, unsigned long long *r)
+    {
+        uint64_t rem;
+        const uint64_t q = udivmod64(n, d, &rem);
+        *r = rem;
+        return q;
+    }
 
-//     return quotient;
-// }
\ No newline at end of file
+#ifdef __cplusplus
+}
+#endif
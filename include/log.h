@@ -3,16 +3,32 @@
  * @brief Minimal kernel logging helpers.
  *
  * Provides a tiny logging macro that prefixes messages with a level string.
- * Optionally includes a tick count when KLOG_USE_TICKS is defined.
+ * Optionally includes a monotonic timestamp (microseconds, from the
+ * clocksource) when KLOG_USE_TICKS is defined.
+ *
+ * With KLOG_BINARY defined, KLOG records binary entries into the deferred
+ * log (see klog.h) and formatting happens in klog_drain(). KLOG_SYNC
+ * always formats immediately and unfiltered; the panic path uses it.
+ *
+ * Filtering happens twice, both before any argument is evaluated:
+ * - At compile time, calls below KLOG_MIN_LEVEL (e.g.
+ *   `-DKLOG_MIN_LEVEL=KLOG_WARN`) are dead code and disappear.
+ * - At run time, each subsystem has a level in `klog_levels`, changed from
+ *   the shell with `log <subsystem> <level>`. Rejecting costs one byte
+ *   load and compare.
+ *
+ * KLOG() logs as the generic kernel subsystem; KLOGS() names one.
  */
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "printf.h"
+#include "klog.h"
 
 #ifdef KLOG_USE_TICKS
-#include "interrupt.h"
+#include "clock.h"
 #endif
 
 #ifdef __cplusplus
@@ -28,6 +44,52 @@ typedef enum klog_level : uint8_t
     KLOG_PANIC
 } klog_level_t;
 
+/**
+ * @brief Subsystems with their own runtime log level.
+ */
+typedef enum klog_subsys : uint8_t
+{
+    KLOG_SYS_KERNEL = 0, /**< Untagged KLOG() calls. */
+    KLOG_SYS_MEMORY,
+    KLOG_SYS_IRQ,
+    KLOG_SYS_TIMER,
+    KLOG_SYS_UART,
+    KLOG_SYS_SHELL,
+    KLOG_SYS_COUNT
+} klog_subsys_t;
+
+/** Lowest level compiled in; anything below is removed entirely. */
+#ifndef KLOG_MIN_LEVEL
+#define KLOG_MIN_LEVEL KLOG_DEBUG
+#endif
+
+/** Runtime level every subsystem starts at. */
+#ifndef KLOG_DEFAULT_LEVEL
+#define KLOG_DEFAULT_LEVEL KLOG_INFO
+#endif
+
+/** Current runtime level per subsystem (a klog_level_t each). */
+extern uint8_t klog_levels[KLOG_SYS_COUNT];
+
+/**
+ * @brief Would a message of `level` from `sys` be logged?
+ *
+ * Constant-folds to false for levels below KLOG_MIN_LEVEL.
+ */
+static inline bool klog_enabled(klog_subsys_t sys, klog_level_t level)
+{
+    return level >= KLOG_MIN_LEVEL && __builtin_expect(level >= klog_levels[sys], 1);
+}
+
+/** @return Lowercase subsystem name, e.g. "memory". */
+const char *klog_subsys_str(klog_subsys_t sys);
+
+/** @return Subsystem matching `name`, or -1. */
+int klog_subsys_parse(const char *name);
+
+/** @return Level matching a lowercase `name` ("debug" ... "panic"), or -1. */
+int klog_level_parse(const char *name);
+
 static inline const char *klog_level_str(klog_level_t level)
 {
     switch (level)
@@ -42,14 +104,35 @@ static inline const char *klog_level_str(klog_level_t level)
 }
 
 #ifdef KLOG_USE_TICKS
-#define KLOG(level, fmt, ...) \
-    printf("[%s %lu] " fmt "\r\n", klog_level_str(level), \
-           (unsigned long)systicks, ##__VA_ARGS__)
+#define KLOG_SYNC(level, fmt, ...) \
+    printf("[%s %llu] " fmt "\r\n", klog_level_str(level), \
+           (unsigned long long)clock_monotonic_us(), ##__VA_ARGS__)
 #else
-#define KLOG(level, fmt, ...) \
+#define KLOG_SYNC(level, fmt, ...) \
     printf("[%s] " fmt "\r\n", klog_level_str(level), ##__VA_ARGS__)
 #endif
 
+#ifdef KLOG_BINARY
+#define KLOG_EMIT(level, fmt, ...) KLOG_DEFER(level, fmt, ##__VA_ARGS__)
+#else
+#define KLOG_EMIT(level, fmt, ...) KLOG_SYNC(level, fmt, ##__VA_ARGS__)
+#endif
+
+/**
+ * @brief Log from subsystem `sys`, if its level allows. Arguments are
+ *        only evaluated when the message is actually logged.
+ */
+#define KLOGS(sys, level, fmt, ...)                                   \
+    do                                                                \
+    {                                                                 \
+        if (klog_enabled((sys), (level)))                             \
+        {                                                             \
+            KLOG_EMIT(level, fmt, ##__VA_ARGS__);                     \
+        }                                                             \
+    } while (0)
+
+#define KLOG(level, fmt, ...) KLOGS(KLOG_SYS_KERNEL, level, fmt, ##__VA_ARGS__)
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -7,6 +8,11 @@
 extern "C"
 {
 #endif
+
+#define KMALLOC_IRQ_CLASSES 4u  /**< IRQ cache size classes: 32, 64, 128 and 256 bytes. */
+#define KMALLOC_IRQ_DEPTH   8u  /**< Objects per class after a refill. */
+#define KMALLOC_IRQ_LOW     4u  /**< Below this many, an IRQ asks for a refill. */
+
     /**
      * @enum block_state_t
      * @brief Enumeration of block states in the memory allocator.
@@ -33,6 +39,35 @@ extern "C"
         struct header    *prev;    /**< Pointer to the previous block in the linked list. */
     };
 
+    /**
+     * @brief Counters of the IRQ-context allocation path.
+     */
+    struct kmalloc_irq_stats
+    {
+        uint32_t allocs;    /**< IRQ allocations served from a cache. */
+        uint32_t misses;    /**< IRQ allocations that got NULL. */
+        uint32_t deferred;  /**< Frees from IRQ context queued for the thread side. */
+        uint32_t reclaimed; /**< Deferred frees returned to the heap. */
+        uint32_t refills;   /**< Objects moved from the heap into the caches. */
+    };
+
+    /**
+     * @brief Allocator state set aside by kmalloc_save().
+     *
+     * The block list, the IRQ caches with the objects on them, the
+     * deferred frees not reclaimed yet and the IRQ-path counters.
+     */
+    struct kmalloc_state
+    {
+        struct header            *head;
+        void                     *irq_free[KMALLOC_IRQ_CLASSES];
+        int32_t                   irq_count[KMALLOC_IRQ_CLASSES];
+        void                     *irq_deferred;
+        bool                      irq_wants;
+        uint32_t                  used_bytes;
+        struct kmalloc_irq_stats  irq_stats;
+    };
+
     /**
     * @brief Retrieves the head of the kmalloc allocation list.
     *
@@ -79,6 +114,8 @@ extern "C"
     *
     * @warning If no suitable block is found, the function will call `kernel_panic`.
     * @note The returned pointer points immediately after the block header.
+    * @note In IRQ context the block comes from a preloaded cache of up to
+    *       256-byte objects instead, and NULL means the cache was empty.
     *
     */
     void*  kmalloc(size_t size);
@@ -95,9 +132,66 @@ extern "C"
     * @note If `block` is NULL, the function does nothing.
     * @note If `block` does not correspond to a valid allocated block,
     *       the function calls `kernel_panic`.
+    * @note In IRQ context the block is only queued; the thread side
+    *       returns it to the heap later.
     */
     void   kfree(void *block);
 
+    /**
+    * @brief Reclaim IRQ-deferred frees and fill every IRQ cache to KMALLOC_IRQ_DEPTH.
+    *
+    * Thread context only. kmalloc_init() leaves the caches empty.
+    */
+    void   kmalloc_irq_refill(void);
+
+    /**
+    * @brief kmalloc_irq_refill() if an interrupt asked for it, else nothing.
+    *
+    * kmalloc() and kfree() call it; the idle thread does too.
+    */
+    void   kmalloc_irq_maintain(void);
+
+    /**
+    * @brief Copy the IRQ-path counters into `stats`.
+    */
+    void   kmalloc_irq_stats(struct kmalloc_irq_stats *stats);
+
+    /**
+    * @brief Set the current heap aside, e.g. before kmalloc_init() on a scratch heap.
+    *
+    * Until kmalloc_restore(), nothing may free a block of the saved heap:
+    * it would land in the scratch one.
+    */
+    void   kmalloc_save(struct kmalloc_state *state);
+
+    /**
+    * @brief Make the heap saved by kmalloc_save() current again.
+    *
+    * Whatever the scratch heap still holds, deferred frees included, is
+    * dropped with it.
+    */
+    void   kmalloc_restore(const struct kmalloc_state *state);
+
+    /**
+    * @brief Allocate `size` bytes starting on an `align` boundary.
+    *
+    * Over-allocates by `align` plus one pointer and keeps the address of
+    * the underlying block just below the returned one. Meant for page
+    * tables and page frames, not for small objects.
+    *
+    * @param size  The number of bytes to allocate.
+    * @param align Power of two, in bytes.
+    *
+    * @return Aligned pointer, or NULL if `size` is zero. Release it with
+    *         `kfree_aligned`, never `kfree`.
+    */
+    void*  kmalloc_aligned(size_t size, size_t align);
+
+    /**
+    * @brief Free a block returned by `kmalloc_aligned`. NULL is ignored.
+    */
+    void   kfree_aligned(void *block);
+
     /**
      * @brief Entry point for testing `kmalloc` and `kfree`.
      * 
@@ -0,0 +1,149 @@
+/**
+ * @file mmci.h
+ * @brief PL181 MultiMedia Card Interface driver for the SD card of QEMU VersatileAB/PB.
+ *
+ * mmci_init() identifies the card (SD v1 or v2, byte or block
+ * addressed) over polled commands. Data moves by PIO in 512-byte
+ * sectors: a run of sectors is one READ/WRITE_MULTIPLE_BLOCK command
+ * closed by STOP_TRANSMISSION, not one command per sector. The FIFO
+ * is serviced from the MMCI interrupt when it crosses half full (reads)
+ * or half empty (writes), eight words at a time, while the caller
+ * sleeps on a wait queue.
+ *
+ * One transfer runs at a time; callers queue on an internal lock.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errno.h"
+
+// Memory-mapped PL181 registers of MMCI0 on QEMU VersatileAB/PB.
+// ref: ARM PrimeCell MultiMedia Card Interface (PL181) TRM, register summary
+#define MMCI_BASE           0x10005000u
+#define MMCI_POWER          (*(volatile uint32_t *)(MMCI_BASE + 0x000))
+#define MMCI_CLOCK          (*(volatile uint32_t *)(MMCI_BASE + 0x004))
+#define MMCI_ARGUMENT       (*(volatile uint32_t *)(MMCI_BASE + 0x008))
+#define MMCI_COMMAND        (*(volatile uint32_t *)(MMCI_BASE + 0x00C))
+#define MMCI_RESPCMD        (*(volatile uint32_t *)(MMCI_BASE + 0x010))
+#define MMCI_RESPONSE(n)    (*(volatile uint32_t *)(MMCI_BASE + 0x014 + 4u * (n)))
+#define MMCI_DATATIMER      (*(volatile uint32_t *)(MMCI_BASE + 0x024))
+#define MMCI_DATALENGTH     (*(volatile uint32_t *)(MMCI_BASE + 0x028))
+#define MMCI_DATACTRL       (*(volatile uint32_t *)(MMCI_BASE + 0x02C))
+#define MMCI_DATACNT        (*(volatile uint32_t *)(MMCI_BASE + 0x030))
+#define MMCI_STATUS         (*(volatile uint32_t *)(MMCI_BASE + 0x034))
+#define MMCI_CLEAR          (*(volatile uint32_t *)(MMCI_BASE + 0x038))
+#define MMCI_MASK0          (*(volatile uint32_t *)(MMCI_BASE + 0x03C))
+#define MMCI_MASK1          (*(volatile uint32_t *)(MMCI_BASE + 0x040))
+#define MMCI_FIFOCNT        (*(volatile uint32_t *)(MMCI_BASE + 0x048))
+#define MMCI_FIFO           (*(volatile uint32_t *)(MMCI_BASE + 0x080)) // 0x80-0xBC all alias it
+
+#define MMCI_POWER_UP       0x2u
+#define MMCI_POWER_ON       0x3u
+
+#define MMCI_CLOCK_DIV(d)   ((uint32_t)(d) & 0xFFu) // MCLK / (2 * (d + 1))
+#define MMCI_CLOCK_ENABLE   (1u << 8)
+
+#define MMCI_CMD_RESPONSE   (1u << 6)
+#define MMCI_CMD_LONGRSP    (1u << 7)
+#define MMCI_CMD_ENABLE     (1u << 10)
+
+#define MMCI_DATA_ENABLE    (1u << 0)
+#define MMCI_DATA_READ      (1u << 1)    // card to controller
+#define MMCI_DATA_BLOCKSZ(l) ((uint32_t)(l) << 4) // log2 of the block size
+
+// Status, Clear and Mask bits.
+#define MMCI_CMDCRCFAIL     (1u << 0)
+#define MMCI_DATACRCFAIL    (1u << 1)
+#define MMCI_CMDTIMEOUT     (1u << 2)
+#define MMCI_DATATIMEOUT    (1u << 3)
+#define MMCI_TXUNDERRUN     (1u << 4)
+#define MMCI_RXOVERRUN      (1u << 5)
+#define MMCI_CMDRESPEND     (1u << 6)
+#define MMCI_CMDSENT        (1u << 7)
+#define MMCI_DATAEND        (1u << 8)
+#define MMCI_STARTBITERR    (1u << 9)
+#define MMCI_DATABLOCKEND   (1u << 10)
+#define MMCI_TXFIFOHALFEMPTY (1u << 14)
+#define MMCI_RXFIFOHALFFULL (1u << 15)
+#define MMCI_TXFIFOFULL     (1u << 16)
+#define MMCI_RXDATAAVLBL    (1u << 21)
+#define MMCI_CLEAR_ALL      0x7FFu       // the sticky bits, 0 to 10
+
+#define MMCI_DATA_ERRORS    (MMCI_DATACRCFAIL | MMCI_DATATIMEOUT | MMCI_TXUNDERRUN | \
+                             MMCI_RXOVERRUN | MMCI_STARTBITERR)
+#define MMCI_FIFO_HALF      8u           // words moved per watermark
+
+#define MMCI_SECTOR_SIZE    512u
+#define MMCI_MAX_SECTORS    64u          // per command: DataLength is 16 bits
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief One piece of a scattered transfer; `len` is a multiple of MMCI_SECTOR_SIZE.
+     */
+    struct mmci_iov
+    {
+        void  *buf;  /**< Word aligned. */
+        size_t len;
+    };
+
+    /**
+     * @brief Power the controller up and identify the card.
+     *
+     * @return KERR_NOT_FOUND if no card answers, KERR_IO if it fails
+     *         initialisation.
+     */
+    kerror_t mmci_init(void);
+
+    /**
+     * @brief Whether mmci_init() found a usable card.
+     */
+    bool mmci_present(void);
+
+    /**
+     * @brief Card capacity in sectors, 0 without a card.
+     */
+    uint32_t mmci_sectors(void);
+
+    /**
+     * @brief Read sectors [lba, lba + total) into the buffers of `iov`, in order.
+     *
+     * Split into commands of at most MMCI_MAX_SECTORS sectors. May sleep.
+     *
+     * @return KERR_INVAL for a misaligned buffer or a range past the end
+     *         of the card, KERR_NOT_FOUND without a card, KERR_IO on a
+     *         card or controller error or timeout.
+     */
+    kerror_t mmci_readv(uint32_t lba, const struct mmci_iov *iov, uint32_t iovcnt);
+
+    /**
+     * @brief Write the buffers of `iov` to consecutive sectors from `lba`.
+     *
+     * Returns once the card has programmed the data. Errors as mmci_readv().
+     */
+    kerror_t mmci_writev(uint32_t lba, const struct mmci_iov *iov, uint32_t iovcnt);
+
+    /**
+     * @brief Read `count` sectors from `lba` into `buf`.
+     */
+    kerror_t mmci_read(uint32_t lba, void *buf, uint32_t count);
+
+    /**
+     * @brief Write `count` sectors from `buf` at `lba`.
+     */
+    kerror_t mmci_write(uint32_t lba, const void *buf, uint32_t count);
+
+    /**
+     * @brief MMCI0 interrupt handler, called from irq_handler() via the SIC.
+     */
+    void mmci_irq_handler(void);
+
+#ifdef __cplusplus
+}
+#endif
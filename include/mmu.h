@@ -0,0 +1,206 @@
+/**
+ * @file mmu.h
+ * @brief Short-descriptor page tables, user address spaces and ASIDs.
+ *
+ * mmu_init() builds the kernel table: RAM identity-mapped with 1 MiB
+ * global sections, privileged only, and the I/O window as device memory.
+ * The kernel is linked at 0 (kernel.ld), below any TTBCR split boundary,
+ * so TTBCR.N stays 0 and TTBR0 walks every address. Each user address
+ * space (struct mm) therefore starts as a copy of the kernel table; the
+ * copied entries are global, so they stay valid in the TLB across
+ * address-space switches.
+ *
+ * User mappings live in [USER_BASE, USER_END), use 4 KiB pages and are
+ * non-global: the TLB tags them with the 8-bit ASID of their mm. ASIDs
+ * are handed out lazily at switch time and recycled by generation: when
+ * all 255 are used, the generation is bumped, the TLB flushed once and
+ * every mm gets a fresh ASID the next time it is switched in. A switch
+ * is then only a CONTEXTIDR/TTBR0 write, never a TLB flush.
+ *
+ * The D-cache stays off: PL080 transfers are not cache-maintained yet.
+ * Translation walks are therefore non-cacheable as well.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errno.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PAGE_SIZE        4096u
+#define SECTION_SIZE     0x00100000u
+
+#define MMU_RAM_SIZE     0x08000000u /**< Identity-mapped RAM, 128 MiB. */
+#define MMU_IO_BASE      0x10000000u /**< Versatile peripherals, device memory. */
+#define MMU_IO_SIZE      0x00200000u
+
+#define USER_BASE        0x40000000u /**< First user virtual address. */
+#define USER_SIZE        0x01000000u /**< 16 MiB of user address space per task. */
+#define USER_END         (USER_BASE + USER_SIZE)
+#define USER_SECTIONS    (USER_SIZE / SECTION_SIZE)
+
+#define MM_PROT_READ     (1u << 0)
+#define MM_PROT_WRITE    (1u << 1)
+#define MM_PROT_EXEC     (1u << 2)
+
+#define ASID_BITS        8u
+#define ASID_MASK        ((1u << ASID_BITS) - 1u)
+
+    /**
+     * @brief Second-level table for one 1 MiB slice of the user window.
+     */
+    struct mm_l2
+    {
+        uint32_t pte[256];  /**< Small-page descriptors (must stay first, 1 KiB aligned). */
+        uint32_t owned[8];  /**< Bit i: the frame behind pte[i] belongs to the mm. */
+    };
+
+    /**
+     * @brief A user address space.
+     */
+    struct mm
+    {
+        uint32_t     *l1;                   /**< 16 KiB L1 table, kernel entries copied in. */
+        struct mm_l2 *l2[USER_SECTIONS];    /**< Tables of the user window, NULL until used. */
+        uint32_t      context;              /**< Generation << ASID_BITS | ASID, 0 if never run. */
+        uint32_t      pages;                /**< Frames owned by the mm. */
+    };
+
+    /**
+     * @brief Build the kernel table and turn the MMU, I-cache and branch prediction on.
+     */
+    void mmu_init(void);
+
+    /**
+     * @brief True once mmu_init() has run.
+     */
+    bool mmu_enabled(void);
+
+    /**
+     * @brief Unmap the kernel page at `va` so any access to it aborts.
+     *
+     * Splits the 1 MiB section around `va` into 4 KiB pages on first use.
+     * Must run before mm_create(): user tables copy the kernel entries.
+     *
+     * @return KERR_INVAL for an unaligned address or one outside RAM.
+     */
+    kerror_t mmu_guard_page(uintptr_t va);
+
+    /**
+     * @brief Translate `va` with the current tables (privileged read).
+     *
+     * @return true and the physical address in `pa`, or false if `va` faults.
+     */
+    bool mmu_translate(uintptr_t va, uintptr_t *pa);
+
+    /**
+     * @brief Create an empty user address space.
+     */
+    struct mm *mm_create(void);
+
+    /**
+     * @brief Free `mm`, its tables and every frame it owns.
+     *
+     * Switches to the kernel table first if `mm` is loaded.
+     */
+    void mm_destroy(struct mm *mm);
+
+    /**
+     * @brief Map the page at physical `pa` at user address `va`.
+     *
+     * The frame is not owned: mm_destroy() leaves it alone.
+     *
+     * @return KERR_INVAL for an unaligned or out-of-window address,
+     *         KERR_BUSY if `va` is already mapped.
+     */
+    kerror_t mm_map(struct mm *mm, uintptr_t va, uintptr_t pa, uint32_t prot);
+
+    /**
+     * @brief Back [va, va + len) with fresh zeroed frames owned by `mm`.
+     *
+     * @return KERR_INVAL for an unaligned or out-of-window range,
+     *         KERR_BUSY if part of it is already mapped.
+     */
+    kerror_t mm_alloc(struct mm *mm, uintptr_t va, size_t len, uint32_t prot);
+
+    /**
+     * @brief Kernel pointer to the byte mapped at user address `va`, or NULL.
+     *
+     * RAM is identity-mapped, so this works whichever mm is loaded.
+     */
+    void *mm_kaddr(const struct mm *mm, uintptr_t va);
+
+    /**
+     * @brief True if [va, va + len) is mapped in `mm` with at least `prot`.
+     */
+    bool mm_access_ok(const struct mm *mm, uintptr_t va, size_t len, uint32_t prot);
+
+    /**
+     * @brief Load `mm`, or the kernel table for NULL. Call with IRQs masked.
+     *
+     * Assigns an ASID if `mm` has none from the current generation.
+     */
+    void mmu_switch(struct mm *mm);
+
+    /**
+     * @brief The mm whose table is loaded, NULL for the kernel table.
+     */
+    struct mm *mmu_active(void);
+
+    /**
+     * @brief Number of ASID generations exhausted (full TLB flushes).
+     */
+    uint32_t mmu_asid_rollovers(void);
+
+    /**
+     * @brief Allocate a zeroed 4 KiB page frame.
+     */
+    void *page_alloc(void);
+
+    /**
+     * @brief Return a frame from page_alloc() to the pool.
+     */
+    void page_free(void *page);
+
+    /**
+     * @brief Invalidate the whole unified TLB.
+     */
+    static inline void tlb_flush_all(void)
+    {
+        __asm__ volatile("mcr p15, 0, %0, c8, c7, 0\n\t"
+                         "dsb\n\t"
+                         "isb" :: "r"(0) : "memory");
+    }
+
+    /**
+     * @brief Invalidate the TLB entry for `va` tagged with `asid`.
+     */
+    static inline void tlb_flush_page(uintptr_t va, uint32_t asid)
+    {
+        const uint32_t mva = ((uint32_t)va & ~(PAGE_SIZE - 1u)) | (asid & ASID_MASK);
+        __asm__ volatile("mcr p15, 0, %0, c8, c7, 1\n\t"
+                         "dsb\n\t"
+                         "isb" :: "r"(mva) : "memory");
+    }
+
+    /**
+     * @brief Invalidate the I-cache and branch predictor after writing code.
+     */
+    static inline void icache_invalidate(void)
+    {
+        __asm__ volatile("dsb\n\t"
+                         "mcr p15, 0, %0, c7, c5, 0\n\t"   // ICIALLU
+                         "mcr p15, 0, %0, c7, c5, 6\n\t"   // BPIALL
+                         "dsb\n\t"
+                         "isb" :: "r"(0) : "memory");
+    }
+
+#ifdef __cplusplus
+}
+#endif
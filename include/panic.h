@@ -7,6 +7,13 @@
  */
 #pragma once
 #include "errno.h"
+#include "kstat.h"
+
+/**
+ * Errors handled instead of being fatal: rejected user pointers and failed
+ * IRQ-context allocations.
+ */
+KSTAT_DECLARE(panics_avoided);
 
 /**
  * @brief Halt the CPU indefinitely.
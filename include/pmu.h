@@ -0,0 +1,42 @@
+/**
+ * @file pmu.h
+ * @brief Cortex-A8 PMU cycle counter for micro-benchmarks.
+ *
+ * PMCCNTR counts CPU cycles (or an approximation of them under QEMU). It
+ * is 32 bits wide, so only measure intervals well below 2^32 cycles and
+ * take differences with unsigned arithmetic.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reset and start the cycle counter.
+ */
+static inline void pmu_init(void)
+{
+    uint32_t pmcr;
+    __asm__ volatile("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+    pmcr |= (1u << 0) | (1u << 2);  // E: enable, C: reset cycle counter
+    pmcr &= ~(1u << 3);             // D: count every cycle, not every 64th
+    __asm__ volatile("mcr p15, 0, %0, c9, c12, 0" :: "r"(pmcr));
+    __asm__ volatile("mcr p15, 0, %0, c9, c12, 1" :: "r"(1u << 31)); // PMCNTENSET: cycle counter
+}
+
+/**
+ * @brief Current cycle count.
+ */
+static inline uint32_t pmu_cycles(void)
+{
+    uint32_t cycles;
+    __asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(cycles) :: "memory");
+    return cycles;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,8 +2,8 @@
  * @file printf.h
  * @brief Minimal kernel printf/puts/getlines interface for freestanding systems.
  *
- * This header defines the kernel's text I/O functions and the
- * internal formatting structures used by the printf subsystem.
+ * This header defines the kernel's text I/O functions. Formatting itself
+ * is done by the vsnformat() core in format.h.
  * 
  * The implementation targets bare-metal systems using memory-mapped UART output,
  * and is fully freestanding (no libc dependencies).
@@ -20,67 +20,45 @@ extern "C" {
 #endif
 
     /**
-     * @enum fmt_state_t
-     * @brief Finite-state machine for parsing format strings.
-     * 
-     * The printf parser moves between these states as it consumes characters.
+     * @brief Transmit a null-terminated string over UART.
+     *
+     * @param s The string to output. If NULL, no output occurs.
     */
-    typedef enum fmt_state : int32_t
-    {
-        FMT_TEXT,    /**< Normal character output. */
-        FMT_PERCENT, /**< After encountering '\%'. */
-        FMT_LONG     /**< After encountering '\%l'. */
-    } fmt_state_t;
+    void puts(const char *s);
 
     /**
-     * @enum fmt_flag_t
-     * @brief Formatting flags for integer conversions.
+     * @brief Prints a formatted string to the UART output.
+     *
+     * @param fmt Format string, see format.h for the supported conversions
+     *            (`%d %i %u %x %X %p %s %c %%`, flags `-` `0`, width,
+     *            precision and the `hh h l ll z t` length modifiers).
+     * @param ... Variable arguments matching the format specifiers.
      *
-     * Used internally by the printf implementation.
+     * @return Number of characters written.
     */
-    typedef enum fmt_flag : uint32_t
-    {
-        FLAG_LONG      = 1u << 0, /**< 'l' length modifier (long / long long). */
-        FLAG_UNSIGNED  = 1u << 1, /**< Future use: unsigned type hint. */
-        FLAG_HEX       = 1u << 2, /**< Future use: hexadecimal output flag. */
-        FLAG_UPPERCASE = 1u << 3  /**< Uppercase hex digits (for %X). */
-    } fmt_flag_t;
+    int printf(const char *fmt, ...);
 
     /**
-     * @struct fmt_args_t
-     * @brief Integer conversion arguments for unsigned formats ( \%u, \%x, \%X ).
-
-     * @details Holds the numeric value and formatting flags for integer output.
-     * Used internally by the printf implementation.
+     * @brief printf() with a `va_list`.
     */
-    typedef struct
-    {
-        unsigned long long num;   /**< Unsigned numeric value to format. */
-        fmt_flag_t         flags; /**< Formatting flags (length, case, etc.). */
-    } fmt_args_t;
+    int vprintf(const char *fmt, va_list args);
 
     /**
-     * @brief Transmit a null-terminated string over UART.
+     * @brief Formats into `buf`, writing at most `size` bytes including the NUL.
      *
-     * @param s The string to output. If NULL, no output occurs.
+     * @param buf  Destination buffer (may be NULL if `size` is 0).
+     * @param size Capacity of `buf`.
+     * @param fmt  Format string, as for printf().
+     *
+     * @return Length of the full formatted string; a value >= `size` means
+     *         the output was truncated.
     */
-    void puts(const char *s);
+    int snprintf(char *buf, size_t size, const char *fmt, ...);
 
     /**
-     * @brief Prints a formatted string to the UART output.
-     *
-     * @param fmt Format string (supports %c, %s, %d, %u, %x, %X, %p, %%).
-     * @param ... Variable arguments matching the format specifiers.
-     *
-     * This function supports a minimal subset of standard C printf:
-     * - Signed/unsigned integers (`%d`, `%u`)
-     * - Hexadecimal (`%x`, `%X`)
-     * - Pointers (`%p`)
-     * - Characters (`%c`)
-     * - Strings (`%s`)
-     * - Length modifier (`%l`)
+     * @brief snprintf() with a `va_list`.
     */
-    void printf(const char *fmt, ...);
+    int vsnprintf(char *buf, size_t size, const char *fmt, va_list args);
 
     /**
      * @brief Reads a line of text from UART into the given buffer.
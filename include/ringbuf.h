@@ -0,0 +1,430 @@
+/**
+ * @file ringbuf.h
+ * @brief Header-only lock-free byte ring buffer for IRQ-to-thread data paths.
+ *
+ * Capacity is a power of two and indices are free-running 32-bit counters,
+ * so `head - tail` is always the fill level and wrap-around is a mask.
+ * Producer and consumer indices live on separate cache lines so the two
+ * sides never false-share.
+ *
+ * Two producer flavours share the same consumer API:
+ * - Single producer (`ringbuf_write*`): one writer context, e.g. an IRQ
+ *   handler feeding a thread.
+ * - Multi producer (`ringbuf_mp_*`): any number of writers, including
+ *   IRQ handlers interrupting a thread in the middle of a write. Space is
+ *   claimed with LDREX/STREX and published once no writer is in flight.
+ *
+ * Do not mix both producer flavours on one ring. There is always exactly
+ * one consumer.
+ *
+ * Barriers: producers issue `dmb` between filling the data and publishing
+ * `head`; the consumer issues `dmb` between reading `head` and the data,
+ * and between reading the data and releasing it through `tail`.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "barrier.h"
+#include "interrupt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Cortex-A8 L1/L2 line size. */
+#define RINGBUF_CACHELINE 64
+
+/*
+ * Test-only seam, run in ringbuf_mp_commit() between reading `reserve` and
+ * leaving. Only a test translation unit that defines RINGBUF_TEST_HOOKS may
+ * supply it; every other build gets the no-op.
+ */
+#if defined(RINGBUF_TEST_HOOKS) && defined(RINGBUF_MP_COMMIT_WINDOW)
+#define RINGBUF_MP_COMMIT_HOOK(rb) RINGBUF_MP_COMMIT_WINDOW(rb)
+#else
+#define RINGBUF_MP_COMMIT_HOOK(rb) ((void)(rb))
+#endif
+
+/**
+ * @brief Ring buffer control block. Storage is supplied by the caller.
+ */
+struct ringbuf
+{
+    alignas(RINGBUF_CACHELINE) volatile uint32_t head;    /**< Published write index. */
+    volatile uint32_t reserve;                            /**< MP: next index to claim. */
+    volatile uint32_t writers;                            /**< MP: writers in flight. */
+
+    alignas(RINGBUF_CACHELINE) volatile uint32_t tail;    /**< Consumer read index. */
+
+    alignas(RINGBUF_CACHELINE) uint8_t *data;             /**< Backing storage. */
+    uint32_t size;                                        /**< Capacity in bytes. */
+    uint32_t mask;                                        /**< size - 1. */
+};
+
+/**
+ * @brief Static initializer, usable before any code has run.
+ *
+ * @param storage Backing array (its size must be a power of two).
+ */
+#define RINGBUF_STATIC_INIT(storage)          \
+    {                                         \
+        .data = (uint8_t *)(storage),         \
+        .size = sizeof(storage),              \
+        .mask = sizeof(storage) - 1,          \
+    }
+
+/**
+ * @brief Initialize a ring over caller-provided storage.
+ *
+ * @param rb      Ring to initialize.
+ * @param storage Backing buffer.
+ * @param size    Capacity in bytes, must be a power of two.
+ *
+ * @return false if `size` is not a non-zero power of two.
+ */
+static inline bool ringbuf_init(struct ringbuf *rb, void *storage, uint32_t size)
+{
+    if (size == 0 || (size & (size - 1)) != 0)
+    {
+        return false;
+    }
+
+    rb->head    = 0;
+    rb->reserve = 0;
+    rb->writers = 0;
+    rb->tail    = 0;
+    rb->data    = (uint8_t *)storage;
+    rb->size    = size;
+    rb->mask    = size - 1;
+    return true;
+}
+
+/**
+ * @brief Bytes available to the consumer.
+ */
+static inline uint32_t ringbuf_used(const struct ringbuf *rb)
+{
+    return rb->head - rb->tail;
+}
+
+/**
+ * @brief Bytes a producer may still claim.
+ */
+static inline uint32_t ringbuf_free(const struct ringbuf *rb)
+{
+    return rb->size - (rb->reserve - rb->tail);
+}
+
+static inline bool ringbuf_empty(const struct ringbuf *rb)
+{
+    return rb->head == rb->tail;
+}
+
+/* ------------------------------------------------------------------ */
+/* LDREX/STREX helpers                                                */
+/* ------------------------------------------------------------------ */
+
+static inline uint32_t ringbuf_ldrex(volatile uint32_t *addr)
+{
+    uint32_t value;
+    __asm__ volatile("ldrex %0, [%1]" : "=r"(value) : "r"(addr) : "memory");
+    return value;
+}
+
+/** @return 0 on success, 1 if the exclusive monitor was lost. */
+static inline uint32_t ringbuf_strex(volatile uint32_t *addr, uint32_t value)
+{
+    uint32_t failed;
+    __asm__ volatile("strex %0, %2, [%1]" : "=&r"(failed) : "r"(addr), "r"(value) : "memory");
+    return failed;
+}
+
+static inline void ringbuf_clrex(void)
+{
+    __asm__ volatile("clrex" ::: "memory");
+}
+
+static inline uint32_t ringbuf_atomic_add(volatile uint32_t *addr, uint32_t delta)
+{
+    uint32_t value;
+    do
+    {
+        value = ringbuf_ldrex(addr) + delta;
+    } while (ringbuf_strex(addr, value));
+    return value;
+}
+
+/* ------------------------------------------------------------------ */
+/* Copy helpers (handle the wrap)                                      */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Copy `len` bytes into the ring at absolute index `pos`.
+ */
+static inline void ringbuf_copy_in(struct ringbuf *rb, uint32_t pos, const void *src, uint32_t len)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        rb->data[(pos + i) & rb->mask] = s[i];
+    }
+}
+
+/**
+ * @brief Copy `len` bytes out of the ring starting at absolute index `pos`.
+ */
+static inline void ringbuf_copy_out(const struct ringbuf *rb, uint32_t pos, void *dst, uint32_t len)
+{
+    uint8_t *d = (uint8_t *)dst;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        d[i] = rb->data[(pos + i) & rb->mask];
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* Single producer                                                     */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Zero-copy write: get the contiguous free span at the write position.
+ *
+ * @param rb  Ring.
+ * @param ptr Receives a pointer into the ring storage.
+ *
+ * @return Number of bytes that may be written at `*ptr` (0 if full). The
+ *         span stops at the end of storage; call again after committing to
+ *         get the wrapped remainder.
+ */
+static inline uint32_t ringbuf_write_reserve(struct ringbuf *rb, void **ptr)
+{
+    const uint32_t head   = rb->head;
+    const uint32_t free   = rb->size - (head - rb->tail);
+    const uint32_t offset = head & rb->mask;
+    const uint32_t linear = rb->size - offset;
+
+    *ptr = rb->data + offset;
+    return free < linear ? free : linear;
+}
+
+/**
+ * @brief Publish `len` bytes written into the span from ringbuf_write_reserve().
+ */
+static inline void ringbuf_write_commit(struct ringbuf *rb, uint32_t len)
+{
+    dmb(); // data before index
+    const uint32_t head = rb->head + len;
+    rb->reserve = head;
+    rb->head    = head;
+}
+
+/**
+ * @brief Copy up to `len` bytes in.
+ *
+ * @return Bytes actually written (less than `len` if the ring filled up).
+ */
+static inline uint32_t ringbuf_write(struct ringbuf *rb, const void *src, uint32_t len)
+{
+    const uint32_t head = rb->head;
+    const uint32_t free = rb->size - (head - rb->tail);
+    const uint32_t n    = len < free ? len : free;
+
+    ringbuf_copy_in(rb, head, src, n);
+    ringbuf_write_commit(rb, n);
+    return n;
+}
+
+/**
+ * @brief Push one byte.
+ *
+ * @return false if the ring is full.
+ */
+static inline bool ringbuf_put(struct ringbuf *rb, uint8_t byte)
+{
+    const uint32_t head = rb->head;
+    if (head - rb->tail == rb->size)
+    {
+        return false;
+    }
+
+    rb->data[head & rb->mask] = byte;
+    ringbuf_write_commit(rb, 1);
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/* Multi producer                                                      */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Finish a multi-producer write.
+ *
+ * The last writer to leave publishes everything claimed so far. An IRQ
+ * writer nested inside a thread writer therefore becomes visible together
+ * with the thread's record, never before it. On a single core this is
+ * exact; with true SMP concurrency a record may be published late, but
+ * never before it is complete.
+ *
+ * `reserve` is read before leaving, so a writer that claims after it
+ * cannot get published half-filled. IRQs stay masked from that read to
+ * the decrement: a writer nested in between would commit while this one
+ * still counts, and then fall outside the stale `end`.
+ */
+static inline void ringbuf_mp_commit(struct ringbuf *rb)
+{
+    dmb(); // data before index
+
+    const uint32_t flags = irq_save();
+    const uint32_t end   = rb->reserve;
+    RINGBUF_MP_COMMIT_HOOK(rb);
+    const uint32_t left  = ringbuf_atomic_add(&rb->writers, (uint32_t)-1);
+    irq_restore(flags);
+
+    if (left != 0)
+    {
+        return; // an outer writer will publish, this record included
+    }
+
+    // Only move head forward: a faster writer may already be past `end`
+    uint32_t head;
+    do
+    {
+        head = ringbuf_ldrex(&rb->head);
+        if ((int32_t)(end - head) <= 0)
+        {
+            ringbuf_clrex();
+            return;
+        }
+    } while (ringbuf_strex(&rb->head, end));
+}
+
+/**
+ * @brief Claim `len` bytes for a multi-producer write.
+ *
+ * All-or-nothing. On success fill the claim with ringbuf_copy_in() (or
+ * directly through `data`), then call ringbuf_mp_commit(). On failure the
+ * writer has already left; do not commit.
+ *
+ * @param rb  Ring.
+ * @param len Bytes to claim.
+ * @param pos Receives the absolute index of the claim.
+ *
+ * @return false if the ring does not have `len` free bytes.
+ */
+static inline bool ringbuf_mp_reserve(struct ringbuf *rb, uint32_t len, uint32_t *pos)
+{
+    ringbuf_atomic_add(&rb->writers, 1);
+
+    uint32_t old;
+    do
+    {
+        old = ringbuf_ldrex(&rb->reserve);
+        if (rb->size - (old - rb->tail) < len)
+        {
+            ringbuf_clrex();
+            // Leave like a committing writer: if we were the last one in
+            // flight, records of writers nested inside us still need publishing.
+            ringbuf_mp_commit(rb);
+            return false;
+        }
+    } while (ringbuf_strex(&rb->reserve, old + len));
+
+    dmb();
+    *pos = old;
+    return true;
+}
+
+/**
+ * @brief Multi-producer copy-in of a whole record.
+ *
+ * @return false if the record did not fit (nothing written).
+ */
+static inline bool ringbuf_mp_write(struct ringbuf *rb, const void *src, uint32_t len)
+{
+    uint32_t pos;
+    if (!ringbuf_mp_reserve(rb, len, &pos))
+    {
+        return false;
+    }
+
+    ringbuf_copy_in(rb, pos, src, len);
+    ringbuf_mp_commit(rb);
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/* Consumer                                                            */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Zero-copy read: get the contiguous readable span.
+ *
+ * @param rb  Ring.
+ * @param ptr Receives a pointer into the ring storage.
+ *
+ * @return Number of bytes readable at `*ptr` (0 if empty). The span stops
+ *         at the end of storage.
+ */
+static inline uint32_t ringbuf_read_peek(const struct ringbuf *rb, const void **ptr)
+{
+    const uint32_t tail   = rb->tail;
+    const uint32_t used   = rb->head - tail;
+    const uint32_t offset = tail & rb->mask;
+    const uint32_t linear = rb->size - offset;
+
+    dmb(); // index before data
+    *ptr = rb->data + offset;
+    return used < linear ? used : linear;
+}
+
+/**
+ * @brief Release `len` consumed bytes back to the producers.
+ */
+static inline void ringbuf_read_commit(struct ringbuf *rb, uint32_t len)
+{
+    dmb(); // finish reading before the space can be reused
+    rb->tail = rb->tail + len;
+}
+
+/**
+ * @brief Copy up to `len` bytes out.
+ *
+ * @return Bytes actually read.
+ */
+static inline uint32_t ringbuf_read(struct ringbuf *rb, void *dst, uint32_t len)
+{
+    const uint32_t tail = rb->tail;
+    const uint32_t used = rb->head - tail;
+    const uint32_t n    = len < used ? len : used;
+
+    dmb(); // index before data
+    ringbuf_copy_out(rb, tail, dst, n);
+    ringbuf_read_commit(rb, n);
+    return n;
+}
+
+/**
+ * @brief Pop one byte.
+ *
+ * @return false if the ring is empty.
+ */
+static inline bool ringbuf_get(struct ringbuf *rb, uint8_t *byte)
+{
+    const uint32_t tail = rb->tail;
+    if (rb->head == tail)
+    {
+        return false;
+    }
+
+    dmb(); // index before data
+    *byte = rb->data[tail & rb->mask];
+    ringbuf_read_commit(rb, 1);
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
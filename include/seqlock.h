@@ -0,0 +1,148 @@
+/**
+ * @file seqlock.h
+ * @brief Sequence counters and seqlocks for read-mostly data.
+ *
+ * Readers never write shared memory and never wait for each other: they
+ * sample the sequence, copy the data and retry if the sequence was odd
+ * (update in progress) or moved meanwhile. Writers make the sequence
+ * odd, update, and make it even again.
+ *
+ *     uint32_t seq;
+ *     do
+ *     {
+ *         seq = read_seqcount_begin(&s);
+ *         copy = shared;
+ *     } while (read_seqcount_retry(&s, seq));
+ *
+ * A bare seqcount_t needs its writers serialised by other means (a single
+ * writer, an IRQ handler, masked IRQs). seqlock_t adds a spinlock for
+ * that. In both cases a reader must never be able to interrupt its own
+ * writer: it would retry forever on an odd sequence. Data written from
+ * thread context and read in IRQ handlers therefore takes
+ * write_seqlock_irqsave().
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "barrier.h"
+#include "spinlock.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Sequence counter; even when the data is stable.
+     */
+    typedef struct
+    {
+        volatile uint32_t sequence;
+    } seqcount_t;
+
+#define SEQCOUNT_INIT { 0 }
+
+    static inline void seqcount_init(seqcount_t *s)
+    {
+        s->sequence = 0;
+    }
+
+    /**
+     * @brief Start a read section, waiting out an update in progress.
+     *
+     * @return The sequence to hand to read_seqcount_retry().
+     */
+    static inline uint32_t read_seqcount_begin(const seqcount_t *s)
+    {
+        uint32_t seq;
+        while ((seq = s->sequence) & 1u)
+        {
+            barrier();
+        }
+        dmb(); // data reads stay after the sequence read
+        return seq;
+    }
+
+    /**
+     * @brief End a read section.
+     *
+     * @return true if the data read since `start` may be torn and must be read again.
+     */
+    static inline bool read_seqcount_retry(const seqcount_t *s, uint32_t start)
+    {
+        dmb(); // data reads complete before the sequence is checked
+        return s->sequence != start;
+    }
+
+    static inline void write_seqcount_begin(seqcount_t *s)
+    {
+        s->sequence = s->sequence + 1; // odd: update in progress
+        dmb();
+    }
+
+    static inline void write_seqcount_end(seqcount_t *s)
+    {
+        dmb();
+        s->sequence = s->sequence + 1; // even: stable again
+    }
+
+    /**
+     * @brief Sequence counter with a lock serialising its writers.
+     */
+    typedef struct
+    {
+        seqcount_t seq;
+        spinlock_t lock;
+    } seqlock_t;
+
+#define SEQLOCK_INIT { .seq = SEQCOUNT_INIT, .lock = SPINLOCK_INIT }
+
+    static inline void seqlock_init(seqlock_t *sl)
+    {
+        seqcount_init(&sl->seq);
+        spin_lock_init(&sl->lock);
+    }
+
+    static inline uint32_t read_seqbegin(const seqlock_t *sl)
+    {
+        return read_seqcount_begin(&sl->seq);
+    }
+
+    static inline bool read_seqretry(const seqlock_t *sl, uint32_t start)
+    {
+        return read_seqcount_retry(&sl->seq, start);
+    }
+
+    static inline void write_seqlock(seqlock_t *sl)
+    {
+        spin_lock(&sl->lock);
+        write_seqcount_begin(&sl->seq);
+    }
+
+    static inline void write_sequnlock(seqlock_t *sl)
+    {
+        write_seqcount_end(&sl->seq);
+        spin_unlock(&sl->lock);
+    }
+
+    /**
+     * @brief write_seqlock() with IRQs masked, for data read from IRQ handlers.
+     */
+    static inline uint32_t write_seqlock_irqsave(seqlock_t *sl)
+    {
+        const uint32_t flags = spin_lock_irqsave(&sl->lock);
+        write_seqcount_begin(&sl->seq);
+        return flags;
+    }
+
+    static inline void write_sequnlock_irqrestore(seqlock_t *sl, uint32_t flags)
+    {
+        write_seqcount_end(&sl->seq);
+        spin_unlock_irqrestore(&sl->lock, flags);
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,153 @@
+/**
+ * @file spinlock.h
+ * @brief Ticket spinlocks, with IRQ-save variants for data shared with handlers.
+ *
+ * A lock is two 16-bit halves of one word: `next` is the ticket the next
+ * locker draws, `owner` the ticket being served. Locking takes a ticket
+ * with one LDREX/STREX add on `next` and waits, in WFE, for `owner` to
+ * reach it; unlocking bumps `owner` and wakes waiters with SEV. Waiters
+ * are served in arrival order, so the lock is fair once there is more
+ * than one core, and it is already written for that case: the acquire
+ * DMB follows the wait, the release DMB precedes the owner store.
+ *
+ * On this single core a thread can only spin on a lock held by a thread
+ * it preempted or by an interrupted context, so:
+ * - spin_lock() also disables preemption for as long as the lock is held;
+ * - data also touched by an IRQ handler must be locked with
+ *   spin_lock_irqsave() on the thread side, or the handler would spin on
+ *   a holder that cannot run until it returns.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "atomic.h"
+#include "barrier.h"
+#include "interrupt.h"
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SPINLOCK_TICKET (1u << 16) /**< One ticket in the `next` half. */
+
+    /**
+     * @brief Ticket lock; `owner` is the low half (little-endian).
+     */
+    typedef union
+    {
+        volatile uint32_t slock;
+        struct
+        {
+            volatile uint16_t owner; /**< Ticket being served. */
+            volatile uint16_t next;  /**< Next ticket to hand out. */
+        } tickets;
+    } spinlock_t;
+
+#define SPINLOCK_INIT { .slock = 0 }
+
+    static inline void spin_lock_init(spinlock_t *lock)
+    {
+        lock->slock = 0;
+    }
+
+    /**
+     * @brief Take `lock` without touching preemption or the IRQ mask.
+     */
+    static inline void spin_lock_raw(spinlock_t *lock)
+    {
+        const uint16_t ticket = (uint16_t)(atomic32_fetch_add_relaxed(&lock->slock, SPINLOCK_TICKET) >> 16);
+
+        while (lock->tickets.owner != ticket)
+        {
+            __asm__ volatile("wfe" ::: "memory");
+        }
+        dmb(); // acquire: the critical section reads after the lock is ours
+    }
+
+    /**
+     * @brief Take `lock` if it is free, without waiting.
+     */
+    static inline bool spin_trylock_raw(spinlock_t *lock)
+    {
+        const uint32_t v = lock->slock;
+
+        if ((v >> 16) != (v & 0xFFFFu) ||
+            atomic32_cmpxchg_relaxed(&lock->slock, v, v + SPINLOCK_TICKET) != v)
+        {
+            return false;
+        }
+        dmb();
+        return true;
+    }
+
+    /**
+     * @brief Release `lock` taken with spin_lock_raw() or spin_trylock_raw().
+     */
+    static inline void spin_unlock_raw(spinlock_t *lock)
+    {
+        dmb(); // release: the critical section is visible before the next owner
+        lock->tickets.owner = (uint16_t)(lock->tickets.owner + 1u); // only the holder writes it
+        dsb();
+        __asm__ volatile("sev" ::: "memory");
+    }
+
+    /**
+     * @brief Whether some context holds `lock`.
+     */
+    static inline bool spin_is_locked(const spinlock_t *lock)
+    {
+        const uint32_t v = lock->slock;
+        return (v >> 16) != (v & 0xFFFFu);
+    }
+
+    /**
+     * @brief Take `lock` with preemption disabled until spin_unlock().
+     */
+    static inline void spin_lock(spinlock_t *lock)
+    {
+        sched_preempt_disable();
+        spin_lock_raw(lock);
+    }
+
+    static inline bool spin_trylock(spinlock_t *lock)
+    {
+        sched_preempt_disable();
+        if (spin_trylock_raw(lock))
+        {
+            return true;
+        }
+        sched_preempt_enable();
+        return false;
+    }
+
+    static inline void spin_unlock(spinlock_t *lock)
+    {
+        spin_unlock_raw(lock);
+        sched_preempt_enable();
+    }
+
+    /**
+     * @brief Mask IRQs, then take `lock`. Masked IRQs also keep preemption out.
+     *
+     * @return The IRQ state for spin_unlock_irqrestore().
+     */
+    static inline uint32_t spin_lock_irqsave(spinlock_t *lock)
+    {
+        const uint32_t flags = irq_save();
+        spin_lock_raw(lock);
+        return flags;
+    }
+
+    static inline void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
+    {
+        spin_unlock_raw(lock);
+        irq_restore(flags);
+    }
+
+#ifdef __cplusplus
+}
+#endif
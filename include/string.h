@@ -25,6 +25,37 @@ extern "C"
   */
   size_t strlen(const char *str);
 
+  /**
+   * @brief Fills `n` bytes at `dst` with `value`.
+   *
+   * Also required by the compiler, which may emit calls to it for
+   * aggregate initialization even in a freestanding build.
+   *
+   * @return `dst`.
+  */
+  void *memset(void *dst, int value, size_t n);
+
+  /**
+   * @brief Copies `n` bytes from `src` to `dst`; the regions must not overlap.
+   *
+   * @return `dst`.
+  */
+  void *memcpy(void *restrict dst, const void *restrict src, size_t n);
+
+  /**
+   * @brief Copies `n` bytes from `src` to `dst`; the regions may overlap.
+   *
+   * @return `dst`.
+  */
+  void *memmove(void *dst, const void *src, size_t n);
+
+  /**
+   * @brief Compares `n` bytes.
+   *
+   * @return int 0 if equal, -1 if `a` < `b`, 1 if `a` > `b` at the first difference.
+  */
+  int memcmp(const void *a, const void *b, size_t n);
+
 #ifdef __cplusplus
 }
 #endif
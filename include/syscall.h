@@ -0,0 +1,104 @@
+/**
+ * @file syscall.h
+ * @brief SVC system call ABI and caller-side wrappers.
+ *
+ * The number goes in r7 and up to six arguments in r0-r5; `svc #0` traps
+ * into svc_entry (start.s), which bounds-checks r7 against SYS_COUNT and
+ * calls syscall_table[r7] with the arguments. The result comes back in
+ * r0: a value >= 0, or a negative kerror_t (KERR_NOSYS for a bad number).
+ *
+ * The trap clobbers r1-r3, r12 and lr (the caller may itself be in SVC
+ * mode, where the exception overwrites lr); r4-r11 are preserved.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @enum syscall_nr_t
+     * @brief System call numbers, the index into syscall_table.
+     */
+    typedef enum syscall_nr : uint32_t
+    {
+        SYS_NULL     = 0, /**< Does nothing, returns 0. Measures the trap itself. */
+        SYS_WRITE    = 1, /**< (buf, len): queue bytes on the UART, returns len. */
+        SYS_YIELD    = 2, /**< Give up the CPU to a ready thread. */
+        SYS_SLEEP_MS = 3, /**< (ms): block for at least ms milliseconds. */
+        SYS_TIME     = 4, /**< Wall-clock seconds since the epoch. */
+        SYS_EXIT     = 5, /**< (code): end the calling task or thread, does not return. */
+        SYS_COUNT
+    } syscall_nr_t;
+
+    /**
+     * @brief Kernel side of a system call; unused arguments are ignored.
+     */
+    typedef int32_t (*syscall_fn_t)(uint32_t a0, uint32_t a1, uint32_t a2,
+                                    uint32_t a3, uint32_t a4, uint32_t a5);
+
+    /** Dispatch table used by svc_entry, SYS_COUNT entries. */
+    extern const syscall_fn_t syscall_table[];
+
+    /** SYS_COUNT, for the bounds check in svc_entry. */
+    extern const uint32_t syscall_count;
+
+#define SYSCALL_CLOBBERS "r1", "r2", "r3", "r12", "lr", "cc", "memory"
+
+    static inline int32_t syscall0(uint32_t nr)
+    {
+        register uint32_t r7 __asm__("r7") = nr;
+        register int32_t  r0 __asm__("r0");
+        __asm__ volatile("svc #0" : "=r"(r0) : "r"(r7) : SYSCALL_CLOBBERS);
+        return r0;
+    }
+
+    static inline int32_t syscall1(uint32_t nr, uint32_t a0)
+    {
+        register uint32_t r7 __asm__("r7") = nr;
+        register uint32_t r0 __asm__("r0") = a0;
+        __asm__ volatile("svc #0" : "+r"(r0) : "r"(r7) : SYSCALL_CLOBBERS);
+        return (int32_t)r0;
+    }
+
+    static inline int32_t syscall2(uint32_t nr, uint32_t a0, uint32_t a1)
+    {
+        register uint32_t r7 __asm__("r7") = nr;
+        register uint32_t r0 __asm__("r0") = a0;
+        register uint32_t r1 __asm__("r1") = a1;
+        __asm__ volatile("svc #0" : "+r"(r0), "+r"(r1) : "r"(r7) : "r2", "r3", "r12", "lr", "cc", "memory");
+        return (int32_t)r0;
+    }
+
+    static inline int32_t syscall6(uint32_t nr, uint32_t a0, uint32_t a1, uint32_t a2,
+                                   uint32_t a3, uint32_t a4, uint32_t a5)
+    {
+        register uint32_t r7 __asm__("r7") = nr;
+        register uint32_t r0 __asm__("r0") = a0;
+        register uint32_t r1 __asm__("r1") = a1;
+        register uint32_t r2 __asm__("r2") = a2;
+        register uint32_t r3 __asm__("r3") = a3;
+        register uint32_t r4 __asm__("r4") = a4;
+        register uint32_t r5 __asm__("r5") = a5;
+        __asm__ volatile("svc #0"
+                         : "+r"(r0), "+r"(r1), "+r"(r2), "+r"(r3)
+                         : "r"(r7), "r"(r4), "r"(r5)
+                         : "r12", "lr", "cc", "memory");
+        return (int32_t)r0;
+    }
+
+    /**
+     * @brief Write `len` bytes to the console through SYS_WRITE.
+     */
+    static inline int32_t sys_write(const void *buf, size_t len)
+    {
+        return syscall2(SYS_WRITE, (uint32_t)(uintptr_t)buf, (uint32_t)len);
+    }
+
+#ifdef __cplusplus
+}
+#endif
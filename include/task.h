@@ -0,0 +1,144 @@
+/**
+ * @file task.h
+ * @brief User-mode tasks: a kernel thread running a flat image in its own address space.
+ *
+ * task_create() copies the image to USER_BASE in a fresh mm, maps a user
+ * stack just below USER_END and starts a thread that drops to USR mode
+ * at USER_BASE. The task talks to the kernel only through `svc #0` (see
+ * syscall.h) and ends with SYS_EXIT. IRQs and system calls from the
+ * task run on its thread's kernel stack, so a task is preempted and
+ * scheduled like any other thread; switching between tasks reloads
+ * TTBR0 and the ASID without flushing the TLB (see mmu.h).
+ *
+ * Flat images are mapped read/write/execute: they carry their data in
+ * the same pages as their code.
+ *
+ * task_exec() runs an ELF32 executable instead (see elf.h). Nothing is
+ * copied at start: read-only pages are mapped onto the image where it
+ * allows, everything else, the stack included, is a lazy segment filled
+ * by task_abort() on the first touch. Start-up cost is then independent
+ * of the program size.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elf.h"
+#include "mmu.h"
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define TASK_STACK_SIZE  (16u * 1024u)                 /**< User stack, below USER_END. */
+#define TASK_IMAGE_MAX   (USER_SIZE - TASK_STACK_SIZE) /**< Largest flat image. */
+#define TASK_STACK_BASE  (USER_END - TASK_STACK_SIZE)  /**< Lowest user stack address. */
+#define TASK_SEGMENTS_MAX (ELF_PHNUM_MAX + 1u)         /**< PT_LOAD segments and the stack. */
+
+    /**
+     * @brief A user range whose pages are filled on first touch.
+     */
+    struct task_segment
+    {
+        uintptr_t      start;  /**< First page. */
+        uintptr_t      end;    /**< End of the last page. */
+        uintptr_t      vaddr;  /**< Where the file bytes begin. */
+        const uint8_t *src;    /**< File bytes, NULL for a zero-filled range. */
+        uint32_t       filesz;
+        uint32_t       prot;   /**< MM_PROT_* of every page. */
+    };
+
+    /**
+     * @brief A user-mode task.
+     */
+    struct task
+    {
+        struct thread *thread;    /**< Kernel thread that carries the task. */
+        struct mm     *mm;
+        uintptr_t      entry;     /**< First user instruction. */
+        int32_t        exit_code; /**< Argument of SYS_EXIT, KERR_FAULT if killed by a fault. */
+
+        struct task_segment segments[TASK_SEGMENTS_MAX]; /**< Lazy ranges, ELF tasks only. */
+        uint32_t            nsegments;
+        uint32_t            faults;   /**< Pages filled on first touch. */
+        uint32_t            in_place; /**< Pages mapped onto the image. */
+    };
+
+    /**
+     * @brief Start a task running a position-independent flat image.
+     *
+     * @param name  Thread name.
+     * @param image Code and data, copied to USER_BASE; execution starts at its first byte.
+     * @param size  Image bytes, at most TASK_IMAGE_MAX.
+     * @param prio  Thread priority.
+     *
+     * @return The task, or NULL for an empty or oversized image. Release it with task_join().
+     */
+    struct task *task_create(const char *name, const void *image, size_t size, uint32_t prio);
+
+    /**
+     * @brief Start a task running an ELF32 ARM executable.
+     *
+     * The image is read in place, now and on later page faults: it must
+     * stay valid until task_join(). Align it to PAGE_SIZE to let
+     * read-only segments be mapped onto it rather than copied.
+     *
+     * @param name  Thread name.
+     * @param image The executable, at least 4-byte aligned.
+     * @param size  Image bytes.
+     * @param prio  Thread priority.
+     *
+     * @return The task, or NULL if elf_check() rejects the image.
+     */
+    struct task *task_exec(const char *name, const void *image, size_t size, uint32_t prio);
+
+    /**
+     * @brief USR-mode abort handler, called from start.s on the task's SVC stack.
+     *
+     * Fills the page of a lazy segment on its first touch and returns to
+     * retry the access. Any other fault ends the task with KERR_FAULT.
+     *
+     * @param is_data 1 for a data abort, 0 for a prefetch abort.
+     */
+    void task_abort(uint32_t is_data);
+
+    /**
+     * @brief Like mm_access_ok(), after filling lazy pages of the range.
+     *
+     * For system calls handed user buffers that were never touched.
+     */
+    bool task_access_ok(struct task *task, uintptr_t va, size_t len, uint32_t prot);
+
+    /**
+     * @brief The task of the running thread, NULL for kernel threads.
+     */
+    struct task *task_current(void);
+
+    /**
+     * @brief End the running task (or kernel thread) with `code`. Backs SYS_EXIT.
+     */
+    [[noreturn]] void task_exit(int32_t code);
+
+    /**
+     * @brief Wait for `task` to exit and free it with its address space.
+     *
+     * @return The task's exit code.
+     */
+    int32_t task_join(struct task *task);
+
+    /**
+     * @brief Switch the calling thread to USR mode at `entry`. Implemented in context.s.
+     *
+     * @param entry      User address of the first instruction.
+     * @param user_sp    Initial USR stack pointer.
+     * @param kstack_top Top of the thread's kernel stack, where SVC and IRQ frames start.
+     */
+    [[noreturn]] void user_enter(uintptr_t entry, uintptr_t user_sp, uintptr_t kstack_top);
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,6 +10,132 @@ extern "C" {
 
 void ktests_timer_test(void);
 
+/**
+ * @brief Measure timer expiry to irq_handler() latency, idle and under load.
+ *
+ * @return 0 if every configuration collected all samples, 1 otherwise.
+ */
+int irq_latency_test(void);
+
+/**
+ * @brief Ring buffer unit tests plus SPSC/MPSC stress under Timer0 IRQs.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int ringbuf_test(void);
+
+/**
+ * @brief snprintf()/vsnformat() conversion, padding and truncation tests.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int format_test(void);
+
+/**
+ * @brief Deferred binary log and runtime log level tests.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int klog_test(void);
+
+/**
+ * @brief PL080 channel, LLI chain and UART DMA transmit tests.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int dma_test(void);
+
+/**
+ * @brief Division library correctness tests and benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int math_test(void);
+
+/**
+ * @brief Civil date conversion and cached wall-clock tests.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int datetime_test(void);
+
+/**
+ * @brief Scheduler tests and context-switch benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int thread_test(void);
+
+/**
+ * @brief Fiber tests and switch benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int fiber_test(void);
+
+/**
+ * @brief System call dispatch tests and round-trip benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int syscall_test(void);
+
+/**
+ * @brief Address space, ASID and user task tests with the TLB switch benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int mmu_test(void);
+
+/**
+ * @brief Atomics, spinlock, seqlock and wait queue tests with timer-interrupt torture and benchmarks.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int sync_test(void);
+
+/**
+ * @brief CPU time accounting tests and accounting overhead benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int cpustat_test(void);
+
+/**
+ * @brief Statistics registry tests and update cost benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int kstat_test(void);
+
+/**
+ * @brief Mode stack high-water mark and guard page tests.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int kstack_test(void);
+
+/**
+ * @brief Initrd index, in-place mapping tests and lookup benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int initrd_test(void);
+
+/**
+ * @brief ELF loader, lazy page fault tests and task start latency benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int elf_test(void);
+
+/**
+ * @brief PL181 SD card driver and buffer cache tests, and 4 KiB I/O throughput benchmark.
+ *
+ * @return 0 on tests passing, 1 on tests failure.
+ */
+int mmci_test(void);
+
 #ifdef __cplusplus
 }
 #endif
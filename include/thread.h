@@ -0,0 +1,209 @@
+/**
+ * @file thread.h
+ * @brief Preemptive kernel threads with an O(1) priority scheduler.
+ *
+ * Every thread has its own kmalloc'd SVC-mode stack and a priority in
+ * [THREAD_PRIO_IDLE, THREAD_PRIO_MAX]; higher numbers run first. Ready
+ * threads sit in one FIFO per priority, and a 32-bit bitmap records which
+ * FIFOs are non-empty, so the next thread is `31 - clz(bitmap)` away.
+ *
+ * Threads of equal priority share the CPU round-robin: the Timer0 tick
+ * charges the running thread and preempts it after THREAD_SLICE_TICKS
+ * when a peer is ready. Waking a higher-priority thread preempts at once,
+ * from thread context or at the end of the interrupt that woke it.
+ *
+ * IRQs are taken on the interrupted thread's stack (see irq_entry in
+ * start.s), so a preempted thread is switched exactly like one that
+ * yielded: context_switch() only saves callee-saved registers.
+ *
+ * Threads that own a user address space (see task.h) also carry the
+ * banked USR sp/lr and load their mm when switched in. Kernel threads
+ * keep whatever table is loaded: kernel mappings are the same in all.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ktimer.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define THREAD_PRIO_IDLE     0u   /**< Idle thread only. */
+#define THREAD_PRIO_DEFAULT  16u  /**< kernel_main and ordinary threads. */
+#define THREAD_PRIO_MAX      31u
+#define THREAD_PRIO_LEVELS   32u
+
+#define THREAD_STACK_DEFAULT 8192u /**< Includes room for IRQ frames. */
+#define THREAD_SLICE_TICKS   2u    /**< Round-robin quantum in Timer0 ticks. */
+#define THREAD_NAME_MAX      16u
+
+    struct mm;
+
+    /**
+     * @enum thread_state_t
+     * @brief Life cycle of a thread.
+     */
+    typedef enum thread_state : uint8_t
+    {
+        THREAD_READY,    /**< In a run queue. */
+        THREAD_RUNNING,  /**< On the CPU. */
+        THREAD_BLOCKED,  /**< Waiting for thread_wake(). */
+        THREAD_DEAD      /**< Exited, waiting for thread_join(). */
+    } thread_state_t;
+
+    typedef void (*thread_fn_t)(void *arg);
+
+    /**
+     * @brief Thread control block.
+     */
+    struct thread
+    {
+        uint32_t       *sp;        /**< Saved stack pointer (must stay first, used by context.s). */
+        struct thread  *next;      /**< Run queue link. */
+        struct thread  *all_next;  /**< Link of the list of all threads. */
+        thread_state_t  state;
+        uint8_t         prio;
+        uint8_t         slice;     /**< Ticks left in the current quantum. */
+        uint32_t        id;
+        void           *stack;     /**< Stack base, NULL for the boot thread. */
+        size_t          stack_size;
+        thread_fn_t     fn;
+        void           *arg;
+        struct thread  *joiner;    /**< Thread blocked in thread_join() on this one. */
+        struct ktimer   sleep;     /**< Wakes the thread from thread_sleep_ms(). */
+        uint64_t        switches;  /**< Times this thread was switched in. */
+        uint64_t        cpu_cycles; /**< Clocksource cycles charged as CPU_THREAD (see cpustat.h). */
+        uint8_t         cpu_state; /**< cpu_state_t to resume with when switched in. */
+        struct mm      *mm;        /**< User address space, NULL for kernel threads. */
+        uint32_t        usr_regs[2]; /**< Banked USR sp and lr while switched out. */
+        char            name[THREAD_NAME_MAX];
+    };
+
+    /**
+     * @brief Turn the boot context into the "main" thread and create the idle thread.
+     *
+     * Needs kmalloc_init(). Until it runs, scheduling calls are no-ops.
+     */
+    void sched_init(void);
+
+    /**
+     * @brief Create a ready thread.
+     *
+     * Preempts the caller at once if `prio` is higher than its own.
+     *
+     * @param name       Name, truncated to THREAD_NAME_MAX - 1 characters.
+     * @param fn         Entry point; returning from it exits the thread.
+     * @param arg        Passed to `fn`.
+     * @param prio       Priority, clamped to [1, THREAD_PRIO_MAX].
+     * @param stack_size Stack bytes, 0 for THREAD_STACK_DEFAULT.
+     *
+     * @return The thread; release it with thread_join().
+     */
+    struct thread *thread_create(const char *name, thread_fn_t fn, void *arg,
+                                 uint32_t prio, size_t stack_size);
+
+    /**
+     * @brief The running thread, NULL before sched_init().
+     */
+    struct thread *thread_current(void);
+
+    /**
+     * @brief Give the CPU to the next ready thread of the same or higher priority.
+     */
+    void thread_yield(void);
+
+    /**
+     * @brief Block the running thread until thread_wake().
+     *
+     * A wake that arrives first is not lost only if the caller masked IRQs
+     * before publishing itself as waiting; block with IRQs masked and the
+     * mask is kept across the switch.
+     */
+    void thread_block(void);
+
+    /**
+     * @brief Make a blocked thread ready. Safe from IRQ context.
+     *
+     * @return true if the thread was blocked.
+     */
+    bool thread_wake(struct thread *t);
+
+    /**
+     * @brief Block the running thread for at least `ms` milliseconds.
+     */
+    void thread_sleep_ms(uint32_t ms);
+
+    /**
+     * @brief End the running thread. Its joiner, if any, is woken.
+     */
+    [[noreturn]] void thread_exit(void);
+
+    /**
+     * @brief Wait for `t` to exit, then free its stack and control block.
+     */
+    void thread_join(struct thread *t);
+
+    /**
+     * @brief Change the priority of a thread, rescheduling if needed.
+     */
+    void thread_set_prio(struct thread *t, uint32_t prio);
+
+    /**
+     * @brief Call `fn` on every thread not yet joined, IRQs masked; `fn` must not block.
+     */
+    void thread_for_each(void (*fn)(struct thread *t, void *arg), void *arg);
+
+    /**
+     * @brief Give the running thread the address space `mm` and load it.
+     *
+     * Only task threads carry an mm (see task.h).
+     */
+    void thread_attach_mm(struct mm *mm);
+
+    /**
+     * @brief Defer preemption; nests. Wakes still make threads ready.
+     */
+    void sched_preempt_disable(void);
+
+    /**
+     * @brief Undo sched_preempt_disable(), switching if one was deferred.
+     */
+    void sched_preempt_enable(void);
+
+    /**
+     * @brief Whether the caller may block: scheduler up, preemption enabled, not in an IRQ.
+     */
+    bool sched_can_block(void);
+
+    /**
+     * @brief Charge the running thread one tick. Called by irq_handler().
+     */
+    void sched_tick(void);
+
+    /**
+     * @brief Switch threads if the interrupt made it necessary.
+     *
+     * Called by irq_handler() last, after the VIC has been acknowledged.
+     */
+    void sched_irq_exit(void);
+
+    /**
+     * @brief Total context switches since sched_init().
+     */
+    uint64_t sched_switch_count(void);
+
+    /**
+     * @brief Save the callee-saved registers on `prev`'s stack and resume `next`.
+     *
+     * Implemented in context.s. Call with IRQs masked.
+     */
+    void context_switch(struct thread *prev, struct thread *next);
+
+#ifdef __cplusplus
+}
+#endif
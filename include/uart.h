@@ -1,16 +1,195 @@
 /**
  * @file uart.h
- * @brief UART0 register map for QEMU VersatileAB/PB.
+ * @brief UART0 (PL011) register map and driver for QEMU VersatileAB/PB.
+ *
+ * Output is interrupt driven: writers append to a TX ring buffer and the
+ * PL011 TX interrupt drains it into the hardware FIFO. Writers only wait
+ * when the ring is full. A synchronous polled mode is kept for early boot
+ * and for the panic path.
+ *
+ * Input is interrupt driven too: the RX level and RX timeout interrupts
+ * empty the hardware FIFO into an RX ring, so bursts of pasted input do
+ * not overrun the 16-byte FIFO while the kernel is busy. Blocking readers
+ * sleep in `wfi` until data arrives.
+ *
+ * Bulk output can bypass the ring: uart_write_dma() hands a whole buffer
+ * to a PL080 channel that feeds the TX FIFO on the UART's DMA requests,
+ * and calls back when done. Ring output queued meanwhile waits for it.
  */
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "errno.h"
+
 // Memory-mapped I/O registers for UART0 on QEMU VersatileAB/PB.
+// ref: PrimeCell UART (PL011) TRM, register summary
 #define UART0_BASE  0x101F1000u
 #define UART0_DR    (*(volatile uint32_t *)UART0_BASE)          // Data Register
 #define UART0_FR    (*(volatile uint32_t *)(UART0_BASE + 0x18)) // Flag Register
+#define UART0_LCRH  (*(volatile uint32_t *)(UART0_BASE + 0x2C)) // Line Control Register
+#define UART0_CR    (*(volatile uint32_t *)(UART0_BASE + 0x30)) // Control Register
+#define UART0_IFLS  (*(volatile uint32_t *)(UART0_BASE + 0x34)) // Interrupt FIFO Level Select
+#define UART0_IMSC  (*(volatile uint32_t *)(UART0_BASE + 0x38)) // Interrupt Mask Set/Clear
+#define UART0_RIS   (*(volatile uint32_t *)(UART0_BASE + 0x3C)) // Raw Interrupt Status
+#define UART0_MIS   (*(volatile uint32_t *)(UART0_BASE + 0x40)) // Masked Interrupt Status
+#define UART0_ICR   (*(volatile uint32_t *)(UART0_BASE + 0x44)) // Interrupt Clear Register
+#define UART0_DMACR (*(volatile uint32_t *)(UART0_BASE + 0x48)) // DMA Control Register
 
 // UART Flag Register bits.
 #define UART_FR_TXFF (1u << 5) // Transmit FIFO full
 #define UART_FR_RXFE (1u << 4) // Receive FIFO empty
+
+// UART Line Control bits.
+#define UART_LCRH_FEN   (1u << 4) // FIFOs enabled
+#define UART_LCRH_WLEN8 (3u << 5) // 8 data bits
+
+// UART Control bits.
+#define UART_CR_UARTEN (1u << 0)
+#define UART_CR_TXE    (1u << 8)
+#define UART_CR_RXE    (1u << 9)
+
+// UART DMA Control bits.
+#define UART_DMACR_TXDMAE (1u << 1) // TX DMA requests enabled
+
+// UART interrupt bits (IMSC/RIS/MIS/ICR).
+#define UART_INT_RX (1u << 4)  // Receive FIFO level
+#define UART_INT_TX (1u << 5)  // Transmit FIFO level
+#define UART_INT_RT (1u << 6)  // Receive timeout
+
+// IFLS triggers: TX when the FIFO drops to <= 1/2 full, RX when it fills to >= 1/2.
+#define UART_IFLS_TX_HALF (2u << 0)
+#define UART_IFLS_RX_HALF (2u << 3)
+
+/** Size of the TX ring buffer in bytes (power of two). */
+#define UART_TX_RING_SIZE 4096u
+
+/** Size of the RX ring buffer in bytes (power of two). */
+#define UART_RX_RING_SIZE 1024u
+
+/** LLIs available to one DMA write; each moves up to 4095 bytes. */
+#define UART_DMA_MAX_LLI 32u
+
+/** A DMA write that makes no progress for this long falls back to the ring. */
+#define UART_DMA_WATCHDOG_MS 20u
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Configure UART0 FIFOs and switch output to interrupt driven mode.
+     *
+     * Until this runs, output is synchronous (polled).
+     */
+    void uart_init(void);
+
+    /**
+     * @brief Queue one character for transmission.
+     *
+     * Blocks only while the TX ring is full.
+     */
+    void uart_putc(char c);
+
+    /**
+     * @brief Queue `len` bytes for transmission.
+     *
+     * Copies as much as fits per critical section; blocks only while the
+     * TX ring is full.
+     */
+    void uart_write(const char *buf, size_t len);
+
+    /**
+     * @brief Completion callback of uart_write_dma(), may run in IRQ context.
+     */
+    typedef void (*uart_dma_done_t)(kerror_t status, void *arg);
+
+    /**
+     * @brief Transmit `len` bytes from `buf` by DMA, without CPU copies.
+     *
+     * Bytes already in the TX ring go out first; ring output queued while
+     * the transfer runs follows it. `buf` must stay valid and unchanged
+     * until `done` runs. One transfer at a time.
+     *
+     * If DMA is unavailable (polled mode, no free channel) the bytes go
+     * through the ring and `done` runs before returning. If the transfer
+     * stalls for UART_DMA_WATCHDOG_MS, the rest is sent through the ring,
+     * and later calls use the ring directly.
+     *
+     * @param buf  Data to send.
+     * @param len  Bytes to send, at most UART_DMA_MAX_LLI * 4095.
+     * @param done Called once everything is handed to the UART, may be NULL.
+     * @param arg  Passed to `done`.
+     *
+     * @return KERR_OK if started, KERR_BUSY while another transfer runs,
+     *         KERR_INVAL for an empty or oversized buffer.
+     */
+    kerror_t uart_write_dma(const void *buf, size_t len, uart_dma_done_t done, void *arg);
+
+    /**
+     * @brief Whether a uart_write_dma() transfer is in flight.
+     */
+    bool uart_dma_busy(void);
+
+    /**
+     * @brief Wait until every queued byte has been handed to the hardware FIFO.
+     *
+     * Also waits out an in-flight DMA transfer, which needs IRQs enabled.
+     */
+    void uart_flush(void);
+
+    /**
+     * @brief Switch to synchronous polled output, draining the ring first.
+     *
+     * Used by the panic path: works with IRQs masked and never returns
+     * before everything queued so far has been written to the FIFO.
+     */
+    void uart_sync_mode(void);
+
+    /**
+     * @brief Blocking character input.
+     *
+     * The calling thread blocks on a wait queue until the RX interrupt
+     * delivers a byte (before the scheduler runs, or with preemption
+     * disabled, it sleeps in `wfi`). With IRQs masked by the caller, or
+     * before uart_init(), it polls the hardware FIFO instead.
+     *
+     * @return The next received character.
+     */
+    char uart_getc(void);
+
+    /**
+     * @brief Non-blocking read of everything already received.
+     *
+     * @param buf Destination buffer.
+     * @param len Capacity of `buf`.
+     *
+     * @return Number of bytes copied, 0 if nothing is pending.
+     */
+    size_t uart_read(char *buf, size_t len);
+
+    struct fiber_event;
+
+    /**
+     * @brief Event signaled by the RX interrupt whenever input arrives.
+     *
+     * Fibers wait on it through fiber_uart_read().
+     */
+    struct fiber_event *uart_rx_event(void);
+
+    /**
+     * @brief Number of received bytes dropped because the RX ring was full.
+     */
+    uint32_t uart_rx_dropped(void);
+
+    /**
+     * @brief UART0 interrupt handler, called from irq_handler().
+     */
+    void uart_irq_handler(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file waitqueue.h
+ * @brief Wait queues: sleep until a condition holds, woken from threads or IRQs.
+ *
+ * A waiter lives on the sleeper's stack and is queued with IRQs masked,
+ * after the condition was found false and before the sleeper gives up
+ * the CPU. A waker sets the condition first and calls wake_up(), which
+ * masks IRQs too, so the wake-up either finds the waiter queued or the
+ * sleeper sees the condition: none is ever lost.
+ *
+ * A thread that may block sleeps in thread_block(). Before sched_init()
+ * or with preemption disabled, the caller sleeps in WFI instead and
+ * re-checks the condition after every interrupt. Waiting in an IRQ
+ * handler is a bug and panics.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "interrupt.h"
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief A sleeper queued on a wait_queue.
+     */
+    struct waiter
+    {
+        struct waiter *next;
+        struct thread *thread; /**< NULL when sleeping in WFI. */
+        volatile bool  queued; /**< Cleared by the waker. */
+    };
+
+    /**
+     * @brief FIFO of waiters.
+     */
+    struct wait_queue
+    {
+        struct waiter *head;
+        struct waiter *tail;
+    };
+
+#define WAIT_QUEUE_INIT { .head = NULL, .tail = NULL }
+
+    void wait_queue_init(struct wait_queue *wq);
+
+    /**
+     * @brief Queue `w` for the running context. Call with IRQs masked.
+     */
+    void wait_prepare(struct wait_queue *wq, struct waiter *w);
+
+    /**
+     * @brief Sleep until `w` is woken or, in WFI mode, until any interrupt.
+     *
+     * Call with IRQs masked; they are masked again on return.
+     */
+    void wait_sleep(struct waiter *w);
+
+    /**
+     * @brief Dequeue `w` if no waker did. Call with IRQs masked.
+     */
+    void wait_finish(struct wait_queue *wq, struct waiter *w);
+
+    /**
+     * @brief Wake the oldest waiter. Safe from IRQ context.
+     *
+     * @return true if there was one.
+     */
+    bool wake_up(struct wait_queue *wq);
+
+    /**
+     * @brief Wake every waiter. Safe from IRQ context.
+     *
+     * @return Number of waiters woken.
+     */
+    uint32_t wake_up_all(struct wait_queue *wq);
+
+    /**
+     * @brief Whether no one waits on `wq`.
+     */
+    static inline bool wait_queue_empty(const struct wait_queue *wq)
+    {
+        return wq->head == NULL;
+    }
+
+/**
+ * @brief Sleep on `wq` until `condition` is true.
+ *
+ * `condition` is evaluated with IRQs masked, once more after every
+ * wake-up; wakers make it true before calling wake_up().
+ */
+#define wait_event(wq, condition)                \
+    do                                           \
+    {                                            \
+        const uint32_t wait_flags_ = irq_save(); \
+        while (!(condition))                     \
+        {                                        \
+            struct waiter wait_w_;               \
+            wait_prepare((wq), &wait_w_);        \
+            wait_sleep(&wait_w_);                \
+            wait_finish((wq), &wait_w_);         \
+        }                                        \
+        irq_restore(wait_flags_);                \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
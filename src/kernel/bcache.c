@@ -0,0 +1,424 @@
+/**
+ * @file bcache.c
+ * @brief Hashed LRU buffer cache with dirty-run write-back and read-ahead.
+ */
+#include "bcache.h"
+#include "memory.h"
+#include "kstat.h"
+#include "string.h"
+#include "waitqueue.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUF_VALID     (1u << 0)
+#define BUF_DIRTY     (1u << 1)
+#define BUF_AHEAD     (1u << 2)  /**< Fetched by read-ahead, not read yet. */
+
+struct bcache_buf
+{
+    struct bcache_buf *hnext;  /**< Hash chain. */
+    struct bcache_buf *prev;   /**< LRU list, toward the most recent. */
+    struct bcache_buf *next;
+    uint32_t           block;
+    uint32_t           flags;
+    uint8_t           *data;
+};
+
+static struct bcache_buf *bufs       = NULL;
+static uint8_t           *buf_data   = NULL;
+static struct bcache_buf *hash[BCACHE_HASH_SIZE];
+static struct bcache_buf  lru;                /**< Sentinel: lru.next is the most recent. */
+static uint32_t           dev_blocks = 0;
+static uint32_t           seq_next   = UINT32_MAX; /**< Block a sequential reader asks next. */
+static uint32_t           ra_window  = 0;
+static bool               locked     = false;
+static struct wait_queue  lock_wq    = WAIT_QUEUE_INIT;
+
+// Updated under the cache lock only
+KSTAT_DEFINE(bcache_hits);
+KSTAT_DEFINE(bcache_misses);
+KSTAT_DEFINE(bcache_readahead_blocks);
+KSTAT_DEFINE(bcache_readahead_hits);
+KSTAT_DEFINE(bcache_evictions);
+KSTAT_DEFINE(bcache_writeback_blocks);
+KSTAT_DEFINE(bcache_writeback_runs);
+KSTAT_GAUGE_DEFINE(bcache_dirty);
+
+static bool try_lock(void)
+{
+    if (locked)
+    {
+        return false;
+    }
+    locked = true;
+    return true;
+}
+
+static void lock(void)
+{
+    wait_event(&lock_wq, try_lock());
+}
+
+static void unlock(void)
+{
+    const uint32_t flags = irq_save();
+    locked = false;
+    wake_up(&lock_wq);
+    irq_restore(flags);
+}
+
+// --- Hash and LRU ---
+
+static inline uint32_t bucket(uint32_t block)
+{
+    return block & (BCACHE_HASH_SIZE - 1u); // runs of blocks spread over consecutive buckets
+}
+
+static struct bcache_buf *lookup(uint32_t block)
+{
+    for (struct bcache_buf *b = hash[bucket(block)]; b; b = b->hnext)
+    {
+        if (b->block == block)
+        {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+static void hash_insert(struct bcache_buf *b)
+{
+    b->hnext = hash[bucket(b->block)];
+    hash[bucket(b->block)] = b;
+}
+
+static void hash_remove(struct bcache_buf *b)
+{
+    struct bcache_buf **link = &hash[bucket(b->block)];
+    while (*link != b)
+    {
+        link = &(*link)->hnext;
+    }
+    *link = b->hnext;
+}
+
+static void lru_unlink(struct bcache_buf *b)
+{
+    b->prev->next = b->next;
+    b->next->prev = b->prev;
+}
+
+static void lru_push_front(struct bcache_buf *b)
+{
+    b->next         = lru.next;
+    b->prev         = &lru;
+    lru.next->prev  = b;
+    lru.next        = b;
+}
+
+static void lru_push_back(struct bcache_buf *b)
+{
+    b->prev         = lru.prev;
+    b->next         = &lru;
+    lru.prev->next  = b;
+    lru.prev        = b;
+}
+
+static void lru_touch(struct bcache_buf *b)
+{
+    lru_unlink(b);
+    lru_push_front(b);
+}
+
+// --- Write-back ---
+
+static inline bool dirty(const struct bcache_buf *b)
+{
+    return b && (b->flags & BUF_DIRTY);
+}
+
+/**
+ * @internal
+ * @brief Write `b` and the dirty blocks around it in one multi-block command.
+ */
+static kerror_t writeback(struct bcache_buf *b)
+{
+    uint32_t first = b->block;
+    while (first > 0 && b->block - first < BCACHE_RUN_MAX - 1u && dirty(lookup(first - 1u)))
+    {
+        first--;
+    }
+
+    struct bcache_buf *run[BCACHE_RUN_MAX];
+    struct mmci_iov    iov[BCACHE_RUN_MAX] = { 0 };
+    uint32_t           n = 0;
+    for (struct bcache_buf *r = lookup(first); n < BCACHE_RUN_MAX && dirty(r); r = lookup(first + n))
+    {
+        run[n] = r;
+        iov[n] = (struct mmci_iov){ .buf = r->data, .len = BCACHE_BLOCK_SIZE };
+        n++;
+    }
+
+    const kerror_t err = mmci_writev(first * BCACHE_BLOCK_SECTORS, iov, n);
+    if (err != KERR_OK)
+    {
+        KLOGS(KLOG_SYS_KERNEL, KLOG_ERROR, "bcache: write-back of blocks %u-%u failed", first, first + n - 1u);
+        return err;
+    }
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        run[i]->flags &= ~BUF_DIRTY;
+    }
+    kstat_sub(bcache_dirty, n);
+    kstat_add(bcache_writeback_blocks, n);
+    kstat_inc(bcache_writeback_runs);
+    return KERR_OK;
+}
+
+/**
+ * @internal
+ * @brief Take the least recently used buffer out of the cache and the LRU list.
+ *
+ * The caller gives it a block and puts it back with lru_push_*().
+ */
+static kerror_t evict(struct bcache_buf **out)
+{
+    struct bcache_buf *b = lru.prev;
+    if (dirty(b))
+    {
+        const kerror_t err = writeback(b);
+        if (err != KERR_OK)
+        {
+            return err;
+        }
+    }
+
+    if (b->flags & BUF_VALID)
+    {
+        hash_remove(b);
+        kstat_inc(bcache_evictions);
+    }
+    b->flags = 0;
+    lru_unlink(b);
+    *out = b;
+    return KERR_OK;
+}
+
+// --- Reads ---
+
+/**
+ * @internal
+ * @brief Read `block` and up to `window - 1` uncached blocks after it in one command.
+ */
+static kerror_t fetch(uint32_t block, uint32_t window, struct bcache_buf **out)
+{
+    uint32_t n = 1;
+    while (n < window && block + n < dev_blocks && !lookup(block + n))
+    {
+        n++;
+    }
+
+    struct bcache_buf *got[BCACHE_READAHEAD_MAX];
+    struct mmci_iov    iov[BCACHE_READAHEAD_MAX];
+    kerror_t           err   = KERR_OK;
+    uint32_t           taken = 0;
+
+    while (taken < n && (err = evict(&got[taken])) == KERR_OK)
+    {
+        iov[taken] = (struct mmci_iov){ .buf = got[taken]->data, .len = BCACHE_BLOCK_SIZE };
+        taken++;
+    }
+    if (err == KERR_OK)
+    {
+        err = mmci_readv(block * BCACHE_BLOCK_SECTORS, iov, n);
+    }
+
+    if (err != KERR_OK)
+    {
+        for (uint32_t i = 0; i < taken; i++)
+        {
+            lru_push_back(got[i]);
+        }
+        return err;
+    }
+
+    // Read-ahead blocks go just behind the one asked for: they are next
+    for (uint32_t i = n; i-- > 0;)
+    {
+        got[i]->block = block + i;
+        got[i]->flags = BUF_VALID | (i ? BUF_AHEAD : 0u);
+        hash_insert(got[i]);
+        lru_push_front(got[i]);
+    }
+    kstat_add(bcache_readahead_blocks, n - 1u);
+    *out = got[0];
+    return KERR_OK;
+}
+
+kerror_t bcache_init(void)
+{
+    dev_blocks = mmci_present() ? mmci_sectors() / BCACHE_BLOCK_SECTORS : 0;
+    if (!dev_blocks)
+    {
+        return KERR_NOT_FOUND;
+    }
+
+    if (!bufs)
+    {
+        bufs     = kmalloc(BCACHE_BUFFERS * sizeof(*bufs));
+        buf_data = kmalloc(BCACHE_BUFFERS * BCACHE_BLOCK_SIZE);
+        if (!bufs || !buf_data)
+        {
+            kfree(bufs);
+            kfree(buf_data);
+            bufs       = NULL;
+            buf_data   = NULL;
+            dev_blocks = 0;
+            return KERR_NOMEM;
+        }
+    }
+
+    lock();
+    memset(hash, 0, sizeof(hash));
+    lru.next = lru.prev = &lru;
+    for (uint32_t i = 0; i < BCACHE_BUFFERS; i++)
+    {
+        bufs[i] = (struct bcache_buf){ .data = buf_data + i * BCACHE_BLOCK_SIZE };
+        lru_push_back(&bufs[i]);
+    }
+    kstat_set(bcache_dirty, 0);
+    seq_next  = UINT32_MAX;
+    ra_window = 0;
+    unlock();
+
+    KLOG(KLOG_INFO, "bcache: %u x %u byte buffers, %u blocks", BCACHE_BUFFERS, BCACHE_BLOCK_SIZE, dev_blocks);
+    return KERR_OK;
+}
+
+uint32_t bcache_blocks(void)
+{
+    return dev_blocks;
+}
+
+kerror_t bcache_read(uint32_t block, void *dst)
+{
+    if (block >= dev_blocks)
+    {
+        return dev_blocks ? KERR_INVAL : KERR_NOT_FOUND;
+    }
+
+    lock();
+
+    // Double the window while the reader stays sequential, drop it otherwise
+    ra_window = block == seq_next ? MIN(MAX(ra_window * 2u, 2u), BCACHE_READAHEAD_MAX) : 1u;
+    seq_next  = block + 1u;
+
+    struct bcache_buf *b   = lookup(block);
+    kerror_t           err = KERR_OK;
+    if (b)
+    {
+        kstat_inc(bcache_hits);
+        if (b->flags & BUF_AHEAD)
+        {
+            kstat_inc(bcache_readahead_hits);
+            b->flags &= ~BUF_AHEAD;
+        }
+        lru_touch(b);
+    }
+    else
+    {
+        kstat_inc(bcache_misses);
+        err = fetch(block, ra_window, &b);
+    }
+
+    if (err == KERR_OK)
+    {
+        memcpy(dst, b->data, BCACHE_BLOCK_SIZE);
+    }
+    unlock();
+    return err;
+}
+
+kerror_t bcache_write(uint32_t block, const void *src)
+{
+    if (block >= dev_blocks)
+    {
+        return dev_blocks ? KERR_INVAL : KERR_NOT_FOUND;
+    }
+
+    lock();
+
+    // A whole block is replaced: a miss needs a buffer, not a read
+    struct bcache_buf *b   = lookup(block);
+    kerror_t           err = KERR_OK;
+    if (b)
+    {
+        lru_unlink(b);
+    }
+    else if ((err = evict(&b)) == KERR_OK)
+    {
+        b->block = block;
+        b->flags = BUF_VALID;
+        hash_insert(b);
+    }
+
+    if (err == KERR_OK)
+    {
+        memcpy(b->data, src, BCACHE_BLOCK_SIZE);
+        if (!(b->flags & BUF_DIRTY))
+        {
+            kstat_add(bcache_dirty, 1);
+        }
+        b->flags = (b->flags | BUF_DIRTY) & ~BUF_AHEAD;
+        lru_push_front(b);
+    }
+    unlock();
+    return err;
+}
+
+static kerror_t sync_locked(void)
+{
+    kerror_t err = KERR_OK;
+    for (uint32_t i = 0; i < BCACHE_BUFFERS && bufs && err == KERR_OK; i++)
+    {
+        if (dirty(&bufs[i]))
+        {
+            err = writeback(&bufs[i]);
+        }
+    }
+    return err;
+}
+
+kerror_t bcache_sync(void)
+{
+    lock();
+    const kerror_t err = sync_locked();
+    unlock();
+    return err;
+}
+
+kerror_t bcache_invalidate(void)
+{
+    lock();
+    const kerror_t err = sync_locked();
+    if (err == KERR_OK)
+    {
+        for (uint32_t i = 0; i < BCACHE_BUFFERS && bufs; i++)
+        {
+            if (bufs[i].flags & BUF_VALID)
+            {
+                hash_remove(&bufs[i]);
+            }
+            bufs[i].flags = 0;
+        }
+    }
+    seq_next  = UINT32_MAX;
+    ra_window = 0;
+    unlock();
+    return err;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file clock.c
+ * @brief Monotonic clocksource on SP804 Timer1 with a seqcount-protected epoch.
+ *
+ * The 64-bit cycle count is `(epoch << 32) | ~T1_VALUE`: Timer1 counts down
+ * from 0xFFFFFFFF, so its one's complement counts up from zero. The only
+ * writer of `clock_epoch` is the Timer1 wrap interrupt, which serialises
+ * updates of the seqcount; readers retry when it moved during their read.
+ */
+#include "clock.h"
+#include "interrupt.h"
+#include "seqlock.h"
+#include "lib/math.h"
+
+#include <stdint.h>
+
+#define NSEC_PER_SEC  1000000000u
+#define USEC_PER_SEC  1000000u
+
+static seqcount_t        clock_seq   = SEQCOUNT_INIT;
+static volatile uint32_t clock_epoch = 0;
+
+static uint32_t clock_freq     = 0;
+static uint32_t clock_ns_mult  = 0;
+static uint32_t clock_ns_shift = 0;
+static uint32_t clock_us_mult  = 0;
+static uint32_t clock_us_shift = 0;
+
+/**
+ * @internal
+ * @brief Compute `mult`/`shift` so that `out = (in * mult) >> shift`.
+ *
+ * Long-divides `to_hz / from_hz` one fractional bit at a time, keeping as
+ * many bits as fit in a 32-bit multiplier. Exact ratios stop early with
+ * the smallest shift. Only runs once at init, so the bit-serial loop is fine.
+ */
+static void clock_calc_mult_shift(uint32_t to_hz, uint32_t from_hz,
+                                  uint32_t *mult, uint32_t *shift)
+{
+    uint64_t m   = _udiv32(to_hz, from_hz);
+    uint64_t rem = to_hz - (uint32_t)m * from_hz;
+    uint32_t s   = 0;
+
+    while (rem != 0 && s < 32 && m < (1ull << 31))
+    {
+        rem <<= 1;
+        m   <<= 1;
+        if (rem >= from_hz)
+        {
+            rem -= from_hz;
+            m   |= 1;
+        }
+        s++;
+    }
+
+    *mult  = (uint32_t)m;
+    *shift = s;
+}
+
+/**
+ * @internal
+ * @brief Scale a 64-bit cycle count without overflowing the 64-bit product.
+ *
+ * Splits the count into 32-bit halves so each partial product fits.
+ */
+static inline uint64_t clock_scale(uint64_t cycles, uint32_t mult, uint32_t shift)
+{
+    const uint64_t hi = (cycles >> 32) * mult;
+    const uint64_t lo = ((uint64_t)(uint32_t)cycles * mult) >> shift;
+    return (hi << (32 - shift)) + lo;
+}
+
+void clock_init(uint32_t timer_clk_hz)
+{
+    if (timer_clk_hz == 0)
+    {
+        timer_clk_hz = 1000000; // fallback to 1 MHz
+    }
+
+    clock_freq = timer_clk_hz;
+    clock_calc_mult_shift(NSEC_PER_SEC, timer_clk_hz, &clock_ns_mult, &clock_ns_shift);
+    clock_calc_mult_shift(USEC_PER_SEC, timer_clk_hz, &clock_us_mult, &clock_us_shift);
+
+    seqcount_init(&clock_seq);
+    clock_epoch = 0;
+
+    // Free-running mode wraps to 0xFFFFFFFF; LOAD seeds the first period.
+    T1_CONTROL = 0;
+    T1_LOAD    = 0xFFFFFFFFu;
+    T1_INTCLR  = 1;
+    T1_CONTROL = TCTRL_32BIT | TCTRL_INTEN | TCTRL_ENABLE;
+
+    vic_enable_timer01_irq();
+}
+
+void clock_handle_wrap(void)
+{
+    write_seqcount_begin(&clock_seq);
+    clock_epoch = clock_epoch + 1;
+    T1_INTCLR   = 1;
+    write_seqcount_end(&clock_seq);
+}
+
+uint64_t clock_cycles(void)
+{
+    uint32_t seq;
+    uint32_t epoch;
+    uint32_t value;
+    uint32_t pending;
+
+    do
+    {
+        seq     = read_seqcount_begin(&clock_seq);
+        epoch   = clock_epoch;
+        value   = T1_VALUE;
+        pending = T1_RIS;
+    } while (read_seqcount_retry(&clock_seq, seq));
+
+    const uint32_t elapsed = ~value;
+
+    // Wrapped but the IRQ has not run yet (IRQs masked, or it is just about
+    // to fire). A small elapsed value means the wrap precedes our read.
+    if (pending && elapsed < 0x80000000u)
+    {
+        epoch++;
+    }
+
+    return ((uint64_t)epoch << 32) | elapsed;
+}
+
+uint32_t clock_cycles32(void)
+{
+    return ~T1_VALUE;
+}
+
+uint64_t clock_cycles_to_ns(uint64_t cycles)
+{
+    return clock_scale(cycles, clock_ns_mult, clock_ns_shift);
+}
+
+uint64_t clock_cycles_to_us(uint64_t cycles)
+{
+    return clock_scale(cycles, clock_us_mult, clock_us_shift);
+}
+
+uint64_t clock_monotonic_ns(void)
+{
+    return clock_scale(clock_cycles(), clock_ns_mult, clock_ns_shift);
+}
+
+uint64_t clock_monotonic_us(void)
+{
+    return clock_scale(clock_cycles(), clock_us_mult, clock_us_shift);
+}
+
+uint32_t clock_hz(void)
+{
+    return clock_freq;
+}
@@ -0,0 +1,67 @@
+/* context.s — thread context switch, ARMv7-A (Cortex-A8), ARM state (A32) */
+
+    .syntax unified
+    .cpu    cortex-a8
+    .arch   armv7-a
+
+    .section .text, "ax", %progbits
+    .align 4
+
+/* ------------------------------------------------------------- */
+/* void context_switch(struct thread *prev, struct thread *next) */
+/* ------------------------------------------------------------- */
+// Only the AAPCS callee-saved registers need saving: the caller (and, for
+// a preempted thread, irq_entry) already keeps everything else on the
+// stack. R12 pads the frame to 40 bytes so sp stays 8-byte aligned.
+// The kernel is built soft-float, so there is no VFP state to switch.
+// fiber_switch() is the same operation on struct fiber, whose saved sp is
+// also its first member.
+    .global context_switch
+    .type   context_switch, %function
+    .global fiber_switch
+    .type   fiber_switch, %function
+context_switch:
+fiber_switch:
+    STMDB   sp!, {R4-R12, LR}
+    STR     sp, [R0]                // prev->sp (first member of struct thread)
+    LDR     sp, [R1]                // next->sp
+    CLREX                           // drop any exclusive reservation of prev
+    LDMIA   sp!, {R4-R12, LR}
+    BX      LR                      // new threads "return" into thread_entry()
+    .size   context_switch, . - context_switch
+    .size   fiber_switch, . - fiber_switch
+
+/* ------------------------------------------------------------- */
+/* void user_enter(uintptr_t entry, uintptr_t user_sp,           */
+/*                 uintptr_t kstack_top)                         */
+/* ------------------------------------------------------------- */
+// Drops the calling thread into USR mode at `entry`, never returns. The
+// SVC stack restarts at `kstack_top`: the frames below it are dead, and
+// every later SVC or IRQ taken from user mode begins on an empty stack.
+// Registers are cleared so no kernel value leaks into the task.
+    .global user_enter
+    .type   user_enter, %function
+user_enter:
+    CPSID   i
+    MOV     sp, R2
+    CPS     #0x1F                   // SYS mode shares sp and lr with USR
+    MOV     sp, R1
+    MOV     lr, #0
+    CPS     #0x13
+    MOV     R1, #0x50               // USR mode, IRQs on, FIQs masked, ARM state
+    STMDB   sp!, {R0, R1}           // RFE frame: pc, then cpsr
+    MOV     R0, #0
+    MOV     R1, #0
+    MOV     R2, #0
+    MOV     R3, #0
+    MOV     R4, #0
+    MOV     R5, #0
+    MOV     R6, #0
+    MOV     R7, #0
+    MOV     R8, #0
+    MOV     R9, #0
+    MOV     R10, #0
+    MOV     R11, #0
+    MOV     R12, #0
+    RFEIA   sp!
+    .size   user_enter, . - user_enter
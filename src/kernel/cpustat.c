@@ -0,0 +1,121 @@
+/**
+ * @file cpustat.c
+ * @brief CPU time buckets charged at state transitions.
+ *
+ * All counters are updated with IRQs masked, so an interrupt never lands
+ * between reading the clock and moving the mark.
+ */
+#include "cpustat.h"
+#include "clock.h"
+#include "interrupt.h"
+#include "thread.h"
+
+#include <stdint.h>
+
+static cpu_state_t    cpu_state = CPU_THREAD;
+static uint32_t       cpu_mark  = 0;
+static struct cpustat stats;
+
+static const char *const STATE_NAMES[CPU_STATES] = {
+    [CPU_THREAD]   = "thread",
+    [CPU_DEFERRED] = "deferred",
+    [CPU_IRQ]      = "irq",
+    [CPU_IDLE]     = "idle",
+};
+
+/**
+ * @internal
+ * @brief Charge the cycles since the last transition. IRQs masked.
+ */
+static inline void charge(void)
+{
+    const uint32_t now   = clock_cycles32();
+    const uint32_t delta = now - cpu_mark;
+
+    cpu_mark = now;
+    stats.state[cpu_state] += delta;
+
+    if (cpu_state == CPU_THREAD)
+    {
+        struct thread *self = thread_current();
+        if (self)
+        {
+            self->cpu_cycles += delta;
+        }
+    }
+}
+
+void cpustat_init(void)
+{
+    const uint32_t flags = irq_save();
+    stats     = (struct cpustat){ 0 };
+    cpu_state = CPU_THREAD;
+    cpu_mark  = clock_cycles32();
+    irq_restore(flags);
+}
+
+cpu_state_t cpustat_enter(cpu_state_t state)
+{
+    const uint32_t    flags = irq_save();
+    const cpu_state_t prev  = cpu_state;
+
+    charge();
+    cpu_state = state;
+
+    irq_restore(flags);
+    return prev;
+}
+
+void cpustat_leave(cpu_state_t prev)
+{
+    (void)cpustat_enter(prev);
+}
+
+uint32_t cpustat_now(void)
+{
+    return clock_cycles32();
+}
+
+void cpustat_irq_line(uint32_t line, uint32_t start)
+{
+    line %= CPUSTAT_IRQ_LINES;
+    stats.irq_cycles[line] += clock_cycles32() - start;
+    stats.irq_count[line]++;
+}
+
+void cpustat_wfi(void)
+{
+    const uint32_t    flags = irq_save();
+    const cpu_state_t prev  = cpu_state;
+
+    charge();
+    cpu_state = CPU_IDLE;
+
+    // Wakes on a pending IRQ even while masked
+    __asm__ volatile("wfi" ::: "memory");
+
+    charge();
+    cpu_state = prev;
+
+    irq_restore(flags);
+}
+
+void cpustat_switch(struct thread *prev, struct thread *next)
+{
+    charge();
+    prev->cpu_state = cpu_state;
+    cpu_state       = (cpu_state_t)next->cpu_state;
+}
+
+void cpustat_sample(struct cpustat *out)
+{
+    const uint32_t flags = irq_save();
+    charge();
+    *out = stats;
+    irq_restore(flags);
+}
+
+const char *cpustat_state_str(cpu_state_t state)
+{
+    return state < CPU_STATES ? STATE_NAMES[state] : "?";
+}
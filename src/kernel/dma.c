@@ -0,0 +1,214 @@
+/**
+ * @file dma.c
+ * @brief PL080 channel allocation, LLI chains and completion interrupts.
+ */
+#include "dma.h"
+#include "interrupt.h"
+#include "barrier.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bounded wait for a halted channel to drain its FIFO. */
+#define DMA_HALT_SPINS 100000u
+
+struct dma_chan
+{
+    bool           used;
+    dma_callback_t cb;
+    void          *arg;
+};
+
+static struct dma_chan dma_chans[DMA_CHANNELS];
+
+static inline bool dma_valid(int channel)
+{
+    return channel >= 0 && channel < DMA_CHANNELS;
+}
+
+void dma_init(void)
+{
+    DMAC_CONFIG = 0;
+    for (int ch = 0; ch < DMA_CHANNELS; ch++)
+    {
+        DMAC_CH_CONFIG(ch) = 0;
+    }
+    DMAC_INTTCCLEAR = 0xFF;
+    DMAC_INTERRCLR  = 0xFF;
+    DMAC_CONFIG     = DMAC_CONFIG_E; // little-endian masters
+
+    vic_enable_irq(IRQ_DMA);
+    KLOGS(KLOG_SYS_IRQ, KLOG_DEBUG, "pl080 dma ready, %d channels", DMA_CHANNELS);
+}
+
+int dma_channel_alloc(void)
+{
+    const uint32_t flags = irq_save();
+    int found = -1;
+
+    for (int ch = 0; ch < DMA_CHANNELS; ch++)
+    {
+        if (!dma_chans[ch].used)
+        {
+            dma_chans[ch].used = true;
+            found = ch;
+            break;
+        }
+    }
+
+    irq_restore(flags);
+    return found;
+}
+
+void dma_channel_free(int channel)
+{
+    if (!dma_valid(channel))
+    {
+        return;
+    }
+
+    dma_abort(channel);
+    dma_chans[channel] = (struct dma_chan){ 0 };
+}
+
+uint32_t dma_lli_chain(dma_lli_t *lli, uint32_t max, uintptr_t src, uintptr_t dst,
+                       size_t units, uint32_t control)
+{
+    const uint32_t swidth = (control >> 18) & 7u;
+    uint32_t used = 0;
+
+    control &= ~(DMA_CTRL_SIZE_MAX | DMA_CTRL_I);
+
+    while (units)
+    {
+        if (used == max)
+        {
+            return 0;
+        }
+
+        const uint32_t n = units > DMA_CTRL_SIZE_MAX ? DMA_CTRL_SIZE_MAX : (uint32_t)units;
+
+        lli[used] = (dma_lli_t){
+            .src     = (uint32_t)src,
+            .dst     = (uint32_t)dst,
+            .next    = 0,
+            .control = control | n,
+        };
+        if (used)
+        {
+            lli[used - 1].next = (uint32_t)(uintptr_t)&lli[used];
+        }
+
+        // Both sides move by the same number of bytes
+        const uintptr_t bytes = (uintptr_t)n << swidth;
+        if (control & DMA_CTRL_SI)
+        {
+            src += bytes;
+        }
+        if (control & DMA_CTRL_DI)
+        {
+            dst += bytes;
+        }
+
+        units -= n;
+        used++;
+    }
+
+    if (used)
+    {
+        lli[used - 1].control |= DMA_CTRL_I;
+    }
+    return used;
+}
+
+kerror_t dma_start(int channel, const dma_lli_t *chain, uint32_t config,
+                   dma_callback_t cb, void *arg)
+{
+    if (!dma_valid(channel) || !dma_chans[channel].used || chain == NULL)
+    {
+        return KERR_INVAL;
+    }
+    if (dma_busy(channel))
+    {
+        return KERR_BUSY;
+    }
+
+    dma_chans[channel].cb  = cb;
+    dma_chans[channel].arg = arg;
+
+    // Clear stale status, then load the first item into the registers
+    DMAC_INTTCCLEAR = 1u << channel;
+    DMAC_INTERRCLR  = 1u << channel;
+
+    DMAC_CH_SRC(channel)     = chain->src;
+    DMAC_CH_DST(channel)     = chain->dst;
+    DMAC_CH_LLI(channel)     = chain->next;
+    DMAC_CH_CONTROL(channel) = chain->control;
+
+    config &= ~(DMA_CFG_E | DMA_CFG_HALT);
+    config |= DMA_CFG_IE | DMA_CFG_ITC;
+
+    dsb(); // descriptors and data reach memory before the channel fetches them
+    DMAC_CH_CONFIG(channel) = config;
+    DMAC_CH_CONFIG(channel) = config | DMA_CFG_E;
+    return KERR_OK;
+}
+
+void dma_abort(int channel)
+{
+    if (!dma_valid(channel) || !dma_busy(channel))
+    {
+        return;
+    }
+
+    // Halt ignores further requests; the FIFO drains, then disable
+    DMAC_CH_CONFIG(channel) |= DMA_CFG_HALT;
+    for (uint32_t i = 0; i < DMA_HALT_SPINS && (DMAC_CH_CONFIG(channel) & DMA_CFG_ACTIVE); i++)
+    {
+    }
+    DMAC_CH_CONFIG(channel) &= ~(DMA_CFG_E | DMA_CFG_HALT);
+
+    DMAC_INTTCCLEAR = 1u << channel;
+    DMAC_INTERRCLR  = 1u << channel;
+}
+
+bool dma_busy(int channel)
+{
+    return dma_valid(channel) && (DMAC_CH_CONFIG(channel) & DMA_CFG_E);
+}
+
+uint32_t dma_current_src(int channel)
+{
+    return dma_valid(channel) ? DMAC_CH_SRC(channel) : 0;
+}
+
+void dma_irq_handler(void)
+{
+    const uint32_t tc  = DMAC_INTTCSTATUS;
+    const uint32_t err = DMAC_INTERRSTATUS;
+
+    DMAC_INTTCCLEAR = tc;
+    DMAC_INTERRCLR  = err;
+
+    const uint32_t done = tc | err;
+    for (int ch = 0; ch < DMA_CHANNELS; ch++)
+    {
+        if (!(done & (1u << ch)))
+        {
+            continue;
+        }
+
+        if (err & (1u << ch))
+        {
+            DMAC_CH_CONFIG(ch) &= ~DMA_CFG_E; // an error leaves the channel enabled
+        }
+
+        const dma_callback_t cb = dma_chans[ch].cb;
+        if (cb)
+        {
+            cb(ch, (err & (1u << ch)) ? KERR_IO : KERR_OK, dma_chans[ch].arg);
+        }
+    }
+}
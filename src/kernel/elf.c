@@ -0,0 +1,187 @@
+/**
+ * @file elf.c
+ * @brief ELF32 header validation and PT_LOAD mapping for user tasks.
+ */
+#include "elf.h"
+#include "task.h"
+#include "kstat.h"
+#include "mmu.h"
+#include "string.h"
+#include "utils.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define EI_CLASS    4u
+#define EI_DATA     5u
+#define EI_VERSION  6u
+
+KSTAT_DEFINE(elf_pages_in_place);
+
+static inline const struct elf32_phdr *phdrs(const void *image)
+{
+    const struct elf32_ehdr *eh = image;
+    return (const struct elf32_phdr *)(const void *)((const uint8_t *)image + eh->e_phoff);
+}
+
+static uint32_t prot_of(uint32_t p_flags)
+{
+    return ((p_flags & PF_R) ? MM_PROT_READ : 0u) |
+           ((p_flags & PF_W) ? MM_PROT_WRITE : 0u) |
+           ((p_flags & PF_X) ? MM_PROT_EXEC : 0u);
+}
+
+static kerror_t check_segment(const struct elf32_phdr *ph, size_t size)
+{
+    if (ph->p_filesz > ph->p_memsz || ph->p_offset > size || ph->p_filesz > size - ph->p_offset)
+    {
+        return KERR_INVAL;
+    }
+    if (ph->p_vaddr < USER_BASE || ph->p_vaddr >= TASK_STACK_BASE ||
+        ph->p_memsz > TASK_STACK_BASE - ph->p_vaddr)
+    {
+        return KERR_INVAL; // outside the window, or over the stack
+    }
+    if ((ph->p_vaddr - ph->p_offset) & (PAGE_SIZE - 1u))
+    {
+        return KERR_INVAL; // file pages could not line up with memory pages
+    }
+    return KERR_OK;
+}
+
+kerror_t elf_check(const void *image, size_t size)
+{
+    const struct elf32_ehdr *eh = image;
+
+    if (!image || ((uintptr_t)image & 3u) || size < sizeof(*eh))
+    {
+        return KERR_INVAL;
+    }
+    if (memcmp(eh->e_ident, ELFMAG, 4) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS32 ||
+        eh->e_ident[EI_DATA] != ELFDATA2LSB || eh->e_ident[EI_VERSION] != EV_CURRENT ||
+        eh->e_type != ET_EXEC || eh->e_machine != EM_ARM || eh->e_version != EV_CURRENT)
+    {
+        return KERR_INVAL;
+    }
+    if (eh->e_phentsize != sizeof(struct elf32_phdr) || eh->e_phnum == 0 || (eh->e_phoff & 3u) ||
+        eh->e_phoff > size || (size_t)eh->e_phnum * sizeof(struct elf32_phdr) > size - eh->e_phoff)
+    {
+        return KERR_INVAL;
+    }
+    if (eh->e_phnum > ELF_PHNUM_MAX)
+    {
+        return KERR_NO_SPACE;
+    }
+
+    const struct elf32_phdr *ph = phdrs(image);
+    bool entry_ok = false;
+    uint32_t loads = 0;
+
+    for (uint32_t i = 0; i < eh->e_phnum; i++)
+    {
+        if (ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0)
+        {
+            continue;
+        }
+        if (check_segment(&ph[i], size) != KERR_OK)
+        {
+            return KERR_INVAL;
+        }
+
+        // A page belongs to one segment: it gets one set of permissions
+        const uintptr_t start = ph[i].p_vaddr & ~(uintptr_t)(PAGE_SIZE - 1u);
+        const uintptr_t end   = align_up_uintptr(ph[i].p_vaddr + ph[i].p_memsz, PAGE_SIZE);
+        for (uint32_t j = 0; j < i; j++)
+        {
+            if (ph[j].p_type != PT_LOAD || ph[j].p_memsz == 0)
+            {
+                continue;
+            }
+            const uintptr_t s = ph[j].p_vaddr & ~(uintptr_t)(PAGE_SIZE - 1u);
+            const uintptr_t e = align_up_uintptr(ph[j].p_vaddr + ph[j].p_memsz, PAGE_SIZE);
+            if (start < e && s < end)
+            {
+                return KERR_INVAL;
+            }
+        }
+
+        if ((ph[i].p_flags & PF_X) && eh->e_entry >= ph[i].p_vaddr &&
+            eh->e_entry - ph[i].p_vaddr < ph[i].p_memsz)
+        {
+            entry_ok = true;
+        }
+        loads++;
+    }
+
+    // user_enter() starts in ARM state: no Thumb entry point
+    return loads && entry_ok && !(eh->e_entry & 3u) ? KERR_OK : KERR_INVAL;
+}
+
+/**
+ * @internal
+ * @brief Whether `page` of a read-only segment can be mapped onto the image.
+ *
+ * The whole frame must lie inside the image, and the page must not need
+ * zeroes past the file bytes.
+ */
+static bool in_place(const struct elf32_phdr *ph, uintptr_t page, uintptr_t src, const void *image, size_t size)
+{
+    const uintptr_t frame = src - ph->p_vaddr + page;
+    const uintptr_t lo    = (uintptr_t)image;
+
+    if ((ph->p_flags & PF_W) || (frame & (PAGE_SIZE - 1u)) || size < PAGE_SIZE || frame < lo ||
+        frame - lo > size - PAGE_SIZE)
+    {
+        return false;
+    }
+    return ph->p_filesz == ph->p_memsz || page + PAGE_SIZE <= ph->p_vaddr + ph->p_filesz;
+}
+
+kerror_t elf_load(struct task *task, const void *image, size_t size)
+{
+    const kerror_t err = elf_check(image, size);
+    if (err != KERR_OK)
+    {
+        return err;
+    }
+
+    const struct elf32_ehdr *eh = image;
+    const struct elf32_phdr *ph = phdrs(image);
+
+    for (uint32_t i = 0; i < eh->e_phnum; i++)
+    {
+        if (ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0)
+        {
+            continue;
+        }
+
+        const uintptr_t src   = (uintptr_t)image + ph[i].p_offset;
+        const uint32_t  prot  = prot_of(ph[i].p_flags);
+        const uintptr_t start = ph[i].p_vaddr & ~(uintptr_t)(PAGE_SIZE - 1u);
+        const uintptr_t end   = align_up_uintptr(ph[i].p_vaddr + ph[i].p_memsz, PAGE_SIZE);
+
+        for (uintptr_t page = start; page < end; page += PAGE_SIZE)
+        {
+            if (in_place(&ph[i], page, src, image, size))
+            {
+                mm_map(task->mm, page, src - ph[i].p_vaddr + page, prot);
+                task->in_place++;
+                kstat_inc(elf_pages_in_place);
+            }
+        }
+
+        // Pages mapped above never fault; the others are filled from here
+        task->segments[task->nsegments++] = (struct task_segment){
+            .start  = start,
+            .end    = end,
+            .vaddr  = ph[i].p_vaddr,
+            .src    = (const uint8_t *)src,
+            .filesz = ph[i].p_filesz,
+            .prot   = prot,
+        };
+    }
+
+    task->entry = eh->e_entry;
+    return KERR_OK;
+}
@@ -14,6 +14,14 @@ const char* error_str(kerror_t error_code)
             return "out of space";
         case KERR_INVAL:
             return "invalid request";
+        case KERR_BUSY:
+            return "resource busy";
+        case KERR_IO:
+            return "i/o error";
+        case KERR_NOSYS:
+            return "no such system call";
+        case KERR_FAULT:
+            return "bad address";
         default:
             return "unknown error";
     }
@@ -0,0 +1,296 @@
+/**
+ * @file fiber.c
+ * @brief Cooperative fibers: ready list, events and the host loop.
+ *
+ * Only the ready list and event waiter lists are shared with interrupts
+ * (fiber_event_signal() may run from an IRQ); they are touched with IRQs
+ * masked. Switches themselves run with IRQs enabled, since no interrupt
+ * ever looks at a fiber's saved context.
+ *
+ * Fibers switch to each other directly. Control goes back to the host
+ * loop in fiber_run() only when no fiber is ready or one has returned.
+ */
+#include "fiber.h"
+#include "interrupt.h"
+#include "memory.h"
+#include "thread.h"
+#include "cpustat.h"
+#include "uart.h"
+#include "panic.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Words pushed by fiber_switch(): r4-r12 and lr. */
+#define CONTEXT_WORDS 10u
+
+static struct fiber   host_ctx;            /**< Saved context of fiber_run(). */
+static struct fiber  *running    = NULL;
+static struct fiber  *ready_head = NULL;
+static struct fiber  *ready_tail = NULL;
+static struct fiber  *dead       = NULL;   /**< Returned fibers waiting to be freed. */
+static uint32_t       live       = 0;
+static struct thread *host       = NULL;
+
+// --- Ready list (IRQs masked) ---
+
+static void ready_push(struct fiber *f)
+{
+    f->state = FIBER_READY;
+    f->next  = NULL;
+    if (ready_tail)
+    {
+        ready_tail->next = f;
+    }
+    else
+    {
+        ready_head = f;
+    }
+    ready_tail = f;
+}
+
+static struct fiber *ready_pop(void)
+{
+    struct fiber *f = ready_head;
+    if (f)
+    {
+        ready_head = f->next;
+        if (!ready_head)
+        {
+            ready_tail = NULL;
+        }
+        f->next = NULL;
+    }
+    return f;
+}
+
+/**
+ * @internal
+ * @brief Leave `self` (already queued or parked) for the next ready fiber.
+ *
+ * Called with IRQs masked by `flags`; restores them before switching.
+ */
+static void fiber_leave(struct fiber *self, uint32_t flags)
+{
+    struct fiber *next = ready_pop();
+    if (next)
+    {
+        next->state = FIBER_RUNNING;
+    }
+    running = next;
+    irq_restore(flags);
+
+    fiber_switch(self, next ? next : &host_ctx);
+}
+
+// --- Life cycle ---
+
+static void fiber_entry(void)
+{
+    struct fiber *self = running;
+    self->fn(self->arg);
+
+    const uint32_t flags = irq_save();
+    self->state = FIBER_DEAD;
+    self->next  = dead;
+    dead        = self;
+    running     = NULL;
+    irq_restore(flags);
+
+    fiber_switch(self, &host_ctx); // the host frees our stack
+    kernel_panic("fiber_entry: dead fiber resumed", KERR_INVAL);
+}
+
+static void fiber_timer_expired(struct ktimer *timer, void *arg)
+{
+    (void)timer;
+    fiber_event_signal(arg);
+}
+
+struct fiber *fiber_create(const char *name, fiber_fn_t fn, void *arg, size_t stack_size)
+{
+    if (stack_size == 0)
+    {
+        stack_size = FIBER_STACK_DEFAULT;
+    }
+    if (stack_size < FIBER_STACK_MIN)
+    {
+        stack_size = FIBER_STACK_MIN;
+    }
+    stack_size = (stack_size + 7u) & ~(size_t)7u;
+
+    struct fiber *f = kmalloc(sizeof(*f));
+    f->stack      = kmalloc(stack_size);
+    f->stack_size = stack_size;
+    f->fn         = fn;
+    f->arg        = arg;
+
+    uint32_t i = 0;
+    for (; name && name[i] && i < FIBER_NAME_MAX - 1; i++)
+    {
+        f->name[i] = name[i];
+    }
+    f->name[i] = '\0';
+
+    // Initial frame as fiber_switch() leaves it: r4-r12, then lr
+    uint32_t *top = (uint32_t *)(((uintptr_t)f->stack + stack_size) & ~(uintptr_t)7u);
+    uint32_t *sp  = top - CONTEXT_WORDS;
+    for (uint32_t w = 0; w < CONTEXT_WORDS - 1; w++)
+    {
+        sp[w] = 0;
+    }
+    sp[CONTEXT_WORDS - 1] = (uint32_t)(uintptr_t)fiber_entry;
+    f->sp = sp;
+
+    const uint32_t flags = irq_save();
+    live++;
+    ready_push(f);
+    irq_restore(flags);
+
+    return f;
+}
+
+void fiber_run(void)
+{
+    host = thread_current();
+
+    for (;;)
+    {
+        uint32_t flags = irq_save();
+
+        while (dead)
+        {
+            struct fiber *f = dead;
+            dead = f->next;
+            live--;
+            irq_restore(flags);
+
+            kfree(f->stack);
+            kfree(f);
+            flags = irq_save();
+        }
+
+        struct fiber *next = ready_pop();
+        if (!next)
+        {
+            if (live == 0)
+            {
+                irq_restore(flags);
+                break;
+            }
+
+            // Every fiber waits: sleep until a signal readies one. The
+            // list was checked with IRQs masked, so no signal is missed.
+            if (host)
+            {
+                thread_block();
+            }
+            else
+            {
+                cpustat_wfi();
+            }
+            irq_restore(flags);
+            continue;
+        }
+
+        next->state = FIBER_RUNNING;
+        running     = next;
+        irq_restore(flags);
+
+        fiber_switch(&host_ctx, next);
+    }
+
+    host = NULL;
+}
+
+struct fiber *fiber_current(void)
+{
+    return running;
+}
+
+void fiber_yield(void)
+{
+    struct fiber *self = running;
+    if (!self)
+    {
+        return;
+    }
+
+    const uint32_t flags = irq_save();
+    if (!ready_head)
+    {
+        irq_restore(flags);
+        return;
+    }
+    ready_push(self);
+    fiber_leave(self, flags);
+}
+
+// --- Events ---
+
+void fiber_await(struct fiber_event *ev)
+{
+    struct fiber *self = running;
+    const uint32_t flags = irq_save();
+
+    if (ev->pending)
+    {
+        ev->pending = false;
+        irq_restore(flags);
+        return;
+    }
+
+    self->state = FIBER_WAITING;
+    self->next  = ev->waiters;
+    ev->waiters = self;
+    fiber_leave(self, flags);
+}
+
+void fiber_event_signal(struct fiber_event *ev)
+{
+    const uint32_t flags = irq_save();
+
+    struct fiber *f = ev->waiters;
+    if (!f)
+    {
+        ev->pending = true;
+        irq_restore(flags);
+        return;
+    }
+
+    ev->waiters = NULL;
+    while (f)
+    {
+        struct fiber *next = f->next;
+        ready_push(f);
+        f = next;
+    }
+
+    // No-op unless the host is parked in fiber_run()
+    if (host)
+    {
+        thread_wake(host);
+    }
+    irq_restore(flags);
+}
+
+void fiber_sleep_ms(uint32_t ms)
+{
+    struct fiber      *self = running;
+    struct fiber_event done = FIBER_EVENT_INIT;
+
+    ktimer_init(&self->timer, fiber_timer_expired, &done);
+    ktimer_add(&self->timer, ktimer_ms_to_ticks(ms));
+    fiber_await(&done);
+}
+
+size_t fiber_uart_read(char *buf, size_t len)
+{
+    size_t n;
+    while ((n = uart_read(buf, len)) == 0)
+    {
+        fiber_await(uart_rx_event());
+    }
+    return n;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file initrd.c
+ * @brief ustar walk and hash index of the `.initrd` section.
+ */
+#include "initrd.h"
+#include "memory.h"
+#include "string.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TAR_BLOCK        512u
+#define TAR_NAME_LEN     100u
+
+/** ustar header layout (POSIX.1-1988), one 512-byte block. */
+struct tar_header
+{
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+};
+
+_Static_assert(sizeof(struct tar_header) == TAR_BLOCK, "ustar headers are one block");
+
+/** Placed by kernel.ld around the objcopy'd archive. */
+extern const char __initrd_start[];
+extern const char __initrd_end[];
+
+static struct initrd_file *files      = NULL;
+static uint32_t            file_count = 0;
+static uint16_t           *slots      = NULL;  /**< files[] index + 1, 0 for empty. */
+static uint32_t            slot_mask  = 0;
+
+static uint32_t fnv1a(const char *s)
+{
+    uint32_t h = 2166136261u;
+    while (*s)
+    {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t parse_octal(const char *s, size_t len)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < len && s[i] >= '0' && s[i] <= '7'; i++)
+    {
+        v = (v << 3) | (uint32_t)(s[i] - '0');
+    }
+    return v;
+}
+
+static bool header_valid(const struct tar_header *h)
+{
+    if (memcmp(h->magic, "ustar", 5) != 0)
+    {
+        return false;
+    }
+
+    // The checksum is computed with its own field read as spaces
+    const uint8_t *b   = (const uint8_t *)h;
+    uint32_t       sum = 0;
+    for (uint32_t i = 0; i < TAR_BLOCK; i++)
+    {
+        const bool in_chksum = i >= offsetof(struct tar_header, chksum) &&
+                               i < offsetof(struct tar_header, typeflag);
+        sum += in_chksum ? (uint32_t)' ' : b[i];
+    }
+    return sum == parse_octal(h->chksum, sizeof(h->chksum));
+}
+
+static bool block_empty(const struct tar_header *h)
+{
+    const uint32_t *w = (const uint32_t *)(const void *)h;
+    for (uint32_t i = 0; i < TAR_BLOCK / 4u; i++)
+    {
+        if (w[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static const char *strip_dot(const char *name)
+{
+    while (name[0] == '.' && name[1] == '/')
+    {
+        name += 2;
+    }
+    return name;
+}
+
+/**
+ * @internal
+ * @brief Walk the archive; with `out`, fill it with the regular files.
+ *
+ * @return Number of regular files, or -1 if the archive is corrupt.
+ */
+static int32_t walk(struct initrd_file *out)
+{
+    const char *p = __initrd_start;
+    int32_t     n = 0;
+
+    while (p + TAR_BLOCK <= __initrd_end)
+    {
+        const struct tar_header *h = (const struct tar_header *)(const void *)p;
+        if (block_empty(h))
+        {
+            break; // end-of-archive marker
+        }
+        if (!header_valid(h))
+        {
+            return -1;
+        }
+
+        const uint32_t size = parse_octal(h->size, sizeof(h->size));
+        const char    *data = p + TAR_BLOCK;
+        if (size > (uint32_t)(__initrd_end - data))
+        {
+            return -1;
+        }
+
+        const bool regular = h->typeflag == '0' || h->typeflag == '\0';
+        if (regular && (h->prefix[0] || h->name[TAR_NAME_LEN - 1u]))
+        {
+            // Long paths would have to be copied to be NUL-terminated
+            if (out)
+            {
+                KLOG(KLOG_WARN, "initrd: path too long, skipped");
+            }
+        }
+        else if (regular && *strip_dot(h->name))
+        {
+            if (out)
+            {
+                const char *name = strip_dot(h->name);
+                out[n] = (struct initrd_file){
+                    .name = name, .data = data, .size = size, .hash = fnv1a(name)
+                };
+            }
+            n++;
+        }
+
+        p = data + ((size + TAR_BLOCK - 1u) & ~(TAR_BLOCK - 1u));
+    }
+    return n;
+}
+
+kerror_t initrd_init(void)
+{
+    kfree(files);
+    kfree(slots);
+    files      = NULL;
+    slots      = NULL;
+    file_count = 0;
+    slot_mask  = 0;
+
+    const int32_t n = walk(NULL);
+    if (n < 0)
+    {
+        KLOG(KLOG_ERROR, "initrd: corrupt archive");
+        return KERR_IO;
+    }
+    if (n == 0)
+    {
+        return KERR_OK;
+    }
+
+    // Load factor at most 1/2, so probes stay short
+    uint32_t cap = 8;
+    while (cap < 2u * (uint32_t)n)
+    {
+        cap <<= 1;
+    }
+
+    if (cap > 0x10000u)
+    {
+        return KERR_NOMEM; // slots hold 16-bit indexes
+    }
+
+    files = kmalloc((uint32_t)n * sizeof(*files));
+    slots = kmalloc(cap * sizeof(*slots));
+    if (!files || !slots)
+    {
+        kfree(files);
+        kfree(slots);
+        files = NULL;
+        slots = NULL;
+        return KERR_NOMEM;
+    }
+    memset(slots, 0, cap * sizeof(*slots));
+    slot_mask  = cap - 1u;
+    file_count = (uint32_t)walk(files);
+
+    for (uint32_t i = 0; i < file_count; i++)
+    {
+        uint32_t s = files[i].hash & slot_mask;
+        while (slots[s])
+        {
+            s = (s + 1u) & slot_mask;
+        }
+        slots[s] = (uint16_t)(i + 1u);
+    }
+
+    KLOG(KLOG_INFO, "initrd: %u files, %u bytes", file_count,
+         (uint32_t)(__initrd_end - __initrd_start));
+    return KERR_OK;
+}
+
+const struct initrd_file *initrd_open(const char *path)
+{
+    if (!slots || !path)
+    {
+        return NULL;
+    }
+    while (*path == '/')
+    {
+        path++;
+    }
+
+    const uint32_t hash = fnv1a(path);
+    for (uint32_t s = hash & slot_mask; slots[s]; s = (s + 1u) & slot_mask)
+    {
+        const struct initrd_file *f = &files[slots[s] - 1u];
+        if (f->hash == hash && strcmp(f->name, path) == 0)
+        {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+const void *initrd_map(const struct initrd_file *file, size_t *size)
+{
+    if (size)
+    {
+        *size = file->size;
+    }
+    return file->data;
+}
+
+uint32_t initrd_count(void)
+{
+    return file_count;
+}
+
+const struct initrd_file *initrd_at(uint32_t i)
+{
+    return i < file_count ? &files[i] : NULL;
+}
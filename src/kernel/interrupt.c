@@ -1,9 +1,39 @@
 #include "interrupt.h"
+#include "clock.h"
+#include "cpustat.h"
+#include "kstat.h"
+#include "kstack.h"
+#include "klog.h"
+#include "panic.h"
+#include "pmu.h"
+#include "ktimer.h"
+#include "uart.h"
+#include "dma.h"
+#include "mmci.h"
+#include "thread.h"
+#include "log.h"
 #include "lib/math.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
-volatile uint64_t systicks = 0;
+volatile uint64_t systicks    = 0;
+volatile uint32_t irq_nesting = 0;
+
+static volatile timer0_hook_t timer0_hook = NULL;
+
+// Written by irq_handler() only, which does not nest
+KSTAT_DEFINE(irq_total);
+KSTAT_DEFINE(irq_timer_count);
+KSTAT_DEFINE(irq_clock_wrap);
+KSTAT_DEFINE(irq_uart_count);
+KSTAT_DEFINE(irq_dma_count);
+KSTAT_DEFINE(irq_mmci_count);
+
+void interrupts_set_timer0_hook(timer0_hook_t hook)
+{
+    timer0_hook = hook;
+}
 
 void interrupts_init_timer0(uint32_t tick_hz, uint32_t timer_clk_hz)
 {
@@ -25,19 +55,118 @@ void interrupts_init_timer0(uint32_t tick_hz, uint32_t timer_clk_hz)
 
     // Route timer01 interrupt to IRQ and enable it in VIC
     vic_enable_timer01_irq();
+
+    KLOGS(KLOG_SYS_IRQ, KLOG_DEBUG, "timer0 periodic, load %u", load);
 }
 
 void irq_handler(void)
 {
+    // Snapshot Timer0 before anything else when someone is measuring it
+    const timer0_hook_t hook  = timer0_hook;
+    const uint32_t entry_cyc  = hook ? pmu_cycles() : 0;
+    const uint32_t entry_t0   = hook ? T0_VALUE : 0;
+
+    irq_nesting = irq_nesting + 1;
+    const cpu_state_t cpu_prev = cpustat_enter(CPU_IRQ);
+    kstat_inc(irq_total);
+
+    const uint32_t timers_start = cpustat_now();
+    bool           timers       = false;
+
     // Check Timer0 MIS (masked interrupt status)
     if (T0_MIS)
     {
+        timers    = true;
         T0_INTCLR = 1;  // Clear the timer interrupt
-        systicks++;
+        kstat_inc(irq_timer_count);
+        if (hook)
+        {
+            hook(entry_t0, entry_cyc);
+        }
+        else
+        {
+            systicks++;
+            ktimer_tick();
+            sched_tick();
+        }
+    }
+
+    // Timer1 shares the line: it is the clocksource wrapping around
+    if (T1_MIS)
+    {
+        timers = true;
+        kstat_inc(irq_clock_wrap);
+        clock_handle_wrap();
+    }
+
+    if (timers)
+    {
+        cpustat_irq_line(IRQ_TIMER01, timers_start);
+    }
+
+    if (VIC_IRQSTATUS & (1u << IRQ_UART0))
+    {
+        const uint32_t start = cpustat_now();
+        kstat_inc(irq_uart_count);
+        uart_irq_handler();
+        cpustat_irq_line(IRQ_UART0, start);
+    }
+
+    if (VIC_IRQSTATUS & (1u << IRQ_DMA))
+    {
+        const uint32_t start = cpustat_now();
+        kstat_inc(irq_dma_count);
+        dma_irq_handler();
+        cpustat_irq_line(IRQ_DMA, start);
+    }
+
+    if ((VIC_IRQSTATUS & (1u << IRQ_SIC)) && (SIC_STATUS & (1u << SIC_IRQ_MMCI0)))
+    {
+        const uint32_t start = cpustat_now();
+        kstat_inc(irq_mmci_count);
+        mmci_irq_handler();
+        cpustat_irq_line(IRQ_SIC, start);
     }
 
     // End of interrupt for PL190 VIC
     VIC_VECTADDR = 0; // signal end of IRQ service
+    cpustat_leave(cpu_prev);
+    irq_nesting  = irq_nesting - 1;
+
+    // Preempt last: the next thread may not come back here for a while
+    sched_irq_exit();
+}
+
+void abort_handler(uint32_t is_data, uint32_t spsr, const uint32_t *frame)
+{
+    uint32_t far;
+    uint32_t fsr;
+
+    if (is_data)
+    {
+        __asm__ volatile("mrc p15, 0, %0, c6, c0, 0" : "=r"(far)); // DFAR
+        __asm__ volatile("mrc p15, 0, %0, c5, c0, 0" : "=r"(fsr)); // DFSR
+    }
+    else
+    {
+        __asm__ volatile("mrc p15, 0, %0, c6, c0, 2" : "=r"(far)); // IFAR
+        __asm__ volatile("mrc p15, 0, %0, c5, c0, 1" : "=r"(fsr)); // IFSR
+    }
+
+    klog_flush();
+    KLOG_SYNC(KLOG_PANIC, "%s abort at pc %p: address %p, fsr 0x%x, mode 0x%x",
+              is_data ? "data" : "prefetch", (void *)(uintptr_t)frame[13],
+              (void *)(uintptr_t)far, fsr, spsr & 0x1Fu);
+
+    const kstack_id_t stack = kstack_guarding(far);
+    if (stack != KSTACK_COUNT)
+    {
+        struct kstack_usage u;
+        kstack_usage(stack, &u);
+        KLOG_SYNC(KLOG_PANIC, "%s stack overflow, budget %u bytes", u.name, u.budget);
+        kernel_panic("stack overflow", KERR_NO_SPACE);
+    }
+    kernel_panic("unhandled abort", KERR_INVAL);
 }
 
 inline void irq_disable(void)
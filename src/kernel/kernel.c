@@ -1,12 +1,29 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
+#include "bcache.h"
 #include "datetime.h"
 #include "printf.h"
 #include "clear.h"
+#include "initrd.h"
 #include "interrupt.h"
+#include "clock.h"
+#include "cpustat.h"
+#include "kstack.h"
+#include "kstat.h"
+#include "ktimer.h"
 #include "memory.h"
+#include "mmci.h"
+#include "mmu.h"
+#include "uart.h"
+#include "dma.h"
+#include "thread.h"
+#include "string.h"
+#include "task.h"
 #include "log.h"
+#include "klog.h"
+#include "lib/math.h"
 
 #ifdef USE_KTESTS
 #include "tests.h"
@@ -43,55 +60,468 @@ static void init_message(void)
     printf("\r\n");
 }
 
+/**
+ * @brief Check the IRQ path once every interrupt source is set up.
+ *
+ * Each VIC line the kernel uses must be enabled and routed to IRQ rather
+ * than FIQ: Timer0/Timer1 (tick and clocksource wrap), UART0, DMA and,
+ * with a card, the SIC cascade. Then the tick must actually arrive.
+ */
 void irq_sanity_check(void)
 {
-    irq_disable();
+    const struct
+    {
+        uint32_t    line;
+        const char *name;
+        bool        used;
+    } lines[] = {
+        { IRQ_TIMER01, "timer0/1", true },
+        { IRQ_UART0,   "uart0",    true },
+        { IRQ_DMA,     "dma",      true },
+        { IRQ_SIC,     "sic",      mmci_present() },
+    };
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+    {
+        const uint32_t bit = 1u << lines[i].line;
+        if (lines[i].used && (!(VIC_INTENABLE & bit) || (VIC_INTSELECT & bit)))
+        {
+            KLOG(KLOG_ERROR, "IRQ sanity: %s (VIC line %u) not routed to IRQ", lines[i].name, lines[i].line);
+            ok = false;
+        }
+    }
+    if (!(T0_CONTROL & TCTRL_INTEN) || !(T1_CONTROL & TCTRL_INTEN))
+    {
+        KLOG(KLOG_ERROR, "IRQ sanity: timer0 tick or timer1 wrap interrupt masked");
+        ok = false;
+    }
+
+    // Wait up to three tick periods for the tick to come through
     const unsigned before = systicks;
+    const uint32_t start  = clock_cycles32();
+    while (systicks == before && clock_cycles32() - start < 3u * (clock_hz() / KTIMER_HZ))
+    {
+    }
+    if (systicks == before)
+    {
+        KLOG(KLOG_ERROR, "IRQ sanity: no timer0 tick");
+        ok = false;
+    }
 
-    irq_enable();
-    irq_disable();
+    if (ok)
+    {
+        KLOG(KLOG_INFO, "IRQ sanity PASS: timer0/1, uart0, dma%s routed, tick running",
+             mmci_present() ? ", sic" : "");
+    }
+}
+
+/**
+ * @brief Whether the first word of `line` is exactly `word`.
+ */
+static bool shell_is_command(const char *line, const char *word)
+{
+    const size_t len = strlen(word);
+    return memcmp(line, word, len) == 0 && (line[len] == '\0' || line[len] == ' ');
+}
 
-    const unsigned after = systicks;
+/**
+ * @brief Split `line` in place into at most `max` space-separated words.
+ *
+ * @return Number of words stored in `argv`.
+ */
+static int shell_split(char *line, char **argv, int max)
+{
+    int argc = 0;
+    while (*line && argc < max)
+    {
+        while (*line == ' ')
+        {
+            *line++ = '\0';
+        }
+        if (*line == '\0')
+        {
+            break;
+        }
 
-    if (before == after)
+        argv[argc++] = line;
+        while (*line && *line != ' ')
+        {
+            line++;
+        }
+    }
+    return argc;
+}
+
+/**
+ * @brief `log` lists the runtime log levels, `log <subsystem|all> <level>` sets them.
+ */
+static void shell_log_command(char *line)
+{
+    char *argv[3];
+    const int argc = shell_split(line, argv, 3);
+
+    if (argc == 1)
     {
-        KLOG(KLOG_INFO, "A1 Sanity PASS: no spurious IRQs");
+        for (int i = 0; i < KLOG_SYS_COUNT; i++)
+        {
+            printf("  %-8s %s\r\n", klog_subsys_str((klog_subsys_t)i),
+                   klog_level_str((klog_level_t)klog_levels[i]));
+        }
+        printf("  (compiled in: %s and above)\r\n", klog_level_str(KLOG_MIN_LEVEL));
+        return;
     }
-    else
+
+    const bool all   = argc == 3 && strcmp(argv[1], "all") == 0;
+    const int  sys   = argc == 3 ? klog_subsys_parse(argv[1]) : -1;
+    const int  level = argc == 3 ? klog_level_parse(argv[2]) : -1;
+
+    if ((!all && sys < 0) || level < 0)
     {
-        KLOG(KLOG_ERROR, "A1 Sanity FAIL: unexpected IRQs");
+        printf("Usage: log [<kernel|memory|irq|timer|uart|shell|all> <debug|info|warn|error|panic>]\r\n");
+        return;
     }
 
-#ifdef KLOG_USE_TICKS
-    irq_enable();
-#endif
+    for (int i = 0; i < KLOG_SYS_COUNT; i++)
+    {
+        if (all || i == sys)
+        {
+            klog_levels[i] = (uint8_t)level;
+        }
+    }
+    KLOGS(KLOG_SYS_SHELL, KLOG_INFO, "log level of %s set to %s",
+          all ? "all" : argv[1], klog_level_str((klog_level_t)level));
+}
+
+/**
+ * @brief `ls [dir]` lists the initrd files, all of them or those under `dir`.
+ */
+static void shell_ls_command(char *line)
+{
+    char *argv[2];
+    const int argc = shell_split(line, argv, 2);
+
+    const char *dir = argc > 1 ? argv[1] : "";
+    while (*dir == '/')
+    {
+        dir++;
+    }
+    const size_t dir_len = strlen(dir);
+
+    for (uint32_t i = 0; i < initrd_count(); i++)
+    {
+        const struct initrd_file *f = initrd_at(i);
+        if (dir_len && (memcmp(f->name, dir, dir_len) != 0 ||
+                        (dir[dir_len - 1] != '/' && f->name[dir_len] != '/')))
+        {
+            continue;
+        }
+        printf("%8u  %s\r\n", f->size, f->name);
+    }
+}
+
+/**
+ * @brief `cat <path>` prints an initrd file, read in place.
+ */
+static void shell_cat_command(char *line)
+{
+    char *argv[2];
+    if (shell_split(line, argv, 2) != 2)
+    {
+        printf("Usage: cat <path>\r\n");
+        return;
+    }
+
+    const struct initrd_file *f = initrd_open(argv[1]);
+    if (!f)
+    {
+        printf("cat: %s: no such file\r\n", argv[1]);
+        return;
+    }
+
+    size_t      size;
+    const char *data = initrd_map(f, &size);
+    for (size_t i = 0; i < size; i++)
+    {
+        if (data[i] == '\n')
+        {
+            uart_putc('\r');
+        }
+        uart_putc(data[i]);
+    }
+}
+
+/**
+ * @brief `exec <path>` runs an initrd ELF executable as a task and waits for it.
+ */
+static void shell_exec_command(char *line)
+{
+    char *argv[2];
+    if (shell_split(line, argv, 2) != 2)
+    {
+        printf("Usage: exec <path>\r\n");
+        return;
+    }
+
+    const struct initrd_file *f = initrd_open(argv[1]);
+    if (!f)
+    {
+        printf("exec: %s: no such file\r\n", argv[1]);
+        return;
+    }
+
+    size_t         size;
+    const void    *image = initrd_map(f, &size);
+    const uint32_t t0    = clock_cycles32();
+    struct task   *task  = task_exec(argv[1], image, size, THREAD_PRIO_DEFAULT);
+    if (!task)
+    {
+        printf("exec: %s: not an ARM executable\r\n", argv[1]);
+        return;
+    }
+
+    const uint32_t start_us = (uint32_t)clock_cycles_to_us(clock_cycles32() - t0);
+    const uint32_t in_place = task->in_place;
+    const int32_t  code     = task_join(task);
+    printf("exec: %s exited with %d (start %u us, %u pages in place)\r\n",
+           argv[1], code, start_us, in_place);
+}
+
+/**
+ * @brief `kstat [-d] [prefix]` dumps the statistics registry; -d adds each counter's change since the last -d.
+ */
+static void shell_kstat_command(char *line)
+{
+    char *argv[3];
+    const int argc = shell_split(line, argv, 3);
+
+    bool        delta  = false;
+    const char *prefix = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-d") == 0)
+        {
+            delta = true;
+        }
+        else
+        {
+            prefix = argv[i];
+        }
+    }
+
+    if (argc == 3 && (!delta || !prefix))
+    {
+        printf("Usage: kstat [-d] [prefix]\r\n");
+        return;
+    }
+    kstat_dump(delta, prefix);
+}
+
+#define TOP_INTERVAL_MS  1000u
+#define TOP_MAX_THREADS  16u
+
+/** What `top` keeps of a thread between two refreshes. */
+struct top_thread
+{
+    uint32_t id;
+    uint8_t  prio;
+    uint8_t  state;
+    uint64_t switches;
+    uint64_t cycles;
+    char     name[THREAD_NAME_MAX];
+};
+
+struct top_sample
+{
+    struct cpustat    cpu;
+    struct top_thread threads[TOP_MAX_THREADS];
+    uint32_t          nthreads;
+};
+
+static const char *const TOP_STATES[] = { "ready", "run", "block", "dead" };
+
+static void top_collect(struct thread *t, void *arg)
+{
+    struct top_sample *s = arg;
+    if (s->nthreads == TOP_MAX_THREADS)
+    {
+        return;
+    }
+
+    struct top_thread *out = &s->threads[s->nthreads++];
+    out->id       = t->id;
+    out->prio     = t->prio;
+    out->state    = t->state;
+    out->switches = t->switches;
+    out->cycles   = t->cpu_cycles;
+    memcpy(out->name, t->name, sizeof(out->name));
+}
+
+static void top_sample(struct top_sample *s)
+{
+    s->nthreads = 0;
+    thread_for_each(top_collect, s);
+    cpustat_sample(&s->cpu);
+}
+
+/** `part` of `whole` in tenths of a percent. */
+static uint32_t top_permille(uint64_t part, uint64_t whole)
+{
+    return whole ? (uint32_t)udiv64(part * 1000u, whole) : 0;
+}
+
+static void top_print(const struct top_sample *old, const struct top_sample *now)
+{
+    uint64_t window = 0;
+    for (uint32_t s = 0; s < CPU_STATES; s++)
+    {
+        window += now->cpu.state[s] - old->cpu.state[s];
+    }
+
+    printf("\033[H\033[J");
+    printf("top - %u ms window, any key quits\r\n\r\nCPU  ",
+           (unsigned)clock_cycles_to_us(window) / 1000u);
+    for (uint32_t s = 0; s < CPU_STATES; s++)
+    {
+        const uint32_t pm = top_permille(now->cpu.state[s] - old->cpu.state[s], window);
+        printf("  %s %3u.%u%%", cpustat_state_str((cpu_state_t)s), pm / 10u, pm % 10u);
+    }
+
+    printf("\r\n\r\nIRQ  line    count       us   cpu%%\r\n");
+    for (uint32_t l = 0; l < CPUSTAT_IRQ_LINES; l++)
+    {
+        const uint32_t count  = now->cpu.irq_count[l] - old->cpu.irq_count[l];
+        const uint64_t cycles = now->cpu.irq_cycles[l] - old->cpu.irq_cycles[l];
+        if (count == 0)
+        {
+            continue;
+        }
+        const uint32_t pm = top_permille(cycles, window);
+        printf("     %4u %8u %8u %3u.%u%%\r\n", l, count,
+               (unsigned)clock_cycles_to_us(cycles), pm / 10u, pm % 10u);
+    }
+
+    printf("\r\nTHREAD  id name             prio state   cpu%%  switches\r\n");
+    for (uint32_t i = 0; i < now->nthreads; i++)
+    {
+        const struct top_thread *t = &now->threads[i];
+
+        uint64_t before = 0;
+        uint64_t sw     = 0;
+        for (uint32_t j = 0; j < old->nthreads; j++)
+        {
+            if (old->threads[j].id == t->id)
+            {
+                before = old->threads[j].cycles;
+                sw     = old->threads[j].switches;
+                break;
+            }
+        }
+
+        const uint32_t pm = top_permille(t->cycles - before, window);
+        printf("      %4u %-16s %4u %-5s %3u.%u%% %9u\r\n", t->id, t->name, t->prio,
+               t->state < 4 ? TOP_STATES[t->state] : "?", pm / 10u, pm % 10u,
+               (unsigned)(t->switches - sw));
+    }
+}
+
+/**
+ * @brief `top` redraws the CPU breakdown every TOP_INTERVAL_MS until a key is pressed.
+ */
+static void shell_top_command(void)
+{
+    static struct top_sample samples[2];
+    uint32_t cur = 0;
+
+    top_sample(&samples[cur]);
+    for (;;)
+    {
+        thread_sleep_ms(TOP_INTERVAL_MS); // idle meanwhile, unless someone else runs
+
+        char key;
+        if (uart_read(&key, 1) != 0)
+        {
+            break;
+        }
+
+        cur ^= 1u;
+        top_sample(&samples[cur]);
+        top_print(&samples[cur ^ 1u], &samples[cur]);
+    }
 }
 
 /* The following macros are for testing purposes. */
 #define     TIMER_TICK_TEST     ktests_timer_test()
 #define     SANITY_CHECK        irq_sanity_check()
-#define     CALL_SVC_0          __asm__ volatile ("svc #0")
 #define     KMALLOC_TEST        kmalloc_test()
+#define     IRQ_LATENCY_TEST    irq_latency_test()
+#define     RINGBUF_TEST        ringbuf_test()
+#define     FORMAT_TEST         format_test()
+#define     KLOG_TEST           klog_test()
+#define     DMA_TEST            dma_test()
+#define     MATH_TEST           math_test()
+#define     DATETIME_TEST       datetime_test()
+#define     THREAD_TEST         thread_test()
+#define     FIBER_TEST          fiber_test()
+#define     SYSCALL_TEST        syscall_test()
+#define     MMU_TEST            mmu_test()
+#define     SYNC_TEST           sync_test()
+#define     CPUSTAT_TEST        cpustat_test()
+#define     KSTAT_TEST          kstat_test()
+#define     KSTACK_TEST         kstack_test()
+#define     INITRD_TEST         initrd_test()
+#define     ELF_TEST            elf_test()
+#define     MMCI_TEST           mmci_test()
 
 // Entry point for the kernel
 void kernel_main(void)
 {
+    clock_init(1000000);
+    cpustat_init();
+    uart_init();
+    dma_init();
     clear();
     KLOG(KLOG_INFO, "kernel_main start");
     kmalloc_init(&__heap_start__, &__heap_end__);
+    kmalloc_irq_refill();
     KLOG(KLOG_INFO, "kmalloc init");
+    mmu_init();
+    KLOG(KLOG_INFO, "mmu on");
+    initrd_init();
+    sched_init();
 
-#ifdef KLOG_USE_TICKS
-    interrupts_init_timer0(100, 1000000);
+    // Kernel tick: drives systicks and the ktimer wheel
+    interrupts_init_timer0(KTIMER_HZ, 1000000);
     irq_enable();
-    KLOG(KLOG_INFO, "timer0 started for log ticks");
-#endif
+    KLOG(KLOG_INFO, "timer0 tick started");
+    datetime_init();
+    if (mmci_init() == KERR_OK)
+    {
+        bcache_init();
+    }
 
     /* TESTS */
-#ifdef USE_KTESTS 
-    SANITY_CHECK;
-    CALL_SVC_0;
+#ifdef USE_KTESTS
+    SANITY_CHECK; // every interrupt source is set up by now
     KMALLOC_TEST;
+    FORMAT_TEST;
+    KLOG_TEST;
+    IRQ_LATENCY_TEST;
+    RINGBUF_TEST;
+    DMA_TEST;
+    MATH_TEST;
+    DATETIME_TEST;
+    THREAD_TEST;
+    FIBER_TEST;
+    SYSCALL_TEST;
+    MMU_TEST;
+    SYNC_TEST;
+    CPUSTAT_TEST;
+    KSTAT_TEST;
+    KSTACK_TEST;
+    INITRD_TEST;
+    ELF_TEST;
+    MMCI_TEST;
     TIMER_TICK_TEST;
 #endif
 
@@ -107,6 +537,7 @@ void kernel_main(void)
     while (is_running)
     {
         input_buffer[0] = '\0'; // Clear the input buffer
+        klog_drain(UINT32_MAX);  // deferred log records, off the hot path
         printf("AstraKernel > ");
         getlines(input_buffer, sizeof(input_buffer));
 
@@ -117,7 +548,7 @@ void kernel_main(void)
         switch (input_buffer[0])
         {
             case 'h': // Check for help command
-                printf("\nHelp:\n 'q' to exit\n 'h' for help\n 'c' to clear screen\n 't' to print current time\n 'd' to print current date\r\n");
+                printf("\nHelp:\n 'q' to exit\n 'h' for help\n 'c' or 'clear' to clear screen\n 't' or 'time' to print current time\n 'd' to print current date\n 'log' to show or set log levels\n 'top' to watch CPU usage\n 'kstat [-d] [prefix]' to dump kernel statistics\n 'stacks' to show stack high-water marks\n 'ls [dir]' to list initrd files\n 'cat <path>' to print an initrd file\n 'exec <path>' to run an initrd ELF program\n 'sync' to write cached SD card blocks back\r\n");
                 break;
 
             case 'b':
@@ -146,7 +577,12 @@ void kernel_main(void)
 #endif
                 break;
 
-            case 'e':
+            case 'e': // Check for exec command
+                if (shell_is_command(input_buffer, "exec"))
+                {
+                    shell_exec_command(input_buffer);
+                    break;
+                }
 #ifdef USE_KTESTS_FEATURE
                 #include <string.h>
                 int result = strcmp("abc", "abc"); // Expect 0
@@ -174,18 +610,82 @@ void kernel_main(void)
 #endif
                 break;
 
+            case 'k': // Check for statistics command
+                if (!shell_is_command(input_buffer, "kstat"))
+                {
+                    printf("Unknown command. Type 'h' for help.\r\n");
+                    break;
+                }
+                shell_kstat_command(input_buffer);
+                break;
+
+            case 's': // Check for stack usage or sync command
+                if (strcmp(input_buffer, "sync") == 0)
+                {
+                    const kerror_t err = bcache_sync();
+                    if (err != KERR_OK)
+                    {
+                        printf("sync: %s\r\n", error_str(err));
+                    }
+                    break;
+                }
+                if (strcmp(input_buffer, "stacks") != 0)
+                {
+                    printf("Unknown command. Type 'h' for help.\r\n");
+                    break;
+                }
+                kstack_dump();
+                break;
+
+            case 'l': // Check for log level or list command
+                if (shell_is_command(input_buffer, "ls"))
+                {
+                    shell_ls_command(input_buffer);
+                }
+                else if (shell_is_command(input_buffer, "log"))
+                {
+                    shell_log_command(input_buffer);
+                }
+                else
+                {
+                    printf("Unknown command. Type 'h' for help.\r\n");
+                }
+                break;
+
             case 'q': // Check for exit command
-                KLOG(KLOG_INFO, "Exiting...");
+                KLOGS(KLOG_SYS_SHELL, KLOG_INFO, "Exiting...");
                 is_running = false;
                 break;
 
-            case 'c': // Check for clear screen command
-                clear();
+            case 'c': // Check for clear screen or cat command
+                if (shell_is_command(input_buffer, "cat"))
+                {
+                    shell_cat_command(input_buffer);
+                }
+                else if (strcmp(input_buffer, "c") == 0 || strcmp(input_buffer, "clear") == 0)
+                {
+                    clear();
+                }
+                else
+                {
+                    printf("Unknown command. Type 'h' for help.\r\n");
+                }
                 break;
 
-            case 't': // Check for time command
-                gettime(&time_struct);
-                printf("Current time(GMT): %d:%d:%d\r\n", time_struct.hrs, time_struct.mins, time_struct.secs);
+            case 't': // Check for time or top command
+                if (shell_is_command(input_buffer, "top"))
+                {
+                    shell_top_command();
+                }
+                else if (strcmp(input_buffer, "t") == 0 || strcmp(input_buffer, "time") == 0)
+                {
+                    gettime(&time_struct);
+                    printf("Current time(GMT): %d:%d:%d\r\n", time_struct.hrs, time_struct.mins, time_struct.secs);
+                }
+                else
+                {
+                    printf("Unknown command. Type 'h' for help.\r\n");
+                }
                 break;
 
             case 'd': // Check for date command
@@ -0,0 +1,212 @@
+/**
+ * @file klog.c
+ * @brief Deferred binary log (record on the hot path, format in the drainer)
+ *        and the runtime per-subsystem log levels.
+ */
+#include "klog.h"
+#include "log.h"
+#include "barrier.h"
+#include "clock.h"
+#include "cpustat.h"
+#include "kstat.h"
+#include "format.h"
+#include "ringbuf.h"
+#include "string.h"
+#include "uart.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+
+/** Longest formatted line; longer messages are truncated. */
+#define KLOG_LINE_MAX 256u
+
+static uint8_t           klog_storage[KLOG_RING_SIZE];
+static struct ringbuf    klog_ring = RINGBUF_STATIC_INIT(klog_storage);
+KSTAT_DEFINE(klog_records);
+KSTAT_DEFINE(klog_drops);
+static uint32_t klog_drops_reported = 0;
+
+/**
+ * @internal
+ * @brief Compute a call site's argument layout.
+ *
+ * Concurrent first calls (an IRQ interrupting the thread on the same site)
+ * compute the same values, so publishing `wide` before `nargs` is enough.
+ */
+static void klog_site_init(struct klog_site *site)
+{
+    uint32_t wide;
+    uint32_t nargs = fmt_arg_layout(site->fmt, &wide);
+
+    if (nargs > KLOG_MAX_WORDS)
+    {
+        nargs = KLOG_MAX_WORDS;
+    }
+
+    site->wide = wide;
+    dmb();
+    site->nargs = (uint8_t)nargs;
+}
+
+void klog_record(struct klog_site *site, uint32_t level, ...)
+{
+    if (site->nargs == KLOG_SITE_UNKNOWN)
+    {
+        klog_site_init(site);
+    }
+
+    uint32_t words[KLOG_MAX_WORDS];
+    uint32_t n = 0;
+
+    va_list args;
+    va_start(args, level);
+    for (uint32_t i = 0; i < site->nargs && n < KLOG_MAX_WORDS; i++)
+    {
+        if (site->wide & (1u << i))
+        {
+            const uint64_t v = va_arg(args, uint64_t);
+            words[n++] = (uint32_t)v;
+            if (n < KLOG_MAX_WORDS)
+            {
+                words[n++] = (uint32_t)(v >> 32);
+            }
+        }
+        else
+        {
+            words[n++] = va_arg(args, uint32_t);
+        }
+    }
+    va_end(args);
+
+    const uint64_t   now = clock_cycles();
+    const klog_rec_t rec = {
+        .fmt    = site->fmt,
+        .ts_lo  = (uint32_t)now,
+        .ts_hi  = (uint32_t)(now >> 32),
+        .level  = (uint8_t)level,
+        .nwords = (uint8_t)n,
+    };
+
+    uint32_t pos;
+    if (!ringbuf_mp_reserve(&klog_ring, sizeof(rec) + n * sizeof(uint32_t), &pos))
+    {
+        kstat_add_atomic(klog_drops, 1);
+        return;
+    }
+    kstat_add_atomic(klog_records, 1);
+
+    ringbuf_copy_in(&klog_ring, pos, &rec, sizeof(rec));
+    ringbuf_copy_in(&klog_ring, pos + sizeof(rec), words, n * sizeof(uint32_t));
+    ringbuf_mp_commit(&klog_ring);
+}
+
+/**
+ * @internal
+ * @brief Format one record into a line and queue it on the UART.
+ */
+static void klog_emit(const klog_rec_t *rec, const uint32_t *words)
+{
+    char       line[KLOG_LINE_MAX];
+    fmt_sink_t sink = fmt_sink_buffer(line, sizeof(line) - 2);
+
+    const uint64_t cycles = ((uint64_t)rec->ts_hi << 32) | rec->ts_lo;
+    snformat(&sink, "[%s %llu] ", klog_level_str((klog_level_t)rec->level),
+             (unsigned long long)clock_cycles_to_us(cycles));
+    vsnformat_words(&sink, rec->fmt, words, rec->nwords);
+
+    line[sink.pos++] = '\r';
+    line[sink.pos++] = '\n';
+    uart_write(line, sink.pos);
+}
+
+uint32_t klog_drain(uint32_t max)
+{
+    uint32_t done = 0;
+    const cpu_state_t cpu_prev = cpustat_enter(CPU_DEFERRED);
+
+    const uint32_t drops = kstat_read(klog_drops);
+    if (drops != klog_drops_reported)
+    {
+        printf("[WARN] klog: %u records dropped\r\n", drops - klog_drops_reported);
+        klog_drops_reported = drops;
+    }
+
+    while (done < max && ringbuf_used(&klog_ring) >= sizeof(klog_rec_t))
+    {
+        // A record is published as a whole, so its words are there too
+        klog_rec_t rec;
+        uint32_t   words[KLOG_MAX_WORDS];
+
+        ringbuf_read(&klog_ring, &rec, sizeof(rec));
+        ringbuf_read(&klog_ring, words, rec.nwords * sizeof(uint32_t));
+
+        klog_emit(&rec, words);
+        done++;
+    }
+
+    cpustat_leave(cpu_prev);
+    return done;
+}
+
+void klog_flush(void)
+{
+    uart_sync_mode();
+    klog_drain(UINT32_MAX);
+}
+
+uint32_t klog_dropped(void)
+{
+    return kstat_read(klog_drops);
+}
+
+// --- Runtime levels ---
+
+uint8_t klog_levels[KLOG_SYS_COUNT] = {
+    [0 ... KLOG_SYS_COUNT - 1] = KLOG_DEFAULT_LEVEL,
+};
+
+static const char *const klog_subsys_names[KLOG_SYS_COUNT] = {
+    [KLOG_SYS_KERNEL] = "kernel",
+    [KLOG_SYS_MEMORY] = "memory",
+    [KLOG_SYS_IRQ]    = "irq",
+    [KLOG_SYS_TIMER]  = "timer",
+    [KLOG_SYS_UART]   = "uart",
+    [KLOG_SYS_SHELL]  = "shell",
+};
+
+static const char *const klog_level_names[] = {
+    [KLOG_DEBUG] = "debug",
+    [KLOG_INFO]  = "info",
+    [KLOG_WARN]  = "warn",
+    [KLOG_ERROR] = "error",
+    [KLOG_PANIC] = "panic",
+};
+
+const char *klog_subsys_str(klog_subsys_t sys)
+{
+    return sys < KLOG_SYS_COUNT ? klog_subsys_names[sys] : "?";
+}
+
+int klog_subsys_parse(const char *name)
+{
+    for (int i = 0; i < KLOG_SYS_COUNT; i++)
+    {
+        if (strcmp(name, klog_subsys_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int klog_level_parse(const char *name)
+{
+    for (int i = 0; i < (int)(sizeof(klog_level_names) / sizeof(klog_level_names[0])); i++)
+    {
+        if (strcmp(name, klog_level_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
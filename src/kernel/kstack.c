@@ -0,0 +1,105 @@
+/**
+ * @file kstack.c
+ * @brief Mode stack table, high-water scan and guard page setup.
+ */
+#include "kstack.h"
+#include "mmu.h"
+#include "printf.h"
+#include "log.h"
+#include "lib/math.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Laid out by kernel.ld; sizes are absolute symbols, read as addresses
+extern char __stack_bottom__[], __stack_top__[], __svc_stack_size__[];
+extern char __irq_stack_bottom__[], __irq_stack_top__[], __irq_stack_size__[];
+extern char __fiq_stack_bottom__[], __fiq_stack_top__[], __fiq_stack_size__[];
+extern char __abt_stack_bottom__[], __abt_stack_top__[], __abt_stack_size__[];
+extern char __und_stack_bottom__[], __und_stack_top__[], __und_stack_size__[];
+
+struct kstack_def
+{
+    const char *name;
+    char       *bottom;
+    char       *top;
+    char       *budget;
+};
+
+static const struct kstack_def STACKS[KSTACK_COUNT] = {
+    [KSTACK_SVC] = { "svc", __stack_bottom__,     __stack_top__,     __svc_stack_size__ },
+    [KSTACK_IRQ] = { "irq", __irq_stack_bottom__, __irq_stack_top__, __irq_stack_size__ },
+    [KSTACK_FIQ] = { "fiq", __fiq_stack_bottom__, __fiq_stack_top__, __fiq_stack_size__ },
+    [KSTACK_ABT] = { "abt", __abt_stack_bottom__, __abt_stack_top__, __abt_stack_size__ },
+    [KSTACK_UND] = { "und", __und_stack_bottom__, __und_stack_top__, __und_stack_size__ },
+};
+
+static bool guarded = false;
+
+void kstack_guard_init(void)
+{
+    for (uint32_t i = 0; i < KSTACK_COUNT; i++)
+    {
+        const uintptr_t guard = (uintptr_t)STACKS[i].bottom - PAGE_SIZE;
+        if (mmu_guard_page(guard) != KERR_OK)
+        {
+            KLOGS(KLOG_SYS_MEMORY, KLOG_WARN, "%s stack: no guard page at %p",
+                  STACKS[i].name, (void *)guard);
+            return;
+        }
+    }
+    guarded = true;
+}
+
+bool kstack_usage(kstack_id_t id, struct kstack_usage *out)
+{
+    if (id >= KSTACK_COUNT)
+    {
+        return false;
+    }
+
+    const struct kstack_def *s = &STACKS[id];
+    const uint32_t *w   = (const uint32_t *)(void *)s->bottom;
+    const uint32_t *end = (const uint32_t *)(void *)s->top;
+
+    // Stacks grow down: the first overwritten word from the bottom is the deepest
+    while (w < end && *w == KSTACK_CANARY)
+    {
+        w++;
+    }
+
+    out->name    = s->name;
+    out->bottom  = (uintptr_t)s->bottom;
+    out->top     = (uintptr_t)s->top;
+    out->budget  = (uint32_t)(uintptr_t)s->budget;
+    out->used    = (uint32_t)((uintptr_t)end - (uintptr_t)w);
+    out->guarded = guarded;
+    return true;
+}
+
+kstack_id_t kstack_guarding(uintptr_t addr)
+{
+    for (uint32_t i = 0; i < KSTACK_COUNT; i++)
+    {
+        const uintptr_t bottom = (uintptr_t)STACKS[i].bottom;
+        if (addr < bottom && addr >= bottom - PAGE_SIZE)
+        {
+            return (kstack_id_t)i;
+        }
+    }
+    return KSTACK_COUNT;
+}
+
+void kstack_dump(void)
+{
+    printf("  stack  bottom        budget      used  of budget  guard\r\n");
+    for (uint32_t i = 0; i < KSTACK_COUNT; i++)
+    {
+        struct kstack_usage u;
+        kstack_usage((kstack_id_t)i, &u);
+
+        printf("  %-5s  %p  %8u  %8u  %8u%%  %s%s\r\n", u.name, (void *)u.bottom, u.budget, u.used,
+               udiv32(u.used * 100u, u.budget), u.guarded ? "yes" : "no",
+               u.used > u.budget ? "  OVER BUDGET" : "");
+    }
+}
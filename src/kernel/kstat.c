@@ -0,0 +1,96 @@
+/**
+ * @file kstat.c
+ * @brief Enumeration and shell dump of the `.kstat` linker section.
+ */
+#include "kstat.h"
+#include "printf.h"
+#include "string.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+extern struct kstat __kstat_start[];
+extern struct kstat __kstat_end[];
+
+uint32_t kstat_count(void)
+{
+    return (uint32_t)(__kstat_end - __kstat_start);
+}
+
+struct kstat *kstat_at(uint32_t i)
+{
+    return i < kstat_count() ? &__kstat_start[i] : NULL;
+}
+
+struct kstat *kstat_find(const char *name)
+{
+    // kernel.ld sorts the section by name
+    uint32_t lo = 0;
+    uint32_t hi = kstat_count();
+
+    while (lo < hi)
+    {
+        const uint32_t mid = lo + (hi - lo) / 2u;
+        const int      cmp = strcmp(__kstat_start[mid].name, name);
+
+        if (cmp == 0)
+        {
+            return &__kstat_start[mid];
+        }
+        if (cmp < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+uint32_t kstat_delta(struct kstat *k)
+{
+    const uint32_t now = k->value;
+    const uint32_t d   = now - k->last;
+    k->last = now;
+    return d;
+}
+
+static bool has_prefix(const char *name, const char *prefix)
+{
+    while (*prefix)
+    {
+        if (*name++ != *prefix++)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void kstat_dump(bool delta, const char *prefix)
+{
+    for (struct kstat *k = __kstat_start; k < __kstat_end; k++)
+    {
+        if (prefix && !has_prefix(k->name, prefix))
+        {
+            continue;
+        }
+
+        if (k->kind == KSTAT_GAUGE)
+        {
+            printf("  %-24s %12d\r\n", k->name, (int32_t)k->value);
+        }
+        else if (delta)
+        {
+            const uint32_t value = k->value;
+            printf("  %-24s %12u  +%u\r\n", k->name, value, kstat_delta(k));
+        }
+        else
+        {
+            printf("  %-24s %12u\r\n", k->name, k->value);
+        }
+    }
+}
@@ -0,0 +1,293 @@
+/**
+ * @file ktimer.c
+ * @brief Hierarchical timing wheel for kernel timers.
+ *
+ * Five wheels cover the full 32-bit tick range: the root wheel has 256
+ * one-tick slots, each outer wheel has 64 slots whose granularity is the
+ * span of the wheel below it (256, 2^14, 2^20 and 2^26 ticks).
+ *
+ * A timer lands in the finest wheel that can hold its remaining delay.
+ * Each time the root wheel wraps, the current slot of the next wheel is
+ * cascaded: its timers are re-inserted and fall into finer slots. Insert
+ * and cancel are a list splice; the per-tick cost is one slot plus an
+ * occasional cascade.
+ */
+#include "ktimer.h"
+#include "interrupt.h"
+#include "log.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TVR_BITS  8
+#define TVN_BITS  6
+#define TVR_SIZE  (1u << TVR_BITS)
+#define TVN_SIZE  (1u << TVN_BITS)
+#define TVR_MASK  (TVR_SIZE - 1)
+#define TVN_MASK  (TVN_SIZE - 1)
+
+// Slot index of `t` at outer wheel level `n` (n = 0 is the first outer wheel)
+#define TVN_INDEX(t, n) (((t) >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+static struct ktimer_link tv1[TVR_SIZE];
+static struct ktimer_link tv2[TVN_SIZE];
+static struct ktimer_link tv3[TVN_SIZE];
+static struct ktimer_link tv4[TVN_SIZE];
+static struct ktimer_link tv5[TVN_SIZE];
+
+static uint32_t timer_jiffies = 0; /**< Next tick the wheel will process. */
+static bool     wheel_ready   = false;
+
+/**
+ * @internal
+ * @brief Lazily turn every slot into an empty circular list.
+ */
+static void ktimer_wheel_init(void)
+{
+    for (uint32_t i = 0; i < TVR_SIZE; i++)
+    {
+        tv1[i].next = tv1[i].prev = &tv1[i];
+    }
+
+    for (uint32_t i = 0; i < TVN_SIZE; i++)
+    {
+        tv2[i].next = tv2[i].prev = &tv2[i];
+        tv3[i].next = tv3[i].prev = &tv3[i];
+        tv4[i].next = tv4[i].prev = &tv4[i];
+        tv5[i].next = tv5[i].prev = &tv5[i];
+    }
+
+    timer_jiffies = (uint32_t)systicks;
+    wheel_ready   = true;
+
+    KLOGS(KLOG_SYS_TIMER, KLOG_DEBUG, "timer wheel ready at jiffy %u", timer_jiffies);
+}
+
+static inline void link_add_tail(struct ktimer_link *head, struct ktimer_link *node)
+{
+    node->prev       = head->prev;
+    node->next       = head;
+    head->prev->next = node;
+    head->prev       = node;
+}
+
+static inline void link_del(struct ktimer_link *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next       = NULL;
+    node->prev       = NULL;
+}
+
+/**
+ * @internal
+ * @brief Hash a timer into the wheel slot matching its remaining delay.
+ *
+ * Caller must hold IRQs masked.
+ */
+static void ktimer_enqueue(struct ktimer *timer)
+{
+    const uint32_t expires = timer->expires;
+    const uint32_t idx     = expires - timer_jiffies;
+    struct ktimer_link *slot;
+
+    if ((int32_t)idx < 0)
+    {
+        // Already due: run on the very next processed tick
+        slot = &tv1[timer_jiffies & TVR_MASK];
+    }
+    else if (idx < TVR_SIZE)
+    {
+        slot = &tv1[expires & TVR_MASK];
+    }
+    else if (idx < (1u << (TVR_BITS + TVN_BITS)))
+    {
+        slot = &tv2[TVN_INDEX(expires, 0)];
+    }
+    else if (idx < (1u << (TVR_BITS + 2 * TVN_BITS)))
+    {
+        slot = &tv3[TVN_INDEX(expires, 1)];
+    }
+    else if (idx < (1u << (TVR_BITS + 3 * TVN_BITS)))
+    {
+        slot = &tv4[TVN_INDEX(expires, 2)];
+    }
+    else
+    {
+        slot = &tv5[TVN_INDEX(expires, 3)];
+    }
+
+    link_add_tail(slot, &timer->link);
+}
+
+/**
+ * @internal
+ * @brief Re-insert every timer of an outer slot into finer wheels.
+ *
+ * @return The slot index, so the caller knows whether this wheel wrapped
+ *         too and the next one must be cascaded.
+ */
+static uint32_t ktimer_cascade(struct ktimer_link *wheel, uint32_t index)
+{
+    struct ktimer_link *head = &wheel[index];
+    struct ktimer_link *node = head->next;
+
+    // Detach the whole slot first: re-inserting may target the same slot
+    head->next = head->prev = head;
+
+    while (node != head)
+    {
+        struct ktimer_link *next = node->next;
+        ktimer_enqueue((struct ktimer *)node);
+        node = next;
+    }
+
+    return index;
+}
+
+void ktimer_init(struct ktimer *timer, ktimer_fn_t fn, void *arg)
+{
+    *timer = (struct ktimer)
+    {
+        .link    = { NULL, NULL },
+        .expires = 0,
+        .period  = 0,
+        .fn      = fn,
+        .arg     = arg,
+    };
+}
+
+/**
+ * @internal
+ * @brief (Re)arm a timer with IRQs already masked.
+ */
+static bool ktimer_arm_locked(struct ktimer *timer, uint32_t delay)
+{
+    if (!wheel_ready)
+    {
+        ktimer_wheel_init();
+    }
+
+    const bool was_pending = ktimer_pending(timer);
+    if (was_pending)
+    {
+        link_del(&timer->link);
+    }
+
+    timer->expires = timer_jiffies + delay;
+    ktimer_enqueue(timer);
+
+    return was_pending;
+}
+
+void ktimer_add(struct ktimer *timer, uint32_t delay)
+{
+    const uint32_t flags = irq_save();
+    timer->period = 0;
+    ktimer_arm_locked(timer, delay);
+    irq_restore(flags);
+}
+
+void ktimer_add_periodic(struct ktimer *timer, uint32_t period)
+{
+    if (period == 0)
+    {
+        period = 1;
+    }
+
+    const uint32_t flags = irq_save();
+    timer->period = period;
+    ktimer_arm_locked(timer, period);
+    irq_restore(flags);
+}
+
+bool ktimer_mod(struct ktimer *timer, uint32_t delay)
+{
+    const uint32_t flags   = irq_save();
+    const bool was_pending = ktimer_arm_locked(timer, delay);
+    irq_restore(flags);
+
+    return was_pending;
+}
+
+bool ktimer_del(struct ktimer *timer)
+{
+    const uint32_t flags = irq_save();
+
+    const bool was_pending = ktimer_pending(timer);
+    if (was_pending)
+    {
+        link_del(&timer->link);
+    }
+    timer->period = 0;
+
+    irq_restore(flags);
+    return was_pending;
+}
+
+uint32_t ktimer_now(void)
+{
+    return timer_jiffies;
+}
+
+void ktimer_tick(void)
+{
+    if (!wheel_ready)
+    {
+        ktimer_wheel_init();
+    }
+
+    const uint32_t now   = (uint32_t)systicks;
+    const uint32_t flags = irq_save(); // already masked in IRQ context
+
+    while ((int32_t)(now - timer_jiffies) >= 0)
+    {
+        const uint32_t index = timer_jiffies & TVR_MASK;
+
+        // Root wheel wrapped: pull the next slot of each outer wheel down
+        if (index == 0 &&
+            ktimer_cascade(tv2, TVN_INDEX(timer_jiffies, 0)) == 0 &&
+            ktimer_cascade(tv3, TVN_INDEX(timer_jiffies, 1)) == 0 &&
+            ktimer_cascade(tv4, TVN_INDEX(timer_jiffies, 2)) == 0)
+        {
+            ktimer_cascade(tv5, TVN_INDEX(timer_jiffies, 3));
+        }
+
+        // Move the slot to a private list: a periodic timer re-armed below
+        // may hash right back into this very slot.
+        struct ktimer_link expired;
+        struct ktimer_link *slot = &tv1[index];
+        if (slot->next == slot)
+        {
+            timer_jiffies++;
+            continue;
+        }
+        expired.next       = slot->next;
+        expired.prev       = slot->prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        slot->next = slot->prev = slot;
+
+        timer_jiffies++;
+
+        while (expired.next != &expired)
+        {
+            struct ktimer *timer = (struct ktimer *)expired.next;
+            link_del(&timer->link);
+
+            // Re-arm periodic timers from their own expiry so they don't drift
+            if (timer->period)
+            {
+                timer->expires += timer->period;
+                ktimer_enqueue(timer);
+            }
+
+            if (timer->fn)
+            {
+                timer->fn(timer, timer->arg);
+            }
+        }
+    }
+
+    irq_restore(flags);
+}
@@ -19,6 +19,13 @@
  * The allocator uses a first-fit strategy and merges adjacent free blocks
  * to reduce fragmentation.
  *
+ * Interrupt handlers never touch the block list. In IRQ context kmalloc()
+ * pops a preloaded object from a small per-size-class cache and kfree()
+ * pushes the block onto a deferred-free list; both are LDREX/STREX
+ * lock-free stacks. The thread side reclaims deferred frees in one batch
+ * and tops the caches up whenever an interrupt asked for it, on its next
+ * kmalloc()/kfree() or from the idle thread.
+ *
  * @note These implementations are inspired by
  *      https://github.com/dthain/basekernel/blob/master/kernel/kmalloc.c
  */
@@ -26,8 +33,40 @@
 #include "panic.h"
 #include "errno.h"
 #include "utils.h"
+#include "log.h"
+#include "thread.h"
+#include "interrupt.h"
+#include "atomic.h"
+#include "cpustat.h"
+#include "kstat.h"
+#include <stdbool.h>
 #include <stdint.h>
 
+/** Object sizes of the IRQ caches; larger IRQ requests fail. */
+static const size_t KMALLOC_IRQ_SIZES[KMALLOC_IRQ_CLASSES] = { 32, 64, 128, 256 };
+
+/**
+ * @brief Preloaded objects of one size class, popped by IRQ handlers only.
+ */
+struct irq_cache
+{
+    void *volatile free;  /**< Lock-free stack linked through the objects. */
+    atomic_t       count; /**< Objects on the stack. */
+};
+
+static struct irq_cache         irq_caches[KMALLOC_IRQ_CLASSES];
+static void *volatile           irq_deferred = NULL;  /**< Blocks freed in IRQ context. */
+static volatile bool            irq_wants    = false; /**< An IRQ wants the caches refilled. */
+
+KSTAT_DEFINE(mem_kmalloc_calls);
+KSTAT_DEFINE(mem_kfree_calls);
+KSTAT_GAUGE_DEFINE(mem_used_bytes);
+KSTAT_DEFINE(mem_irq_allocs);    // IRQ side: one writer, the interrupt
+KSTAT_DEFINE(mem_irq_misses);
+KSTAT_DEFINE(mem_irq_deferred);
+KSTAT_DEFINE(mem_irq_reclaimed); // thread side, preemption off
+KSTAT_DEFINE(mem_irq_refills);
+
 static struct header *head = NULL;
 /**< Default alignment: at least pointer size; 16 is a good general default. */
 static const size_t KMALLOC_ALIGN = (16 < sizeof(void*) ? sizeof(void*) : 16); 
@@ -37,6 +76,41 @@ struct header *kmalloc_get_head(void)
     return head;
 }
 
+// --- Lock-free stacks ---
+// irq_entry ends with CLREX, so an interrupt that lands between LDREX and
+// STREX always makes the STREX fail and the loop retry. Only IRQ handlers
+// pop from an IRQ cache and they do not nest, so pops cannot suffer ABA.
+
+static inline void lf_push(void *volatile *top, void *node)
+{
+    void *old;
+    do
+    {
+        old            = *top;
+        *(void **)node = old;
+    } while (atomic_cmpxchg_ptr(top, old, node) != old);
+}
+
+/** Pop keeps its own LDREX/STREX pair: the link is read inside it. */
+
+static inline void *lf_pop(void *volatile *top)
+{
+    void    *node;
+    uint32_t failed;
+    do
+    {
+        __asm__ volatile("ldrex %0, [%1]" : "=&r"(node) : "r"(top) : "memory");
+        if (!node)
+        {
+            __asm__ volatile("clrex" ::: "memory");
+            return NULL;
+        }
+        __asm__ volatile("strex %0, %2, [%1]" : "=&r"(failed) : "r"(top), "r"(*(void **)node) : "memory");
+    } while (failed);
+    return node;
+}
+
+
 void kmalloc_init(void *restrict start, void *restrict limit)
 {
     const uintptr_t s = (uintptr_t)start;
@@ -62,6 +136,23 @@ void kmalloc_init(void *restrict start, void *restrict limit)
         .next  = NULL,
         .prev  = NULL,
     };
+
+    // Objects of a previous heap are forgotten; kmalloc_irq_refill() reloads
+    for (uint32_t c = 0; c < KMALLOC_IRQ_CLASSES; c++)
+    {
+        irq_caches[c] = (struct irq_cache){ 0 };
+    }
+    irq_deferred = NULL;
+    irq_wants    = false;
+    kstat_set(mem_used_bytes, 0);
+    kstat_set(mem_irq_allocs, 0);
+    kstat_set(mem_irq_misses, 0);
+    kstat_set(mem_irq_deferred, 0);
+    kstat_set(mem_irq_reclaimed, 0);
+    kstat_set(mem_irq_refills, 0);
+
+    KLOGS(KLOG_SYS_MEMORY, KLOG_DEBUG, "heap %p..%p, %u bytes free",
+          (void *)aligned_start, (void *)aligned_end, (unsigned)head->size);
 }
 
 /**
@@ -97,13 +188,12 @@ static void ksplit_block(struct header *curr, size_t size)
     curr->size = size;
 }
 
-void *kmalloc(size_t size)
+/**
+ * @internal
+ * @brief First-fit allocation from the block list; preemption must be off.
+ */
+static void *heap_alloc(size_t size)
 {
-    if (size == 0)
-    {
-        return NULL; // not initialized
-    }
-
     // Round size up to alignment
     size = (size + (KMALLOC_ALIGN - 1)) & ~(size_t)(KMALLOC_ALIGN - 1);
 
@@ -127,6 +217,7 @@ void *kmalloc(size_t size)
         ksplit_block(curr, size);
     }
     curr->state = BLOCK_USED;
+    kstat_add(mem_used_bytes, curr->size);
 
     return (void*)((char*)curr + sizeof(struct header));
 }
@@ -159,21 +250,213 @@ static void kmerge(struct header *curr)
     }
 }
 
-void kfree(void *block)
+static inline struct header *block_header(void *block)
 {
-    if (!block)
-    {
-        return;
-    }
-
     struct header *curr = (struct header*)((char*)block - sizeof(struct header));
 
     if (curr->state != BLOCK_USED)
     {
         kernel_panic("kfree:", KERR_INVAL);
     }
+    return curr;
+}
 
+/** Free with preemption already disabled. */
+static void heap_free(void *block)
+{
+    struct header *curr = block_header(block);
+
+    kstat_sub(mem_used_bytes, curr->size);
     curr->state = BLOCK_FREE;
     kmerge(curr);
     kmerge(curr->prev);
 }
+
+// --- IRQ context ---
+
+static void *irq_alloc(size_t size)
+{
+    // Smallest class that fits; a larger one if that cache ran dry
+    for (uint32_t c = 0; c < KMALLOC_IRQ_CLASSES; c++)
+    {
+        if (size > KMALLOC_IRQ_SIZES[c])
+        {
+            continue;
+        }
+
+        void *obj = lf_pop(&irq_caches[c].free);
+        if (obj)
+        {
+            if (atomic_sub_return(&irq_caches[c].count, 1) < (int32_t)KMALLOC_IRQ_LOW)
+            {
+                irq_wants = true;
+            }
+            kstat_inc(mem_irq_allocs);
+            return obj;
+        }
+    }
+
+    irq_wants = true;
+    kstat_inc(mem_irq_misses);
+    kstat_add_atomic(panics_avoided, 1);
+    return NULL;
+}
+
+void kmalloc_irq_refill(void)
+{
+    irq_wants = false; // before the work, so a request made meanwhile is kept
+    const cpu_state_t cpu_prev = cpustat_enter(CPU_DEFERRED);
+
+    // Detach and free with no switch in between: the heap can be swapped meanwhile
+    sched_preempt_disable();
+    void *list = atomic_xchg_ptr(&irq_deferred, NULL);
+    while (list)
+    {
+        void *next = *(void **)list;
+        heap_free(list);
+        kstat_inc(mem_irq_reclaimed);
+        list = next;
+    }
+
+    for (uint32_t c = 0; c < KMALLOC_IRQ_CLASSES; c++)
+    {
+        while (atomic_read(&irq_caches[c].count) < (int32_t)KMALLOC_IRQ_DEPTH)
+        {
+            lf_push(&irq_caches[c].free, heap_alloc(KMALLOC_IRQ_SIZES[c]));
+            atomic_inc(&irq_caches[c].count);
+            kstat_inc(mem_irq_refills);
+        }
+    }
+    sched_preempt_enable();
+    cpustat_leave(cpu_prev);
+}
+
+void kmalloc_irq_maintain(void)
+{
+    if (irq_wants)
+    {
+        kmalloc_irq_refill();
+    }
+}
+
+void kmalloc_irq_stats(struct kmalloc_irq_stats *stats)
+{
+    *stats = (struct kmalloc_irq_stats){
+        .allocs    = kstat_read(mem_irq_allocs),
+        .misses    = kstat_read(mem_irq_misses),
+        .deferred  = kstat_read(mem_irq_deferred),
+        .reclaimed = kstat_read(mem_irq_reclaimed),
+        .refills   = kstat_read(mem_irq_refills),
+    };
+}
+
+void kmalloc_save(struct kmalloc_state *state)
+{
+    const uint32_t flags = irq_save(); // no IRQ pop or push halfway through
+    *state = (struct kmalloc_state){
+        .head         = head,
+        .irq_deferred = irq_deferred,
+        .irq_wants    = irq_wants,
+        .used_bytes   = kstat_read(mem_used_bytes),
+    };
+    for (uint32_t c = 0; c < KMALLOC_IRQ_CLASSES; c++)
+    {
+        state->irq_free[c]  = irq_caches[c].free;
+        state->irq_count[c] = atomic_read(&irq_caches[c].count);
+    }
+    kmalloc_irq_stats(&state->irq_stats);
+    irq_restore(flags);
+}
+
+void kmalloc_restore(const struct kmalloc_state *state)
+{
+    const uint32_t flags = irq_save();
+    head         = state->head;
+    irq_deferred = state->irq_deferred;
+    irq_wants    = state->irq_wants;
+    for (uint32_t c = 0; c < KMALLOC_IRQ_CLASSES; c++)
+    {
+        irq_caches[c].free = state->irq_free[c];
+        atomic_set(&irq_caches[c].count, state->irq_count[c]);
+    }
+    kstat_set(mem_used_bytes, state->used_bytes);
+    kstat_set(mem_irq_allocs, state->irq_stats.allocs);
+    kstat_set(mem_irq_misses, state->irq_stats.misses);
+    kstat_set(mem_irq_deferred, state->irq_stats.deferred);
+    kstat_set(mem_irq_reclaimed, state->irq_stats.reclaimed);
+    kstat_set(mem_irq_refills, state->irq_stats.refills);
+    irq_restore(flags);
+}
+
+// --- Public entry points ---
+
+void *kmalloc(size_t size)
+{
+    if (size == 0)
+    {
+        return NULL; // not initialized
+    }
+    if (in_irq())
+    {
+        return irq_alloc(size);
+    }
+
+    kmalloc_irq_maintain();
+
+    sched_preempt_disable(); // the block list is shared by all threads
+    void *block = heap_alloc(size);
+    kstat_inc(mem_kmalloc_calls);
+    sched_preempt_enable();
+    return block;
+}
+
+void kfree(void *block)
+{
+    if (!block)
+    {
+        return;
+    }
+    if (in_irq())
+    {
+        block_header(block); // catch a double free here, not in the batch
+        lf_push(&irq_deferred, block);
+        kstat_inc(mem_irq_deferred);
+        irq_wants = true;
+        return;
+    }
+
+    kmalloc_irq_maintain();
+
+    sched_preempt_disable();
+    heap_free(block);
+    kstat_inc(mem_kfree_calls);
+    sched_preempt_enable();
+}
+
+void *kmalloc_aligned(size_t size, size_t align)
+{
+    if (size == 0)
+    {
+        return NULL;
+    }
+    if (align == 0 || (align & (align - 1)) != 0)
+    {
+        kernel_panic("kmalloc_aligned: alignment not a power of two", KERR_INVAL);
+    }
+
+    // Room to slide to the boundary, plus one word for the raw pointer
+    char *raw = kmalloc(size + align + sizeof(void *));
+    const uintptr_t aligned = align_up_uintptr((uintptr_t)raw + sizeof(void *), align);
+
+    ((void **)aligned)[-1] = raw;
+    return (void *)aligned;
+}
+
+void kfree_aligned(void *block)
+{
+    if (!block)
+    {
+        return;
+    }
+    kfree(((void **)block)[-1]);
+}
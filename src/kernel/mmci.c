@@ -0,0 +1,570 @@
+/**
+ * @file mmci.c
+ * @brief PL181 card identification, multi-block commands and FIFO interrupts.
+ *
+ * Commands are short and polled. A data transfer is set up by the
+ * calling thread, which then sleeps; mmci_irq_handler() moves the FIFO
+ * contents between the card and the caller's buffers and wakes it on
+ * DataEnd, an error, or the watchdog timer.
+ */
+#include "mmci.h"
+#include "interrupt.h"
+#include "clock.h"
+#include "ktimer.h"
+#include "kstat.h"
+#include "waitqueue.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// SD commands used here. ref: SD Physical Layer Simplified Specification, 4.7.4
+#define SD_GO_IDLE_STATE       0u
+#define SD_ALL_SEND_CID        2u
+#define SD_SEND_RELATIVE_ADDR  3u
+#define SD_SELECT_CARD         7u
+#define SD_SEND_IF_COND        8u
+#define SD_SEND_CSD            9u
+#define SD_STOP_TRANSMISSION   12u
+#define SD_SEND_STATUS         13u
+#define SD_SET_BLOCKLEN        16u
+#define SD_READ_SINGLE_BLOCK   17u
+#define SD_READ_MULTIPLE_BLOCK 18u
+#define SD_WRITE_BLOCK         24u
+#define SD_WRITE_MULTIPLE_BLOCK 25u
+#define SD_APP_CMD             55u
+#define SD_APP_SEND_OP_COND    41u
+
+#define SD_IF_COND_CHECK       0x1AAu      // 2.7-3.6 V, check pattern 0xAA
+#define SD_OCR_VDD             0x00FF8000u // 2.7-3.6 V
+#define SD_OCR_CCS             (1u << 30)  // block addressed (SDHC/SDXC)
+#define SD_OCR_READY           (1u << 31)  // power-up done
+
+#define SD_R1_ERRORS           0xFD398008u // errors of this command, not the previous one
+#define SD_R1_READY_FOR_DATA   (1u << 8)
+#define SD_R1_STATE(r)         (((r) >> 9) & 0xFu)
+#define SD_STATE_TRAN          4u
+
+#define RSP_NONE               0u
+#define RSP_SHORT              MMCI_CMD_RESPONSE
+#define RSP_LONG               (MMCI_CMD_RESPONSE | MMCI_CMD_LONGRSP)
+#define RSP_NOCRC              (1u << 31)  // R3 carries no CRC: CmdCrcFail is expected
+
+#define MMCI_CLKDIV_IDENT      59u         // <= 400 kHz from MCLK until the card is identified
+#define MMCI_CLKDIV_DATA       0u
+#define MMCI_CMD_TIMEOUT_MS    10u
+#define MMCI_POWERUP_MS        1000u
+#define MMCI_DATA_TIMEOUT_MS   1000u
+#define MMCI_DATA_TIMER        0x00FFFFFFu // card clocks before DataTimeOut
+
+#define MMCI_CMD_STATUS        (MMCI_CMDCRCFAIL | MMCI_CMDTIMEOUT | MMCI_CMDRESPEND | MMCI_CMDSENT)
+
+struct mmci_card
+{
+    bool     present;
+    bool     block_addressed; /**< Arguments are sector numbers, not byte offsets. */
+    uint32_t rca;             /**< Relative card address, in the upper half. */
+    uint32_t sectors;
+};
+
+/** The transfer in flight; the cursor runs across the commands of one call. */
+struct mmci_xfer
+{
+    const struct mmci_iov *iov;
+    const struct mmci_iov *iov_end;
+    uint32_t              *p;        /**< Next word of the current buffer. */
+    size_t                 seg_left; /**< Bytes left in the current buffer. */
+    size_t                 left;     /**< Bytes left in the current command. */
+    bool                   read;
+    volatile bool          done;
+    kerror_t               status;
+};
+
+static struct mmci_card   card;
+static struct mmci_xfer   xfer = { .done = true };
+static struct wait_queue  xfer_wq = WAIT_QUEUE_INIT;
+static struct ktimer      xfer_watchdog;
+static bool               xfer_locked = false;
+static struct wait_queue  lock_wq = WAIT_QUEUE_INIT;
+
+static void mmci_watchdog(struct ktimer *timer, void *arg);
+
+KSTAT_DEFINE(mmci_commands);
+KSTAT_DEFINE(mmci_sectors_read);
+KSTAT_DEFINE(mmci_sectors_written);
+KSTAT_DEFINE(mmci_fifo_bursts); // IRQ context only
+KSTAT_DEFINE(mmci_errors);
+
+// --- Commands ---
+
+static inline uint32_t timeout_cycles(uint32_t ms)
+{
+    return ms * (clock_hz() / 1000u);
+}
+
+/**
+ * @internal
+ * @brief Send one command and poll for its completion.
+ *
+ * @param flags RSP_* response kind.
+ * @param resp  Response words, 4 for RSP_LONG (resp[0] holds bits 127-96); may be NULL.
+ *
+ * @return KERR_NOT_FOUND if the card did not answer, KERR_IO on a CRC error.
+ */
+static kerror_t mmci_command(uint32_t index, uint32_t arg, uint32_t flags, uint32_t *resp)
+{
+    const uint32_t wait = (flags & MMCI_CMD_RESPONSE) ? MMCI_CMDRESPEND | MMCI_CMDTIMEOUT | MMCI_CMDCRCFAIL
+                                                      : MMCI_CMDSENT;
+    kstat_inc(mmci_commands);
+
+    MMCI_CLEAR    = MMCI_CMD_STATUS;
+    MMCI_ARGUMENT = arg;
+    MMCI_COMMAND  = index | (flags & RSP_LONG) | MMCI_CMD_ENABLE;
+
+    const uint32_t t0 = clock_cycles32();
+    uint32_t status   = MMCI_STATUS;
+    while (!(status & wait) && clock_cycles32() - t0 < timeout_cycles(MMCI_CMD_TIMEOUT_MS))
+    {
+        status = MMCI_STATUS;
+    }
+    MMCI_CLEAR   = MMCI_CMD_STATUS;
+    MMCI_COMMAND = 0;
+
+    if (!(status & wait) || (status & MMCI_CMDTIMEOUT))
+    {
+        return KERR_NOT_FOUND;
+    }
+    if ((status & MMCI_CMDCRCFAIL) && !(flags & RSP_NOCRC))
+    {
+        return KERR_IO;
+    }
+    if (resp)
+    {
+        const uint32_t words = (flags & MMCI_CMD_LONGRSP) ? 4u : (flags & MMCI_CMD_RESPONSE) ? 1u : 0u;
+        for (uint32_t i = 0; i < words; i++)
+        {
+            resp[i] = MMCI_RESPONSE(i);
+        }
+    }
+    return KERR_OK;
+}
+
+static kerror_t mmci_app_command(uint32_t index, uint32_t arg, uint32_t flags, uint32_t *resp)
+{
+    const kerror_t err = mmci_command(SD_APP_CMD, card.rca, RSP_SHORT, NULL);
+    return err == KERR_OK ? mmci_command(index, arg, flags, resp) : err;
+}
+
+/** Bits [lo, lo + width) of a 128-bit register read as resp[0] = bits 127-96. */
+static uint32_t reg_bits(const uint32_t reg[4], uint32_t lo, uint32_t width)
+{
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < width; i++)
+    {
+        const uint32_t bit = lo + i;
+        v |= ((reg[3u - bit / 32u] >> (bit % 32u)) & 1u) << i;
+    }
+    return v;
+}
+
+static uint32_t csd_sectors(const uint32_t csd[4])
+{
+    if (reg_bits(csd, 126, 2) == 1u)
+    {
+        return (reg_bits(csd, 48, 22) + 1u) * 1024u; // CSD 2.0: C_SIZE in 512 KiB units
+    }
+
+    const uint32_t c_size   = reg_bits(csd, 62, 12);
+    const uint32_t mult     = reg_bits(csd, 47, 3);
+    const uint32_t read_len = reg_bits(csd, 80, 4);
+    return (c_size + 1u) << (mult + 2u + read_len - 9u);
+}
+
+/** Poll SEND_STATUS until the card has programmed a write and is back in transfer state. */
+static kerror_t mmci_wait_ready(void)
+{
+    const uint32_t t0 = clock_cycles32();
+    do
+    {
+        uint32_t r1 = 0;
+        const kerror_t err = mmci_command(SD_SEND_STATUS, card.rca, RSP_SHORT, &r1);
+        if (err != KERR_OK)
+        {
+            return err;
+        }
+        if (SD_R1_STATE(r1) == SD_STATE_TRAN && (r1 & SD_R1_READY_FOR_DATA))
+        {
+            return (r1 & SD_R1_ERRORS) ? KERR_IO : KERR_OK;
+        }
+    } while (clock_cycles32() - t0 < timeout_cycles(MMCI_DATA_TIMEOUT_MS));
+    return KERR_IO;
+}
+
+kerror_t mmci_init(void)
+{
+    card = (struct mmci_card){ 0 };
+
+    MMCI_MASK0 = 0;
+    MMCI_MASK1 = 0;
+    MMCI_CLEAR = MMCI_CLEAR_ALL;
+    MMCI_POWER = MMCI_POWER_UP;
+    MMCI_POWER = MMCI_POWER_ON;
+    MMCI_CLOCK = MMCI_CLOCK_ENABLE | MMCI_CLOCK_DIV(MMCI_CLKDIV_IDENT);
+
+    mmci_command(SD_GO_IDLE_STATE, 0, RSP_NONE, NULL);
+
+    // Only v2 cards echo the check pattern, and only they may be block addressed
+    uint32_t r = 0;
+    const bool v2 = mmci_command(SD_SEND_IF_COND, SD_IF_COND_CHECK, RSP_SHORT, &r) == KERR_OK &&
+                    (r & 0xFFFu) == SD_IF_COND_CHECK;
+
+    const uint32_t t0 = clock_cycles32();
+    do
+    {
+        if (mmci_app_command(SD_APP_SEND_OP_COND, SD_OCR_VDD | (v2 ? SD_OCR_CCS : 0u),
+                             RSP_SHORT | RSP_NOCRC, &r) != KERR_OK)
+        {
+            KLOGS(KLOG_SYS_KERNEL, KLOG_INFO, "mmci: no card");
+            return KERR_NOT_FOUND;
+        }
+    } while (!(r & SD_OCR_READY) && clock_cycles32() - t0 < timeout_cycles(MMCI_POWERUP_MS));
+
+    uint32_t cid[4];
+    uint32_t csd[4];
+    if (!(r & SD_OCR_READY) ||
+        mmci_command(SD_ALL_SEND_CID, 0, RSP_LONG, cid) != KERR_OK ||
+        mmci_command(SD_SEND_RELATIVE_ADDR, 0, RSP_SHORT, &card.rca) != KERR_OK)
+    {
+        KLOGS(KLOG_SYS_KERNEL, KLOG_ERROR, "mmci: card did not power up");
+        return KERR_IO;
+    }
+    card.block_addressed = v2 && (r & SD_OCR_CCS);
+    card.rca &= 0xFFFF0000u;
+
+    if (mmci_command(SD_SEND_CSD, card.rca, RSP_LONG, csd) != KERR_OK ||
+        mmci_command(SD_SELECT_CARD, card.rca, RSP_SHORT, NULL) != KERR_OK ||
+        (!card.block_addressed &&
+         mmci_command(SD_SET_BLOCKLEN, MMCI_SECTOR_SIZE, RSP_SHORT, NULL) != KERR_OK))
+    {
+        KLOGS(KLOG_SYS_KERNEL, KLOG_ERROR, "mmci: card did not select");
+        return KERR_IO;
+    }
+
+    card.sectors = csd_sectors(csd);
+    card.present = true;
+    MMCI_CLOCK   = MMCI_CLOCK_ENABLE | MMCI_CLOCK_DIV(MMCI_CLKDIV_DATA);
+
+    ktimer_init(&xfer_watchdog, mmci_watchdog, NULL);
+    sic_enable_irq(SIC_IRQ_MMCI0);
+
+    KLOG(KLOG_INFO, "mmci: SD%s card, %u sectors (%u MiB)", card.block_addressed ? "HC" : "SC",
+         card.sectors, card.sectors / 2048u);
+    return KERR_OK;
+}
+
+bool mmci_present(void)
+{
+    return card.present;
+}
+
+uint32_t mmci_sectors(void)
+{
+    return card.sectors;
+}
+
+// --- Data path ---
+
+/** Stop the data path and wake the caller. IRQ context or IRQs masked. */
+static void mmci_finish(kerror_t status)
+{
+    if (xfer.done)
+    {
+        return;
+    }
+    MMCI_MASK0    = 0;
+    MMCI_DATACTRL = 0;
+    xfer.status   = status;
+    xfer.done     = true;
+    wake_up(&xfer_wq);
+}
+
+static void mmci_watchdog(struct ktimer *timer, void *arg)
+{
+    (void)timer;
+    (void)arg;
+    mmci_finish(KERR_IO); // mmci_run() counts the error
+}
+
+/** Move the cursor past `bytes` just read or written. */
+static inline void cursor_advance(size_t bytes)
+{
+    xfer.p        += bytes / sizeof(uint32_t);
+    xfer.seg_left -= bytes;
+    xfer.left     -= bytes;
+    if (xfer.seg_left == 0 && xfer.iov + 1 < xfer.iov_end)
+    {
+        xfer.iov++;
+        xfer.p        = xfer.iov->buf;
+        xfer.seg_left = xfer.iov->len;
+    }
+}
+
+// Buffers and commands are whole sectors, so a burst never straddles either
+static void mmci_pio_read(void)
+{
+    while (xfer.left)
+    {
+        const uint32_t status = MMCI_STATUS;
+        if (status & MMCI_RXFIFOHALFFULL)
+        {
+            uint32_t *p = xfer.p;
+            for (uint32_t i = 0; i < MMCI_FIFO_HALF; i++)
+            {
+                p[i] = MMCI_FIFO;
+            }
+            kstat_inc(mmci_fifo_bursts);
+            cursor_advance(MMCI_FIFO_HALF * sizeof(uint32_t));
+        }
+        else if (status & MMCI_RXDATAAVLBL)
+        {
+            *xfer.p = MMCI_FIFO;
+            cursor_advance(sizeof(uint32_t));
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+static void mmci_pio_write(void)
+{
+    while (xfer.left)
+    {
+        const uint32_t status = MMCI_STATUS;
+        if (status & MMCI_TXFIFOHALFEMPTY)
+        {
+            const uint32_t *p = xfer.p;
+            for (uint32_t i = 0; i < MMCI_FIFO_HALF; i++)
+            {
+                MMCI_FIFO = p[i];
+            }
+            kstat_inc(mmci_fifo_bursts);
+            cursor_advance(MMCI_FIFO_HALF * sizeof(uint32_t));
+        }
+        else if (!(status & MMCI_TXFIFOFULL))
+        {
+            MMCI_FIFO = *xfer.p;
+            cursor_advance(sizeof(uint32_t));
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+void mmci_irq_handler(void)
+{
+    if (xfer.done)
+    {
+        MMCI_MASK0 = 0; // late interrupt of a finished or timed-out transfer
+        MMCI_CLEAR = MMCI_CLEAR_ALL;
+        return;
+    }
+
+    const uint32_t status = MMCI_STATUS;
+    if (status & MMCI_DATA_ERRORS)
+    {
+        MMCI_CLEAR = status & MMCI_CLEAR_ALL;
+        kstat_inc(mmci_errors);
+        mmci_finish(KERR_IO);
+        return;
+    }
+
+    if (xfer.read)
+    {
+        mmci_pio_read();
+    }
+    else
+    {
+        mmci_pio_write();
+    }
+
+    if (xfer.left == 0)
+    {
+        if (MMCI_STATUS & MMCI_DATAEND)
+        {
+            MMCI_CLEAR = MMCI_DATAEND | MMCI_DATABLOCKEND;
+            mmci_finish(KERR_OK);
+        }
+        else
+        {
+            MMCI_MASK0 = MMCI_DATAEND | MMCI_DATA_ERRORS; // FIFO done, wait for the card
+        }
+    }
+}
+
+/**
+ * @internal
+ * @brief One command moving `count` sectors at `lba` through the cursor.
+ */
+static kerror_t mmci_run(uint32_t lba, uint32_t count, bool read)
+{
+    const uint32_t arg   = card.block_addressed ? lba : lba * MMCI_SECTOR_SIZE;
+    const bool     multi = count > 1u;
+    uint32_t       r1    = 0;
+    kerror_t       err;
+    bool           started;
+
+    xfer.left   = count * MMCI_SECTOR_SIZE;
+    xfer.read   = read;
+    xfer.status = KERR_OK;
+    xfer.done   = false;
+
+    MMCI_CLEAR      = MMCI_CLEAR_ALL;
+    MMCI_DATATIMER  = MMCI_DATA_TIMER;
+    MMCI_DATALENGTH = count * MMCI_SECTOR_SIZE;
+    ktimer_add(&xfer_watchdog, ktimer_ms_to_ticks(MMCI_DATA_TIMEOUT_MS));
+
+    // Reads arm the data path first so no byte is missed; writes wait for the card to accept
+    if (read)
+    {
+        MMCI_DATACTRL = MMCI_DATA_ENABLE | MMCI_DATA_READ | MMCI_DATA_BLOCKSZ(9);
+        MMCI_MASK0    = MMCI_RXFIFOHALFFULL | MMCI_DATAEND | MMCI_DATA_ERRORS;
+        err = mmci_command(multi ? SD_READ_MULTIPLE_BLOCK : SD_READ_SINGLE_BLOCK, arg, RSP_SHORT, &r1);
+        started = err == KERR_OK;
+    }
+    else
+    {
+        err = mmci_command(multi ? SD_WRITE_MULTIPLE_BLOCK : SD_WRITE_BLOCK, arg, RSP_SHORT, &r1);
+        started = err == KERR_OK;
+        if (err == KERR_OK && !(r1 & SD_R1_ERRORS))
+        {
+            MMCI_DATACTRL = MMCI_DATA_ENABLE | MMCI_DATA_BLOCKSZ(9);
+            MMCI_MASK0    = MMCI_TXFIFOHALFEMPTY | MMCI_DATAEND | MMCI_DATA_ERRORS;
+        }
+    }
+
+    if (err == KERR_OK && (r1 & SD_R1_ERRORS))
+    {
+        err = KERR_IO;
+    }
+    if (err != KERR_OK)
+    {
+        const uint32_t flags = irq_save();
+        mmci_finish(err);
+        irq_restore(flags);
+    }
+
+    wait_event(&xfer_wq, xfer.done);
+    ktimer_del(&xfer_watchdog);
+    err = xfer.status;
+
+    // A multi-block command runs until stopped, even after an error
+    if (multi && started && mmci_command(SD_STOP_TRANSMISSION, 0, RSP_SHORT, NULL) != KERR_OK)
+    {
+        err = KERR_IO;
+    }
+    if (!read && err == KERR_OK)
+    {
+        err = mmci_wait_ready();
+    }
+    if (err != KERR_OK)
+    {
+        kstat_inc(mmci_errors);
+    }
+    return err;
+}
+
+static bool xfer_try_lock(void)
+{
+    if (xfer_locked)
+    {
+        return false;
+    }
+    xfer_locked = true;
+    return true;
+}
+
+static kerror_t mmci_transfer(uint32_t lba, const struct mmci_iov *iov, uint32_t iovcnt, bool read)
+{
+    size_t total = 0;
+    for (uint32_t i = 0; i < iovcnt; i++)
+    {
+        if (!iov[i].buf || ((uintptr_t)iov[i].buf & 3u) || iov[i].len == 0 ||
+            iov[i].len % MMCI_SECTOR_SIZE)
+        {
+            return KERR_INVAL;
+        }
+        total += iov[i].len;
+    }
+    if (!card.present)
+    {
+        return KERR_NOT_FOUND;
+    }
+
+    const uint32_t sectors = (uint32_t)(total / MMCI_SECTOR_SIZE);
+    if (lba > card.sectors || sectors > card.sectors - lba)
+    {
+        return KERR_INVAL;
+    }
+    if (sectors == 0)
+    {
+        return KERR_OK;
+    }
+
+    wait_event(&lock_wq, xfer_try_lock());
+
+    xfer.iov      = iov;
+    xfer.iov_end  = iov + iovcnt;
+    xfer.p        = iov->buf;
+    xfer.seg_left = iov->len;
+
+    kerror_t err = KERR_OK;
+    for (uint32_t done = 0; done < sectors && err == KERR_OK;)
+    {
+        const uint32_t n = MIN(sectors - done, MMCI_MAX_SECTORS);
+        err = mmci_run(lba + done, n, read);
+        done += n;
+    }
+
+    if (read)
+    {
+        kstat_add(mmci_sectors_read, sectors);
+    }
+    else
+    {
+        kstat_add(mmci_sectors_written, sectors);
+    }
+
+    const uint32_t flags = irq_save();
+    xfer_locked = false;
+    wake_up(&lock_wq);
+    irq_restore(flags);
+    return err;
+}
+
+kerror_t mmci_readv(uint32_t lba, const struct mmci_iov *iov, uint32_t iovcnt)
+{
+    return mmci_transfer(lba, iov, iovcnt, true);
+}
+
+kerror_t mmci_writev(uint32_t lba, const struct mmci_iov *iov, uint32_t iovcnt)
+{
+    return mmci_transfer(lba, iov, iovcnt, false);
+}
+
+kerror_t mmci_read(uint32_t lba, void *buf, uint32_t count)
+{
+    const struct mmci_iov iov = { .buf = buf, .len = (size_t)count * MMCI_SECTOR_SIZE };
+    return mmci_transfer(lba, &iov, 1, true);
+}
+
+kerror_t mmci_write(uint32_t lba, const void *buf, uint32_t count)
+{
+    const struct mmci_iov iov = { .buf = (void *)(uintptr_t)buf, .len = (size_t)count * MMCI_SECTOR_SIZE };
+    return mmci_transfer(lba, &iov, 1, false);
+}
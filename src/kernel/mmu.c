@@ -0,0 +1,477 @@
+/**
+ * @file mmu.c
+ * @brief Kernel page table, user address spaces, ASID allocation and the frame pool.
+ *
+ * Descriptor layouts follow the ARMv7-A short-descriptor format. All
+ * memory is in domain 0, set to "client" so the AP bits are enforced.
+ */
+#include "mmu.h"
+#include "interrupt.h"
+#include "kstack.h"
+#include "barrier.h"
+#include "memory.h"
+#include "string.h"
+#include "utils.h"
+#include "panic.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Descriptor bits ---
+
+#define L1_ENTRIES       4096u
+#define L1_PAGE_TABLE    0x1u
+#define L1_SECTION       0x2u
+#define L1_B             (1u << 2)
+#define L1_C             (1u << 3)
+#define L1_XN            (1u << 4)
+#define L1_AP_PRIV_RW    (1u << 10)        /**< AP[2:0] = 001: kernel RW, user none. */
+#define L1_TEX(x)        ((uint32_t)(x) << 12)
+
+#define L2_ENTRIES       256u
+#define L2_XN            (1u << 0)
+#define L2_SMALL         (1u << 1)
+#define L2_B             (1u << 2)
+#define L2_C             (1u << 3)
+#define L2_AP_PRIV_RW    (1u << 4)         /**< AP[2:0] = 001: kernel RW, user none. */
+#define L2_AP_USER_RW    (3u << 4)         /**< AP[2:0] = 011. */
+#define L2_AP_USER_RO    (2u << 4)         /**< AP[2:0] = 010: kernel RW, user RO. */
+#define L2_AP_MASK       ((3u << 4) | (1u << 9))
+#define L2_TEX(x)        ((uint32_t)(x) << 6)
+#define L2_NG            (1u << 11)        /**< Not global: tagged with the ASID. */
+
+/** Normal memory, write-back write-allocate (TEX=001, C=1, B=1). */
+#define SECT_RAM         (L1_SECTION | L1_TEX(1) | L1_C | L1_B | L1_AP_PRIV_RW)
+/** Shareable device memory, never executable. */
+#define SECT_IO          (L1_SECTION | L1_B | L1_XN | L1_AP_PRIV_RW)
+#define PTE_USER         (L2_SMALL | L2_TEX(1) | L2_C | L2_B | L2_NG)
+/** Kernel RAM page, same attributes as SECT_RAM. */
+#define PTE_KERNEL       (L2_SMALL | L2_TEX(1) | L2_C | L2_B | L2_AP_PRIV_RW)
+
+#define SCTLR_M          (1u << 0)
+#define SCTLR_Z          (1u << 11)
+#define SCTLR_I          (1u << 12)
+
+#define DACR_CLIENT_D0   0x1u
+
+/** Frames carved from the heap per refill of the page pool. */
+#define PAGE_POOL_CHUNK  16u
+
+/** Reserved by kernel.ld for the kernel L1 table (16 KiB, 16 KiB aligned). */
+extern uint32_t __ptables_start[];
+
+static uint32_t *const kernel_l1 = __ptables_start;
+
+static bool       mmu_on          = false;
+static struct mm *active          = NULL;
+static uint32_t   asid_generation = 1u << ASID_BITS;
+static uint32_t   asid_next       = 1;   /**< ASID 0 is reserved for the kernel table. */
+static uint32_t   asid_rollovers  = 0;
+static void      *page_pool       = NULL; /**< Free frames, linked through their first word. */
+
+// --- CP15 access ---
+
+static inline void cp15_set_ttbr0(uint32_t v)
+{
+    __asm__ volatile("mcr p15, 0, %0, c2, c0, 0" :: "r"(v) : "memory");
+}
+
+static inline void cp15_set_contextidr(uint32_t v)
+{
+    __asm__ volatile("mcr p15, 0, %0, c13, c0, 1" :: "r"(v) : "memory");
+}
+
+// --- Kernel table ---
+
+static inline uint32_t pte_index(uintptr_t va)
+{
+    return (uint32_t)(va >> 12) & (L2_ENTRIES - 1u);
+}
+
+void mmu_init(void)
+{
+    for (uint32_t i = 0; i < L1_ENTRIES; i++)
+    {
+        kernel_l1[i] = 0; // translation fault
+    }
+    for (uint32_t pa = 0; pa < MMU_RAM_SIZE; pa += SECTION_SIZE)
+    {
+        kernel_l1[pa >> 20] = pa | SECT_RAM;
+    }
+    for (uint32_t pa = MMU_IO_BASE; pa < MMU_IO_BASE + MMU_IO_SIZE; pa += SECTION_SIZE)
+    {
+        kernel_l1[pa >> 20] = pa | SECT_IO;
+    }
+    kstack_guard_init(); // user tables copy the kernel one, guards included
+    dsb();
+
+    __asm__ volatile("mcr p15, 0, %0, c7, c5, 0\n\t"   // ICIALLU
+                     "mcr p15, 0, %0, c7, c5, 6\n\t"   // BPIALL
+                     "mcr p15, 0, %0, c8, c7, 0\n\t"   // TLBIALL
+                     "mcr p15, 0, %1, c3, c0, 0\n\t"   // DACR
+                     "mcr p15, 0, %0, c2, c0, 2"       // TTBCR: N = 0, TTBR0 walks everything
+                     :: "r"(0), "r"(DACR_CLIENT_D0) : "memory");
+    cp15_set_ttbr0((uint32_t)(uintptr_t)kernel_l1);
+    cp15_set_contextidr(0);
+    isb();
+
+    uint32_t sctlr;
+    __asm__ volatile("mrc p15, 0, %0, c1, c0, 0" : "=r"(sctlr));
+    sctlr |= SCTLR_M | SCTLR_Z | SCTLR_I;
+    __asm__ volatile("mcr p15, 0, %0, c1, c0, 0" :: "r"(sctlr) : "memory");
+    isb();
+
+    mmu_on = true;
+    KLOGS(KLOG_SYS_MEMORY, KLOG_DEBUG, "mmu on, kernel table at %p", (void *)kernel_l1);
+}
+
+bool mmu_enabled(void)
+{
+    return mmu_on;
+}
+
+kerror_t mmu_guard_page(uintptr_t va)
+{
+    if (va & (PAGE_SIZE - 1u) || va >= MMU_RAM_SIZE)
+    {
+        return KERR_INVAL;
+    }
+
+    uint32_t *l1 = &kernel_l1[va >> 20];
+
+    // Split the section into pages with the same attributes first
+    if ((*l1 & 0x3u) == L1_SECTION)
+    {
+        uint32_t      *pte  = kmalloc_aligned(L2_ENTRIES * sizeof(uint32_t), 1024);
+        const uint32_t base = *l1 & ~(SECTION_SIZE - 1u);
+
+        for (uint32_t i = 0; i < L2_ENTRIES; i++)
+        {
+            pte[i] = (base + i * PAGE_SIZE) | PTE_KERNEL;
+        }
+        dsb();
+        *l1 = (uint32_t)(uintptr_t)pte | L1_PAGE_TABLE;
+    }
+
+    uint32_t *pte = (uint32_t *)(uintptr_t)(*l1 & ~0x3FFu);
+    pte[pte_index(va)] = 0; // translation fault
+    dsb();
+
+    if (mmu_on)
+    {
+        tlb_flush_all();
+    }
+    return KERR_OK;
+}
+
+bool mmu_translate(uintptr_t va, uintptr_t *pa)
+{
+    const uint32_t flags = irq_save();
+    uint32_t par;
+
+    __asm__ volatile("mcr p15, 0, %1, c7, c8, 0\n\t"   // ATS1CPR
+                     "isb\n\t"
+                     "mrc p15, 0, %0, c7, c4, 0"       // PAR
+                     : "=r"(par) : "r"(va) : "memory");
+    irq_restore(flags);
+
+    if (par & 1u)
+    {
+        return false;
+    }
+    *pa = (par & ~(PAGE_SIZE - 1u)) | (va & (PAGE_SIZE - 1u));
+    return true;
+}
+
+// --- Frame pool ---
+
+void *page_alloc(void)
+{
+    uint32_t flags = irq_save();
+
+    if (!page_pool)
+    {
+        irq_restore(flags);
+        char *chunk = kmalloc_aligned(PAGE_POOL_CHUNK * PAGE_SIZE, PAGE_SIZE);
+        flags = irq_save();
+
+        for (uint32_t i = 0; i < PAGE_POOL_CHUNK; i++)
+        {
+            void **frame = (void **)(chunk + i * PAGE_SIZE);
+            *frame    = page_pool;
+            page_pool = frame;
+        }
+    }
+
+    void **frame = page_pool;
+    page_pool    = *frame;
+    irq_restore(flags);
+
+    memset(frame, 0, PAGE_SIZE);
+    return frame;
+}
+
+void page_free(void *page)
+{
+    if (!page)
+    {
+        return;
+    }
+
+    const uint32_t flags = irq_save();
+    *(void **)page = page_pool;
+    page_pool      = page;
+    irq_restore(flags);
+}
+
+// --- Address spaces ---
+
+static inline bool user_range(uintptr_t va, size_t len)
+{
+    return va >= USER_BASE && va < USER_END && len <= USER_END - va;
+}
+
+static uint32_t pte_for(uint32_t prot)
+{
+    uint32_t pte = PTE_USER;
+    pte |= (prot & MM_PROT_WRITE) ? L2_AP_USER_RW : L2_AP_USER_RO;
+    if (!(prot & MM_PROT_EXEC))
+    {
+        pte |= L2_XN;
+    }
+    return pte;
+}
+
+/** PTE slot of `va` (inside the user window), NULL if its L2 table is missing. */
+static uint32_t *pte_slot(const struct mm *mm, uintptr_t va)
+{
+    struct mm_l2 *l2 = mm->l2[(va - USER_BASE) / SECTION_SIZE];
+    return l2 ? &l2->pte[pte_index(va)] : NULL;
+}
+
+static struct mm_l2 *l2_get(struct mm *mm, uintptr_t va)
+{
+    const uint32_t slot = (uint32_t)((va - USER_BASE) / SECTION_SIZE);
+
+    if (!mm->l2[slot])
+    {
+        struct mm_l2 *l2 = kmalloc_aligned(sizeof(*l2), 1024);
+        memset(l2, 0, sizeof(*l2));
+        mm->l2[slot] = l2;
+
+        // The L1 entry was a fault, so no TLB entry can cache it
+        dsb();
+        mm->l1[va >> 20] = (uint32_t)(uintptr_t)l2->pte | L1_PAGE_TABLE;
+        dsb();
+    }
+    return mm->l2[slot];
+}
+
+struct mm *mm_create(void)
+{
+    if (!mmu_on)
+    {
+        kernel_panic("mm_create: MMU not initialised", KERR_INVAL);
+    }
+
+    struct mm *mm = kmalloc(sizeof(*mm));
+    *mm = (struct mm){ 0 };
+
+    mm->l1 = kmalloc_aligned(L1_ENTRIES * sizeof(uint32_t), L1_ENTRIES * sizeof(uint32_t));
+    memcpy(mm->l1, kernel_l1, L1_ENTRIES * sizeof(uint32_t));
+    dsb();
+    return mm;
+}
+
+void mm_destroy(struct mm *mm)
+{
+    if (!mm)
+    {
+        return;
+    }
+
+    // Entries tagged with its ASID may linger in the TLB; the ASID is not
+    // handed out again before the next rollover, which flushes them.
+    const uint32_t flags = irq_save();
+    if (active == mm)
+    {
+        mmu_switch(NULL);
+    }
+    irq_restore(flags);
+
+    for (uint32_t s = 0; s < USER_SECTIONS; s++)
+    {
+        struct mm_l2 *l2 = mm->l2[s];
+        if (!l2)
+        {
+            continue;
+        }
+        for (uint32_t i = 0; i < L2_ENTRIES; i++)
+        {
+            if (l2->owned[i / 32] & (1u << (i % 32)))
+            {
+                page_free((void *)(uintptr_t)(l2->pte[i] & ~(PAGE_SIZE - 1u)));
+            }
+        }
+        kfree_aligned(l2);
+    }
+
+    kfree_aligned(mm->l1);
+    kfree(mm);
+}
+
+kerror_t mm_map(struct mm *mm, uintptr_t va, uintptr_t pa, uint32_t prot)
+{
+    if ((va | pa) & (PAGE_SIZE - 1u) || !user_range(va, PAGE_SIZE))
+    {
+        return KERR_INVAL;
+    }
+
+    struct mm_l2 *l2 = l2_get(mm, va);
+    uint32_t     *pte = &l2->pte[pte_index(va)];
+    if (*pte)
+    {
+        return KERR_BUSY;
+    }
+
+    *pte = (uint32_t)pa | pte_for(prot);
+    dsb();
+    return KERR_OK;
+}
+
+kerror_t mm_alloc(struct mm *mm, uintptr_t va, size_t len, uint32_t prot)
+{
+    len = align_up_uintptr(len, PAGE_SIZE);
+    if (va & (PAGE_SIZE - 1u) || len == 0 || !user_range(va, len))
+    {
+        return KERR_INVAL;
+    }
+
+    // All or nothing: check the whole range before taking any frame
+    for (uintptr_t p = va; p < va + len; p += PAGE_SIZE)
+    {
+        const uint32_t *pte = pte_slot(mm, p);
+        if (pte && *pte)
+        {
+            return KERR_BUSY;
+        }
+    }
+
+    for (uintptr_t p = va; p < va + len; p += PAGE_SIZE)
+    {
+        struct mm_l2  *l2 = l2_get(mm, p);
+        const uint32_t i  = pte_index(p);
+
+        l2->pte[i] = (uint32_t)(uintptr_t)page_alloc() | pte_for(prot);
+        l2->owned[i / 32] |= 1u << (i % 32);
+        mm->pages++;
+    }
+    dsb();
+    return KERR_OK;
+}
+
+void *mm_kaddr(const struct mm *mm, uintptr_t va)
+{
+    if (!user_range(va, 1))
+    {
+        return NULL;
+    }
+
+    const uint32_t *pte = pte_slot(mm, va);
+    if (!pte || !(*pte & L2_SMALL))
+    {
+        return NULL;
+    }
+    return (void *)(uintptr_t)((*pte & ~(PAGE_SIZE - 1u)) | (va & (PAGE_SIZE - 1u)));
+}
+
+bool mm_access_ok(const struct mm *mm, uintptr_t va, size_t len, uint32_t prot)
+{
+    if (len == 0)
+    {
+        return true;
+    }
+    if (!user_range(va, len))
+    {
+        return false;
+    }
+
+    for (uintptr_t p = va & ~(uintptr_t)(PAGE_SIZE - 1u); p < va + len; p += PAGE_SIZE)
+    {
+        const uint32_t *pte = pte_slot(mm, p);
+        if (!pte || !(*pte & L2_SMALL))
+        {
+            return false;
+        }
+        if ((prot & MM_PROT_WRITE) && (*pte & L2_AP_MASK) != L2_AP_USER_RW)
+        {
+            return false;
+        }
+        if ((prot & MM_PROT_EXEC) && (*pte & L2_XN))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- ASIDs and switching ---
+
+/**
+ * @internal
+ * @brief ASID of `mm` in the current generation, allocating one if needed.
+ *
+ * Once the 255 user ASIDs are used up, start a new generation: one full
+ * TLB flush, after which every mm re-allocates on its next switch.
+ */
+static uint32_t asid_of(struct mm *mm)
+{
+    if ((mm->context & ~ASID_MASK) == asid_generation)
+    {
+        return mm->context & ASID_MASK;
+    }
+
+    if (asid_next > ASID_MASK)
+    {
+        asid_generation += 1u << ASID_BITS;
+        if (asid_generation == 0)
+        {
+            asid_generation = 1u << ASID_BITS; // 0 means "never run"
+        }
+        asid_next = 1;
+        asid_rollovers++;
+        tlb_flush_all();
+    }
+
+    mm->context = asid_generation | asid_next++;
+    return mm->context & ASID_MASK;
+}
+
+void mmu_switch(struct mm *mm)
+{
+    const uint32_t asid = mm ? asid_of(mm) : 0;
+    const uint32_t ttb  = (uint32_t)(uintptr_t)(mm ? mm->l1 : kernel_l1);
+
+    // Through the reserved ASID, so no walk pairs the old ASID with the
+    // new table or the new ASID with the old one.
+    cp15_set_contextidr(0);
+    isb();
+    cp15_set_ttbr0(ttb);
+    isb();
+    cp15_set_contextidr(asid);
+    isb();
+
+    active = mm;
+}
+
+struct mm *mmu_active(void)
+{
+    return active;
+}
+
+uint32_t mmu_asid_rollovers(void)
+{
+    return asid_rollovers;
+}
@@ -1,5 +1,8 @@
 #include "panic.h"
 #include "log.h"
+#include "klog.h"
+
+KSTAT_DEFINE(panics_avoided);
 
 /**
  * @internal
@@ -35,13 +38,17 @@
  * @brief Print a panic message with error code and halt the CPU.
  *
  * Implementation details:
+ * - Switches the UART to synchronous polled output (flushing the TX ring)
+ *   and formats whatever is left in the deferred log, so everything logged
+ *   before the panic gets out with IRQs masked.
  * - Uses `printf()` to display the error message.
  * - Fetch the kernel error string based on the kernel error code.
  * - Calls ::kernel_halt() after printing.
  */
 [[noreturn]] void kernel_panic(const char *message, kerror_t kerr_code)
 {
+    klog_flush();
     const char* code_str = kerr_is_err(kerr_code) ? error_str(kerr_code) : "no error code";
-    KLOG(KLOG_PANIC, "%s [%s]\n", message, code_str);
+    KLOG_SYNC(KLOG_PANIC, "%s [%s]", message, code_str);
     kernel_halt();
 }
@@ -17,8 +17,8 @@ vectors_base:
 /* 0x00 Reset        */   B   _start
 /* 0x04 Undefined    */   B   undef_handler
 /* 0x08 SWI/SVC      */   B   svc_entry
-/* 0x0C PrefetchAbt  */   B   pabort_handler
-/* 0x10 DataAbt      */   B   dabort_handler
+/* 0x0C PrefetchAbt  */   B   pabort_entry
+/* 0x10 DataAbt      */   B   dabort_entry
 /* 0x14 Reserved     */   B   reserved_handler
 /* 0x18 IRQ          */   B   irq_entry
 /* 0x1C FIQ          */   B   fiq_handler
@@ -66,7 +66,7 @@ _start:
     ORR     R1, R1, #(1 << 7)     // Keep IRQ masked
     MSR     cpsr_c, R1            // Switch to IRQ mode
 
-    LDR     sp, =irq_stack_top    // Give IRQ mode its own stack
+    LDR     sp, =__irq_stack_top__ // Give IRQ mode its own stack (kernel.ld)
     BIC     sp, sp, #7
 
     // Switch to FIQ mode to init its own stack
@@ -76,7 +76,7 @@ _start:
     ORR     R1, R1, #(1 << 6)     // Keep FIQ masked
     MSR     cpsr_c, R1
 
-    LDR     sp, =fiq_stack_top
+    LDR     sp, =__fiq_stack_top__
     BIC     sp, sp, #7
 
     // Switch to Abort mode to init its own stack
@@ -86,7 +86,7 @@ _start:
     ORR     R1, R1, #(1 << 6)     // Keep FIQ masked
     MSR     cpsr_c, R1
 
-    LDR     sp, =abt_stack_top
+    LDR     sp, =__abt_stack_top__
     BIC     sp, sp, #7
 
     // Switch to Undefined mode to init its own stack
@@ -96,7 +96,7 @@ _start:
     ORR     R1, R1, #(1 << 6)     // Keep FIQ masked
     MSR     cpsr_c, R1
 
-    LDR     sp, =und_stack_top
+    LDR     sp, =__und_stack_top__
     BIC     sp, sp, #7
 
     // Back to SVC with IRQ/FIQ still masked
@@ -132,29 +132,29 @@ zero_bss:
     STR     R2, [R0], #4    // *R0 = 0; R0 += 4
     B       zero_bss        // Loop back until you reach the end
 bss_done:
+
+    // Fill the mode stacks with KSTACK_CANARY (kstack.h) for high-water
+    // marks. Nothing has been pushed yet: sp_svc is still at the top.
+    LDR     R2, =0x57AC57AC
+    LDR     R0, =__stacks_start
+    LDR     R1, =__stacks_end
+    BL      canary_fill
+    LDR     R0, =__stack_bottom__
+    LDR     R1, =__stack_top__
+    BL      canary_fill
+
     BL      kernel_main
 hang:
     B       hang        // Halt if kernel_main returns (shouldn't happen)
 
-// Reserve space for IRQ mode stack
-    .section .bss
-    .align 8
-
-irq_stack:
-    .space 1024          // 1 KB stack for IRQ mode
-irq_stack_top:
-
-fiq_stack:
-    .space 1024          // 1 KB stack for FIQ mode
-fiq_stack_top:
-
-abt_stack:
-    .space 1024          // 1 KB stack for Abort mode
-abt_stack_top:
+// Store R2 at every word of [R0, R1); no stack used
+canary_fill:
+    CMP     R0, R1
+    STRLO   R2, [R0], #4
+    BLO     canary_fill
+    BX      LR
 
-und_stack:
-    .space 1024          // 1 KB stack for Undefined mode
-und_stack_top:
+// The mode stacks live in kernel.ld's .stacks section, above guard pages
 
 /* ------------------------------------------------------------- */
 /* Exception Entries                                             */
@@ -162,37 +162,121 @@ und_stack_top:
     .section .text, "ax", %progbits
     .align 4
 
+    // System call: number in R7, arguments in R0-R5, result in R0 (see
+    // syscall.h). Only R4/R5 are copied, as the 5th/6th C arguments; the
+    // handler preserves R4-R11 and callers treat R1-R3, R12 and LR as
+    // clobbered. The return state lives on the stack, not in banked
+    // registers, so handlers may switch threads (SYS_YIELD).
     .global svc_entry
     .type   svc_entry, %function
-    .extern puts
+    .extern syscall_table
+    .extern syscall_count
 svc_entry:
-    STMDB   sp!, {R0-R3, R12, LR}   // save caller-saves register
-    LDR     R0, =svc_msg
-    BL      puts
-    LDMIA   sp!, {R0-R3, R12, LR}
-    SUBS    pc, LR, #0              // return from SVC (restores CPSR)
+    SRSDB   sp!, #0x13              // push LR_svc (return address) and SPSR_svc
+    CPSIE   i                       // handlers run with IRQs enabled
+    LDR     R12, =syscall_count
+    LDR     R12, [R12]
+    CMP     R7, R12                 // unsigned: also rejects "negative" numbers
+    MVNHS   R0, #6                  // KERR_NOSYS (-7)
+    BHS     1f
+    STMDB   sp!, {R4, R5}           // arguments 5 and 6 go on the stack
+    LDR     R12, =syscall_table
+    LDR     R12, [R12, R7, LSL #2]
+    BLX     R12
+    ADD     sp, sp, #8
+1:
+    RFEIA   sp!                     // return to the caller, restoring CPSR
 
+    // IRQs are serviced in SVC mode on the interrupted thread's stack, so
+    // irq_handler() may switch threads: the whole interrupted context stays
+    // on that thread's stack until it is switched back in and returns here.
     .global irq_entry
     .type   irq_entry, %function
     .extern irq_handler
 irq_entry:
-    STMDB   sp!, {R0-R3, R12, LR}
+    SUB     LR, LR, #4              // return address
+    SRSDB   sp!, #0x13              // push LR_irq and SPSR_irq on the SVC stack
+    CPS     #0x13                   // SVC mode, IRQs stay masked
+    STMDB   sp!, {R0-R3, R12, LR}   // LR is the interrupted LR_svc
+    AND     R1, sp, #4              // AAPCS wants sp 8-byte aligned at the call
+    SUB     sp, sp, R1
+    STMDB   sp!, {R1, R2}           // remember the adjustment (R2 pads)
     BL      irq_handler
+    LDMIA   sp!, {R1, R2}
+    ADD     sp, sp, R1
+    LDMIA   sp!, {R0-R3, R12, LR}
+    CLREX                           // an interrupted LDREX/STREX must retry
+    RFEIA   sp!                     // return from IRQ (restores CPSR)
+
+    // Aborts from USR mode are a task touching a page that is loaded on
+    // first use, or a bad address: like irq_entry they move to the task's
+    // SVC stack, where task_abort() may allocate and copy with IRQs on.
+    // Any other abort is a kernel bug or an overflow into a guard page. It
+    // stays on the ABT stack, as the faulting stack may be unusable, and
+    // abort_handler() reports it from a frame of R0-R12 and the address
+    // of the aborting instruction.
+    .global dabort_entry
+    .type   dabort_entry, %function
+    .global pabort_entry
+    .type   pabort_entry, %function
+    .extern abort_handler
+    .extern task_abort
+dabort_entry:
+    SUB     LR, LR, #8              // the access that aborted
+    STMDB   sp!, {R0}
+    MRS     R0, spsr
+    AND     R0, R0, #0x1F
+    CMP     R0, #0x10               // taken from USR mode?
+    LDMIA   sp!, {R0}               // flags survive the load
+    BEQ     1f
+    STMDB   sp!, {R0-R12, LR}
+    MOV     R0, #1                  // data abort
+    B       kernel_abort
+1:
+    SRSDB   sp!, #0x13              // push LR_abt and SPSR_abt on the SVC stack
+    CPS     #0x13                   // SVC mode, IRQs stay masked
+    STMDB   sp!, {R0-R3, R12, LR}
+    MOV     R0, #1
+    B       user_abort
+
+pabort_entry:
+    SUB     LR, LR, #4              // the fetch that aborted
+    STMDB   sp!, {R0}
+    MRS     R0, spsr
+    AND     R0, R0, #0x1F
+    CMP     R0, #0x10
+    LDMIA   sp!, {R0}
+    BEQ     1f
+    STMDB   sp!, {R0-R12, LR}
+    MOV     R0, #0                  // prefetch abort
+    B       kernel_abort
+1:
+    SRSDB   sp!, #0x13
+    CPS     #0x13
+    STMDB   sp!, {R0-R3, R12, LR}
+    MOV     R0, #0
+    B       user_abort
+
+kernel_abort:
+    MRS     R1, spsr
+    MOV     R2, sp
+    BL      abort_handler           // reports and halts
+    B       hang
+
+user_abort:
+    AND     R1, sp, #4              // AAPCS wants sp 8-byte aligned at the call
+    SUB     sp, sp, R1
+    STMDB   sp!, {R1, R2}
+    BL      task_abort              // returns once the page is mapped
+    LDMIA   sp!, {R1, R2}
+    ADD     sp, sp, R1
     LDMIA   sp!, {R0-R3, R12, LR}
-    SUBS    pc, LR, #4              // return from IRQ
+    CLREX
+    RFEIA   sp!                     // retry the access
 
 /* ------------------------------------------------------------- */
 /* Default handlers (spin until implemented)                     */
 /* ------------------------------------------------------------- */
 undef_handler:     B   hang
-pabort_handler:    B   hang
-dabort_handler:    B   hang
 reserved_handler:  B   hang
 fiq_handler:       B   hang
-
-/* ------------------------------------------------------------- */
-/* Read Only Data Section                                        */
-/* ------------------------------------------------------------- */
-    .section .rodata
-svc_msg:
-    .asciz "SVC Exception Handled!\r\n"
@@ -0,0 +1,97 @@
+/**
+ * @file syscall.c
+ * @brief System call handlers and the table svc_entry dispatches through.
+ */
+#include "syscall.h"
+#include "datetime.h"
+#include "errno.h"
+#include "mmu.h"
+#include "task.h"
+#include "thread.h"
+#include "uart.h"
+#include "kstat.h"
+#include "panic.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Largest single SYS_WRITE, so one call cannot hog the console ring. */
+#define SYS_WRITE_MAX 4096u
+
+KSTAT_DEFINE(sys_bad_pointers);
+
+static int32_t sys_null(uint32_t a0, uint32_t a1, uint32_t a2,
+                        uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return 0;
+}
+
+static int32_t sys_write_handler(uint32_t buf, uint32_t len, uint32_t a2,
+                                 uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    (void)a2; (void)a3; (void)a4; (void)a5;
+
+    if (buf == 0 && len != 0)
+    {
+        return KERR_INVAL;
+    }
+    if (len > SYS_WRITE_MAX)
+    {
+        len = SYS_WRITE_MAX;
+    }
+
+    // A task may only hand over its own mapped memory
+    struct task *task = task_current();
+    if (task && !task_access_ok(task, buf, len, MM_PROT_READ))
+    {
+        kstat_add_atomic(sys_bad_pointers, 1); // any task thread
+        kstat_add_atomic(panics_avoided, 1);
+        return KERR_INVAL;
+    }
+
+    uart_write((const char *)(uintptr_t)buf, len);
+    return (int32_t)len;
+}
+
+static int32_t sys_yield(uint32_t a0, uint32_t a1, uint32_t a2,
+                         uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    thread_yield();
+    return 0;
+}
+
+static int32_t sys_sleep_ms(uint32_t ms, uint32_t a1, uint32_t a2,
+                            uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    thread_sleep_ms(ms);
+    return 0;
+}
+
+static int32_t sys_time(uint32_t a0, uint32_t a1, uint32_t a2,
+                        uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return (int32_t)datetime_now();
+}
+
+static int32_t sys_exit(uint32_t code, uint32_t a1, uint32_t a2,
+                        uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    task_exit((int32_t)code);
+    return 0; // not reached
+}
+
+const syscall_fn_t syscall_table[SYS_COUNT] = {
+    [SYS_NULL]     = sys_null,
+    [SYS_WRITE]    = sys_write_handler,
+    [SYS_YIELD]    = sys_yield,
+    [SYS_SLEEP_MS] = sys_sleep_ms,
+    [SYS_TIME]     = sys_time,
+    [SYS_EXIT]     = sys_exit,
+};
+
+const uint32_t syscall_count = SYS_COUNT;
@@ -0,0 +1,208 @@
+/**
+ * @file task.c
+ * @brief User task creation, lazy page faults, exit and teardown.
+ */
+#include "task.h"
+#include "interrupt.h"
+#include "kstat.h"
+#include "memory.h"
+#include "string.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FSR_TRANSLATION_SECTION 0x05u
+#define FSR_TRANSLATION_PAGE    0x07u
+#define DFSR_WNR                (1u << 11)
+
+KSTAT_DEFINE(task_page_faults);
+KSTAT_DEFINE(task_faults_killed);
+
+/**
+ * @internal
+ * @brief Thread body of a task: load its address space and leave for USR mode.
+ */
+static void task_main(void *arg)
+{
+    struct task   *task = arg;
+    struct thread *self = thread_current();
+
+    thread_attach_mm(task->mm);
+
+    const uintptr_t kstack_top = ((uintptr_t)self->stack + self->stack_size) & ~(uintptr_t)7u;
+    user_enter(task->entry, USER_END, kstack_top);
+}
+
+struct task *task_create(const char *name, const void *image, size_t size, uint32_t prio)
+{
+    if (!image || size == 0 || size > TASK_IMAGE_MAX)
+    {
+        return NULL;
+    }
+
+    struct task *task = kmalloc(sizeof(*task));
+    *task = (struct task){ .mm = mm_create(), .entry = USER_BASE };
+
+    mm_alloc(task->mm, USER_BASE, size, MM_PROT_READ | MM_PROT_WRITE | MM_PROT_EXEC);
+    mm_alloc(task->mm, USER_END - TASK_STACK_SIZE, TASK_STACK_SIZE, MM_PROT_READ | MM_PROT_WRITE);
+
+    // Frames are not contiguous: copy page by page through the kernel mapping
+    const uint8_t *src = image;
+    for (size_t off = 0; off < size; off += PAGE_SIZE)
+    {
+        memcpy(mm_kaddr(task->mm, USER_BASE + off), src + off, MIN((size_t)PAGE_SIZE, size - off));
+    }
+    icache_invalidate();
+
+    KLOGS(KLOG_SYS_KERNEL, KLOG_DEBUG, "task %s: %u byte image, %u pages",
+          name, (unsigned)size, (unsigned)task->mm->pages);
+
+    task->thread = thread_create(name, task_main, task, prio, 0);
+    return task;
+}
+
+struct task *task_exec(const char *name, const void *image, size_t size, uint32_t prio)
+{
+    if (elf_check(image, size) != KERR_OK)
+    {
+        return NULL;
+    }
+
+    struct task *task = kmalloc(sizeof(*task));
+    *task = (struct task){ .mm = mm_create() };
+
+    elf_load(task, image, size);
+    task->segments[task->nsegments++] = (struct task_segment){
+        .start = TASK_STACK_BASE,
+        .end   = USER_END,
+        .vaddr = TASK_STACK_BASE,
+        .prot  = MM_PROT_READ | MM_PROT_WRITE,
+    };
+
+    KLOGS(KLOG_SYS_KERNEL, KLOG_DEBUG, "task %s: %u byte ELF, %u segments, %u pages in place",
+          name, (unsigned)size, (unsigned)task->nsegments, (unsigned)task->in_place);
+
+    task->thread = thread_create(name, task_main, task, prio, 0);
+    return task;
+}
+
+static const struct task_segment *segment_of(const struct task *task, uintptr_t va)
+{
+    for (uint32_t i = 0; i < task->nsegments; i++)
+    {
+        if (va >= task->segments[i].start && va < task->segments[i].end)
+        {
+            return &task->segments[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @internal
+ * @brief Back the page at `page` with a fresh frame and copy in its file bytes.
+ */
+static void populate(struct task *task, const struct task_segment *seg, uintptr_t page)
+{
+    mm_alloc(task->mm, page, PAGE_SIZE, seg->prot);
+
+    // Intersect [page, page + PAGE_SIZE) with the file bytes; the rest stays zero
+    const uintptr_t file_end = seg->vaddr + seg->filesz;
+    const uintptr_t lo       = MAX(page, seg->vaddr);
+    const uintptr_t hi       = MIN(page + PAGE_SIZE, file_end);
+    if (seg->src && lo < hi)
+    {
+        memcpy(mm_kaddr(task->mm, lo), seg->src + (lo - seg->vaddr), hi - lo);
+    }
+    if (seg->prot & MM_PROT_EXEC)
+    {
+        icache_invalidate();
+    }
+
+    task->faults++;
+    kstat_inc(task_page_faults);
+}
+
+void task_abort(uint32_t is_data)
+{
+    uint32_t far;
+    uint32_t fsr;
+
+    // Read before anything else can fault or be scheduled
+    if (is_data)
+    {
+        __asm__ volatile("mrc p15, 0, %0, c6, c0, 0" : "=r"(far));
+        __asm__ volatile("mrc p15, 0, %0, c5, c0, 0" : "=r"(fsr));
+    }
+    else
+    {
+        __asm__ volatile("mrc p15, 0, %0, c6, c0, 2" : "=r"(far));
+        __asm__ volatile("mrc p15, 0, %0, c5, c0, 1" : "=r"(fsr));
+    }
+    irq_enable();
+
+    struct task *task = task_current();
+    const uint32_t status = (fsr & 0xFu) | ((fsr >> 6) & 0x10u);
+    const uint32_t need   = !is_data ? MM_PROT_EXEC : (fsr & DFSR_WNR) ? MM_PROT_WRITE : MM_PROT_READ;
+    const struct task_segment *seg = task ? segment_of(task, far) : NULL;
+
+    if (seg && (status == FSR_TRANSLATION_SECTION || status == FSR_TRANSLATION_PAGE) &&
+        (seg->prot & need) == need)
+    {
+        populate(task, seg, far & ~(uintptr_t)(PAGE_SIZE - 1u));
+        return;
+    }
+
+    // A permission fault, or an address no segment covers
+    kstat_inc(task_faults_killed);
+    KLOGS(KLOG_SYS_KERNEL, KLOG_WARN, "task %s: %s fault at 0x%08x (fsr 0x%03x), killed",
+          thread_current()->name, is_data ? "data" : "prefetch", far, fsr);
+    task_exit(KERR_FAULT);
+}
+
+bool task_access_ok(struct task *task, uintptr_t va, size_t len, uint32_t prot)
+{
+    if (len == 0 || va + len < va)
+    {
+        return len == 0;
+    }
+
+    for (uintptr_t p = va & ~(uintptr_t)(PAGE_SIZE - 1u); p < va + len; p += PAGE_SIZE)
+    {
+        const struct task_segment *seg = segment_of(task, p);
+        if (seg && (seg->prot & prot) == prot && !mm_kaddr(task->mm, p))
+        {
+            populate(task, seg, p);
+        }
+    }
+    return mm_access_ok(task->mm, va, len, prot);
+}
+
+struct task *task_current(void)
+{
+    struct thread *self = thread_current();
+    return self && self->mm ? self->arg : NULL;
+}
+
+void task_exit(int32_t code)
+{
+    struct task *task = task_current();
+    if (task)
+    {
+        task->exit_code = code;
+    }
+    thread_exit();
+}
+
+int32_t task_join(struct task *task)
+{
+    thread_join(task->thread);
+
+    const int32_t code = task->exit_code;
+    mm_destroy(task->mm);
+    kfree(task);
+    return code;
+}
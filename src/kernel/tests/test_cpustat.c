@@ -0,0 +1,196 @@
+/**
+ * @file test_cpustat.c
+ * @brief CPU time accounting: buckets add up to wall time, idle, IRQ, deferred and per-thread time.
+ */
+#include "tests.h"
+#include "cpustat.h"
+#include "clock.h"
+#include "interrupt.h"
+#include "thread.h"
+#include "printf.h"
+#include "pmu.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_OPS 1000u
+
+static struct cpustat before;
+static struct cpustat after;
+
+/** Clocksource cycles in `ms` milliseconds. */
+static uint32_t ms_cycles(uint32_t ms)
+{
+    return ms * (clock_hz() / 1000u);
+}
+
+static void busy_ms(uint32_t ms)
+{
+    const uint32_t start = clock_cycles32();
+    while (clock_cycles32() - start < ms_cycles(ms))
+    {
+    }
+}
+
+static uint64_t delta(cpu_state_t s)
+{
+    return after.state[s] - before.state[s];
+}
+
+static uint64_t window(void)
+{
+    uint64_t sum = 0;
+    for (uint32_t s = 0; s < CPU_STATES; s++)
+    {
+        sum += delta((cpu_state_t)s);
+    }
+    return sum;
+}
+
+// --- Tests ---
+static int cpustat_test_sums_to_wall(void)
+{
+    const uint32_t t0 = clock_cycles32();
+    cpustat_sample(&before);
+    busy_ms(5);
+    thread_sleep_ms(20);
+    cpustat_sample(&after);
+    const uint32_t t1 = clock_cycles32();
+
+    // Every cycle between the samples is charged to exactly one state
+    const uint64_t sum = window();
+    return sum <= t1 - t0 && sum + 50u >= t1 - t0;
+}
+
+static int cpustat_test_idle(void)
+{
+    cpustat_sample(&before);
+    thread_sleep_ms(50); // only the idle thread is left to run
+    cpustat_sample(&after);
+
+    const uint32_t ticks = after.irq_count[IRQ_TIMER01] - before.irq_count[IRQ_TIMER01];
+    const uint64_t irq   = after.irq_cycles[IRQ_TIMER01] - before.irq_cycles[IRQ_TIMER01];
+
+    return delta(CPU_IDLE) * 10u >= window() * 8u &&
+           ticks >= 3 && irq <= delta(CPU_IRQ);
+}
+
+static int cpustat_test_busy_thread(void)
+{
+    struct thread *self  = thread_current();
+    const uint64_t mine0 = self->cpu_cycles;
+
+    cpustat_sample(&before);
+    busy_ms(20);
+    cpustat_sample(&after);
+
+    const uint64_t mine = self->cpu_cycles - mine0;
+    return delta(CPU_THREAD) * 10u >= window() * 9u &&
+           mine * 10u >= window() * 9u && delta(CPU_IDLE) * 20u < window();
+}
+
+static int cpustat_test_deferred(void)
+{
+    cpustat_sample(&before);
+    const cpu_state_t outer = cpustat_enter(CPU_DEFERRED);
+    busy_ms(5);
+    const cpu_state_t inner = cpustat_enter(CPU_IRQ);
+    cpustat_leave(inner);
+    cpustat_leave(outer);
+    cpustat_sample(&after);
+
+    return outer == CPU_THREAD && inner == CPU_DEFERRED &&
+           delta(CPU_DEFERRED) * 10u >= ms_cycles(5) * 9u &&
+           delta(CPU_DEFERRED) <= window();
+}
+
+static volatile uint64_t worker_cycles;
+
+static void worker_fn(void *arg)
+{
+    (void)arg;
+    busy_ms(10);
+    worker_cycles = thread_current()->cpu_cycles;
+}
+
+static int cpustat_test_per_thread(void)
+{
+    struct thread *self  = thread_current();
+    const uint64_t mine0 = self->cpu_cycles;
+
+    // Higher priority: runs to completion inside thread_create()
+    worker_cycles = 0;
+    struct thread *t = thread_create("busy", worker_fn, NULL, THREAD_PRIO_DEFAULT + 1, 0);
+    thread_join(t);
+
+    return worker_cycles * 10u >= ms_cycles(10) * 9u &&
+           self->cpu_cycles - mine0 < ms_cycles(10) / 2u;
+}
+
+static int cpustat_test_benchmark(void)
+{
+    pmu_init();
+
+    const uint32_t flags = irq_save();
+    uint32_t t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_OPS; i++)
+    {
+        cpustat_leave(cpustat_enter(CPU_DEFERRED));
+    }
+    const uint32_t enter_leave = (pmu_cycles() - t0) / BENCH_OPS;
+
+    t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_OPS; i++)
+    {
+        cpustat_irq_line(31, cpustat_now());
+    }
+    const uint32_t irq_line = (pmu_cycles() - t0) / BENCH_OPS;
+    irq_restore(flags);
+
+    printf("\r\ncpustat_bench enter_leave_cyc=%u irq_line_cyc=%u\r\n", enter_leave, irq_line);
+    return 1;
+}
+
+// --- Main test runner ---
+int cpustat_test(void)
+{
+    KLOG(KLOG_INFO, "Running cpustat tests...");
+
+    int (*tests[])(void) = {
+        cpustat_test_sums_to_wall,
+        cpustat_test_idle,
+        cpustat_test_busy_thread,
+        cpustat_test_deferred,
+        cpustat_test_per_thread,
+        cpustat_test_benchmark,
+    };
+
+    const char *names[] = {
+        "sums_to_wall",
+        "idle",
+        "busy_thread",
+        "deferred",
+        "per_thread",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        int result = tests[i]();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\ncpustat_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
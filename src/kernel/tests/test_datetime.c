@@ -0,0 +1,152 @@
+/**
+ * @file test_datetime.c
+ * @brief Epoch to civil date conversion and cached wall-clock tests.
+ */
+#include "tests.h"
+#include "datetime.h"
+#include "clock.h"
+#include "printf.h"
+#include "log.h"
+
+#include <stdint.h>
+
+// --- Conversion ---
+static int datetime_test_known_dates(void)
+{
+    static const struct
+    {
+        uint32_t epoch;
+        dateval  date;
+        timeval  time;
+    } cases[] = {
+        { 0u,          { 1, 1, 1970 },  { 0, 0, 0 } },
+        { 951782400u,  { 29, 2, 2000 }, { 0, 0, 0 } },    // leap day of a 400-year
+        { 1234567890u, { 13, 2, 2009 }, { 23, 31, 30 } },
+        { 1709251199u, { 29, 2, 2024 }, { 23, 59, 59 } },
+        { 4107542399u, { 28, 2, 2100 }, { 23, 59, 59 } }, // 2100 is not a leap year
+        { 4107542400u, { 1, 3, 2100 },  { 0, 0, 0 } },
+        { 4294967295u, { 7, 2, 2106 },  { 6, 28, 15 } },  // last 32-bit second
+    };
+
+    for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        dateval d;
+        timeval t;
+        datetime_from_epoch(cases[i].epoch, &d, &t);
+
+        if (d.day != cases[i].date.day || d.month != cases[i].date.month ||
+            d.year != cases[i].date.year || t.hrs != cases[i].time.hrs ||
+            t.mins != cases[i].time.mins || t.secs != cases[i].time.secs)
+        {
+            KLOG(KLOG_ERROR, "%u -> %u-%u-%u %u:%u:%u", cases[i].epoch,
+                 d.year, d.month, d.day, t.hrs, t.mins, t.secs);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int datetime_test_day_boundaries(void)
+{
+    // Walking day by day, the date must advance by exactly one calendar day
+    dateval prev;
+    datetime_from_epoch(0, &prev, NULL);
+
+    for (uint32_t day = 1; day <= 0xFFFFFFFFu / 86400u; day++)
+    {
+        dateval d;
+        datetime_from_epoch(day * 86400u, &d, NULL);
+
+        const int next_day   = d.year == prev.year && d.month == prev.month && d.day == prev.day + 1;
+        const int next_month = d.year == prev.year && d.month == prev.month + 1 && d.day == 1;
+        const int next_year  = d.year == prev.year + 1 && d.month == 1 && d.day == 1 &&
+                               prev.month == 12 && prev.day == 31;
+        if (!next_day && !next_month && !next_year)
+        {
+            return 0;
+        }
+        prev = d;
+    }
+    return 1;
+}
+
+// --- Wall clock ---
+static int datetime_test_tracks_rtc(void)
+{
+    datetime_resync();
+
+    const uint32_t rtc = RTCDR;
+    const uint32_t now = datetime_now();
+
+    // Either read may land just after a second boundary
+    return now + 1 >= rtc && now <= rtc + 1;
+}
+
+static int datetime_test_monotonic(void)
+{
+    uint64_t prev = datetime_now_us();
+    for (uint32_t i = 0; i < 10000u; i++)
+    {
+        const uint64_t now = datetime_now_us();
+        if (now < prev)
+        {
+            return 0;
+        }
+        prev = now;
+    }
+    return 1;
+}
+
+static int datetime_test_shared_snapshot(void)
+{
+    dateval d;
+    timeval t;
+    const uint32_t now = getdatetime(&d, &t);
+
+    dateval d2;
+    timeval t2;
+    datetime_from_epoch(now, &d2, &t2);
+    return d.day == d2.day && d.month == d2.month && d.year == d2.year &&
+           t.hrs == t2.hrs && t.mins == t2.mins && t.secs == t2.secs;
+}
+
+// --- Main test runner ---
+int datetime_test(void)
+{
+    KLOG(KLOG_INFO, "Running datetime tests...");
+
+    int (*tests[])(void) = {
+        datetime_test_known_dates,
+        datetime_test_day_boundaries,
+        datetime_test_tracks_rtc,
+        datetime_test_monotonic,
+        datetime_test_shared_snapshot,
+    };
+
+    const char *names[] = {
+        "known_dates",
+        "day_boundaries",
+        "tracks_rtc",
+        "monotonic",
+        "shared_snapshot",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        int result = tests[i]();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\ndatetime_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -0,0 +1,414 @@
+/**
+ * @file test_elf.c
+ * @brief ELF loader: header validation, lazy page faults, in-place mapping
+ *        and the task start latency benchmark.
+ */
+#include "tests.h"
+#include "elf.h"
+#include "task.h"
+#include "syscall.h"
+#include "clock.h"
+#include "memory.h"
+#include "string.h"
+#include "printf.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TEXT_OFF     PAGE_SIZE             /**< File offset of the text segment. */
+#define ELF_MSG      "[elf] hello\r\n"
+#define ELF_WORD     4000u
+#define BENCH_TEXT   (4u * 1024u * 1024u)  /**< The large image, and again as frames of the flat copy. */
+#define BENCH_BSS    (4u * 1024u * 1024u)  /**< Address space only: never touched. */
+
+/*
+ * User programs, copied to the text segment of images built at run time.
+ * Each ends with a word the builder fills with the data segment address.
+ *
+ * elf_prog writes the message at data + PAGE_SIZE, a page it never
+ * touches itself, then adds the initialised data word to the .bss word
+ * at data + 2 * PAGE_SIZE (which must read zero), pushes to the stack
+ * and exits with word + bytes written. elf_poke stores into its own
+ * text, elf_wild loads from an address no segment covers, and elf_exit
+ * only touches its stack.
+ */
+_Static_assert(SYS_WRITE == 1 && SYS_EXIT == 5, "update the user programs");
+
+__asm__(
+    "    .pushsection .rodata.elf_prog, \"a\", %progbits\n"
+    "    .align 2\n"
+    "elf_prog_start:\n"
+    "    ldr   r5, elf_prog_data\n"
+    "    add   r0, r5, #0x1000\n"
+    "    mov   r1, #13\n"
+    "    mov   r7, #1\n"            // SYS_WRITE
+    "    svc   #0\n"
+    "    mov   r4, r0\n"
+    "    ldr   r0, [r5]\n"
+    "    add   r6, r5, #0x2000\n"
+    "    ldr   r1, [r6]\n"
+    "    add   r0, r0, r1\n"
+    "    str   r0, [r6]\n"
+    "    ldr   r1, [r6]\n"
+    "    cmp   r0, r1\n"
+    "    movne r0, #0\n"
+    "    add   r0, r0, r4\n"
+    "    push  {r0}\n"
+    "    pop   {r0}\n"
+    "    mov   r7, #5\n"            // SYS_EXIT
+    "    svc   #0\n"
+    "    b     .\n"
+    "elf_prog_data:\n"
+    "    .word 0\n"
+    "elf_prog_end:\n"
+    "\n"
+    "elf_poke_start:\n"
+    "    adr   r0, elf_poke_start\n"
+    "    str   r0, [r0]\n"
+    "    mov   r0, #0\n"
+    "    mov   r7, #5\n"
+    "    svc   #0\n"
+    "    b     .\n"
+    "    .word 0\n"
+    "elf_poke_end:\n"
+    "\n"
+    "elf_wild_start:\n"
+    "    ldr   r0, elf_wild_data\n"
+    "    add   r0, r0, #0x400000\n"
+    "    ldr   r0, [r0]\n"
+    "    mov   r7, #5\n"
+    "    svc   #0\n"
+    "    b     .\n"
+    "elf_wild_data:\n"
+    "    .word 0\n"
+    "elf_wild_end:\n"
+    "\n"
+    "elf_exit_start:\n"
+    "    push  {r0}\n"
+    "    mov   r0, #0\n"
+    "    mov   r7, #5\n"
+    "    svc   #0\n"
+    "    b     .\n"
+    "    .word 0\n"
+    "elf_exit_end:\n"
+    "    .popsection\n");
+
+extern const uint8_t elf_prog_start[], elf_prog_end[];
+extern const uint8_t elf_poke_start[], elf_poke_end[];
+extern const uint8_t elf_wild_start[], elf_wild_end[];
+extern const uint8_t elf_exit_start[], elf_exit_end[];
+
+// --- Setup and teardown ---
+static uint8_t     *images[2]; /**< Built by the running test, freed by tear_down(). */
+static struct task *live;      /**< Started and not joined yet, joined by tear_down(). */
+
+static void setup(void)
+{
+    memset(images, 0, sizeof(images));
+    live = NULL;
+}
+
+static void tear_down(void)
+{
+    if (live)
+    {
+        task_join(live); // a failed check must not leave the task or its address space behind
+        live = NULL;
+    }
+    for (uint32_t i = 0; i < sizeof(images) / sizeof(images[0]); i++)
+    {
+        kfree_aligned(images[i]);
+        images[i] = NULL;
+    }
+}
+
+/** Track `task` until join() or tear_down(). */
+static struct task *started(struct task *task)
+{
+    live = task;
+    return task;
+}
+
+static int32_t join(void)
+{
+    const int32_t code = task_join(live);
+    live = NULL;
+    return code;
+}
+
+static inline struct elf32_ehdr *ehdr_of(uint8_t *image)
+{
+    return (struct elf32_ehdr *)(void *)image;
+}
+
+static inline struct elf32_phdr *phdr_of(uint8_t *image, uint32_t i)
+{
+    return (struct elf32_phdr *)(void *)(image + sizeof(struct elf32_ehdr)) + i;
+}
+
+/**
+ * @brief Build a page-aligned executable around `code`.
+ *
+ * Text (R+X) at USER_BASE, file offset TEXT_OFF, at least `text_bytes`
+ * long. Data (R+W) on the next page: the word ELF_WORD, ELF_MSG one
+ * page further, then at least one page plus `bss_bytes` of zeroes.
+ * The image belongs to the fixture; NULL once both slots are taken.
+ */
+static uint8_t *build(const uint8_t *code, const uint8_t *code_end, size_t text_bytes,
+                      size_t bss_bytes, size_t *size)
+{
+    const size_t    code_size = (size_t)(code_end - code);
+    const size_t    text_len  = align_up_uintptr(MAX(code_size, text_bytes), PAGE_SIZE);
+    const size_t    data_off  = TEXT_OFF + text_len;
+    const uintptr_t data_va   = USER_BASE + text_len;
+    const size_t    filesz    = PAGE_SIZE + sizeof(ELF_MSG) - 1u;
+
+    uint32_t slot = 0;
+    while (slot < sizeof(images) / sizeof(images[0]) && images[slot])
+    {
+        slot++;
+    }
+    if (slot == sizeof(images) / sizeof(images[0]))
+    {
+        return NULL;
+    }
+
+    *size = data_off + filesz;
+    uint8_t *image = kmalloc_aligned(align_up_uintptr(*size, PAGE_SIZE), PAGE_SIZE);
+    if (!image)
+    {
+        return NULL;
+    }
+    images[slot] = image;
+    memset(image, 0, *size);
+
+    struct elf32_ehdr *eh = ehdr_of(image);
+    memcpy(eh->e_ident, ELFMAG, 4);
+    eh->e_ident[4]   = ELFCLASS32;
+    eh->e_ident[5]   = ELFDATA2LSB;
+    eh->e_ident[6]   = EV_CURRENT;
+    eh->e_type       = ET_EXEC;
+    eh->e_machine    = EM_ARM;
+    eh->e_version    = EV_CURRENT;
+    eh->e_entry      = USER_BASE;
+    eh->e_phoff      = sizeof(*eh);
+    eh->e_ehsize     = sizeof(*eh);
+    eh->e_phentsize  = sizeof(struct elf32_phdr);
+    eh->e_phnum      = 2;
+
+    *phdr_of(image, 0) = (struct elf32_phdr){
+        .p_type = PT_LOAD, .p_offset = TEXT_OFF, .p_vaddr = USER_BASE, .p_paddr = USER_BASE,
+        .p_filesz = text_len, .p_memsz = text_len, .p_flags = PF_R | PF_X, .p_align = PAGE_SIZE,
+    };
+    *phdr_of(image, 1) = (struct elf32_phdr){
+        .p_type = PT_LOAD, .p_offset = data_off, .p_vaddr = data_va, .p_paddr = data_va,
+        .p_filesz = filesz, .p_memsz = 2u * PAGE_SIZE + bss_bytes, .p_flags = PF_R | PF_W,
+        .p_align = PAGE_SIZE,
+    };
+
+    memcpy(image + TEXT_OFF, code, code_size);
+    memcpy(image + TEXT_OFF + code_size - sizeof(uint32_t), &data_va, sizeof(uint32_t));
+
+    const uint32_t word = ELF_WORD;
+    memcpy(image + data_off, &word, sizeof(word));
+    memcpy(image + data_off + PAGE_SIZE, ELF_MSG, sizeof(ELF_MSG) - 1u);
+    return image;
+}
+
+/** Let `task` run to its end without releasing it. */
+static void wait_dead(const struct task *task)
+{
+    while (task->thread->state != THREAD_DEAD)
+    {
+        thread_yield();
+    }
+}
+
+static inline uint32_t us(uint32_t cycles)
+{
+    return (uint32_t)clock_cycles_to_us(cycles);
+}
+
+// --- Tests ---
+static int elf_test_validation(void)
+{
+    size_t   size  = 0;
+    uint8_t *image = build(elf_prog_start, elf_prog_end, 0, 0, &size);
+    if (!image)
+    {
+        return 0;
+    }
+    bool ok = elf_check(image, size) == KERR_OK;
+
+    struct elf32_ehdr *eh   = ehdr_of(image);
+    struct elf32_phdr *text = phdr_of(image, 0);
+    struct elf32_phdr *data = phdr_of(image, 1);
+    const struct elf32_ehdr eh0   = *eh;
+    const struct elf32_phdr text0 = *text;
+    const struct elf32_phdr data0 = *data;
+
+    // Each case breaks one field; the image is restored after it
+    for (uint32_t c = 0; c < 12 && ok; c++)
+    {
+        kerror_t want = KERR_INVAL;
+        size_t   len  = size;
+        switch (c)
+        {
+        case 0:  eh->e_ident[1] = 'e';                          break;
+        case 1:  eh->e_machine = 3;                             break; // x86
+        case 2:  eh->e_type = 3;                                break; // ET_DYN
+        case 3:  eh->e_phnum = ELF_PHNUM_MAX + 1u; want = KERR_NO_SPACE; break;
+        case 4:  eh->e_entry = data->p_vaddr;                   break; // not executable
+        case 5:  eh->e_entry = USER_BASE + 2u;                  break; // Thumb
+        case 6:  data->p_filesz = data->p_memsz + 1u;           break;
+        case 7:  data->p_offset += 4u;                          break; // off by 4 from vaddr
+        case 8:  data->p_vaddr = USER_BASE;                     break; // shares text pages
+        case 9:  data->p_vaddr = TASK_STACK_BASE - PAGE_SIZE;   break; // runs into the stack
+        case 10: text->p_vaddr = 0x1000u; eh->e_entry = 0x1000u; break; // kernel space
+        default: len = TEXT_OFF;                                break; // truncated
+        }
+
+        ok = elf_check(image, len) == want && started(task_exec("bad", image, len, THREAD_PRIO_DEFAULT)) == NULL;
+        *eh   = eh0;
+        *text = text0;
+        *data = data0;
+    }
+
+    return ok && elf_check(image + 2, size - 2u) == KERR_INVAL && elf_check(NULL, size) == KERR_INVAL;
+}
+
+static int elf_test_lazy_run(void)
+{
+    size_t   size  = 0;
+    uint8_t *image = build(elf_prog_start, elf_prog_end, 0, PAGE_SIZE, &size);
+
+    struct task *task = image ? started(task_exec("elf_prog", image, size, THREAD_PRIO_DEFAULT)) : NULL;
+    if (!task)
+    {
+        return 0;
+    }
+
+    // Only the text is present before the program runs, and it is the image
+    bool ok = task->in_place == 1 && task->faults == 0 &&
+              mm_kaddr(task->mm, USER_BASE) == image + TEXT_OFF && task->mm->pages == 0;
+
+    wait_dead(task);
+
+    // Data page, message page (from SYS_WRITE), .bss page, stack page
+    ok = ok && task->faults == 4 && task->mm->pages == 4 &&
+         mm_kaddr(task->mm, USER_BASE + 4u * PAGE_SIZE) == NULL; // last .bss page untouched
+    return join() == (int32_t)(ELF_WORD + sizeof(ELF_MSG) - 1u) && ok;
+}
+
+static int elf_test_write_text(void)
+{
+    size_t   size  = 0;
+    uint8_t *image = build(elf_poke_start, elf_poke_end, 0, 0, &size);
+
+    return image && started(task_exec("elf_poke", image, size, THREAD_PRIO_DEFAULT)) &&
+           join() == KERR_FAULT && memcmp(image + TEXT_OFF, elf_poke_start, 8) == 0; // shared text intact
+}
+
+static int elf_test_wild_read(void)
+{
+    size_t   size  = 0;
+    uint8_t *image = build(elf_wild_start, elf_wild_end, 0, 0, &size);
+
+    return image && started(task_exec("elf_wild", image, size, THREAD_PRIO_DEFAULT)) && join() == KERR_FAULT;
+}
+
+// --- Benchmark ---
+static int elf_test_benchmark(void)
+{
+    size_t   small_size = 0;
+    size_t   large_size = 0;
+    uint8_t *small = build(elf_exit_start, elf_exit_end, 0, 0, &small_size);
+    uint8_t *large = build(elf_exit_start, elf_exit_end, BENCH_TEXT, BENCH_BSS, &large_size);
+    if (!small || !large)
+    {
+        return 0;
+    }
+
+    // Start = the exec call, run = until the task has exited and is freed
+    uint32_t t0 = clock_cycles32();
+    if (!started(task_exec("elf_small", small, small_size, THREAD_PRIO_DEFAULT)))
+    {
+        return 0;
+    }
+    const uint32_t small_start = clock_cycles32() - t0;
+    int32_t codes = join();
+    const uint32_t small_run = clock_cycles32() - t0;
+
+    t0 = clock_cycles32();
+    if (!started(task_exec("elf_large", large, large_size, THREAD_PRIO_DEFAULT)))
+    {
+        return 0;
+    }
+    const uint32_t large_start = clock_cycles32() - t0;
+    const uint32_t in_place = live->in_place;
+    codes |= join();
+    const uint32_t large_run = clock_cycles32() - t0;
+
+    // The same text as a flat image: every page allocated and copied up front
+    t0 = clock_cycles32();
+    if (!started(task_create("flat_large", large + TEXT_OFF, BENCH_TEXT, THREAD_PRIO_DEFAULT)))
+    {
+        return 0;
+    }
+    const uint32_t flat_start = clock_cycles32() - t0;
+    codes |= join();
+    const uint32_t flat_run = clock_cycles32() - t0;
+
+    printf("\r\nelf_bench image_kib=%u in_place=%u small_start_us=%u large_start_us=%u "
+           "flat_start_us=%u small_run_us=%u large_run_us=%u flat_run_us=%u\r\n",
+           (uint32_t)(large_size / 1024u), in_place, us(small_start), us(large_start), us(flat_start),
+           us(small_run), us(large_run), us(flat_run));
+
+    return codes == 0 && in_place == BENCH_TEXT / PAGE_SIZE;
+}
+
+// --- Main test runner ---
+int elf_test(void)
+{
+    KLOG(KLOG_INFO, "Running elf tests...");
+
+    int (*tests[])(void) = {
+        elf_test_validation,
+        elf_test_lazy_run,
+        elf_test_write_text,
+        elf_test_wild_read,
+        elf_test_benchmark,
+    };
+
+    const char *names[] = {
+        "validation",
+        "lazy_run",
+        "write_text",
+        "wild_read",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nelf_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
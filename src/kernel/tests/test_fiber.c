@@ -0,0 +1,217 @@
+/**
+ * @file test_fiber.c
+ * @brief Fiber tests: yield order, events, timer and IRQ wakeups.
+ *
+ * Also reports the cost of a fiber_yield() switch in PMU cycles.
+ */
+#include "tests.h"
+#include "fiber.h"
+#include "thread.h"
+#include "ktimer.h"
+#include "clock.h"
+#include "printf.h"
+#include "pmu.h"
+#include "string.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_SWITCHES 4000u
+
+static char     order[16];
+static uint32_t order_len;
+
+static struct fiber_event ev;
+
+static void note(char c)
+{
+    if (order_len < sizeof(order) - 1)
+    {
+        order[order_len++] = c;
+        order[order_len]   = '\0';
+    }
+}
+
+// --- Setup and teardown ---
+static void setup(void)
+{
+    order_len = 0;
+    order[0]  = '\0';
+    ev        = (struct fiber_event)FIBER_EVENT_INIT;
+}
+
+static void tear_down(void)
+{
+}
+
+// --- Yield ---
+static void yield_fn(void *arg)
+{
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        note((char)(uintptr_t)arg);
+        fiber_yield();
+    }
+}
+
+static int fiber_test_yield_interleave(void)
+{
+    fiber_create("A", yield_fn, (void *)'A', 0);
+    fiber_create("B", yield_fn, (void *)'B', 0);
+    fiber_run();
+    return strcmp(order, "ABABAB") == 0 && fiber_current() == NULL;
+}
+
+// --- Events ---
+static void waiter_fn(void *arg)
+{
+    fiber_await(&ev);
+    note((char)(uintptr_t)arg);
+}
+
+static void signaler_fn(void *arg)
+{
+    (void)arg;
+    note('b');
+    fiber_event_signal(&ev);
+    note('c');
+}
+
+static int fiber_test_await_signal(void)
+{
+    fiber_create("wait", waiter_fn, (void *)'a', 0);
+    fiber_create("sig", signaler_fn, NULL, 0);
+    fiber_run();
+    return strcmp(order, "bca") == 0 && !ev.pending;
+}
+
+static int fiber_test_latched_signal(void)
+{
+    fiber_event_signal(&ev); // nobody waits yet
+    fiber_create("late", waiter_fn, (void *)'x', 0);
+    fiber_run();
+    return strcmp(order, "x") == 0 && !ev.pending;
+}
+
+// --- Wakeups from interrupts ---
+static uint64_t slept_us;
+
+static void sleeper_fn(void *arg)
+{
+    (void)arg;
+    const uint64_t start = clock_monotonic_us();
+    fiber_sleep_ms(30);
+    slept_us = clock_monotonic_us() - start;
+}
+
+static int fiber_test_sleep_blocks_host(void)
+{
+    const uint64_t switches = sched_switch_count();
+
+    fiber_create("sleep", sleeper_fn, NULL, 0);
+    fiber_run();
+
+    // The host thread blocked while the fiber slept, so idle ran
+    return slept_us >= 20000u && slept_us < 200000u && sched_switch_count() - switches >= 2;
+}
+
+static void kick_event(struct ktimer *timer, void *arg)
+{
+    (void)timer;
+    fiber_event_signal(arg); // IRQ context
+}
+
+static int fiber_test_irq_signal(void)
+{
+    struct ktimer kick;
+    ktimer_init(&kick, kick_event, &ev);
+
+    fiber_create("irq", waiter_fn, (void *)'i', 0);
+    ktimer_add(&kick, 2);
+    fiber_run();
+    return strcmp(order, "i") == 0;
+}
+
+// --- Benchmark ---
+static void pingpong_fn(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < BENCH_SWITCHES / 2; i++)
+    {
+        fiber_yield();
+    }
+}
+
+static uint32_t bench_cycles;
+
+static void bench_fn(void *arg)
+{
+    (void)arg;
+    fiber_yield(); // let the peer reach its loop
+
+    const uint32_t t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_SWITCHES / 2; i++)
+    {
+        fiber_yield();
+    }
+    bench_cycles = pmu_cycles() - t0;
+}
+
+static int fiber_test_benchmark(void)
+{
+    pmu_init();
+
+    fiber_create("ping", bench_fn, NULL, 0);
+    fiber_create("pong", pingpong_fn, NULL, 0);
+    fiber_run();
+
+    // Each iteration is two switches: to the peer and back
+    printf("\r\nfiber_bench yield_switch_cyc=%u\r\n", bench_cycles / BENCH_SWITCHES);
+    return bench_cycles != 0;
+}
+
+// --- Main test runner ---
+int fiber_test(void)
+{
+    KLOG(KLOG_INFO, "Running fiber tests...");
+
+    int (*tests[])(void) = {
+        fiber_test_yield_interleave,
+        fiber_test_await_signal,
+        fiber_test_latched_signal,
+        fiber_test_sleep_blocks_host,
+        fiber_test_irq_signal,
+        fiber_test_benchmark,
+    };
+
+    const char *names[] = {
+        "yield_interleave",
+        "await_signal",
+        "latched_signal",
+        "sleep_blocks_host",
+        "irq_signal",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nfiber_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
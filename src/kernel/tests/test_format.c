@@ -0,0 +1,234 @@
+/**
+ * @file test_format.c
+ * @brief vsnformat()/snprintf() conversion and truncation tests.
+ *
+ * Also benchmarks the division-free integer conversion against the
+ * previous per-digit `_divmod()` loop, in PMU cycles.
+ */
+#include "tests.h"
+#include "format.h"
+#include "printf.h"
+#include "pmu.h"
+#include "lib/math.h"
+#include "string.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_ROUNDS 2000u
+
+static char out[96];
+
+static int expect(const char *want, int len)
+{
+    if (strcmp(out, want) != 0 || len != (int)strlen(want))
+    {
+        KLOG(KLOG_ERROR, "got \"%s\" (%d), want \"%s\"", out, len, want);
+        return 0;
+    }
+    return 1;
+}
+
+// --- Setup and teardown ---
+static void setup(void)
+{
+    memset(out, 0x5A, sizeof(out));
+}
+
+static void tear_down(void)
+{
+}
+
+// --- Conversions ---
+static int format_test_integers(void)
+{
+    int n = snprintf(out, sizeof(out), "%d %i %u %x %X", -42, 7, 4000000000u, 0xbeefu, 0xbeefu);
+    return expect("-42 7 4000000000 beef BEEF", n);
+}
+
+static int format_test_width_precision(void)
+{
+    int n = snprintf(out, sizeof(out), "[%5d|%-5d|%05d|%.3d|%8.3d|%*d|%.0d]",
+                     12, 12, -12, 7, -7, 4, 3, 0);
+    return expect("[   12|12   |-0012|007|    -007|   3|]", n);
+}
+
+static int format_test_long_long_size(void)
+{
+    int n = snprintf(out, sizeof(out), "%llu %lld %llx %zu %lu",
+                     18446744073709551615ull, -9000000000ll, 0x123456789abull,
+                     (size_t)4096, 4000000000ul);
+    return expect("18446744073709551615 -9000000000 123456789ab 4096 4000000000", n);
+}
+
+static int format_test_strings_chars(void)
+{
+    int n = snprintf(out, sizeof(out), "%s|%6s|%-6s|%.2s|%c|%3c|%%|%s",
+                     "abc", "abc", "abc", "abc", 'x', 'y', (const char *)NULL);
+    return expect("abc|   abc|abc   |ab|x|  y|%|(null)", n);
+}
+
+static int format_test_pointer(void)
+{
+    int n = snprintf(out, sizeof(out), "%p", (void *)0x1000);
+    return expect("0x1000", n);
+}
+
+// --- Sinks ---
+static int format_test_truncation(void)
+{
+    int n = snprintf(out, 5, "%s", "abcdefgh");
+    if (n != 8 || strcmp(out, "abcd") != 0)
+    {
+        return 0;
+    }
+
+    // size 0 writes nothing, still reports the full length
+    out[0] = '#';
+    n = snprintf(out, 0, "%d", 12345);
+    return n == 5 && out[0] == '#';
+}
+
+static int format_test_chunking(void)
+{
+    // Longer than FMT_CHUNK so the staging buffer is flushed mid-string
+    const char *tail = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+    int n = snprintf(out, sizeof(out), "%s-%d", tail, 99);
+    return n == 67 && out[64] == '-' && out[66] == '9' && out[67] == '\0';
+}
+
+// --- Benchmark ---
+
+// The conversion printf used before: one 64-bit divide per digit.
+static char *legacy_utoa(char *end, unsigned long long num, unsigned base)
+{
+    static const char digits[] = "0123456789abcdef";
+    char *p = end;
+    do
+    {
+        unsigned long long rem;
+        num  = _divmod(num, base, &rem);
+        *--p = digits[rem];
+    } while (num);
+    return p;
+}
+
+static uint32_t bench_rng = 0x9E3779B9u;
+
+static inline uint32_t bench_rand(void)
+{
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return bench_rng;
+}
+
+static int format_test_benchmark(void)
+{
+    char buf[24];
+    uint32_t t0;
+    uint32_t legacy_cycles = 0;
+    uint32_t fast_cycles   = 0;
+    uint32_t legacy64      = 0;
+    uint32_t fast64        = 0;
+
+    pmu_init();
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++)
+    {
+        const uint32_t v32 = bench_rand() >> (i & 31);
+        const unsigned long long v64 = ((unsigned long long)bench_rand() << 32) | bench_rand();
+
+        t0 = pmu_cycles();
+        legacy_utoa(buf + sizeof(buf), v32, 10);
+        legacy_utoa(buf + sizeof(buf), v32, 16);
+        legacy_cycles += pmu_cycles() - t0;
+
+        t0 = pmu_cycles();
+        fmt_utoa(buf + sizeof(buf), v32, 10, false);
+        fmt_utoa(buf + sizeof(buf), v32, 16, false);
+        fast_cycles += pmu_cycles() - t0;
+
+        t0 = pmu_cycles();
+        legacy_utoa(buf + sizeof(buf), v64, 10);
+        legacy64 += pmu_cycles() - t0;
+
+        t0 = pmu_cycles();
+        fmt_utoa(buf + sizeof(buf), v64, 10, false);
+        fast64 += pmu_cycles() - t0;
+    }
+
+    // Number-heavy printf-style workload through the whole formatter
+    t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++)
+    {
+        snprintf(out, sizeof(out), "%u %d %08x %llu %p", i * 2654435761u, -(int)i,
+                 i, (unsigned long long)i << 33, (void *)out);
+    }
+    const uint32_t fmt_cycles = pmu_cycles() - t0;
+
+    printf("\r\nfmt_bench utoa32 legacy_cyc=%u fast_cyc=%u\r\n",
+           legacy_cycles / BENCH_ROUNDS, fast_cycles / BENCH_ROUNDS);
+    printf("fmt_bench utoa64 legacy_cyc=%u fast_cyc=%u\r\n",
+           legacy64 / BENCH_ROUNDS, fast64 / BENCH_ROUNDS);
+    printf("fmt_bench snprintf_5_numbers cyc=%u\r\n", fmt_cycles / BENCH_ROUNDS);
+
+    // Both conversions must still agree
+    char ref[24];
+    const unsigned long long v = 18446744073709551615ull;
+    char *a = legacy_utoa(ref + sizeof(ref), v, 10);
+    char *b = fmt_utoa(buf + sizeof(buf), v, 10, false);
+    return (ref + sizeof(ref) - a) == (buf + sizeof(buf) - b) &&
+           memcmp(a, b, (size_t)(buf + sizeof(buf) - b)) == 0;
+}
+
+// --- Main test runner ---
+int format_test(void)
+{
+    KLOG(KLOG_INFO, "Running format tests...");
+
+    int (*tests[])(void) = {
+        format_test_integers,
+        format_test_width_precision,
+        format_test_long_long_size,
+        format_test_strings_chars,
+        format_test_pointer,
+        format_test_truncation,
+        format_test_chunking,
+        format_test_benchmark,
+    };
+
+    const char *names[] = {
+        "integers",
+        "width_precision",
+        "long_long_size",
+        "strings_chars",
+        "pointer",
+        "truncation",
+        "chunking",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nformat_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file test_initrd.c
+ * @brief Initrd: archive index, in-place mapping and O(1) lookup.
+ *
+ * Relies on the fixtures under initrd/test/.
+ */
+#include "tests.h"
+#include "initrd.h"
+#include "interrupt.h"
+#include "string.h"
+#include "printf.h"
+#include "pmu.h"
+#include "log.h"
+#include "lib/math.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HELLO_PATH   "test/hello.txt"
+#define HELLO_TEXT   "hello, initrd\n"
+#define BENCH_ROUNDS 100u
+
+extern const char __initrd_start[];
+extern const char __initrd_end[];
+
+// --- Tests ---
+static int initrd_test_index(void)
+{
+    const uint32_t n = initrd_count();
+    if (n < 2 || initrd_at(n) != NULL)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const struct initrd_file *f = initrd_at(i);
+        if (initrd_open(f->name) != f || f->name[0] == '.' || f->name[0] == '/')
+        {
+            return 0;
+        }
+        // tar --sort=name keeps the archive in path order
+        if (i > 0 && strcmp(initrd_at(i - 1)->name, f->name) >= 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int initrd_test_map(void)
+{
+    const struct initrd_file *f = initrd_open(HELLO_PATH);
+    if (!f)
+    {
+        return 0;
+    }
+
+    size_t      size = 0;
+    const char *data = initrd_map(f, &size);
+
+    // In place: the pointer is into the linked image, nothing was copied
+    return size == sizeof(HELLO_TEXT) - 1u && memcmp(data, HELLO_TEXT, size) == 0 &&
+           data >= __initrd_start && data + size <= __initrd_end &&
+           ((uintptr_t)data & 511u) == 0 && initrd_map(f, NULL) == data;
+}
+
+static int initrd_test_lookup(void)
+{
+    return initrd_open("/" HELLO_PATH) == initrd_open(HELLO_PATH) &&
+           initrd_open("test") == NULL &&             // directories are not indexed
+           initrd_open("test/") == NULL &&
+           initrd_open("test/hello.tx") == NULL &&
+           initrd_open("no/such/file") == NULL &&
+           initrd_open("") == NULL && initrd_open(NULL) == NULL;
+}
+
+static int initrd_test_reinit(void)
+{
+    const uint32_t n = initrd_count();
+    const void    *data = initrd_map(initrd_open(HELLO_PATH), NULL);
+
+    return initrd_init() == KERR_OK && initrd_count() == n &&
+           initrd_map(initrd_open(HELLO_PATH), NULL) == data;
+}
+
+static int initrd_test_benchmark(void)
+{
+    const uint32_t n = initrd_count();
+    uint32_t       found = 0;
+
+    pmu_init();
+    const uint32_t flags = irq_save();
+
+    uint32_t t0 = pmu_cycles();
+    for (uint32_t r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            found += initrd_open(initrd_at(i)->name) != NULL;
+        }
+    }
+    const uint32_t hashed = pmu_cycles() - t0;
+
+    // What a lookup costs without the index: compare names in archive order
+    t0 = pmu_cycles();
+    for (uint32_t r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            const char *name = initrd_at(i)->name;
+            for (uint32_t j = 0; j < n; j++)
+            {
+                if (strcmp(initrd_at(j)->name, name) == 0)
+                {
+                    found++;
+                    break;
+                }
+            }
+        }
+    }
+    const uint32_t linear = pmu_cycles() - t0;
+    irq_restore(flags);
+
+    const uint32_t lookups = BENCH_ROUNDS * n;
+    printf("\r\ninitrd_bench files=%u image_bytes=%u open_cyc=%u linear_cyc=%u\r\n", n,
+           (uint32_t)(__initrd_end - __initrd_start), udiv32(hashed, lookups), udiv32(linear, lookups));
+    return found == 2u * lookups;
+}
+
+// --- Main test runner ---
+int initrd_test(void)
+{
+    KLOG(KLOG_INFO, "Running initrd tests...");
+
+    int (*tests[])(void) = {
+        initrd_test_index,
+        initrd_test_map,
+        initrd_test_lookup,
+        initrd_test_reinit,
+        initrd_test_benchmark,
+    };
+
+    const char *names[] = {
+        "index",
+        "map",
+        "lookup",
+        "reinit",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        int result = tests[i]();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\ninitrd_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -0,0 +1,286 @@
+/**
+ * @file test_irq_latency.c
+ * @brief Timer expiry to irq_handler() latency harness with log2 histograms.
+ *
+ * Timer0 is taken away from the kernel tick for the duration of the test.
+ * Each sample arms Timer0 with a pseudo-random reload value and notes the
+ * PMU cycle counter right after enabling it. irq_handler() samples the
+ * cycle counter and T0_VALUE first thing; the hook stops the timer.
+ *
+ * The SP804 counts at 1 MHz, far too coarse for the latency itself, so
+ * samples are in CPU cycles: handler entry minus (arm + LOAD timer ticks),
+ * with the cycles per timer tick calibrated against Timer1 beforehand.
+ * `LOAD - VALUE`, the raw tick delta, is reported alongside as a check.
+ * A handler entry more than one timer tick (the arm phase) before the
+ * computed expiry means the measurement is broken and fails the run.
+ *
+ * PMCCNTR stops in `wfi` on Cortex-A8, so the wfi configuration can only
+ * use the raw tick delta, scaled to cycles at 1 us resolution.
+ *
+ * SP804 one-shot mode parks the counter at zero, which would hide how long
+ * ago it expired, so the timer runs in periodic mode and the hook stops it
+ * after the first expiry instead.
+ *
+ * Build with -DIRQ_LAT_SAMPLES=1000000 for long runs.
+ */
+#include "tests.h"
+#include "interrupt.h"
+#include "clock.h"
+#include "cpustat.h"
+#include "ktimer.h"
+#include "memory.h"
+#include "pmu.h"
+#include "printf.h"
+#include "log.h"
+#include "lib/math.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef IRQ_LAT_SAMPLES
+#define IRQ_LAT_SAMPLES 10000u
+#endif
+
+#define LAT_BUCKETS      32u
+#define LAT_MIN_LOAD     50u    /**< Shortest arm delay in timer ticks. */
+#define LAT_LOAD_SPREAD  127u   /**< Delay jitter mask, breaks phase lock with the stress loop. */
+#define LAT_TIMEOUT_US   20000u /**< Give up on a sample after this long. */
+#define LAT_CALIB_TICKS  100000u /**< Timer1 ticks to calibrate cycles per tick over. */
+
+typedef enum lat_stress
+{
+    LAT_STRESS_NONE,  /**< Spin on the done flag while waiting. */
+    LAT_STRESS_WFI,   /**< Sleep in cpustat_wfi() while waiting; tick resolution. */
+    LAT_STRESS_ALLOC, /**< kmalloc/kfree churn while waiting. */
+    LAT_STRESS_UART   /**< Console output while waiting. */
+} lat_stress_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;       /**< Cycles. */
+    uint32_t max;
+    uint64_t sum;
+    uint32_t max_ticks; /**< Largest raw SP804 delta. */
+    uint32_t hist[LAT_BUCKETS]; /**< log2 of cycles. */
+} lat_stats_t;
+
+static volatile uint32_t lat_load   = 0;
+static volatile uint32_t lat_armed  = 0; /**< Cycle counter when Timer0 started. */
+static volatile uint32_t lat_entry  = 0; /**< Cycle counter at irq_handler() entry. */
+static volatile uint32_t lat_ticks  = 0;
+static volatile bool     lat_done   = false;
+static uint32_t          lat_cpt_q16 = 0; /**< CPU cycles per timer tick, 16.16 fixed point. */
+
+static uint32_t lat_rng = 0x2545F491u;
+
+static inline uint32_t lat_rand(void)
+{
+    // xorshift32
+    lat_rng ^= lat_rng << 13;
+    lat_rng ^= lat_rng >> 17;
+    lat_rng ^= lat_rng << 5;
+    return lat_rng;
+}
+
+// Timer0 hook, runs in IRQ context.
+static void lat_hook(uint32_t entry_value, uint32_t entry_cycles)
+{
+    T0_CONTROL = 0; // one sample per arm
+    lat_entry  = entry_cycles;
+    lat_ticks  = lat_load - entry_value;
+    lat_done   = true;
+}
+
+static inline void lat_arm(uint32_t load)
+{
+    lat_load = load;
+    lat_done = false;
+
+    // timer0_start_periodic() with the cycle count taken as it starts
+    T0_CONTROL = 0;
+    T0_LOAD    = load;
+    T0_INTCLR  = 1;
+    const uint32_t flags = irq_save(); // nothing between the start and the sample
+    T0_CONTROL = TCTRL_32BIT | TCTRL_PERIODIC | TCTRL_INTEN | TCTRL_ENABLE;
+    lat_armed  = pmu_cycles();
+    irq_restore(flags);
+}
+
+/**
+ * @internal
+ * @brief Measure CPU cycles per SP804 tick; Timer0 and Timer1 share TIMCLK.
+ */
+static void lat_calibrate(void)
+{
+    const uint32_t t0 = clock_cycles32();
+    const uint32_t c0 = pmu_cycles();
+    while (clock_cycles32() - t0 < LAT_CALIB_TICKS)
+    {
+    }
+    const uint32_t c1 = pmu_cycles();
+    const uint32_t t1 = clock_cycles32();
+
+    lat_cpt_q16 = (uint32_t)udiv64((uint64_t)(c1 - c0) << 16, t1 - t0);
+}
+
+static inline uint32_t lat_bucket(uint32_t cycles)
+{
+    return cycles ? 32u - (uint32_t)__builtin_clz(cycles) : 0u;
+}
+
+static void lat_stress_step(lat_stress_t stress, uint32_t iteration)
+{
+    switch (stress)
+    {
+        case LAT_STRESS_ALLOC:
+        {
+            void *a = kmalloc(16 + (iteration & 0xFF));
+            void *b = kmalloc(64);
+            kfree(a);
+            kfree(b);
+            break;
+        }
+
+        case LAT_STRESS_UART:
+            puts("irq latency uart stress\r");
+            break;
+
+        case LAT_STRESS_WFI:
+        {
+            const uint32_t flags = irq_save(); // wfi still wakes on the pending IRQ
+            if (!lat_done)
+            {
+                cpustat_wfi();
+            }
+            irq_restore(flags);
+            break;
+        }
+
+        case LAT_STRESS_NONE:
+        default:
+            break;
+    }
+}
+
+/**
+ * @internal
+ * @brief Collect IRQ_LAT_SAMPLES samples under the given background load.
+ *
+ * @return false if an armed timer never reached the handler, or reached it
+ *         before it can have expired.
+ */
+static bool lat_run(lat_stress_t stress, lat_stats_t *stats)
+{
+    *stats = (lat_stats_t){ .min = UINT32_MAX };
+    const uint64_t timeout = (LAT_TIMEOUT_US / 1000u) * (clock_hz() / 1000u);
+
+    for (uint32_t i = 0; i < IRQ_LAT_SAMPLES; i++)
+    {
+        const uint64_t start = clock_cycles();
+        lat_arm(LAT_MIN_LOAD + (lat_rand() & LAT_LOAD_SPREAD));
+
+        uint32_t spin = 0;
+        while (!lat_done)
+        {
+            if (clock_cycles() - start > timeout)
+            {
+                T0_CONTROL = 0;
+                KLOG(KLOG_ERROR, "sample %u timed out", i);
+                return false;
+            }
+            lat_stress_step(stress, spin++);
+        }
+
+        const uint32_t tick   = lat_cpt_q16 >> 16;
+        uint32_t       cycles = lat_ticks * tick;
+        if (stress != LAT_STRESS_WFI)
+        {
+            // Timer0 starts counting on its next TIMCLK edge: up to a tick of phase
+            const uint32_t expiry = lat_armed + (uint32_t)(((uint64_t)lat_load * lat_cpt_q16) >> 16);
+            const int32_t  delta  = (int32_t)(lat_entry - expiry);
+            if (delta < -(int32_t)tick)
+            {
+                KLOG(KLOG_ERROR, "sample %u: handler entered %d cycles before expiry", i, -delta);
+                return false;
+            }
+            cycles = delta > 0 ? (uint32_t)delta : 0u;
+        }
+
+        stats->count++;
+        stats->sum      += cycles;
+        stats->min       = cycles < stats->min ? cycles : stats->min;
+        stats->max       = cycles > stats->max ? cycles : stats->max;
+        stats->max_ticks = lat_ticks > stats->max_ticks ? lat_ticks : stats->max_ticks;
+        stats->hist[lat_bucket(cycles)]++;
+    }
+
+    return true;
+}
+
+static void lat_report(const char *name, const lat_stats_t *stats)
+{
+    const uint32_t avg = stats->count ? (uint32_t)udiv64(stats->sum, stats->count) : 0;
+
+    printf("irq_lat %s samples=%u min_cyc=%u avg_cyc=%u max_cyc=%u max_ticks=%u cyc_per_tick=%u\r\n",
+           name, stats->count, stats->min, avg, stats->max, stats->max_ticks, lat_cpt_q16 >> 16);
+
+    for (uint32_t b = 0; b < LAT_BUCKETS; b++)
+    {
+        if (stats->hist[b])
+        {
+            const uint32_t lo = b ? 1u << (b - 1) : 0u;
+            printf("irq_lat %s bucket_cyc=%u count=%u\r\n", name, lo, stats->hist[b]);
+        }
+    }
+}
+
+int irq_latency_test(void)
+{
+    KLOG(KLOG_INFO, "Running irq latency tests...");
+
+    const lat_stress_t stress[] = {
+        LAT_STRESS_NONE,
+        LAT_STRESS_WFI,
+        LAT_STRESS_ALLOC,
+        LAT_STRESS_UART,
+    };
+
+    const char *names[] = {
+        "idle",
+        "wfi",
+        "alloc_stress",
+        "uart_stress",
+    };
+
+    int num_tests   = sizeof(stress) / sizeof(stress[0]);
+    int test_passed = 0;
+    int rc          = 0;
+    lat_stats_t stats;
+
+    pmu_init();
+    lat_calibrate();
+    interrupts_set_timer0_hook(lat_hook);
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+
+        if (!lat_run(stress[i], &stats))
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            rc = 1;
+            break;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        lat_report(names[i], &stats);
+        test_passed++;
+    }
+
+    // Give Timer0 back to the kernel tick
+    interrupts_set_timer0_hook(NULL);
+    interrupts_init_timer0(KTIMER_HZ, 1000000);
+
+    KLOG(KLOG_INFO, "\nirq_latency_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return rc;
+}
@@ -4,6 +4,7 @@
  */
 #include "tests.h"
 #include "interrupt.h"
+#include "ktimer.h"
 #include "memory.h"
 #include "printf.h"
 #include "log.h"
@@ -14,6 +15,16 @@ extern char __heap_start__;
 extern char __heap_end__;
 extern char __heap_size__;
 
+static struct ktimer dot_timer;
+
+// Periodic ktimer callback, runs from the tick IRQ.
+static void dot_timer_fn(struct ktimer *timer, void *arg)
+{
+    (void)timer;
+    (void)arg;
+    puts(".");
+}
+
 // This function is for testing purposes.
 // It test that the timer interrupt is firing as expected.
 void ktests_timer_test(void)
@@ -49,20 +60,13 @@ void ktests_timer_test(void)
 
     KLOG(KLOG_INFO, "Time0 IRQ firing test!");
 
-    // Configure Timer0 for 100 Hz assuming 1 MHz timer clock in QEMU
-    interrupts_init_timer0(100, 1000000);
-
-    // Unmask CPU IRQs (I-bit = 0)
-    irq_enable();
+    // Print a dot every second (KTIMER_HZ ticks) from a periodic ktimer;
+    // the tick itself is already running from kernel_main().
+    ktimer_init(&dot_timer, dot_timer_fn, NULL);
+    ktimer_add_periodic(&dot_timer, KTIMER_HZ);
 
-    // Test loop: print a dot every ~100 ticks
-    uint64_t last = 0;
     for (;;)
     {
-        if (systicks - last >= 100)
-        {
-            last = systicks;
-            puts(".");
-        }
+        __asm__ volatile("wfi" ::: "memory");
     }
 }
@@ -0,0 +1,150 @@
+/**
+ * @file test_klog.c
+ * @brief Deferred binary log tests (layout, draining, overflow, cost) and
+ *        runtime level filtering.
+ */
+#include "tests.h"
+#include "klog.h"
+#include "format.h"
+#include "pmu.h"
+#include "printf.h"
+#include "log.h"
+
+#include <stdint.h>
+
+#define KLOG_BENCH_CALLS 256u
+
+// --- Setup and teardown ---
+static void setup(void)
+{
+    klog_drain(UINT32_MAX); // start from an empty ring
+}
+
+static void tear_down(void)
+{
+}
+
+// --- Layout ---
+static int klog_test_layout(void)
+{
+    uint32_t wide;
+    uint32_t nargs = fmt_arg_layout("%d %llu %s %*d %llx", &wide);
+
+    // %d, %llu, %s, '*' width, %d, %llx -> args 1 and 5 are 64-bit
+    return nargs == 6 && wide == ((1u << 1) | (1u << 5));
+}
+
+// --- Record and drain ---
+static int klog_test_record_drain(void)
+{
+    KLOG_DEFER(KLOG_INFO, "klog test: %u %llu %s %x", 7u, 123456789012ull, "static", 0xbeefu);
+    KLOG_DEFER(KLOG_WARN, "klog test: no arguments");
+
+    printf("\r\n");
+    return klog_drain(UINT32_MAX) == 2 && klog_drain(UINT32_MAX) == 0;
+}
+
+static int klog_test_overflow_counts(void)
+{
+    const uint32_t before = klog_dropped();
+
+    // Each record is at least a 16-byte header: this must overflow the ring
+    for (uint32_t i = 0; i < KLOG_RING_SIZE / 16 + 8; i++)
+    {
+        KLOG_DEFER(KLOG_DEBUG, "klog flood %u", i);
+    }
+
+    const uint32_t dropped = klog_dropped() - before;
+    printf("\r\n");
+    klog_drain(UINT32_MAX);
+    return dropped > 0;
+}
+
+// --- Level filtering ---
+static uint32_t evaluated = 0;
+
+static uint32_t count_evaluation(void)
+{
+    return ++evaluated;
+}
+
+static int klog_test_level_filter(void)
+{
+    const uint8_t saved = klog_levels[KLOG_SYS_MEMORY];
+    klog_levels[KLOG_SYS_MEMORY] = KLOG_WARN;
+
+    // Rejected messages must not evaluate their arguments
+    KLOGS(KLOG_SYS_MEMORY, KLOG_DEBUG, "filtered %u", count_evaluation());
+    KLOGS(KLOG_SYS_MEMORY, KLOG_INFO, "filtered %u", count_evaluation());
+    const int rejected = evaluated == 0 &&
+                         !klog_enabled(KLOG_SYS_MEMORY, KLOG_INFO) &&
+                         klog_enabled(KLOG_SYS_MEMORY, KLOG_WARN) &&
+                         klog_enabled(KLOG_SYS_IRQ, KLOG_INFO) == (KLOG_INFO >= KLOG_MIN_LEVEL);
+
+    printf("\r\n");
+    KLOGS(KLOG_SYS_MEMORY, KLOG_WARN, "klog test: passes the filter (%u)", count_evaluation());
+
+    klog_levels[KLOG_SYS_MEMORY] = saved;
+    return rejected && evaluated == 1 &&
+           klog_level_parse("warn") == KLOG_WARN && klog_subsys_parse("uart") == KLOG_SYS_UART;
+}
+
+// --- Cost ---
+static int klog_test_record_cost(void)
+{
+    pmu_init();
+
+    const uint32_t t0 = pmu_cycles();
+    for (uint32_t i = 0; i < KLOG_BENCH_CALLS; i++)
+    {
+        KLOG_DEFER(KLOG_DEBUG, "klog bench %u %u", i, i * 3);
+    }
+    const uint32_t cycles = pmu_cycles() - t0;
+
+    klog_drain(UINT32_MAX);
+    printf("klog_bench record_cyc=%u\r\n", cycles / KLOG_BENCH_CALLS);
+    return 1;
+}
+
+// --- Main test runner ---
+int klog_test(void)
+{
+    KLOG_SYNC(KLOG_INFO, "Running klog tests...");
+
+    int (*tests[])(void) = {
+        klog_test_layout,
+        klog_test_record_drain,
+        klog_test_overflow_counts,
+        klog_test_level_filter,
+        klog_test_record_cost,
+    };
+
+    const char *names[] = {
+        "layout",
+        "record_drain",
+        "overflow_counts",
+        "level_filter",
+        "record_cost",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG_SYNC(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG_SYNC(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG_SYNC(KLOG_INFO, "\nklog_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file test_kstack.c
+ * @brief Mode stacks: layout, canary high-water marks and guard pages.
+ */
+#include "tests.h"
+#include "kstack.h"
+#include "interrupt.h"
+#include "mmu.h"
+#include "printf.h"
+#include "pmu.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// --- Tests ---
+static int kstack_test_layout(void)
+{
+    struct kstack_usage prev = { 0 };
+
+    for (uint32_t i = 0; i < KSTACK_COUNT; i++)
+    {
+        struct kstack_usage u;
+        if (!kstack_usage((kstack_id_t)i, &u))
+        {
+            return 0;
+        }
+
+        const uint32_t span = (uint32_t)(u.top - u.bottom);
+        if (u.bottom & (PAGE_SIZE - 1u) || u.top & 7u || u.budget == 0 || u.budget > span ||
+            span - u.budget >= PAGE_SIZE)
+        {
+            return 0;
+        }
+
+        // .stacks: each guard page sits between two stacks
+        if (i > KSTACK_IRQ && u.bottom - PAGE_SIZE != prev.top)
+        {
+            return 0;
+        }
+        prev = u;
+    }
+
+    struct kstack_usage svc;
+    kstack_usage(KSTACK_SVC, &svc);
+    return svc.top == MMU_RAM_SIZE && !kstack_usage(KSTACK_COUNT, &svc);
+}
+
+static int kstack_test_high_water(void)
+{
+    struct kstack_usage u;
+    bool ok = true;
+
+    for (uint32_t i = 0; i < KSTACK_COUNT && ok; i++)
+    {
+        kstack_usage((kstack_id_t)i, &u);
+        ok = u.used <= u.budget;
+    }
+
+    // IRQ entry moves to the SVC stack at once, FIQ and UND are unused
+    kstack_usage(KSTACK_SVC, &u);
+    ok = ok && u.used > 0;
+    kstack_usage(KSTACK_IRQ, &u);
+    ok = ok && u.used == 0;
+    kstack_usage(KSTACK_FIQ, &u);
+    ok = ok && u.used == 0;
+    kstack_usage(KSTACK_UND, &u);
+    return ok && u.used == 0;
+}
+
+static int kstack_test_scribble(void)
+{
+    struct kstack_usage before;
+    struct kstack_usage during;
+    struct kstack_usage after;
+    kstack_usage(KSTACK_SVC, &before);
+
+    // Only meaningful from the boot thread, which runs on the SVC stack
+    const uintptr_t here = (uintptr_t)&before;
+    if (here < before.bottom || here >= before.top)
+    {
+        return 1;
+    }
+
+    // A word deeper than anything used so far moves the mark to it
+    const uintptr_t deep = (before.top - before.used - 256u) & ~(uintptr_t)3u;
+    if (deep < before.bottom + 4u)
+    {
+        return 0;
+    }
+
+    const uint32_t flags = irq_save();
+    *(volatile uint32_t *)deep = 0;
+    kstack_usage(KSTACK_SVC, &during);
+    *(volatile uint32_t *)deep = KSTACK_CANARY;
+    kstack_usage(KSTACK_SVC, &after);
+    irq_restore(flags);
+
+    return during.used == before.top - deep && after.used <= before.used + 64u;
+}
+
+static int kstack_test_guards(void)
+{
+    if (!mmu_enabled())
+    {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < KSTACK_COUNT; i++)
+    {
+        struct kstack_usage u;
+        uintptr_t           pa;
+        kstack_usage((kstack_id_t)i, &u);
+
+        const uintptr_t guard = u.bottom - PAGE_SIZE;
+        if (!u.guarded || mmu_translate(guard, &pa) || mmu_translate(u.bottom - 4u, &pa) ||
+            !mmu_translate(u.bottom, &pa) || pa != u.bottom ||
+            !mmu_translate(guard - 4u, &pa) || pa != guard - 4u)
+        {
+            return 0;
+        }
+        if (kstack_guarding(guard) != i || kstack_guarding(u.bottom - 1u) != i ||
+            kstack_guarding(u.bottom) != KSTACK_COUNT)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int kstack_test_user_tables(void)
+{
+    if (!mmu_enabled())
+    {
+        return 1;
+    }
+
+    // User tables start as a copy of the kernel one, guards included
+    struct kstack_usage u;
+    uintptr_t           pa;
+    kstack_usage(KSTACK_SVC, &u);
+
+    struct mm *mm = mm_create();
+    const uint32_t flags = irq_save();
+    struct mm *prev = mmu_active();
+    mmu_switch(mm);
+    const bool guarded = !mmu_translate(u.bottom - PAGE_SIZE, &pa);
+    const bool mapped  = mmu_translate(u.bottom, &pa);
+    mmu_switch(prev);
+    irq_restore(flags);
+    mm_destroy(mm);
+
+    return guarded && mapped;
+}
+
+static int kstack_test_benchmark(void)
+{
+    struct kstack_usage svc;
+    struct kstack_usage abt;
+
+    pmu_init();
+    const uint32_t flags = irq_save();
+    const uint32_t t0 = pmu_cycles();
+    kstack_usage(KSTACK_SVC, &svc);
+    const uint32_t scan = pmu_cycles() - t0;
+    irq_restore(flags);
+    kstack_usage(KSTACK_ABT, &abt);
+
+    printf("\r\nkstack_bench svc_used=%u svc_budget=%u abt_used=%u svc_scan_cyc=%u\r\n",
+           svc.used, svc.budget, abt.used, scan);
+    return 1;
+}
+
+// --- Main test runner ---
+int kstack_test(void)
+{
+    KLOG(KLOG_INFO, "Running kstack tests...");
+
+    int (*tests[])(void) = {
+        kstack_test_layout,
+        kstack_test_high_water,
+        kstack_test_scribble,
+        kstack_test_guards,
+        kstack_test_user_tables,
+        kstack_test_benchmark,
+    };
+
+    const char *names[] = {
+        "layout",
+        "high_water",
+        "scribble",
+        "guards",
+        "user_tables",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        int result = tests[i]();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nkstack_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file test_kstat.c
+ * @brief Statistics registry: section layout, lookup, deltas, subsystem feeds and update cost.
+ */
+#include "tests.h"
+#include "kstat.h"
+#include "panic.h"
+#include "interrupt.h"
+#include "memory.h"
+#include "thread.h"
+#include "string.h"
+#include "uart.h"
+#include "printf.h"
+#include "pmu.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_OPS 1000u
+
+KSTAT_DEFINE(test_kstat_events);
+KSTAT_GAUGE_DEFINE(test_kstat_level);
+
+KSTAT_DECLARE(irq_timer_count);
+KSTAT_DECLARE(sched_switches);
+KSTAT_DECLARE(mem_kmalloc_calls);
+KSTAT_DECLARE(mem_used_bytes);
+KSTAT_DECLARE(uart_tx_bytes);
+
+// --- Setup and teardown ---
+static void setup(void)
+{
+    kstat_set(test_kstat_events, 0);
+    kstat_set(test_kstat_level, 0);
+}
+
+static void tear_down(void)
+{
+}
+
+// --- Registry ---
+static int kstat_test_registry(void)
+{
+    const uint32_t n = kstat_count();
+    bool ok = n >= 10 && kstat_at(n) == NULL;
+
+    // kernel.ld sorts by name, which kstat_find() relies on
+    for (uint32_t i = 1; i < n && ok; i++)
+    {
+        ok = strcmp(kstat_at(i - 1)->name, kstat_at(i)->name) < 0;
+    }
+
+    const char *known[] = { "irq_timer_count", "mem_kmalloc_calls", "panics_avoided",
+                            "sched_switches", "uart_tx_bytes", "test_kstat_events" };
+    for (uint32_t i = 0; i < sizeof(known) / sizeof(known[0]) && ok; i++)
+    {
+        const struct kstat *k = kstat_find(known[i]);
+        ok = k && strcmp(k->name, known[i]) == 0;
+    }
+
+    return ok && kstat_find("no_such_stat") == NULL &&
+           kstat_find("test_kstat_events") == &kstat_test_kstat_events &&
+           kstat_find("test_kstat_level")->kind == KSTAT_GAUGE;
+}
+
+static int kstat_test_counter_gauge(void)
+{
+    struct kstat *k = &kstat_test_kstat_events;
+    (void)kstat_delta(k);
+
+    kstat_inc(test_kstat_events);
+    kstat_add(test_kstat_events, 41);
+    kstat_add_atomic(test_kstat_events, 8);
+    const uint32_t d1 = kstat_delta(k);
+    const uint32_t d2 = kstat_delta(k);
+
+    // Deltas survive the 32-bit wrap
+    kstat_set(test_kstat_events, 0xFFFFFFF0u);
+    (void)kstat_delta(k);
+    kstat_add(test_kstat_events, 0x20);
+    const uint32_t d3 = kstat_delta(k);
+
+    kstat_add(test_kstat_level, 5);
+    kstat_sub(test_kstat_level, 7);
+
+    return d1 == 50 && d2 == 0 && d3 == 0x20 && kstat_read(test_kstat_events) == 0x10 &&
+           (int32_t)kstat_read(test_kstat_level) == -2;
+}
+
+// --- Feeds ---
+static int kstat_test_feeds(void)
+{
+    const uint32_t ticks    = kstat_read(irq_timer_count);
+    const uint32_t switches = kstat_read(sched_switches);
+    const uint32_t calls    = kstat_read(mem_kmalloc_calls);
+    const uint32_t used     = kstat_read(mem_used_bytes);
+    const uint32_t tx       = kstat_read(uart_tx_bytes);
+
+    thread_sleep_ms(30); // ticks, and a switch to idle and back
+    void *p = kmalloc(100);
+    const uint32_t used_live = kstat_read(mem_used_bytes);
+    kfree(p);
+    uart_write("kstat\r\n", 7);
+
+    return kstat_read(irq_timer_count) - ticks >= 2 &&
+           kstat_read(sched_switches) - switches >= 2 &&
+           kstat_read(mem_kmalloc_calls) - calls >= 1 &&
+           used_live - used >= 100 && kstat_read(mem_used_bytes) == used &&
+           kstat_read(uart_tx_bytes) - tx >= 7;
+}
+
+static int kstat_test_panics_avoided(void)
+{
+    const uint32_t before = kstat_read(panics_avoided);
+
+    // Larger than any IRQ cache class: the IRQ path fails softly
+    irq_nesting = irq_nesting + 1;
+    void *p = kmalloc(4096);
+    irq_nesting = irq_nesting - 1;
+
+    return p == NULL && kstat_read(panics_avoided) == before + 1;
+}
+
+static int kstat_test_dump(void)
+{
+    printf("\r\n");
+    kstat_inc(test_kstat_events);
+    kstat_dump(true, "test_kstat");
+    return kstat_delta(&kstat_test_kstat_events) == 0;
+}
+
+// --- Benchmark ---
+static int kstat_test_benchmark(void)
+{
+    pmu_init();
+    const uint32_t flags = irq_save();
+
+    uint32_t t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_OPS; i++)
+    {
+        kstat_inc(test_kstat_events);
+    }
+    const uint32_t inc_cyc = (pmu_cycles() - t0) / BENCH_OPS;
+
+    t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_OPS; i++)
+    {
+        kstat_add_atomic(test_kstat_events, 1);
+    }
+    const uint32_t atomic_cyc = (pmu_cycles() - t0) / BENCH_OPS;
+
+    t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_OPS; i++)
+    {
+        (void)kstat_find("sched_switches");
+    }
+    const uint32_t find_cyc = (pmu_cycles() - t0) / BENCH_OPS;
+
+    irq_restore(flags);
+    printf("\r\nkstat_bench stats=%u inc_cyc=%u atomic_cyc=%u find_cyc=%u\r\n",
+           kstat_count(), inc_cyc, atomic_cyc, find_cyc);
+
+    return kstat_read(test_kstat_events) == 2u * BENCH_OPS;
+}
+
+// --- Main test runner ---
+int kstat_test(void)
+{
+    KLOG(KLOG_INFO, "Running kstat tests...");
+
+    int (*tests[])(void) = {
+        kstat_test_registry,
+        kstat_test_counter_gauge,
+        kstat_test_feeds,
+        kstat_test_panics_avoided,
+        kstat_test_dump,
+        kstat_test_benchmark,
+    };
+
+    const char *names[] = {
+        "registry",
+        "counter_gauge",
+        "feeds",
+        "panics_avoided",
+        "dump",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nkstat_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
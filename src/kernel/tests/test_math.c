@@ -0,0 +1,272 @@
+/**
+ * @file test_math.c
+ * @brief Division library checks against a bit-serial reference.
+ *
+ * Also benchmarks the CLZ-normalized helpers, the EABI entry points the
+ * compiler calls for `/`, and the constant-divisor reciprocal path against
+ * the previous 32/64-iteration loops, in PMU cycles.
+ */
+#include "tests.h"
+#include "lib/math.h"
+#include "printf.h"
+#include "pmu.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MATH_ROUNDS 4000u
+#define BENCH_ROUNDS 1000u
+
+static uint32_t math_rng;
+
+static inline uint32_t math_rand(void)
+{
+    math_rng ^= math_rng << 13;
+    math_rng ^= math_rng >> 17;
+    math_rng ^= math_rng << 5;
+    return math_rng;
+}
+
+static inline uint64_t math_rand64(void)
+{
+    return ((uint64_t)math_rand() << 32) | math_rand();
+}
+
+// The loops _udiv32() and the old _bdiv() used: one step per dividend bit.
+static uint32_t ref_udivmod32(uint32_t n, uint32_t d, uint32_t *rem)
+{
+    uint32_t q = 0;
+    uint32_t r = 0;
+    for (int i = 31; i >= 0; --i)
+    {
+        r = (r << 1) | ((n >> i) & 1u);
+        if (r >= d)
+        {
+            r -= d;
+            q |= 1u << i;
+        }
+    }
+    *rem = r;
+    return q;
+}
+
+static uint64_t ref_udivmod64(uint64_t n, uint64_t d, uint64_t *rem)
+{
+    uint64_t q = 0;
+    uint64_t r = 0;
+    for (int i = 63; i >= 0; --i)
+    {
+        r = (r << 1) | ((n >> i) & 1u);
+        if (r >= d)
+        {
+            r -= d;
+            q |= 1ull << i;
+        }
+    }
+    *rem = r;
+    return q;
+}
+
+// --- Setup and teardown ---
+static void setup(void)
+{
+    math_rng = 0x2545F491u;
+}
+
+static void tear_down(void)
+{
+}
+
+// --- Correctness ---
+static int math_test_udivmod32(void)
+{
+    static const uint32_t edges[] = { 0, 1, 2, 3, 7, 10, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFEu, 0xFFFFFFFFu };
+
+    for (uint32_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+    {
+        for (uint32_t j = 1; j < sizeof(edges) / sizeof(edges[0]); j++)
+        {
+            uint32_t r, rr;
+            if (udivmod32(edges[i], edges[j], &r) != ref_udivmod32(edges[i], edges[j], &rr) || r != rr)
+            {
+                return 0;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < MATH_ROUNDS; i++)
+    {
+        const uint32_t n = math_rand() >> (i & 31);
+        const uint32_t d = (math_rand() >> ((i * 7) & 31)) | 1u;
+        uint32_t r, rr;
+
+        if (udivmod32(n, d, &r) != ref_udivmod32(n, d, &rr) || r != rr)
+        {
+            KLOG(KLOG_ERROR, "udivmod32 %u / %u", n, d);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int math_test_udivmod64(void)
+{
+    for (uint32_t i = 0; i < MATH_ROUNDS; i++)
+    {
+        const uint64_t n = math_rand64() >> (i & 63);
+        const uint64_t d = (math_rand64() >> ((i * 13) & 63)) | 1u;
+        uint64_t r, rr;
+
+        if (udivmod64(n, d, &r) != ref_udivmod64(n, d, &rr) || r != rr)
+        {
+            KLOG(KLOG_ERROR, "udivmod64 %llu / %llu", (unsigned long long)n, (unsigned long long)d);
+            return 0;
+        }
+    }
+
+    uint64_t r;
+    return udivmod64(UINT64_MAX, 1, &r) == UINT64_MAX && r == 0 &&
+           udivmod64(5, UINT64_MAX, &r) == 0 && r == 5 &&
+           udivmod64(1ull << 63, 3, &r) == 3074457345618258602ull && r == 2;
+}
+
+static int math_test_eabi_helpers(void)
+{
+    // volatile keeps the compiler from folding; each operator is a helper call
+    volatile uint32_t un = 4000000007u, ud = 13;
+    volatile int32_t  sn = -1000003, sd = 7;
+    volatile uint64_t ln = 0xFEDCBA9876543210ull, ld = 0x12345678ull;
+
+    return un / ud == 307692308u && un % ud == 3u &&
+           sn / sd == -142857 && sn % sd == -4 &&
+           sn / -sd == 142857 && -sn % sd == 4 &&
+           ln / ld == 0xE00000077ull && ln % ld == 0x48ull;
+}
+
+static int math_test_constant_divisor(void)
+{
+    for (uint32_t i = 0; i < MATH_ROUNDS; i++)
+    {
+        const uint64_t n = math_rand64() >> (i & 63);
+        uint64_t r;
+
+        if (udiv64(n, 10) != ref_udivmod64(n, 10, &r) ||
+            udiv64(n, 1000000) != ref_udivmod64(n, 1000000, &r) ||
+            udiv64(n, 0xFFFFFFFFFFFFFFC5ull) != ref_udivmod64(n, 0xFFFFFFFFFFFFFFC5ull, &r) ||
+            udiv32((uint32_t)n, 7) != (uint32_t)ref_udivmod64((uint32_t)n, 7, &r))
+        {
+            return 0;
+        }
+    }
+    return udiv64(UINT64_MAX, 1) == UINT64_MAX && udiv64(UINT64_MAX, 3) == 0x5555555555555555ull;
+}
+
+// --- Benchmark ---
+
+// Average cycles of `expr` over BENCH_ROUNDS pre-generated operand pairs.
+#define BENCH(acc, expr)                                     \
+    do                                                       \
+    {                                                        \
+        const uint32_t t0_ = pmu_cycles();                   \
+        for (uint32_t k = 0; k < BENCH_ROUNDS; k++)          \
+        {                                                    \
+            sink += (expr);                                  \
+        }                                                    \
+        (acc) = (pmu_cycles() - t0_) / BENCH_ROUNDS;         \
+    } while (0)
+
+static uint32_t n32[BENCH_ROUNDS], d32[BENCH_ROUNDS];
+static uint64_t n64[BENCH_ROUNDS], d64[BENCH_ROUNDS];
+
+static int math_test_benchmark(void)
+{
+    volatile uint64_t sink = 0;
+    uint32_t rem32;
+    uint64_t rem64;
+    uint32_t ref, fast, eabi, cnst;
+
+    pmu_init();
+
+    // Random operands: quotients of every length
+    for (uint32_t k = 0; k < BENCH_ROUNDS; k++)
+    {
+        n32[k] = math_rand();
+        d32[k] = (math_rand() >> (k & 31)) | 1u;
+        n64[k] = math_rand64();
+        d64[k] = (math_rand64() >> (k & 63)) | 1u;
+    }
+
+    BENCH(ref,  ref_udivmod32(n32[k], d32[k], &rem32));
+    BENCH(fast, udivmod32(n32[k], d32[k], &rem32));
+    BENCH(eabi, n32[k] / *(volatile uint32_t *)&d32[k]);
+    printf("\r\nmath_bench div32 random ref_cyc=%u clz_cyc=%u eabi_cyc=%u\r\n", ref, fast, eabi);
+
+    BENCH(ref,  ref_udivmod64(n64[k], d64[k], &rem64));
+    BENCH(fast, udivmod64(n64[k], d64[k], &rem64));
+    BENCH(eabi, n64[k] / *(volatile uint64_t *)&d64[k]);
+    printf("math_bench div64 random ref_cyc=%u clz_cyc=%u eabi_cyc=%u\r\n", ref, fast, eabi);
+
+    // Small divisors: long quotients, the worst case for shift-subtract
+    for (uint32_t k = 0; k < BENCH_ROUNDS; k++)
+    {
+        d32[k] = (k % 15) + 2;
+        d64[k] = d32[k];
+    }
+
+    BENCH(ref,  ref_udivmod32(n32[k], d32[k], &rem32));
+    BENCH(fast, udivmod32(n32[k], d32[k], &rem32));
+    BENCH(cnst, udiv32(n32[k], 10));
+    printf("math_bench div32 small ref_cyc=%u clz_cyc=%u const10_cyc=%u\r\n", ref, fast, cnst);
+
+    BENCH(ref,  ref_udivmod64(n64[k], d64[k], &rem64));
+    BENCH(fast, udivmod64(n64[k], d64[k], &rem64));
+    BENCH(cnst, udiv64(n64[k], 10));
+    printf("math_bench div64 small ref_cyc=%u clz_cyc=%u const10_cyc=%u\r\n", ref, fast, cnst);
+
+    (void)sink;
+    return 1;
+}
+
+// --- Main test runner ---
+int math_test(void)
+{
+    KLOG(KLOG_INFO, "Running math tests...");
+
+    int (*tests[])(void) = {
+        math_test_udivmod32,
+        math_test_udivmod64,
+        math_test_eabi_helpers,
+        math_test_constant_divisor,
+        math_test_benchmark,
+    };
+
+    const char *names[] = {
+        "udivmod32",
+        "udivmod64",
+        "eabi_helpers",
+        "constant_divisor",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nmath_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -1,11 +1,21 @@
 #include "memory.h"
+#include "interrupt.h"
+#include "ktimer.h"
 #include "printf.h"
 #include "log.h"
 
+#include <stdbool.h>
+
 
 #define TEST_HEAP_SIZE (1024 * 1024)
 static uint8_t heap_space[TEST_HEAP_SIZE];
 static size_t initial_heap_size = 0;
+static struct kmalloc_state kernel_heap; /**< Set aside while the tests run on heap_space. */
+
+#define STRESS_LOAD      40u     /**< Timer0 reload for the stress IRQ: 25 kHz at 1 MHz. */
+#define STRESS_IRQS      20000u  /**< Interrupts to survive. */
+#define STRESS_SLOTS     16u     /**< Live thread-side blocks. */
+#define HANDOFF_SIZE     32u     /**< IRQ-to-thread queue, a power of two. */
 
 // --- Setup and teardown ---
 static void setup()
@@ -153,10 +163,178 @@ static int kfree_merge_order_test()
     return 1;
 }
 
+// --- IRQ-context path ---
+
+/** Walk the block list: links agree and blocks tile the heap. */
+static bool heap_consistent(void)
+{
+    size_t total = 0;
+    for (struct header *curr = kmalloc_get_head(); curr; curr = curr->next)
+    {
+        if (curr->next && (curr->next->prev != curr ||
+            (char *)curr->next != (char *)curr + sizeof(struct header) + curr->size))
+        {
+            return false;
+        }
+        total += sizeof(struct header) + curr->size;
+    }
+    return total == initial_heap_size + sizeof(struct header);
+}
+
+static int kmalloc_test_irq_path()
+{
+    kmalloc_irq_refill();
+
+    struct kmalloc_irq_stats before, after;
+    kmalloc_irq_stats(&before);
+
+    // Pose as irq_handler(): same nesting count, IRQs masked
+    const uint32_t flags = irq_save();
+    irq_nesting = irq_nesting + 1;
+    void *small = kmalloc(40);
+    void *large = kmalloc(1000);
+    kfree(small);
+    irq_nesting = irq_nesting - 1;
+    irq_restore(flags);
+
+    kmalloc_irq_stats(&after);
+    const bool queued = after.allocs == before.allocs + 1 && after.misses == before.misses + 1 &&
+                        after.deferred == before.deferred + 1 && after.reclaimed == before.reclaimed;
+
+    kmalloc_irq_maintain();
+    kmalloc_irq_stats(&after);
+
+    return small != NULL && large == NULL && queued &&
+           after.reclaimed == before.reclaimed + 1 && heap_consistent();
+}
+
+static void *volatile handoff[HANDOFF_SIZE];
+static volatile uint32_t handoff_head = 0; /**< Written by the IRQ only. */
+static volatile uint32_t handoff_tail = 0; /**< Written by the thread only. */
+static volatile uint32_t stress_irqs  = 0;
+static volatile bool     stress_bad   = false;
+static void             *irq_held     = NULL;
+
+static inline uint32_t stress_pattern(const void *p)
+{
+    return (uint32_t)(uintptr_t)p ^ 0xA5A5A5A5u;
+}
+
+// Timer0 hook, runs in IRQ context at STRESS_LOAD
+static void stress_hook(uint32_t entry_value, uint32_t entry_cycles)
+{
+    (void)entry_value;
+    (void)entry_cycles;
+    const uint32_t n = stress_irqs;
+
+    uint32_t *p = kmalloc(16 + (n & 127u));
+    if (p)
+    {
+        p[0] = stress_pattern(p);
+        p[3] = n;
+
+        // Half go to the thread, half are freed here next time round
+        if ((n & 1u) && handoff_head - handoff_tail < HANDOFF_SIZE)
+        {
+            handoff[handoff_head % HANDOFF_SIZE] = p;
+            handoff_head = handoff_head + 1;
+        }
+        else
+        {
+            if (irq_held && ((uint32_t *)irq_held)[0] != stress_pattern(irq_held))
+            {
+                stress_bad = true;
+            }
+            kfree(irq_held);
+            irq_held = p;
+        }
+    }
+    stress_irqs = n + 1;
+}
+
+static bool stress_take_handoff(void)
+{
+    if (handoff_tail == handoff_head)
+    {
+        return false;
+    }
+    uint32_t *p = handoff[handoff_tail % HANDOFF_SIZE];
+    handoff_tail = handoff_tail + 1;
+
+    if (p[0] != stress_pattern(p))
+    {
+        stress_bad = true;
+    }
+    kfree(p);
+    return true;
+}
+
+static int kmalloc_test_irq_stress()
+{
+    uint32_t *slots[STRESS_SLOTS] = { 0 };
+    uint32_t  rng = 0x9E3779B9u;
+
+    kmalloc_irq_refill();
+    handoff_head = handoff_tail = 0;
+    stress_irqs  = 0;
+    stress_bad   = false;
+    irq_held     = NULL;
+
+    interrupts_set_timer0_hook(stress_hook);
+    timer0_start_periodic(STRESS_LOAD);
+
+    while (stress_irqs < STRESS_IRQS && !stress_bad)
+    {
+        // Thread-side churn on the same heap while the IRQ allocates
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+
+        const uint32_t s = rng % STRESS_SLOTS;
+        if (slots[s])
+        {
+            if (slots[s][0] != stress_pattern(slots[s]))
+            {
+                stress_bad = true;
+            }
+            kfree(slots[s]);
+        }
+        slots[s]    = kmalloc(16 + (rng >> 20) % 512);
+        slots[s][0] = stress_pattern(slots[s]);
+
+        while (stress_take_handoff())
+        {
+        }
+    }
+
+    // Give Timer0 back to the kernel tick
+    T0_CONTROL = 0;
+    interrupts_set_timer0_hook(NULL);
+    interrupts_init_timer0(KTIMER_HZ, 1000000);
+
+    while (stress_take_handoff())
+    {
+    }
+    kfree(irq_held);
+    for (uint32_t s = 0; s < STRESS_SLOTS; s++)
+    {
+        kfree(slots[s]);
+    }
+    kmalloc_irq_refill();
+
+    struct kmalloc_irq_stats stats;
+    kmalloc_irq_stats(&stats);
+    printf("\r\nkmalloc_irq_stress irqs=%u allocs=%u misses=%u deferred=%u reclaimed=%u refills=%u\r\n",
+           stress_irqs, stats.allocs, stats.misses, stats.deferred, stats.reclaimed, stats.refills);
+
+    return !stress_bad && stats.allocs > 0 && stats.reclaimed == stats.deferred && heap_consistent();
+}
+
 // --- Main test runner ---
 int kmalloc_test()
 {
     KLOG(KLOG_INFO, "Running kmalloc tests...");
+    kmalloc_save(&kernel_heap);
 
     int (*tests[])(void) = {
         kmalloc_test_single_alloc,
@@ -167,6 +345,8 @@ int kmalloc_test()
         // kfree_invalid_pointer_inside_heap_test,
         // kfree_invalid_pointer_outside_heap_test,
         kfree_merge_order_test,
+        kmalloc_test_irq_path,
+        kmalloc_test_irq_stress,
     };
 
     const char *names[] = {
@@ -178,6 +358,8 @@ int kmalloc_test()
         // "kfree_invalid_inside_heap",
         // "kfree_invalid_outside_heap",
         "kfree_merge_order",
+        "irq_path",
+        "irq_stress",
     };
 
     int num_tests = sizeof(tests) / sizeof(tests[0]);
@@ -192,12 +374,14 @@ int kmalloc_test()
 
         if (!result)
         {
+            kmalloc_restore(&kernel_heap);
             KLOG(KLOG_ERROR, "FAILED");
             return 1;
         }
         KLOG(KLOG_INFO, "PASSED");
         test_passed++;
     }
+    kmalloc_restore(&kernel_heap);
     KLOG(KLOG_INFO, "\nkmalloc_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,362 @@
+/**
+ * @file test_mmci.c
+ * @brief PL181 driver and buffer cache tests, and the 4 KiB I/O throughput benchmark.
+ *
+ * Overwrites the last TEST_BLOCKS blocks of the SD card.
+ */
+#include "tests.h"
+#include "mmci.h"
+#include "bcache.h"
+#include "clock.h"
+#include "kstat.h"
+#include "memory.h"
+#include "string.h"
+#include "printf.h"
+#include "log.h"
+#include "lib/math.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TEST_BLOCKS   1024u    /**< 4 MiB scratch area at the end of the card, a power of two. */
+#define BENCH_OPS     256u     /**< 4 KiB operations per benchmark run (1 MiB). */
+#define HOT_BLOCKS    32u      /**< Random working set that fits in the cache. */
+#define MULTI_SECTORS (MMCI_MAX_SECTORS + 16u)
+
+KSTAT_DECLARE(bcache_hits);
+KSTAT_DECLARE(bcache_misses);
+KSTAT_DECLARE(bcache_readahead_hits);
+KSTAT_DECLARE(bcache_evictions);
+KSTAT_DECLARE(bcache_writeback_blocks);
+KSTAT_DECLARE(bcache_writeback_runs);
+KSTAT_DECLARE(bcache_dirty);
+KSTAT_DECLARE(mmci_fifo_bursts);
+KSTAT_DECLARE(irq_mmci_count);
+
+static uint32_t base;  /**< First scratch block. */
+static uint32_t buf[BCACHE_BLOCK_SIZE / sizeof(uint32_t)];
+static uint32_t ref[BCACHE_BLOCK_SIZE / sizeof(uint32_t)];
+
+// --- Setup ---
+static void setup(void)
+{
+    base = bcache_blocks() - TEST_BLOCKS;
+}
+
+static void fill(uint32_t *words, size_t bytes, uint32_t seed)
+{
+    for (size_t i = 0; i < bytes / sizeof(uint32_t); i++)
+    {
+        words[i] = seed * 0x9E3779B1u + (uint32_t)i;
+    }
+}
+
+static inline uint32_t lba_of(uint32_t block)
+{
+    return block * BCACHE_BLOCK_SECTORS;
+}
+
+/** Whether the card holds `fill(seed)` in `block`, bypassing the cache. */
+static bool card_holds(uint32_t block, uint32_t seed)
+{
+    fill(ref, sizeof(ref), seed);
+    return mmci_read(lba_of(block), buf, BCACHE_BLOCK_SECTORS) == KERR_OK &&
+           memcmp(buf, ref, sizeof(ref)) == 0;
+}
+
+// --- Driver ---
+static int mmci_test_identify(void)
+{
+    return mmci_present() && mmci_sectors() >= TEST_BLOCKS * BCACHE_BLOCK_SECTORS &&
+           bcache_blocks() == mmci_sectors() / BCACHE_BLOCK_SECTORS;
+}
+
+static int mmci_test_raw_roundtrip(void)
+{
+    const uint32_t lba = lba_of(base);
+
+    // One sector, then a short multi-block run after it
+    fill(ref, sizeof(ref), 1);
+    bool ok = mmci_write(lba, ref, 1) == KERR_OK && mmci_write(lba + 1u, ref + 128, 3) == KERR_OK;
+
+    memset(buf, 0, sizeof(buf));
+    ok = ok && mmci_read(lba, buf, 4) == KERR_OK && memcmp(buf, ref, 4u * MMCI_SECTOR_SIZE) == 0;
+
+    return ok && mmci_read(lba, (uint8_t *)buf + 2, 1) == KERR_INVAL &&
+           mmci_read(mmci_sectors() - 1u, buf, 2) == KERR_INVAL &&
+           mmci_write(mmci_sectors(), buf, 1) == KERR_INVAL;
+}
+
+static int mmci_test_multi_command(void)
+{
+    // More sectors than one command carries, scattered over three buffers
+    uint32_t *data = kmalloc(MULTI_SECTORS * MMCI_SECTOR_SIZE);
+    uint32_t *back = kmalloc(MULTI_SECTORS * MMCI_SECTOR_SIZE);
+    if (!data || !back)
+    {
+        kfree(data);
+        kfree(back);
+        return 0;
+    }
+    fill(data, MULTI_SECTORS * MMCI_SECTOR_SIZE, 2);
+
+    const size_t          a   = 40u * MMCI_SECTOR_SIZE;
+    const size_t          b   = 8u * MMCI_SECTOR_SIZE;
+    const struct mmci_iov iov[] = {
+        { .buf = data, .len = a },
+        { .buf = (uint8_t *)data + a, .len = b },
+        { .buf = (uint8_t *)data + a + b, .len = MULTI_SECTORS * MMCI_SECTOR_SIZE - a - b },
+    };
+
+    const uint32_t irqs   = kstat_read(irq_mmci_count);
+    const uint32_t bursts = kstat_read(mmci_fifo_bursts);
+
+    const bool ok = mmci_writev(lba_of(base), iov, 3) == KERR_OK &&
+                    mmci_read(lba_of(base), back, MULTI_SECTORS) == KERR_OK &&
+                    memcmp(data, back, MULTI_SECTORS * MMCI_SECTOR_SIZE) == 0 &&
+                    kstat_read(irq_mmci_count) != irqs && kstat_read(mmci_fifo_bursts) != bursts;
+
+    kfree(data);
+    kfree(back);
+    return ok;
+}
+
+// --- Cache ---
+static int mmci_test_cache_hit(void)
+{
+    fill(ref, sizeof(ref), 3);
+    if (bcache_invalidate() != KERR_OK || mmci_write(lba_of(base), ref, BCACHE_BLOCK_SECTORS) != KERR_OK)
+    {
+        return 0;
+    }
+
+    const uint32_t hits   = kstat_read(bcache_hits);
+    const uint32_t misses = kstat_read(bcache_misses);
+
+    bool ok = bcache_read(base, buf) == KERR_OK && kstat_read(bcache_misses) == misses + 1u &&
+              memcmp(buf, ref, sizeof(ref)) == 0;
+    memset(buf, 0, sizeof(buf));
+    ok = ok && bcache_read(base, buf) == KERR_OK && kstat_read(bcache_hits) == hits + 1u &&
+         memcmp(buf, ref, sizeof(ref)) == 0;
+
+    return ok && bcache_read(bcache_blocks(), buf) == KERR_INVAL;
+}
+
+static int mmci_test_write_back(void)
+{
+    const uint32_t b = base + 1u;
+
+    // The image outlives boots: start from contents that differ from the new data
+    memset(buf, 0, sizeof(buf));
+    if (bcache_invalidate() != KERR_OK || mmci_write(lba_of(b), buf, BCACHE_BLOCK_SECTORS) != KERR_OK)
+    {
+        return 0;
+    }
+
+    // Dirty in the cache only until the sync
+    fill(ref, sizeof(ref), 4);
+    bool ok = bcache_write(b, ref) == KERR_OK && kstat_read(bcache_dirty) == 1u &&
+              !card_holds(b, 4) && bcache_sync() == KERR_OK && card_holds(b, 4) &&
+              kstat_read(bcache_dirty) == 0;
+
+    // Neighbouring dirty blocks leave in one command
+    const uint32_t runs   = kstat_read(bcache_writeback_runs);
+    const uint32_t blocks = kstat_read(bcache_writeback_blocks);
+    for (uint32_t i = 0; i < BCACHE_RUN_MAX && ok; i++)
+    {
+        fill(ref, sizeof(ref), 100u + i);
+        ok = bcache_write(base + 8u + i, ref) == KERR_OK;
+    }
+    ok = ok && bcache_sync() == KERR_OK && kstat_read(bcache_writeback_runs) == runs + 1u &&
+         kstat_read(bcache_writeback_blocks) == blocks + BCACHE_RUN_MAX;
+
+    for (uint32_t i = 0; i < BCACHE_RUN_MAX && ok; i++)
+    {
+        ok = card_holds(base + 8u + i, 100u + i);
+    }
+    return ok;
+}
+
+static int mmci_test_eviction(void)
+{
+    const uint32_t count = BCACHE_BUFFERS + 16u;
+    if (bcache_invalidate() != KERR_OK)
+    {
+        return 0;
+    }
+
+    // More dirty blocks than buffers: the oldest are written back to make room
+    const uint32_t evictions = kstat_read(bcache_evictions);
+    const uint32_t written   = kstat_read(bcache_writeback_blocks);
+    bool ok = true;
+    for (uint32_t i = 0; i < count && ok; i++)
+    {
+        fill(ref, sizeof(ref), 200u + i);
+        ok = bcache_write(base + 2u * i, ref) == KERR_OK; // no runs: one block per write-back
+    }
+    ok = ok && kstat_read(bcache_evictions) - evictions >= count - BCACHE_BUFFERS &&
+         kstat_read(bcache_writeback_blocks) - written >= count - BCACHE_BUFFERS &&
+         kstat_read(bcache_dirty) <= BCACHE_BUFFERS && bcache_sync() == KERR_OK;
+
+    for (uint32_t i = 0; i < count && ok; i++)
+    {
+        ok = card_holds(base + 2u * i, 200u + i);
+    }
+    return ok;
+}
+
+static int mmci_test_readahead(void)
+{
+    const uint32_t n = 2u * BCACHE_READAHEAD_MAX;
+    if (bcache_invalidate() != KERR_OK)
+    {
+        return 0;
+    }
+
+    const uint32_t misses = kstat_read(bcache_misses);
+    const uint32_t ahead  = kstat_read(bcache_readahead_hits);
+    bool ok = true;
+    for (uint32_t i = 0; i < n && ok; i++)
+    {
+        ok = bcache_read(base + i, ref) == KERR_OK &&
+             mmci_read(lba_of(base + i), buf, BCACHE_BLOCK_SECTORS) == KERR_OK &&
+             memcmp(buf, ref, sizeof(ref)) == 0;
+    }
+
+    // Windows of 1, 2, 8 and 8 blocks: four commands for sixteen blocks
+    return ok && kstat_read(bcache_misses) - misses <= 4u &&
+           kstat_read(bcache_readahead_hits) - ahead >= n - 4u;
+}
+
+// --- Benchmark ---
+typedef kerror_t (*block_op_t)(uint32_t block, void *data);
+
+static kerror_t raw_read(uint32_t block, void *data)
+{
+    return mmci_read(lba_of(block), data, BCACHE_BLOCK_SECTORS);
+}
+
+static kerror_t raw_write(uint32_t block, void *data)
+{
+    return mmci_write(lba_of(block), data, BCACHE_BLOCK_SECTORS);
+}
+
+static kerror_t cached_read(uint32_t block, void *data)
+{
+    return bcache_read(block, data);
+}
+
+static kerror_t cached_write(uint32_t block, void *data)
+{
+    return bcache_write(block, data);
+}
+
+/**
+ * @brief KiB/s of BENCH_OPS 4 KiB operations, in order or at random within `span` blocks.
+ *
+ * Cached runs start from an empty cache, with a `span` of up to HOT_BLOCKS
+ * read in first, and include the final sync.
+ */
+static uint32_t bench(block_op_t op, bool random, uint32_t span, bool cached, bool *ok)
+{
+    uint32_t seed = 0x2545F491u;
+    if (cached)
+    {
+        *ok = bcache_invalidate() == KERR_OK && *ok;
+        for (uint32_t i = 0; i < span && span <= HOT_BLOCKS; i++)
+        {
+            *ok = bcache_read(base + i, buf) == KERR_OK && *ok; // warm the hot set
+        }
+    }
+
+    const uint32_t t0 = clock_cycles32();
+    for (uint32_t i = 0; i < BENCH_OPS; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const uint32_t block = random ? (seed >> 8) & (span - 1u) : i;
+        *ok = op(base + block, buf) == KERR_OK && *ok;
+    }
+    if (cached)
+    {
+        *ok = bcache_sync() == KERR_OK && *ok;
+    }
+    const uint64_t us = clock_cycles_to_us(clock_cycles32() - t0);
+
+    return us ? (uint32_t)udiv64((uint64_t)BENCH_OPS * (BCACHE_BLOCK_SIZE / 1024u) * 1000000u, us) : 0;
+}
+
+static int mmci_test_benchmark(void)
+{
+    bool ok = true;
+    fill(buf, sizeof(buf), 5);
+
+    const uint32_t raw_seq_wr   = bench(raw_write, false, 0, false, &ok);
+    const uint32_t raw_seq_rd   = bench(raw_read, false, 0, false, &ok);
+    const uint32_t raw_rnd_wr   = bench(raw_write, true, TEST_BLOCKS, false, &ok);
+    const uint32_t raw_rnd_rd   = bench(raw_read, true, TEST_BLOCKS, false, &ok);
+    const uint32_t cache_seq_wr = bench(cached_write, false, 0, true, &ok);
+    const uint32_t cache_seq_rd = bench(cached_read, false, 0, true, &ok);
+    const uint32_t cache_rnd_wr = bench(cached_write, true, TEST_BLOCKS, true, &ok);
+    const uint32_t cache_rnd_rd = bench(cached_read, true, TEST_BLOCKS, true, &ok);
+    const uint32_t cache_hot_rd = bench(cached_read, true, HOT_BLOCKS, true, &ok);
+
+    printf("\r\nmmci_bench kib_s raw_seq_rd=%u raw_seq_wr=%u raw_rnd_rd=%u raw_rnd_wr=%u "
+           "cache_seq_rd=%u cache_seq_wr=%u cache_rnd_rd=%u cache_rnd_wr=%u cache_hot_rd=%u\r\n",
+           raw_seq_rd, raw_seq_wr, raw_rnd_rd, raw_rnd_wr,
+           cache_seq_rd, cache_seq_wr, cache_rnd_rd, cache_rnd_wr, cache_hot_rd);
+    return ok;
+}
+
+// --- Main test runner ---
+int mmci_test(void)
+{
+    KLOG(KLOG_INFO, "Running mmci tests...");
+    if (!mmci_present() || bcache_blocks() < TEST_BLOCKS)
+    {
+        KLOG(KLOG_WARN, "mmci tests skipped: no SD card (see `make qemu`)");
+        return 0;
+    }
+
+    int (*tests[])(void) = {
+        mmci_test_identify,
+        mmci_test_raw_roundtrip,
+        mmci_test_multi_command,
+        mmci_test_cache_hit,
+        mmci_test_write_back,
+        mmci_test_eviction,
+        mmci_test_readahead,
+        mmci_test_benchmark,
+    };
+
+    const char *names[] = {
+        "identify",
+        "raw_roundtrip",
+        "multi_command",
+        "cache_hit",
+        "write_back",
+        "eviction",
+        "readahead",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nmmci_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -0,0 +1,318 @@
+/**
+ * @file test_mmu.c
+ * @brief Address space, ASID and user task tests, and the TLB switch benchmark.
+ */
+#include "tests.h"
+#include "mmu.h"
+#include "task.h"
+#include "syscall.h"
+#include "interrupt.h"
+#include "memory.h"
+#include "string.h"
+#include "printf.h"
+#include "pmu.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_SWITCHES 256u
+#define BENCH_PAGES    8u
+
+/*
+ * Position-independent user programs. user_prog bumps its private magic
+ * word, prints a line, yields a few times and exits with
+ * magic + 1 + bytes written, or 14 alone if its stack or data did not
+ * survive the switches. user_probe passes a kernel address to SYS_WRITE
+ * and exits with the result.
+ */
+_Static_assert(SYS_WRITE == 1 && SYS_YIELD == 2 && SYS_EXIT == 5, "update the user programs");
+
+__asm__(
+    "    .pushsection .rodata.user_prog, \"a\", %progbits\n"
+    "    .align 2\n"
+    "user_prog_start:\n"
+    "    adr   r5, user_prog_magic\n"
+    "    ldr   r4, [r5]\n"
+    "    add   r4, r4, #1\n"
+    "    str   r4, [r5]\n"
+    "    push  {r4}\n"
+    "    adr   r0, user_prog_msg\n"
+    "    mov   r1, #14\n"
+    "    mov   r7, #1\n"            // SYS_WRITE
+    "    svc   #0\n"
+    "    mov   r6, r0\n"
+    "    mov   r8, #4\n"
+    "1:  mov   r7, #2\n"            // SYS_YIELD
+    "    svc   #0\n"
+    "    subs  r8, r8, #1\n"
+    "    bne   1b\n"
+    "    pop   {r0}\n"
+    "    ldr   r1, [r5]\n"
+    "    cmp   r0, r1\n"
+    "    movne r0, #0\n"
+    "    add   r0, r0, r6\n"
+    "    mov   r7, #5\n"            // SYS_EXIT
+    "    svc   #0\n"
+    "    b     .\n"
+    "user_prog_msg:\n"
+    "    .ascii \"[user] hello\\r\\n\"\n"
+    "    .align 2\n"
+    "user_prog_magic:\n"
+    "    .word 0\n"
+    "user_prog_end:\n"
+    "\n"
+    "user_probe_start:\n"
+    "    mov   r0, #0x10000\n"      // kernel text
+    "    mov   r1, #4\n"
+    "    mov   r7, #1\n"            // SYS_WRITE
+    "    svc   #0\n"
+    "    mov   r7, #5\n"            // SYS_EXIT
+    "    svc   #0\n"
+    "    b     .\n"
+    "user_probe_end:\n"
+    "    .popsection\n");
+
+extern const uint8_t user_prog_start[], user_prog_magic[], user_prog_end[];
+extern const uint8_t user_probe_start[], user_probe_end[];
+
+static uint32_t kernel_word = 0x600DF00Du;
+
+/** Run `mm` on the test thread: mmu_switch() wants IRQs masked. */
+static void load(struct mm *mm)
+{
+    const uint32_t flags = irq_save();
+    mmu_switch(mm);
+    irq_restore(flags);
+}
+
+static inline uint32_t *user_word(uint32_t page)
+{
+    return (uint32_t *)(uintptr_t)(USER_BASE + page * PAGE_SIZE);
+}
+
+// --- Kernel table ---
+static int mmu_test_kernel_identity(void)
+{
+    uintptr_t pa = 0;
+    load(NULL);
+
+    return mmu_enabled() &&
+           mmu_translate((uintptr_t)&kernel_word, &pa) && pa == (uintptr_t)&kernel_word &&
+           !mmu_translate(USER_BASE, &pa);
+}
+
+// --- Address spaces ---
+static int mmu_test_map_alloc(void)
+{
+    struct mm *mm = mm_create();
+    const uint32_t rw = MM_PROT_READ | MM_PROT_WRITE;
+
+    bool ok = mm_alloc(mm, USER_BASE, 3 * PAGE_SIZE, rw) == KERR_OK &&
+              mm->pages == 3 &&
+              mm_alloc(mm, USER_BASE + PAGE_SIZE, PAGE_SIZE, rw) == KERR_BUSY &&
+              mm_alloc(mm, USER_BASE + 1, PAGE_SIZE, rw) == KERR_INVAL &&
+              mm_alloc(mm, USER_END, PAGE_SIZE, rw) == KERR_INVAL &&
+              mm_map(mm, USER_BASE + 16 * PAGE_SIZE, (uintptr_t)&kernel_word & ~(uintptr_t)(PAGE_SIZE - 1u),
+                     MM_PROT_READ) == KERR_OK;
+
+    ok = ok && mm_access_ok(mm, USER_BASE, 3 * PAGE_SIZE, rw) &&
+         !mm_access_ok(mm, USER_BASE, 4 * PAGE_SIZE, MM_PROT_READ) &&
+         !mm_access_ok(mm, USER_BASE, PAGE_SIZE, MM_PROT_EXEC) &&
+         mm_access_ok(mm, USER_BASE + 16 * PAGE_SIZE, 4, MM_PROT_READ) &&
+         !mm_access_ok(mm, USER_BASE + 16 * PAGE_SIZE, 4, MM_PROT_WRITE) &&
+         !mm_access_ok(mm, 0x10000, 4, MM_PROT_READ);
+
+    // Fresh frames are zeroed, the kernel alias reaches them
+    const uint32_t *k = mm_kaddr(mm, USER_BASE + 8);
+    ok = ok && k && *k == 0 && mm_kaddr(mm, USER_BASE + 4 * PAGE_SIZE) == NULL;
+
+    mm_destroy(mm);
+    return ok;
+}
+
+static int mmu_test_asid_isolation(void)
+{
+    struct mm *a = mm_create();
+    struct mm *b = mm_create();
+    mm_alloc(a, USER_BASE, PAGE_SIZE, MM_PROT_READ | MM_PROT_WRITE);
+    mm_alloc(b, USER_BASE, PAGE_SIZE, MM_PROT_READ | MM_PROT_WRITE);
+
+    // Same virtual address, two frames; no flush between the switches
+    load(a);
+    *user_word(0) = 0xAAAAAAAAu;
+    load(b);
+    *user_word(0) = 0xBBBBBBBBu;
+    load(a);
+    const uint32_t seen_a = *user_word(0);
+    load(b);
+    const uint32_t seen_b = *user_word(0);
+
+    const bool asids = (a->context & ASID_MASK) != 0 && (b->context & ASID_MASK) != 0 &&
+                       (a->context & ASID_MASK) != (b->context & ASID_MASK);
+
+    load(NULL);
+    const bool ok = seen_a == 0xAAAAAAAAu && seen_b == 0xBBBBBBBBu && asids &&
+                    *(uint32_t *)mm_kaddr(a, USER_BASE) == 0xAAAAAAAAu;
+
+    mm_destroy(a);
+    mm_destroy(b);
+    return ok;
+}
+
+static int mmu_test_asid_rollover(void)
+{
+    struct mm *a = mm_create();
+    mm_alloc(a, USER_BASE, PAGE_SIZE, MM_PROT_READ | MM_PROT_WRITE);
+
+    load(a);
+    *user_word(0) = 0x12345678u;
+    const uint32_t before     = mmu_asid_rollovers();
+    const uint32_t context_a0 = a->context;
+
+    // One more address space than there are ASIDs forces a new generation
+    for (uint32_t i = 0; i <= ASID_MASK; i++)
+    {
+        struct mm *tmp = mm_create();
+        mm_alloc(tmp, USER_BASE, PAGE_SIZE, MM_PROT_READ | MM_PROT_WRITE);
+        load(tmp);
+        *user_word(0) = i;
+        mm_destroy(tmp);
+    }
+
+    load(a);
+    const bool ok = mmu_asid_rollovers() > before &&
+                    a->context != context_a0 &&
+                    *user_word(0) == 0x12345678u;
+
+    load(NULL);
+    mm_destroy(a);
+    return ok;
+}
+
+// --- User tasks ---
+static struct task *spawn_prog(const char *name, uint32_t magic)
+{
+    const size_t size = (size_t)(user_prog_end - user_prog_start);
+    uint8_t *image = kmalloc(size);
+
+    memcpy(image, user_prog_start, size);
+    memcpy(image + (user_prog_magic - user_prog_start), &magic, sizeof(magic));
+
+    struct task *task = task_create(name, image, size, THREAD_PRIO_DEFAULT);
+    kfree(image);
+    return task;
+}
+
+static int mmu_test_user_tasks(void)
+{
+    // Both images run at USER_BASE and interleave through SYS_YIELD
+    struct task *a = spawn_prog("user_a", 1000);
+    struct task *b = spawn_prog("user_b", 2000);
+
+    const int32_t code_a = task_join(a);
+    const int32_t code_b = task_join(b);
+
+    return code_a == 1000 + 1 + 14 && code_b == 2000 + 1 + 14;
+}
+
+static int mmu_test_user_bad_pointer(void)
+{
+    struct task *t = task_create("probe", user_probe_start,
+                                 (size_t)(user_probe_end - user_probe_start), THREAD_PRIO_DEFAULT);
+
+    return task_join(t) == KERR_INVAL &&
+           task_create("empty", user_probe_start, 0, THREAD_PRIO_DEFAULT) == NULL;
+}
+
+// --- Benchmark ---
+static uint32_t bench_switches(struct mm *a, struct mm *b, bool flush)
+{
+    const uint32_t flags = irq_save();
+    const uint32_t t0 = pmu_cycles();
+
+    for (uint32_t i = 0; i < BENCH_SWITCHES; i++)
+    {
+        struct mm *mm = (i & 1u) ? b : a;
+        mmu_switch(mm);
+        if (flush)
+        {
+            tlb_flush_all(); // what a switch costs without ASIDs
+        }
+        for (uint32_t p = 0; p < BENCH_PAGES; p++)
+        {
+            (void)*(volatile uint32_t *)user_word(p);
+        }
+    }
+
+    const uint32_t cycles = pmu_cycles() - t0;
+    mmu_switch(NULL);
+    irq_restore(flags);
+    return cycles / BENCH_SWITCHES;
+}
+
+static int mmu_test_benchmark(void)
+{
+    struct mm *a = mm_create();
+    struct mm *b = mm_create();
+    mm_alloc(a, USER_BASE, BENCH_PAGES * PAGE_SIZE, MM_PROT_READ | MM_PROT_WRITE);
+    mm_alloc(b, USER_BASE, BENCH_PAGES * PAGE_SIZE, MM_PROT_READ | MM_PROT_WRITE);
+
+    pmu_init();
+    bench_switches(a, b, false); // warm up: ASIDs assigned, TLB filled
+
+    const uint32_t asid_cyc  = bench_switches(a, b, false);
+    const uint32_t flush_cyc = bench_switches(a, b, true);
+
+    printf("\r\nmmu_bench pages=%u asid_switch_cyc=%u flush_switch_cyc=%u rollovers=%u\r\n",
+           BENCH_PAGES, asid_cyc, flush_cyc, mmu_asid_rollovers());
+
+    mm_destroy(a);
+    mm_destroy(b);
+    return 1;
+}
+
+// --- Main test runner ---
+int mmu_test(void)
+{
+    KLOG(KLOG_INFO, "Running mmu tests...");
+
+    int (*tests[])(void) = {
+        mmu_test_kernel_identity,
+        mmu_test_map_alloc,
+        mmu_test_asid_isolation,
+        mmu_test_asid_rollover,
+        mmu_test_user_tasks,
+        mmu_test_user_bad_pointer,
+        mmu_test_benchmark,
+    };
+
+    const char *names[] = {
+        "kernel_identity",
+        "map_alloc",
+        "asid_isolation",
+        "asid_rollover",
+        "user_tasks",
+        "user_bad_pointer",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        int result = tests[i]();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nmmu_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -0,0 +1,402 @@
+/**
+ * @file test_ringbuf.c
+ * @brief Ring buffer unit tests and IRQ-to-thread stress tests.
+ *
+ * The stress tests take Timer0 away from the kernel tick and run it at a
+ * high rate; its hook produces sequence-numbered records while the thread
+ * consumes (and, for the multi-producer case, produces) at the same time.
+ *
+ * The commit window test hooks into ringbuf_mp_commit() itself through the
+ * test-only RINGBUF_TEST_HOOKS seam, which must be defined before ringbuf.h
+ * is included.
+ */
+#define RINGBUF_TEST_HOOKS
+struct ringbuf;
+static void commit_window_hook(struct ringbuf *rb);
+#define RINGBUF_MP_COMMIT_WINDOW(rb) commit_window_hook(rb)
+
+#include "tests.h"
+#include "ringbuf.h"
+#include "interrupt.h"
+#include "ktimer.h"
+#include "printf.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STRESS_RECORDS   20000u
+#define STRESS_LOAD      20u    /**< Timer0 reload in ticks (~50 kHz at 1 MHz). */
+#define WINDOW_ROUNDS    1000u
+
+typedef struct
+{
+    uint32_t id;
+    uint32_t seq;
+} stress_rec_t;
+
+static uint8_t        ring_storage[256];
+static struct ringbuf ring;
+
+static volatile uint32_t irq_seq = 0;
+static volatile bool     irq_mp  = false;
+
+static volatile bool     window_armed = false; /**< Inject on the next commit. */
+static volatile uint32_t window_irqs  = 0;
+
+// --- Setup and teardown ---
+static void setup(void)
+{
+    ringbuf_init(&ring, ring_storage, sizeof(ring_storage));
+    irq_seq = 0;
+}
+
+static void tear_down(void)
+{
+}
+
+// Timer0 hook: one record per interrupt, retried on the next one if full.
+static void producer_hook(uint32_t entry_value, uint32_t entry_cycles)
+{
+    (void)entry_value;
+    (void)entry_cycles;
+
+    if (irq_seq >= STRESS_RECORDS)
+    {
+        return;
+    }
+
+    bool ok;
+    if (irq_mp)
+    {
+        const stress_rec_t rec = { .id = 1, .seq = irq_seq };
+        ok = ringbuf_mp_write(&ring, &rec, sizeof(rec));
+    }
+    else
+    {
+        const uint32_t seq = irq_seq;
+        ok = ringbuf_free(&ring) >= sizeof(seq) &&
+             ringbuf_write(&ring, &seq, sizeof(seq)) == sizeof(seq);
+    }
+
+    if (ok)
+    {
+        irq_seq = irq_seq + 1;
+    }
+}
+
+static void stress_start(bool mp)
+{
+    irq_mp = mp;
+    interrupts_set_timer0_hook(producer_hook);
+    timer0_start_periodic(STRESS_LOAD);
+}
+
+static void stress_stop(void)
+{
+    interrupts_set_timer0_hook(NULL);
+    interrupts_init_timer0(KTIMER_HZ, 1000000);
+}
+
+/**
+ * Inside the commit window: make Timer0 raise its interrupt and wait
+ * until it is pending, so it is taken the moment IRQs are unmasked.
+ */
+static void commit_window_hook(struct ringbuf *rb)
+{
+    (void)rb;
+    if (!window_armed)
+    {
+        return;
+    }
+    window_armed = false;
+
+    T0_CONTROL = 0;
+    T0_INTCLR  = 1;
+    T0_LOAD    = 1;
+    T0_CONTROL = TCTRL_32BIT | TCTRL_ONESHOT | TCTRL_INTEN | TCTRL_ENABLE;
+    while (!T0_RIS)
+    {
+    }
+}
+
+// Timer0 hook: the nested writer of the commit window test
+static void window_writer_hook(uint32_t entry_value, uint32_t entry_cycles)
+{
+    (void)entry_value;
+    (void)entry_cycles;
+    const uint32_t irq = window_irqs;
+    ringbuf_mp_write(&ring, &irq, sizeof(irq));
+    window_irqs = irq + 1;
+}
+
+// --- Single producer basics ---
+static int ringbuf_test_put_get_wrap(void)
+{
+    uint8_t out;
+
+    for (uint32_t round = 0; round < 3; round++)
+    {
+        for (uint32_t i = 0; i < sizeof(ring_storage); i++)
+        {
+            if (!ringbuf_put(&ring, (uint8_t)(i + round)))
+            {
+                KLOG(KLOG_ERROR, "put failed before full at %u", i);
+                return 0;
+            }
+        }
+
+        if (ringbuf_put(&ring, 0xAA))
+        {
+            KLOG(KLOG_ERROR, "put succeeded on a full ring");
+            return 0;
+        }
+
+        for (uint32_t i = 0; i < sizeof(ring_storage); i++)
+        {
+            if (!ringbuf_get(&ring, &out) || out != (uint8_t)(i + round))
+            {
+                KLOG(KLOG_ERROR, "get mismatch at %u", i);
+                return 0;
+            }
+        }
+
+        if (ringbuf_get(&ring, &out) || !ringbuf_empty(&ring))
+        {
+            KLOG(KLOG_ERROR, "ring not empty after draining");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int ringbuf_test_reserve_commit_spans(void)
+{
+    // Move the indices so the free space wraps around the end of storage
+    uint8_t scratch[200] = {0};
+    ringbuf_write(&ring, scratch, sizeof(scratch));
+    ringbuf_read(&ring, scratch, sizeof(scratch));
+
+    void *span;
+    uint32_t first = ringbuf_write_reserve(&ring, &span);
+    if (first != sizeof(ring_storage) - 200 || span != ring_storage + 200)
+    {
+        KLOG(KLOG_ERROR, "first span wrong: %u", first);
+        return 0;
+    }
+    for (uint32_t i = 0; i < first; i++)
+    {
+        ((uint8_t *)span)[i] = (uint8_t)i;
+    }
+    ringbuf_write_commit(&ring, first);
+
+    uint32_t second = ringbuf_write_reserve(&ring, &span);
+    if (second != 200 || span != ring_storage)
+    {
+        KLOG(KLOG_ERROR, "wrapped span wrong: %u", second);
+        return 0;
+    }
+    ringbuf_write_commit(&ring, 10);
+
+    const void *rspan;
+    if (ringbuf_read_peek(&ring, &rspan) != first || rspan != ring_storage + 200)
+    {
+        KLOG(KLOG_ERROR, "read span wrong");
+        return 0;
+    }
+    ringbuf_read_commit(&ring, first);
+
+    return ringbuf_used(&ring) == 10;
+}
+
+// --- Multi producer publication order ---
+static int ringbuf_test_mp_nested_publish(void)
+{
+    uint32_t outer;
+    uint32_t inner;
+
+    if (!ringbuf_mp_reserve(&ring, 8, &outer))
+    {
+        return 0;
+    }
+
+    // An "interrupting" writer claims, fills and commits inside the outer one
+    if (!ringbuf_mp_reserve(&ring, 4, &inner) || inner != outer + 8)
+    {
+        return 0;
+    }
+    ringbuf_copy_in(&ring, inner, "IRQ!", 4);
+    ringbuf_mp_commit(&ring);
+
+    if (ringbuf_used(&ring) != 0)
+    {
+        KLOG(KLOG_ERROR, "inner record published before the outer one");
+        return 0;
+    }
+
+    ringbuf_copy_in(&ring, outer, "THREAD!!", 8);
+    ringbuf_mp_commit(&ring);
+
+    char out[12];
+    if (ringbuf_read(&ring, out, sizeof(out)) != 12 ||
+        out[0] != 'T' || out[8] != 'I')
+    {
+        KLOG(KLOG_ERROR, "records missing or out of order");
+        return 0;
+    }
+    return 1;
+}
+
+static int ringbuf_test_mp_commit_window_irq(void)
+{
+    window_irqs = 0;
+    interrupts_set_timer0_hook(window_writer_hook);
+
+    bool ok = true;
+    for (uint32_t i = 0; i < WINDOW_ROUNDS && ok; i++)
+    {
+        // A thread record whose commit an IRQ writer interrupts halfway
+        const stress_rec_t rec = { .id = 0, .seq = i };
+        window_armed = true;
+        ok = ringbuf_mp_write(&ring, &rec, sizeof(rec)) && window_irqs == i + 1u;
+
+        // Both records published, the thread's first
+        stress_rec_t out;
+        uint32_t     irq = 0;
+        ok = ok && ringbuf_used(&ring) == sizeof(out) + sizeof(irq) &&
+             ringbuf_read(&ring, &out, sizeof(out)) == sizeof(out) && out.seq == i &&
+             ringbuf_read(&ring, &irq, sizeof(irq)) == sizeof(irq) && irq == i;
+    }
+
+    window_armed = false;
+    stress_stop();
+    if (!ok)
+    {
+        KLOG(KLOG_ERROR, "nested record lost after %u rounds", window_irqs);
+    }
+    return ok;
+}
+
+static int ringbuf_test_mp_full_rejects(void)
+{
+    uint8_t blob[64] = {0};
+    uint32_t written = 0;
+
+    while (ringbuf_mp_write(&ring, blob, sizeof(blob)))
+    {
+        written += sizeof(blob);
+    }
+
+    return written == sizeof(ring_storage) && ringbuf_used(&ring) == written;
+}
+
+// --- IRQ stress ---
+static int ringbuf_test_spsc_irq_stress(void)
+{
+    uint32_t expect = 0;
+
+    stress_start(false);
+    while (expect < STRESS_RECORDS)
+    {
+        uint32_t seq;
+        if (ringbuf_used(&ring) < sizeof(seq))
+        {
+            continue;
+        }
+
+        ringbuf_read(&ring, &seq, sizeof(seq));
+        if (seq != expect)
+        {
+            stress_stop();
+            KLOG(KLOG_ERROR, "sequence break: got %u expected %u", seq, expect);
+            return 0;
+        }
+        expect++;
+    }
+    stress_stop();
+    return 1;
+}
+
+static int ringbuf_test_mpsc_irq_stress(void)
+{
+    uint32_t expect[2]    = {0, 0};
+    uint32_t thread_seq   = 0;
+
+    stress_start(true);
+    while (expect[0] < STRESS_RECORDS || expect[1] < STRESS_RECORDS)
+    {
+        // Produce from the thread, racing the Timer0 producer
+        if (thread_seq < STRESS_RECORDS)
+        {
+            const stress_rec_t rec = { .id = 0, .seq = thread_seq };
+            if (ringbuf_mp_write(&ring, &rec, sizeof(rec)))
+            {
+                thread_seq++;
+            }
+        }
+
+        // Consume whatever is published
+        stress_rec_t rec;
+        while (ringbuf_used(&ring) >= sizeof(rec))
+        {
+            ringbuf_read(&ring, &rec, sizeof(rec));
+            if (rec.id > 1 || rec.seq != expect[rec.id])
+            {
+                stress_stop();
+                KLOG(KLOG_ERROR, "producer %u: got %u expected %u",
+                     rec.id, rec.seq, rec.id > 1 ? 0 : expect[rec.id]);
+                return 0;
+            }
+            expect[rec.id]++;
+        }
+    }
+    stress_stop();
+    return 1;
+}
+
+// --- Main test runner ---
+int ringbuf_test(void)
+{
+    KLOG(KLOG_INFO, "Running ringbuf tests...");
+
+    int (*tests[])(void) = {
+        ringbuf_test_put_get_wrap,
+        ringbuf_test_reserve_commit_spans,
+        ringbuf_test_mp_nested_publish,
+        ringbuf_test_mp_commit_window_irq,
+        ringbuf_test_mp_full_rejects,
+        ringbuf_test_spsc_irq_stress,
+        ringbuf_test_mpsc_irq_stress,
+    };
+
+    const char *names[] = {
+        "put_get_wrap",
+        "reserve_commit_spans",
+        "mp_nested_publish",
+        "mp_commit_window_irq",
+        "mp_full_rejects",
+        "spsc_irq_stress",
+        "mpsc_irq_stress",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nringbuf_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
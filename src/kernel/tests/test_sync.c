@@ -0,0 +1,534 @@
+/**
+ * @file test_sync.c
+ * @brief Atomics, spinlocks, seqlocks and wait queues: semantics, timer-interrupt torture, costs.
+ *
+ * Each torture test races the thread against a Timer0 hook firing at
+ * TORTURE_LOAD on the same data, so every primitive is interrupted in
+ * the middle of its own critical path thousands of times.
+ */
+#include "tests.h"
+#include "atomic.h"
+#include "spinlock.h"
+#include "seqlock.h"
+#include "waitqueue.h"
+#include "interrupt.h"
+#include "thread.h"
+#include "ktimer.h"
+#include "printf.h"
+#include "pmu.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TORTURE_LOAD     50u    /**< Timer0 reload: 20 kHz at 1 MHz. */
+#define TORTURE_IRQS     5000u  /**< Interrupts per torture test. */
+#define WAIT_ROUNDS      400u
+#define WAIT_WATCHDOG    200u   /**< Interrupts past the target that count as a lost wake-up. */
+#define BENCH_OPS        10000u
+#define BENCH_ROUND_TRIPS 500u
+
+typedef enum torture : uint8_t
+{
+    TORTURE_ATOMIC,
+    TORTURE_SPIN,
+    TORTURE_SEQ,
+    TORTURE_WAIT
+} torture_t;
+
+/** Two words that must always read as (a, ~a). */
+struct pair
+{
+    volatile uint32_t a;
+    volatile uint32_t b;
+};
+
+static volatile torture_t torture_mode;
+static volatile uint32_t  torture_irqs;
+static volatile bool      torture_bad;
+
+static atomic_t           t_counter;
+static atomic_t           t_ordered;
+static volatile uint32_t  t_bits[2];
+static spinlock_t         t_lock;
+static seqlock_t          t_seqlock;
+static struct pair        t_pair;
+static struct wait_queue  t_wq;
+static volatile uint32_t  t_events;
+static volatile uint32_t  t_target;
+static volatile bool      t_lost;
+
+// --- Setup and teardown ---
+static void setup(void)
+{
+    atomic_set(&t_counter, 0);
+    atomic_set(&t_ordered, 0);
+    t_bits[0] = t_bits[1] = 0;
+    spin_lock_init(&t_lock);
+    seqlock_init(&t_seqlock);
+    t_pair.a = 0;
+    t_pair.b = ~0u;
+    wait_queue_init(&t_wq);
+    t_events = t_target = 0;
+    t_lost   = false;
+
+    torture_irqs = 0;
+    torture_bad  = false;
+}
+
+static void tear_down(void)
+{
+}
+
+static inline bool pair_ok(const struct pair *p)
+{
+    return p->b == ~p->a;
+}
+
+static inline void pair_bump(struct pair *p)
+{
+    p->a = p->a + 1;
+    p->b = ~p->a;
+}
+
+// Timer0 hook, runs in IRQ context at TORTURE_LOAD
+static void torture_hook(uint32_t entry_value, uint32_t entry_cycles)
+{
+    (void)entry_value;
+    (void)entry_cycles;
+    const uint32_t n = torture_irqs;
+
+    switch (torture_mode)
+    {
+    case TORTURE_ATOMIC:
+        atomic_inc(&t_counter);
+        (void)atomic_add_return(&t_ordered, 2);
+        // Bits 0..15 of word 0 belong to the IRQ, 16..31 to the thread
+        if ((n & 1u) ? !test_and_clear_bit((n >> 1) & 15u, t_bits)
+                     : test_and_set_bit((n >> 1) & 15u, t_bits))
+        {
+            torture_bad = true;
+        }
+        break;
+
+    case TORTURE_SPIN:
+        // The thread only holds the lock with IRQs masked: it is always free here
+        if (!spin_trylock_raw(&t_lock))
+        {
+            torture_bad = true;
+            break;
+        }
+        if (!pair_ok(&t_pair))
+        {
+            torture_bad = true;
+        }
+        pair_bump(&t_pair);
+        spin_unlock_raw(&t_lock);
+        break;
+
+    case TORTURE_SEQ:
+        write_seqlock(&t_seqlock);
+        pair_bump(&t_pair);
+        write_sequnlock(&t_seqlock);
+        break;
+
+    case TORTURE_WAIT:
+        t_events = t_events + 1;
+        if (t_events == t_target)
+        {
+            wake_up(&t_wq); // exactly one wake-up per round
+        }
+        else if (t_events - t_target == WAIT_WATCHDOG && !wait_queue_empty(&t_wq))
+        {
+            t_lost = true;
+            wake_up(&t_wq);
+        }
+        break;
+    }
+
+    torture_irqs = n + 1;
+}
+
+static void torture_start(torture_t mode)
+{
+    torture_mode = mode;
+    interrupts_set_timer0_hook(torture_hook);
+    timer0_start_periodic(TORTURE_LOAD);
+}
+
+static void torture_stop(void)
+{
+    // Give Timer0 back to the kernel tick
+    T0_CONTROL = 0;
+    interrupts_set_timer0_hook(NULL);
+    interrupts_init_timer0(KTIMER_HZ, 1000000);
+}
+
+// --- Semantics ---
+static int sync_test_atomic_ops(void)
+{
+    atomic_t a = ATOMIC_INIT(5);
+    int ok = atomic_add_return(&a, 3) == 8 &&
+             atomic_fetch_add(&a, -2) == 8 &&
+             atomic_sub_return(&a, 6) == 0 &&
+             atomic_cmpxchg(&a, 1, 9) == 0 && atomic_read(&a) == 0 &&
+             atomic_cmpxchg(&a, 0, 9) == 0 && atomic_read(&a) == 9 &&
+             atomic_xchg(&a, -1) == 9 &&
+             atomic_inc_return(&a) == 0;
+
+    atomic_set(&a, 2);
+    ok = ok && !atomic_dec_and_test(&a) && atomic_dec_and_test(&a);
+
+    int   x = 1, y = 2;
+    void *volatile p = &x;
+    ok = ok && atomic_cmpxchg_ptr(&p, &y, NULL) == &x && p == &x &&
+         atomic_cmpxchg_ptr(&p, &x, &y) == &x && p == &y &&
+         atomic_xchg_ptr(&p, NULL) == &y && p == NULL;
+
+    volatile uint32_t bits[2] = { 0, 0 };
+    set_bit(3, bits);
+    set_bit(35, bits);
+    change_bit(4, bits);
+    clear_bit(3, bits);
+    ok = ok && bits[0] == (1u << 4) && bits[1] == (1u << 3) &&
+         test_bit(35, bits) && !test_bit(3, bits) &&
+         !test_and_set_bit(63, bits) && test_and_set_bit(63, bits) &&
+         test_and_clear_bit(63, bits) && !test_and_clear_bit(63, bits) &&
+         test_and_change_bit(4, bits) && bits[0] == 0;
+
+    return ok;
+}
+
+static int sync_test_spinlock_ops(void)
+{
+    spinlock_t lock = SPINLOCK_INIT;
+
+    spin_lock(&lock);
+    const bool held = spin_is_locked(&lock) && !spin_trylock_raw(&lock);
+    spin_unlock(&lock);
+
+    const bool was_masked = irq_masked();
+    const uint32_t flags  = spin_lock_irqsave(&lock);
+    const bool masked     = irq_masked();
+    spin_unlock_irqrestore(&lock, flags);
+
+    const bool got = spin_trylock(&lock);
+    spin_unlock(&lock);
+
+    // Three acquisitions: three tickets drawn and served
+    return held && masked && irq_masked() == was_masked && got &&
+           !spin_is_locked(&lock) && lock.tickets.owner == 3 && lock.tickets.next == 3;
+}
+
+static int sync_test_seqlock_ops(void)
+{
+    seqlock_t sl = SEQLOCK_INIT;
+
+    const uint32_t s0 = read_seqbegin(&sl);
+    const bool stable = !read_seqretry(&sl, s0);
+
+    const uint32_t s1 = read_seqbegin(&sl);
+    write_seqlock(&sl);
+    const bool odd = (sl.seq.sequence & 1u) != 0;
+    write_sequnlock(&sl);
+
+    return stable && odd && read_seqretry(&sl, s1) &&
+           read_seqbegin(&sl) == s1 + 2 && !spin_is_locked(&sl.lock);
+}
+
+static volatile uint32_t wq_order;
+static volatile uint32_t wq_flag;
+
+static void wq_sleeper(void *arg)
+{
+    const uint32_t id = (uint32_t)(uintptr_t)arg;
+    wait_event(&t_wq, wq_flag >= id);
+    wq_order = wq_order * 10 + id;
+}
+
+static void wq_timer_fn(struct ktimer *timer, void *arg)
+{
+    (void)timer;
+    (void)arg;
+    wq_flag = 1;
+    wake_up(&t_wq);
+}
+
+static int sync_test_waitqueue_ops(void)
+{
+    wq_order = 0;
+    wq_flag  = 0;
+
+    // Higher priority: both are asleep on the queue when create returns
+    struct thread *a = thread_create("wq1", wq_sleeper, (void *)1, THREAD_PRIO_DEFAULT + 1, 0);
+    struct thread *b = thread_create("wq2", wq_sleeper, (void *)2, THREAD_PRIO_DEFAULT + 1, 0);
+
+    // A wake-up with a false condition puts the sleeper back to sleep
+    bool ok = wake_up(&t_wq) && !wait_queue_empty(&t_wq) && wq_order == 0;
+
+    // wq1 went back to sleep behind wq2, and wake-ups are FIFO
+    wq_flag = 2;
+    ok = ok && wake_up_all(&t_wq) == 2;
+    thread_join(a);
+    thread_join(b);
+    ok = ok && wq_order == 21 && wait_queue_empty(&t_wq) && !wake_up(&t_wq);
+
+    // No blocking with preemption off: the caller sleeps in WFI instead
+    struct ktimer timer;
+    wq_flag = 0;
+    ktimer_init(&timer, wq_timer_fn, NULL);
+    ktimer_add(&timer, 2);
+
+    sched_preempt_disable();
+    wait_event(&t_wq, wq_flag != 0);
+    sched_preempt_enable();
+
+    return ok && wait_queue_empty(&t_wq);
+}
+
+// --- Torture ---
+static int sync_test_torture_atomic(void)
+{
+    uint32_t ops = 0;
+
+    torture_start(TORTURE_ATOMIC);
+    while (torture_irqs < TORTURE_IRQS)
+    {
+        atomic_inc(&t_counter);
+        (void)atomic_add_return(&t_ordered, 2);
+        change_bit(16u + (ops & 15u), t_bits); // same word as the IRQ's bits
+        change_bit(16u + (ops & 15u), t_bits);
+        ops++;
+    }
+    torture_stop();
+
+    const uint32_t total = ops + torture_irqs;
+    const uint32_t irq_bits = (torture_irqs & 1u) ? 1u << (((torture_irqs - 1u) >> 1) & 15u) : 0u;
+
+    return !torture_bad &&
+           (uint32_t)atomic_read(&t_counter) == total &&
+           (uint32_t)atomic_read(&t_ordered) == 2u * total &&
+           t_bits[0] == irq_bits;
+}
+
+static int sync_test_torture_spinlock(void)
+{
+    uint32_t ops = 0;
+
+    torture_start(TORTURE_SPIN);
+    while (torture_irqs < TORTURE_IRQS && !torture_bad)
+    {
+        const uint32_t flags = spin_lock_irqsave(&t_lock);
+        if (!pair_ok(&t_pair))
+        {
+            torture_bad = true;
+        }
+        pair_bump(&t_pair);
+        spin_unlock_irqrestore(&t_lock, flags);
+        ops++;
+    }
+    torture_stop();
+
+    const uint32_t total = ops + torture_irqs;
+    return !torture_bad && pair_ok(&t_pair) && t_pair.a == total &&
+           t_lock.tickets.owner == (uint16_t)total && !spin_is_locked(&t_lock);
+}
+
+static int sync_test_torture_seqlock(void)
+{
+    uint32_t reads   = 0;
+    uint32_t retries = 0;
+
+    torture_start(TORTURE_SEQ);
+    while (torture_irqs < TORTURE_IRQS)
+    {
+        uint32_t seq, a, b;
+        do
+        {
+            seq = read_seqbegin(&t_seqlock);
+            a   = t_pair.a;
+            // Widen the window for a writer to land in
+            for (volatile uint32_t spin = 0; spin < 32; spin++)
+            {
+            }
+            b   = t_pair.b;
+            retries++;
+        } while (read_seqretry(&t_seqlock, seq));
+        retries--;
+
+        if (b != ~a)
+        {
+            torture_bad = true;
+        }
+
+        // A second writer, serialised by the lock with IRQs masked
+        if ((++reads & 63u) == 0)
+        {
+            const uint32_t flags = write_seqlock_irqsave(&t_seqlock);
+            pair_bump(&t_pair);
+            write_sequnlock_irqrestore(&t_seqlock, flags);
+        }
+    }
+    torture_stop();
+
+    printf("\r\nsync_seqlock reads=%u retries=%u\r\n", reads, retries);
+    return !torture_bad && retries > 0 && pair_ok(&t_pair) &&
+           t_pair.a == torture_irqs + reads / 64u;
+}
+
+static int sync_test_torture_waitqueue(void)
+{
+    torture_start(TORTURE_WAIT);
+    for (uint32_t i = 0; i < WAIT_ROUNDS && !t_lost; i++)
+    {
+        t_target = t_events + 1u + (i & 3u);
+
+        // Odd rounds sleep in WFI, even rounds block
+        if (i & 1u)
+        {
+            sched_preempt_disable();
+        }
+        wait_event(&t_wq, t_events >= t_target);
+        if (i & 1u)
+        {
+            sched_preempt_enable();
+        }
+    }
+    torture_stop();
+
+    return !t_lost && wait_queue_empty(&t_wq);
+}
+
+// --- Benchmark ---
+static volatile uint32_t pp_turn;
+static volatile bool     pp_stop;
+static struct wait_queue pp_ping = WAIT_QUEUE_INIT;
+static struct wait_queue pp_pong = WAIT_QUEUE_INIT;
+
+static void pong_fn(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        wait_event(&pp_ping, pp_turn == 1 || pp_stop);
+        if (pp_stop)
+        {
+            return;
+        }
+        pp_turn = 0;
+        wake_up(&pp_pong);
+    }
+}
+
+/** Average cycles of `stmt` over BENCH_OPS runs with IRQs masked. */
+#define BENCH(stmt)                                                   \
+    ({                                                                \
+        const uint32_t bench_flags_ = irq_save();                     \
+        const uint32_t bench_t0_    = pmu_cycles();                   \
+        for (uint32_t bench_i_ = 0; bench_i_ < BENCH_OPS; bench_i_++) \
+        {                                                             \
+            stmt;                                                     \
+        }                                                             \
+        const uint32_t bench_c_ = pmu_cycles() - bench_t0_;           \
+        irq_restore(bench_flags_);                                    \
+        bench_c_ / BENCH_OPS;                                         \
+    })
+
+static int sync_test_benchmark(void)
+{
+    atomic_t   a    = ATOMIC_INIT(0);
+    spinlock_t lock = SPINLOCK_INIT;
+    seqcount_t seq  = SEQCOUNT_INIT;
+    volatile uint32_t bits[1] = { 0 };
+    volatile uint32_t sink = 0;
+
+    pmu_init();
+
+    const uint32_t irqsave_cyc = BENCH(irq_restore(irq_save()));
+    const uint32_t add_cyc     = BENCH(atomic_add(&a, 1));
+    const uint32_t add_ret_cyc = BENCH(sink = (uint32_t)atomic_add_return(&a, 1));
+    const uint32_t cmpxchg_cyc = BENCH(sink = (uint32_t)atomic_cmpxchg(&a, atomic_read(&a), 0));
+    const uint32_t tas_cyc     = BENCH(sink = test_and_set_bit(3, bits));
+    const uint32_t raw_cyc     = BENCH(spin_lock_raw(&lock); spin_unlock_raw(&lock));
+    const uint32_t irq_cyc     = BENCH(const uint32_t f = spin_lock_irqsave(&lock); spin_unlock_irqrestore(&lock, f));
+    const uint32_t spin_cyc    = BENCH(spin_lock(&lock); spin_unlock(&lock));
+    const uint32_t seq_cyc     = BENCH(uint32_t s; do { s = read_seqcount_begin(&seq); sink = bits[0]; }
+                                       while (read_seqcount_retry(&seq, s)));
+
+    // Wait queue round trip: wake a higher-priority thread, get woken back
+    pp_turn = 0;
+    pp_stop = false;
+    struct thread *pong = thread_create("pong", pong_fn, NULL, THREAD_PRIO_DEFAULT + 1, 0);
+
+    const uint32_t t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_ROUND_TRIPS; i++)
+    {
+        pp_turn = 1;
+        wake_up(&pp_ping);
+        wait_event(&pp_pong, pp_turn == 0);
+    }
+    const uint32_t rt_cyc = (pmu_cycles() - t0) / BENCH_ROUND_TRIPS;
+
+    pp_stop = true;
+    wake_up(&pp_ping);
+    thread_join(pong);
+    (void)sink;
+
+    printf("\r\nsync_bench irqsave_cyc=%u atomic_add_cyc=%u atomic_add_return_cyc=%u cmpxchg_cyc=%u "
+           "test_and_set_bit_cyc=%u spin_raw_cyc=%u spin_irqsave_cyc=%u spin_cyc=%u seq_read_cyc=%u "
+           "wait_wake_rt_cyc=%u\r\n",
+           irqsave_cyc, add_cyc, add_ret_cyc, cmpxchg_cyc, tas_cyc, raw_cyc, irq_cyc, spin_cyc, seq_cyc,
+           rt_cyc);
+    return 1;
+}
+
+// --- Main test runner ---
+int sync_test(void)
+{
+    KLOG(KLOG_INFO, "Running sync tests...");
+
+    int (*tests[])(void) = {
+        sync_test_atomic_ops,
+        sync_test_spinlock_ops,
+        sync_test_seqlock_ops,
+        sync_test_waitqueue_ops,
+        sync_test_torture_atomic,
+        sync_test_torture_spinlock,
+        sync_test_torture_seqlock,
+        sync_test_torture_waitqueue,
+        sync_test_benchmark,
+    };
+
+    const char *names[] = {
+        "atomic_ops",
+        "spinlock_ops",
+        "seqlock_ops",
+        "waitqueue_ops",
+        "torture_atomic",
+        "torture_spinlock",
+        "torture_seqlock",
+        "torture_waitqueue",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nsync_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
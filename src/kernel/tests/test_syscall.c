@@ -0,0 +1,166 @@
+/**
+ * @file test_syscall.c
+ * @brief SVC dispatch tests and system call round-trip benchmark.
+ */
+#include "tests.h"
+#include "syscall.h"
+#include "thread.h"
+#include "datetime.h"
+#include "uart.h"
+#include "printf.h"
+#include "pmu.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_CALLS  2000u
+#define BENCH_WRITES 32u
+
+// --- Dispatch ---
+static int syscall_test_null(void)
+{
+    return syscall0(SYS_NULL) == 0;
+}
+
+static int syscall_test_bad_number(void)
+{
+    return syscall0(SYS_COUNT) == KERR_NOSYS &&
+           syscall0(0xFFFFFFFFu) == KERR_NOSYS;
+}
+
+static int syscall_test_preserves_r4_r5(void)
+{
+    register uint32_t r4 __asm__("r4") = 0x44444444u;
+    register uint32_t r5 __asm__("r5") = 0x55555555u;
+    register uint32_t r7 __asm__("r7") = SYS_NULL;
+
+    __asm__ volatile("svc #0"
+                     : "+r"(r4), "+r"(r5)
+                     : "r"(r7)
+                     : "r0", SYSCALL_CLOBBERS);
+    return r4 == 0x44444444u && r5 == 0x55555555u;
+}
+
+static int syscall_test_write(void)
+{
+    return sys_write("", 0) == 0 &&
+           sys_write(NULL, 4) == KERR_INVAL &&
+           sys_write("ok ", 3) == 3;
+}
+
+static int syscall_test_time(void)
+{
+    const uint32_t now = (uint32_t)syscall0(SYS_TIME);
+    const uint32_t ref = datetime_now();
+    return now == ref || now + 1 == ref;
+}
+
+static volatile bool peer_ran;
+
+static void peer_fn(void *arg)
+{
+    (void)arg;
+    peer_ran = true;
+}
+
+static int syscall_test_yield_switches(void)
+{
+    // The switch happens inside the handler; the return state must survive it
+    peer_ran = false;
+    struct thread *peer = thread_create("peer", peer_fn, NULL, THREAD_PRIO_DEFAULT, 0);
+
+    const int32_t ret = syscall0(SYS_YIELD);
+    const bool    ran = peer_ran;
+
+    thread_join(peer);
+    return ret == 0 && ran;
+}
+
+// --- Benchmark ---
+static int syscall_test_benchmark(void)
+{
+    const syscall_fn_t volatile direct = syscall_table[SYS_NULL];
+    uint32_t t0;
+
+    pmu_init();
+
+    t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_CALLS; i++)
+    {
+        syscall0(SYS_NULL);
+    }
+    const uint32_t null_cyc = (pmu_cycles() - t0) / BENCH_CALLS;
+
+    t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_CALLS; i++)
+    {
+        direct(0, 0, 0, 0, 0, 0);
+    }
+    const uint32_t call_cyc = (pmu_cycles() - t0) / BENCH_CALLS;
+
+    uart_flush();
+    t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_WRITES; i++)
+    {
+        sys_write(".", 1);
+    }
+    const uint32_t write_cyc = (pmu_cycles() - t0) / BENCH_WRITES;
+
+    uart_flush();
+    t0 = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_WRITES; i++)
+    {
+        uart_write(".", 1);
+    }
+    const uint32_t uart_cyc = (pmu_cycles() - t0) / BENCH_WRITES;
+
+    printf("\r\nsyscall_bench null_cyc=%u call_cyc=%u write_cyc=%u uart_write_cyc=%u\r\n",
+           null_cyc, call_cyc, write_cyc, uart_cyc);
+    return 1;
+}
+
+// --- Main test runner ---
+int syscall_test(void)
+{
+    KLOG(KLOG_INFO, "Running syscall tests...");
+
+    int (*tests[])(void) = {
+        syscall_test_null,
+        syscall_test_bad_number,
+        syscall_test_preserves_r4_r5,
+        syscall_test_write,
+        syscall_test_time,
+        syscall_test_yield_switches,
+        syscall_test_benchmark,
+    };
+
+    const char *names[] = {
+        "null",
+        "bad_number",
+        "preserves_r4_r5",
+        "write",
+        "time",
+        "yield_switches",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        int result = tests[i]();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nsyscall_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ * @file test_thread.c
+ * @brief Scheduler tests: priorities, round-robin, tick preemption, sleep.
+ *
+ * Also reports the cost of a thread_yield() context switch in PMU cycles.
+ */
+#include "tests.h"
+#include "thread.h"
+#include "clock.h"
+#include "printf.h"
+#include "pmu.h"
+#include "string.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_SWITCHES 2000u
+
+static char     order[16];
+static uint32_t order_len;
+
+static void note(char c)
+{
+    if (order_len < sizeof(order) - 1)
+    {
+        order[order_len++] = c;
+        order[order_len]   = '\0';
+    }
+}
+
+static void note_fn(void *arg)
+{
+    note((char)(uintptr_t)arg);
+}
+
+// --- Setup and teardown ---
+static void setup(void)
+{
+    order_len = 0;
+    order[0]  = '\0';
+}
+
+static void tear_down(void)
+{
+}
+
+// --- Life cycle ---
+static int thread_test_create_join(void)
+{
+    struct thread *t = thread_create("note", note_fn, (void *)'x', THREAD_PRIO_DEFAULT, 0);
+    thread_join(t);
+    return strcmp(order, "x") == 0 && thread_current()->state == THREAD_RUNNING;
+}
+
+static int thread_test_priority_preempts(void)
+{
+    // Higher priority runs before thread_create() returns
+    struct thread *hi = thread_create("hi", note_fn, (void *)'H', THREAD_PRIO_DEFAULT + 1, 0);
+    note('M');
+    // Lower priority waits until main blocks
+    struct thread *lo = thread_create("lo", note_fn, (void *)'L', THREAD_PRIO_DEFAULT - 1, 0);
+    note('M');
+
+    thread_join(hi);
+    thread_join(lo);
+    return strcmp(order, "HMML") == 0;
+}
+
+static int thread_test_bitmap_order(void)
+{
+    struct thread *self = thread_current();
+    thread_set_prio(self, THREAD_PRIO_MAX);
+
+    struct thread *t[4] = {
+        thread_create("p5",  note_fn, (void *)'a', 5, 0),
+        thread_create("p25", note_fn, (void *)'b', 25, 0),
+        thread_create("p12", note_fn, (void *)'c', 12, 0),
+        thread_create("p25", note_fn, (void *)'d', 25, 0),
+    };
+
+    thread_set_prio(self, THREAD_PRIO_IDLE + 1); // everything else runs now
+    thread_set_prio(self, THREAD_PRIO_DEFAULT);
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        thread_join(t[i]);
+    }
+    return strcmp(order, "bdca") == 0;
+}
+
+// --- Round-robin ---
+static void yield_fn(void *arg)
+{
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        note((char)(uintptr_t)arg);
+        thread_yield();
+    }
+}
+
+static int thread_test_round_robin_yield(void)
+{
+    struct thread *a = thread_create("A", yield_fn, (void *)'A', THREAD_PRIO_DEFAULT, 0);
+    struct thread *b = thread_create("B", yield_fn, (void *)'B', THREAD_PRIO_DEFAULT, 0);
+
+    thread_join(a);
+    thread_join(b);
+    return strcmp(order, "ABABAB") == 0;
+}
+
+static volatile uint64_t spin_deadline;
+
+static void spin_fn(void *arg)
+{
+    volatile uint32_t *count = arg;
+    while (clock_monotonic_us() < spin_deadline)
+    {
+        *count = *count + 1;
+    }
+}
+
+static int thread_test_tick_preemption(void)
+{
+    // Neither thread yields; once main blocks in join, only the tick can
+    // share the CPU between them
+    volatile uint32_t count_a = 0;
+    volatile uint32_t count_b = 0;
+    const uint64_t switches   = sched_switch_count();
+
+    spin_deadline = clock_monotonic_us() + 100000u;
+    struct thread *a = thread_create("spinA", spin_fn, (void *)&count_a, THREAD_PRIO_DEFAULT, 0);
+    struct thread *b = thread_create("spinB", spin_fn, (void *)&count_b, THREAD_PRIO_DEFAULT, 0);
+
+    thread_join(a);
+    thread_join(b);
+
+    printf("(a=%u b=%u switches=%u) ", count_a, count_b,
+           (uint32_t)(sched_switch_count() - switches));
+    return count_a > 0 && count_b > 0;
+}
+
+static int thread_test_sleep(void)
+{
+    const uint64_t start = clock_monotonic_us();
+    thread_sleep_ms(30);
+    const uint64_t slept = clock_monotonic_us() - start;
+
+    // The first tick may come early; the wake is never a tick short of that
+    return slept >= 20000u && slept < 200000u;
+}
+
+// --- Benchmark ---
+static void pingpong_fn(void *arg)
+{
+    for (uint32_t i = 0; i < (uint32_t)(uintptr_t)arg; i++)
+    {
+        thread_yield();
+    }
+}
+
+static int thread_test_benchmark(void)
+{
+    pmu_init();
+
+    struct thread *peer = thread_create("pong", pingpong_fn, (void *)(uintptr_t)BENCH_SWITCHES,
+                                        THREAD_PRIO_DEFAULT, 0);
+
+    const uint64_t switches = sched_switch_count();
+    const uint32_t t0       = pmu_cycles();
+    for (uint32_t i = 0; i < BENCH_SWITCHES; i++)
+    {
+        thread_yield();
+    }
+    const uint32_t cycles = pmu_cycles() - t0;
+    const uint32_t n      = (uint32_t)(sched_switch_count() - switches);
+
+    thread_join(peer);
+
+    printf("\r\nsched_bench yield_switch_cyc=%u switches=%u\r\n", n ? cycles / n : 0, n);
+    return n >= BENCH_SWITCHES;
+}
+
+// --- Main test runner ---
+int thread_test(void)
+{
+    KLOG(KLOG_INFO, "Running thread tests...");
+
+    int (*tests[])(void) = {
+        thread_test_create_join,
+        thread_test_priority_preempts,
+        thread_test_bitmap_order,
+        thread_test_round_robin_yield,
+        thread_test_tick_preemption,
+        thread_test_sleep,
+        thread_test_benchmark,
+    };
+
+    const char *names[] = {
+        "create_join",
+        "priority_preempts",
+        "bitmap_order",
+        "round_robin_yield",
+        "tick_preemption",
+        "sleep",
+        "benchmark",
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int test_passed = 0;
+
+    for (int i = 0; i < num_tests; i++)
+    {
+        printf("Running test %d (%s): ", i, names[i]);
+        setup();
+        int result = tests[i]();
+        tear_down();
+
+        if (!result)
+        {
+            KLOG(KLOG_ERROR, "FAILED");
+            return 1;
+        }
+        KLOG(KLOG_INFO, "PASSED");
+        test_passed++;
+    }
+    KLOG(KLOG_INFO, "\nthread_test() -> %d/%d tests passed!\n\n", test_passed, num_tests);
+    return 0;
+}
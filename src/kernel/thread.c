@@ -0,0 +1,511 @@
+/**
+ * @file thread.c
+ * @brief Kernel threads: run queues, priority bitmap and preemption points.
+ *
+ * All scheduler state is touched with IRQs masked. schedule() runs in the
+ * context of the outgoing thread and returns once that thread is switched
+ * back in; a thread that was preempted returns through sched_irq_exit()
+ * and irq_entry, one that yielded or blocked returns to its caller.
+ */
+#include "thread.h"
+#include "interrupt.h"
+#include "memory.h"
+#include "mmu.h"
+#include "cpustat.h"
+#include "kstat.h"
+#include "panic.h"
+#include "log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Words pushed by context_switch(): r4-r12 and lr. */
+#define CONTEXT_WORDS 10u
+
+static struct thread  main_thread;
+static struct thread *current = NULL;
+static struct thread *idle_thread = NULL;
+static struct thread *all_threads = NULL;
+
+static struct thread *rq_head[THREAD_PRIO_LEVELS];
+static struct thread *rq_tail[THREAD_PRIO_LEVELS];
+static uint32_t       rq_bitmap = 0; /**< Bit p set: priority p has ready threads. */
+
+static volatile bool     need_resched  = false;
+static volatile uint32_t preempt_count = 0;
+static uint32_t          next_id       = 0;
+
+KSTAT_DEFINE(sched_switches); // all scheduler state is written with IRQs masked
+KSTAT_DEFINE(sched_preemptions);
+KSTAT_GAUGE_DEFINE(sched_threads);
+
+// --- Run queues ---
+
+static void rq_push(struct thread *t)
+{
+    const uint32_t p = t->prio;
+
+    t->next = NULL;
+    if (rq_tail[p])
+    {
+        rq_tail[p]->next = t;
+    }
+    else
+    {
+        rq_head[p] = t;
+    }
+    rq_tail[p] = t;
+    rq_bitmap |= 1u << p;
+}
+
+static struct thread *rq_pop(uint32_t p)
+{
+    struct thread *t = rq_head[p];
+
+    rq_head[p] = t->next;
+    if (rq_head[p] == NULL)
+    {
+        rq_tail[p] = NULL;
+        rq_bitmap &= ~(1u << p);
+    }
+    t->next = NULL;
+    return t;
+}
+
+static void rq_remove(struct thread *t)
+{
+    const uint32_t p = t->prio;
+    struct thread *prev = NULL;
+
+    for (struct thread *it = rq_head[p]; it; prev = it, it = it->next)
+    {
+        if (it != t)
+        {
+            continue;
+        }
+
+        if (prev)
+        {
+            prev->next = t->next;
+        }
+        else
+        {
+            rq_head[p] = t->next;
+        }
+        if (rq_tail[p] == t)
+        {
+            rq_tail[p] = prev;
+        }
+        if (rq_head[p] == NULL)
+        {
+            rq_bitmap &= ~(1u << p);
+        }
+        t->next = NULL;
+        return;
+    }
+}
+
+/** Highest ready priority, or -1 when every run queue is empty. */
+static inline int rq_highest(void)
+{
+    return rq_bitmap ? 31 - __builtin_clz(rq_bitmap) : -1;
+}
+
+// --- Switching ---
+
+/** Store the banked USR sp/lr; `^` selects the user bank from SVC mode. */
+static inline void usr_regs_save(struct thread *t)
+{
+    __asm__ volatile("stmia %0, {sp, lr}^" :: "r"(t->usr_regs) : "memory");
+}
+
+static inline void usr_regs_load(const struct thread *t)
+{
+    __asm__ volatile("ldmia %0, {sp, lr}^\n\t"
+                     "nop" :: "r"(t->usr_regs) : "memory");
+}
+
+/**
+ * @internal
+ * @brief Pick the next thread and switch to it. IRQs must be masked.
+ *
+ * A running `current` keeps the CPU unless a thread of the same or higher
+ * priority is ready; on a tie it goes to the back of its queue.
+ */
+static void schedule(void)
+{
+    struct thread *prev = current;
+
+    need_resched = false;
+
+    if (prev->state == THREAD_RUNNING)
+    {
+        if (rq_highest() < (int)prev->prio)
+        {
+            prev->slice = THREAD_SLICE_TICKS;
+            return;
+        }
+        prev->state = THREAD_READY;
+        rq_push(prev);
+    }
+
+    // The idle thread is always ready when nothing else is
+    struct thread *next = rq_pop((uint32_t)rq_highest());
+    next->state = THREAD_RUNNING;
+    next->slice = THREAD_SLICE_TICKS;
+
+    if (next == prev)
+    {
+        return;
+    }
+
+    next->switches++;
+    kstat_inc(sched_switches);
+    cpustat_switch(prev, next); // charges `prev`: before `current` moves
+    current = next;
+
+    if (prev->mm)
+    {
+        usr_regs_save(prev);
+    }
+    if (next->mm)
+    {
+        usr_regs_load(next);
+        if (next->mm != mmu_active())
+        {
+            mmu_switch(next->mm); // ASID-tagged: no TLB flush
+        }
+    }
+    context_switch(prev, next);
+}
+
+/** Switch now if something asked for it and it is allowed here. */
+static inline void resched_if_needed(void)
+{
+    if (need_resched && preempt_count == 0 && !in_irq())
+    {
+        schedule();
+    }
+}
+
+// --- Thread life cycle ---
+
+/**
+ * @internal
+ * @brief First code a new thread runs, "returned" to by context_switch().
+ */
+static void thread_entry(void)
+{
+    irq_enable(); // schedule() switched to us with IRQs masked
+
+    struct thread *self = current;
+    self->fn(self->arg);
+    thread_exit();
+}
+
+static void thread_sleep_expired(struct ktimer *timer, void *arg)
+{
+    (void)timer;
+    thread_wake(arg);
+}
+
+static void idle_loop(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        kmalloc_irq_maintain(); // nothing else is ready: reload the IRQ caches now
+        cpustat_wfi();
+    }
+}
+
+static void thread_setup(struct thread *t, const char *name, uint32_t prio)
+{
+    uint32_t i = 0;
+    for (; name && name[i] && i < THREAD_NAME_MAX - 1; i++)
+    {
+        t->name[i] = name[i];
+    }
+    t->name[i] = '\0';
+
+    t->prio     = (uint8_t)prio;
+    t->slice    = THREAD_SLICE_TICKS;
+    t->id       = next_id++;
+    t->next     = NULL;
+    t->joiner   = NULL;
+    t->switches = 0;
+    t->mm       = NULL;
+    t->cpu_cycles = 0;
+    t->cpu_state  = CPU_THREAD;
+    ktimer_init(&t->sleep, thread_sleep_expired, t);
+
+    const uint32_t flags = irq_save();
+    t->all_next = all_threads;
+    all_threads = t;
+    kstat_inc(sched_threads);
+    irq_restore(flags);
+}
+
+static struct thread *thread_spawn(const char *name, thread_fn_t fn, void *arg,
+                                   uint32_t prio, size_t stack_size)
+{
+    if (stack_size == 0)
+    {
+        stack_size = THREAD_STACK_DEFAULT;
+    }
+    stack_size = (stack_size + 7u) & ~(size_t)7u;
+
+    struct thread *t = kmalloc(sizeof(*t));
+    t->stack      = kmalloc(stack_size);
+    t->stack_size = stack_size;
+    t->fn         = fn;
+    t->arg        = arg;
+    thread_setup(t, name, prio);
+
+    // Initial frame as context_switch() leaves it: r4-r12, then lr
+    uint32_t *top = (uint32_t *)(((uintptr_t)t->stack + stack_size) & ~(uintptr_t)7u);
+    uint32_t *sp  = top - CONTEXT_WORDS;
+    for (uint32_t w = 0; w < CONTEXT_WORDS - 1; w++)
+    {
+        sp[w] = 0;
+    }
+    sp[CONTEXT_WORDS - 1] = (uint32_t)(uintptr_t)thread_entry;
+    t->sp = sp;
+
+    const uint32_t flags = irq_save();
+    t->state = THREAD_READY;
+    rq_push(t);
+    if (current && prio > current->prio)
+    {
+        need_resched = true;
+        resched_if_needed();
+    }
+    irq_restore(flags);
+
+    return t;
+}
+
+void sched_init(void)
+{
+    thread_setup(&main_thread, "main", THREAD_PRIO_DEFAULT);
+    main_thread.state = THREAD_RUNNING;
+    current = &main_thread;
+
+    idle_thread = thread_spawn("idle", idle_loop, NULL, THREAD_PRIO_IDLE, 0); // interrupts run on it
+
+    KLOGS(KLOG_SYS_KERNEL, KLOG_DEBUG, "scheduler up, %u priority levels", THREAD_PRIO_LEVELS);
+}
+
+struct thread *thread_create(const char *name, thread_fn_t fn, void *arg,
+                             uint32_t prio, size_t stack_size)
+{
+    if (prio < THREAD_PRIO_IDLE + 1)
+    {
+        prio = THREAD_PRIO_IDLE + 1;
+    }
+    if (prio > THREAD_PRIO_MAX)
+    {
+        prio = THREAD_PRIO_MAX;
+    }
+    return thread_spawn(name, fn, arg, prio, stack_size);
+}
+
+struct thread *thread_current(void)
+{
+    return current;
+}
+
+void thread_yield(void)
+{
+    const uint32_t flags = irq_save();
+    if (current && preempt_count == 0)
+    {
+        schedule();
+    }
+    irq_restore(flags);
+}
+
+void thread_block(void)
+{
+    const uint32_t flags = irq_save();
+    if (preempt_count != 0)
+    {
+        kernel_panic("thread_block: preemption disabled", KERR_INVAL);
+    }
+    current->state = THREAD_BLOCKED;
+    schedule();
+    irq_restore(flags);
+}
+
+bool thread_wake(struct thread *t)
+{
+    const uint32_t flags = irq_save();
+
+    if (t->state != THREAD_BLOCKED)
+    {
+        irq_restore(flags);
+        return false;
+    }
+
+    t->state = THREAD_READY;
+    rq_push(t);
+    if (t->prio > current->prio)
+    {
+        need_resched = true;
+        resched_if_needed();
+    }
+
+    irq_restore(flags);
+    return true;
+}
+
+void thread_sleep_ms(uint32_t ms)
+{
+    const uint32_t flags = irq_save();
+    ktimer_add(&current->sleep, ktimer_ms_to_ticks(ms));
+    thread_block();
+    irq_restore(flags);
+}
+
+void thread_exit(void)
+{
+    irq_disable();
+
+    struct thread *self = current;
+    ktimer_del(&self->sleep);
+    self->state = THREAD_DEAD;
+    if (self->joiner)
+    {
+        thread_wake(self->joiner);
+    }
+    schedule();
+
+    kernel_panic("thread_exit: dead thread resumed", KERR_INVAL);
+}
+
+void thread_join(struct thread *t)
+{
+    const uint32_t flags = irq_save();
+    while (t->state != THREAD_DEAD)
+    {
+        t->joiner = current;
+        thread_block();
+    }
+
+    struct thread **link = &all_threads;
+    while (*link != t)
+    {
+        link = &(*link)->all_next;
+    }
+    *link = t->all_next;
+    kstat_sub(sched_threads, 1);
+    irq_restore(flags);
+
+    kfree(t->stack);
+    kfree(t);
+}
+
+void thread_for_each(void (*fn)(struct thread *t, void *arg), void *arg)
+{
+    const uint32_t flags = irq_save();
+    for (struct thread *t = all_threads; t; t = t->all_next)
+    {
+        fn(t, arg);
+    }
+    irq_restore(flags);
+}
+
+void thread_set_prio(struct thread *t, uint32_t prio)
+{
+    if (prio > THREAD_PRIO_MAX)
+    {
+        prio = THREAD_PRIO_MAX;
+    }
+
+    const uint32_t flags = irq_save();
+
+    if (t->state == THREAD_READY)
+    {
+        rq_remove(t);
+        t->prio = (uint8_t)prio;
+        rq_push(t);
+    }
+    else
+    {
+        t->prio = (uint8_t)prio;
+    }
+
+    if (rq_highest() > (int)current->prio)
+    {
+        need_resched = true;
+        resched_if_needed();
+    }
+
+    irq_restore(flags);
+}
+
+void thread_attach_mm(struct mm *mm)
+{
+    const uint32_t flags = irq_save();
+    current->mm = mm;
+    mmu_switch(mm);
+    irq_restore(flags);
+}
+
+// --- Preemption ---
+
+void sched_preempt_disable(void)
+{
+    const uint32_t flags = irq_save();
+    preempt_count = preempt_count + 1;
+    irq_restore(flags);
+}
+
+void sched_preempt_enable(void)
+{
+    const uint32_t flags = irq_save();
+    preempt_count = preempt_count - 1;
+    if (current)
+    {
+        resched_if_needed();
+    }
+    irq_restore(flags);
+}
+
+bool sched_can_block(void)
+{
+    return current && preempt_count == 0 && !in_irq();
+}
+
+void sched_tick(void)
+{
+    struct thread *self = current;
+    if (!self)
+    {
+        return;
+    }
+
+    if (self->slice)
+    {
+        self->slice--;
+    }
+    if (self->slice == 0 && rq_highest() >= (int)self->prio)
+    {
+        need_resched = true;
+    }
+}
+
+void sched_irq_exit(void)
+{
+    if (current && need_resched && preempt_count == 0)
+    {
+        kstat_inc(sched_preemptions);
+        schedule();
+    }
+}
+
+uint64_t sched_switch_count(void)
+{
+    return kstat_read(sched_switches);
+}
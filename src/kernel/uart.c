@@ -0,0 +1,454 @@
+/**
+ * @file uart.c
+ * @brief Interrupt-driven PL011 UART0 transmit and receive paths.
+ *
+ * Transmit uses a multi-producer ring: any context (thread or IRQ handler)
+ * claims space and copies its bytes in without locking. The pump that moves
+ * bytes into the hardware FIFO is the single consumer; it runs from the TX
+ * interrupt, or under irq_save() when a writer kicks an idle transmitter.
+ *
+ * The TX interrupt is only unmasked while the ring holds data, so an idle
+ * console costs nothing.
+ *
+ * Receive uses a single-producer ring: the RX/RX-timeout interrupt is the
+ * only producer and the thread reading input the only consumer. A reader
+ * with nothing to read leaves the run queue on a wait queue until the
+ * interrupt delivers.
+ *
+ * A DMA write owns the TX FIFO while it runs: the pump leaves the ring
+ * alone until the transfer completes, so bytes never interleave.
+ */
+#include "uart.h"
+#include "interrupt.h"
+#include "ringbuf.h"
+#include "dma.h"
+#include "fiber.h"
+#include "waitqueue.h"
+#include "ktimer.h"
+#include "kstat.h"
+#include "log.h"
+#include "utils.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static uint8_t        tx_storage[UART_TX_RING_SIZE];
+static struct ringbuf tx_ring     = RINGBUF_STATIC_INIT(tx_storage);
+static volatile bool  tx_irq_on   = false;
+static volatile bool  uart_polled = true; // polled until uart_init()
+
+static uint8_t           rx_storage[UART_RX_RING_SIZE];
+static struct ringbuf    rx_ring    = RINGBUF_STATIC_INIT(rx_storage);
+static struct fiber_event rx_event  = FIBER_EVENT_INIT;
+static struct wait_queue rx_wq      = WAIT_QUEUE_INIT;
+
+static int               tx_dma_channel = -1;
+static volatile bool     tx_dma_active  = false;
+static bool              tx_dma_stalled = false; // DMA never moved data: use the ring
+static dma_lli_t         tx_dma_lli[UART_DMA_MAX_LLI];
+static uintptr_t         tx_dma_base;
+static size_t            tx_dma_len;
+static uint32_t          tx_dma_last_src;
+static uart_dma_done_t   tx_dma_done;
+static void             *tx_dma_arg;
+static struct ktimer     tx_dma_watchdog;
+
+KSTAT_DEFINE(uart_rx_bytes);   // RX pump: the interrupt, or a reader with IRQs masked
+KSTAT_DEFINE(uart_rx_dropped);
+KSTAT_DEFINE(uart_tx_bytes);   // any context
+KSTAT_DEFINE(uart_tx_dma_bytes);
+
+static inline void uart_poll_putc(char c)
+{
+    // Wait until UART transmit FIFO is not full
+    while (UART0_FR & UART_FR_TXFF) {}
+    UART0_DR = (uint32_t)c;
+}
+
+/**
+ * @internal
+ * @brief Move queued bytes into the TX FIFO until it is full or the ring empty.
+ *
+ * Keeps the TX interrupt unmasked exactly while bytes remain queued.
+ * Caller runs with IRQs masked (or is the UART interrupt itself).
+ */
+static void uart_tx_pump(void)
+{
+    const void *span;
+    uint32_t    len;
+
+    if (tx_dma_active)
+    {
+        return; // the DMA transfer owns the FIFO; its completion restarts us
+    }
+
+    while ((len = ringbuf_read_peek(&tx_ring, &span)) != 0)
+    {
+        const char *p = (const char *)span;
+        uint32_t    n = 0;
+
+        while (n < len && !(UART0_FR & UART_FR_TXFF))
+        {
+            UART0_DR = (uint32_t)p[n++];
+        }
+        ringbuf_read_commit(&tx_ring, n);
+
+        if (n < len)
+        {
+            break; // FIFO full
+        }
+    }
+
+    if (!ringbuf_empty(&tx_ring))
+    {
+        if (!tx_irq_on)
+        {
+            UART0_IMSC |= UART_INT_TX;
+            tx_irq_on   = true;
+        }
+    }
+    else if (tx_irq_on)
+    {
+        UART0_IMSC &= ~UART_INT_TX;
+        tx_irq_on   = false;
+    }
+}
+
+/**
+ * @internal
+ * @brief Start the transmitter if the TX interrupt is not already draining.
+ */
+static inline void uart_tx_kick(void)
+{
+    if (!tx_irq_on)
+    {
+        const uint32_t flags = irq_save();
+        uart_tx_pump();
+        irq_restore(flags);
+    }
+}
+
+/**
+ * @internal
+ * @brief Empty the RX FIFO into the RX ring.
+ *
+ * Runs from the RX interrupt, or from a reader polling with IRQs masked.
+ */
+static void uart_rx_pump(void)
+{
+    while (!(UART0_FR & UART_FR_RXFE))
+    {
+        const uint8_t c = (uint8_t)(UART0_DR & 0xFF);
+        kstat_inc(uart_rx_bytes);
+        if (!ringbuf_put(&rx_ring, c))
+        {
+            kstat_inc(uart_rx_dropped);
+        }
+    }
+}
+
+void uart_init(void)
+{
+    UART0_CR   = 0;                               // disable while reconfiguring
+    UART0_LCRH = UART_LCRH_WLEN8 | UART_LCRH_FEN; // 8N1, FIFOs on
+    UART0_IFLS = UART_IFLS_TX_HALF | UART_IFLS_RX_HALF;
+    UART0_ICR  = 0x7FF;                           // clear anything stale
+    UART0_IMSC = UART_INT_RX | UART_INT_RT;       // TX is unmasked on demand
+    UART0_CR   = UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE;
+
+    vic_enable_irq(IRQ_UART0);
+
+    tx_irq_on   = false;
+    uart_polled = false;
+
+    KLOGS(KLOG_SYS_UART, KLOG_DEBUG, "uart0 irq driven, tx ring %u, rx ring %u",
+          UART_TX_RING_SIZE, UART_RX_RING_SIZE);
+}
+
+void uart_write(const char *buf, size_t len)
+{
+    kstat_add_atomic(uart_tx_bytes, len);
+
+    if (uart_polled)
+    {
+        while (len--)
+        {
+            uart_poll_putc(*buf++);
+        }
+        return;
+    }
+
+    while (len)
+    {
+        const uint32_t n = (uint32_t)MIN((size_t)ringbuf_free(&tx_ring), len);
+
+        if (n != 0 && ringbuf_mp_write(&tx_ring, buf, n))
+        {
+            buf += n;
+            len -= n;
+            uart_tx_kick();
+            continue;
+        }
+
+        if (irq_masked())
+        {
+            // Ring full and the TX interrupt cannot run: drain by polling
+            while (UART0_FR & UART_FR_TXFF) {}
+            uart_tx_pump();
+        }
+        // else: the TX interrupt is draining, retry
+    }
+}
+
+/**
+ * @internal
+ * @brief Stop the DMA transfer and give the FIFO back to the ring.
+ *
+ * Halting lets the channel FIFO drain into the UART first, so everything
+ * before the channel's current source address has been sent.
+ *
+ * @return Unsent bytes, starting at `*rest`.
+ */
+static size_t uart_dma_stop(const char **rest)
+{
+    ktimer_del(&tx_dma_watchdog);
+    dma_abort(tx_dma_channel);
+    UART0_DMACR &= ~UART_DMACR_TXDMAE;
+
+    const uintptr_t end = tx_dma_base + tx_dma_len;
+    uintptr_t       src = dma_current_src(tx_dma_channel);
+    if (src < tx_dma_base || src > end)
+    {
+        src = tx_dma_base;
+    }
+
+    tx_dma_active = false;
+    *rest = (const char *)src;
+    return end - src;
+}
+
+static void uart_dma_complete(int channel, kerror_t status, void *arg)
+{
+    (void)channel;
+    (void)arg;
+
+    ktimer_del(&tx_dma_watchdog);
+    UART0_DMACR  &= ~UART_DMACR_TXDMAE;
+    tx_dma_active = false;
+    uart_tx_pump(); // ring output that queued up behind the transfer
+
+    if (tx_dma_done)
+    {
+        tx_dma_done(status, tx_dma_arg);
+    }
+}
+
+// Runs every UART_DMA_WATCHDOG_MS while a transfer is in flight.
+static void uart_dma_watchdog(struct ktimer *timer, void *arg)
+{
+    (void)timer;
+    (void)arg;
+
+    const uint32_t src = dma_current_src(tx_dma_channel);
+    if (!tx_dma_active || src != tx_dma_last_src)
+    {
+        tx_dma_last_src = src;
+        return;
+    }
+
+    // No progress for a whole period: DMA requests are not reaching the
+    // controller (e.g. an emulator without peripheral flow control).
+    const char  *rest;
+    const size_t left = uart_dma_stop(&rest);
+    tx_dma_stalled = true;
+    KLOGS(KLOG_SYS_UART, KLOG_WARN, "tx dma stalled, falling back to the ring");
+
+    uart_write(rest, left);
+    if (tx_dma_done)
+    {
+        tx_dma_done(KERR_OK, tx_dma_arg);
+    }
+}
+
+kerror_t uart_write_dma(const void *buf, size_t len, uart_dma_done_t done, void *arg)
+{
+    if (buf == NULL || len == 0 || len > (size_t)UART_DMA_MAX_LLI * DMA_CTRL_SIZE_MAX)
+    {
+        return KERR_INVAL;
+    }
+    if (tx_dma_active)
+    {
+        return KERR_BUSY;
+    }
+
+    if (tx_dma_channel < 0 && !uart_polled && !tx_dma_stalled)
+    {
+        tx_dma_channel = dma_channel_alloc();
+        ktimer_init(&tx_dma_watchdog, uart_dma_watchdog, NULL);
+    }
+
+    if (uart_polled || tx_dma_stalled || tx_dma_channel < 0)
+    {
+        uart_write((const char *)buf, len);
+        if (done)
+        {
+            done(KERR_OK, arg);
+        }
+        return KERR_OK;
+    }
+
+    uart_flush(); // earlier ring output goes first
+
+    const uint32_t flags = irq_save();
+    if (tx_dma_active)
+    {
+        irq_restore(flags);
+        return KERR_BUSY;
+    }
+
+    dma_lli_chain(tx_dma_lli, UART_DMA_MAX_LLI, (uintptr_t)buf, (uintptr_t)&UART0_DR, len,
+                  DMA_CTRL_SI | DMA_CTRL_SWIDTH(DMA_WIDTH_8) | DMA_CTRL_DWIDTH(DMA_WIDTH_8) |
+                  DMA_CTRL_SBSIZE(DMA_BURST_4) | DMA_CTRL_DBSIZE(DMA_BURST_4));
+
+    tx_dma_base     = (uintptr_t)buf;
+    tx_dma_len      = len;
+    tx_dma_last_src = (uint32_t)tx_dma_base;
+    tx_dma_done     = done;
+    tx_dma_arg      = arg;
+    tx_dma_active   = true;
+    kstat_add(uart_tx_dma_bytes, len); // IRQs masked
+
+    // The transfer owns the FIFO now
+    UART0_IMSC &= ~UART_INT_TX;
+    tx_irq_on   = false;
+    UART0_DMACR |= UART_DMACR_TXDMAE;
+
+    const kerror_t err = dma_start(tx_dma_channel, tx_dma_lli,
+                                   DMA_CFG_DSTPERIPH(DMA_REQ_UART0_TX) | DMA_CFG_FLOW_M2P,
+                                   uart_dma_complete, NULL);
+    if (kerr_is_err(err))
+    {
+        UART0_DMACR  &= ~UART_DMACR_TXDMAE;
+        tx_dma_active = false;
+        uart_tx_pump();
+    }
+    else
+    {
+        ktimer_add_periodic(&tx_dma_watchdog, ktimer_ms_to_ticks(UART_DMA_WATCHDOG_MS));
+    }
+
+    irq_restore(flags);
+    return err;
+}
+
+bool uart_dma_busy(void)
+{
+    return tx_dma_active;
+}
+
+void uart_putc(char c)
+{
+    uart_write(&c, 1);
+}
+
+void uart_flush(void)
+{
+    while (tx_dma_active || !ringbuf_empty(&tx_ring))
+    {
+        const uint32_t flags = irq_save();
+        if (irq_flags_masked(flags))
+        {
+            uart_tx_pump(); // nobody else will
+        }
+        irq_restore(flags);
+    }
+}
+
+void uart_sync_mode(void)
+{
+    const uint32_t flags = irq_save();
+
+    // An interrupted DMA write finishes by polling, ahead of the ring
+    const char *rest = NULL;
+    size_t      left = tx_dma_active ? uart_dma_stop(&rest) : 0;
+
+    UART0_IMSC &= ~UART_INT_TX;
+    tx_irq_on   = false;
+    uart_polled = true;
+
+    while (left--)
+    {
+        uart_poll_putc(*rest++);
+    }
+
+    uint8_t c;
+    while (ringbuf_get(&tx_ring, &c))
+    {
+        uart_poll_putc((char)c);
+    }
+
+    irq_restore(flags);
+}
+
+char uart_getc(void)
+{
+    uint8_t c;
+
+    const uint32_t flags = irq_save();
+    if (uart_polled || irq_flags_masked(flags))
+    {
+        // The RX interrupt cannot run, and may be all a sleeper waits for: spin
+        while (!ringbuf_get(&rx_ring, &c))
+        {
+            uart_rx_pump();
+        }
+        irq_restore(flags);
+        return (char)c;
+    }
+    irq_restore(flags);
+
+    wait_event(&rx_wq, ringbuf_get(&rx_ring, &c));
+    return (char)c;
+}
+
+size_t uart_read(char *buf, size_t len)
+{
+    const uint32_t flags = irq_save();
+    if (uart_polled || irq_flags_masked(flags))
+    {
+        uart_rx_pump();
+    }
+    irq_restore(flags);
+
+    return ringbuf_read(&rx_ring, buf, (uint32_t)len);
+}
+
+struct fiber_event *uart_rx_event(void)
+{
+    return &rx_event;
+}
+
+uint32_t uart_rx_dropped(void)
+{
+    return kstat_read(uart_rx_dropped);
+}
+
+void uart_irq_handler(void)
+{
+    const uint32_t mis = UART0_MIS;
+
+    if (mis & (UART_INT_RX | UART_INT_RT))
+    {
+        uart_rx_pump(); // draining the FIFO deasserts RX; RT needs the clear
+        UART0_ICR = UART_INT_RX | UART_INT_RT;
+        fiber_event_signal(&rx_event);
+        wake_up_all(&rx_wq);
+    }
+
+    if (mis & UART_INT_TX)
+    {
+        UART0_ICR = UART_INT_TX;
+        uart_tx_pump();
+    }
+}
@@ -0,0 +1,142 @@
+/**
+ * @file waitqueue.c
+ * @brief Wait queue enqueue, sleep and wake-up.
+ */
+#include "waitqueue.h"
+#include "interrupt.h"
+#include "thread.h"
+#include "cpustat.h"
+#include "panic.h"
+#include "errno.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+void wait_queue_init(struct wait_queue *wq)
+{
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+void wait_prepare(struct wait_queue *wq, struct waiter *w)
+{
+    if (in_irq())
+    {
+        kernel_panic("wait_event: called from IRQ context", KERR_INVAL);
+    }
+
+    w->next   = NULL;
+    w->thread = sched_can_block() ? thread_current() : NULL;
+    w->queued = true;
+
+    if (wq->tail)
+    {
+        wq->tail->next = w;
+    }
+    else
+    {
+        wq->head = w;
+    }
+    wq->tail = w;
+}
+
+void wait_sleep(struct waiter *w)
+{
+    if (w->thread)
+    {
+        thread_block(); // IRQs stay masked across the switch
+        return;
+    }
+
+    // WFI wakes on a pending IRQ even while masked; open the mask for
+    // one instruction so the handler (and its wake_up()) runs now.
+    cpustat_wfi();
+    __asm__ volatile("cpsie i\n\t"
+                     "isb\n\t"
+                     "cpsid i" ::: "memory");
+}
+
+void wait_finish(struct wait_queue *wq, struct waiter *w)
+{
+    if (!w->queued)
+    {
+        return;
+    }
+
+    struct waiter *prev = NULL;
+    for (struct waiter *it = wq->head; it; prev = it, it = it->next)
+    {
+        if (it != w)
+        {
+            continue;
+        }
+        if (prev)
+        {
+            prev->next = w->next;
+        }
+        else
+        {
+            wq->head = w->next;
+        }
+        if (wq->tail == w)
+        {
+            wq->tail = prev;
+        }
+        break;
+    }
+    w->queued = false;
+}
+
+/**
+ * @internal
+ * @brief Dequeue the head waiter and make it runnable. IRQs masked.
+ */
+static void wake_head(struct wait_queue *wq)
+{
+    struct waiter *w = wq->head;
+
+    wq->head = w->next;
+    if (!wq->head)
+    {
+        wq->tail = NULL;
+    }
+
+    struct thread *t = w->thread;
+    w->queued = false; // `w` may be gone as soon as its thread runs
+    if (t)
+    {
+        thread_wake(t);
+    }
+}
+
+bool wake_up(struct wait_queue *wq)
+{
+    const uint32_t flags = irq_save();
+    const bool     found = wq->head != NULL;
+
+    if (found)
+    {
+        wake_head(wq);
+    }
+
+    irq_restore(flags);
+    return found;
+}
+
+uint32_t wake_up_all(struct wait_queue *wq)
+{
+    const uint32_t flags = irq_save();
+    uint32_t       woken = 0;
+
+    sched_preempt_disable(); // queue everyone before the first of them runs
+    while (wq->head)
+    {
+        wake_head(wq);
+        woken++;
+    }
+    sched_preempt_enable();
+
+    irq_restore(flags);
+    return woken;
+}
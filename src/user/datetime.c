@@ -1,65 +1,140 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "datetime.h"
+#include "clock.h"
+#include "interrupt.h"
+#include "ktimer.h"
+#include "lib/math.h"
+#include "seqlock.h"
 
 _Static_assert(sizeof(uint32_t) == 4, "uint32_t must be 4 bytes");
 
-// TODO: Potentially move those macros to utils file or something
-#define     RTCDR (*(volatile uint32_t *)0x101e8000) // RTC Register
+#define     SECONDS_IN_DAY          86400u
+#define     USEC_PER_SEC            1000000u
 
-#define     SECONDS_IN_YEAR         31556926
-#define     SECONDS_IN_MONTH        2629743
-#define     SECONDS_IN_DAY          86400
-#define     LEAP_YEARS_BEFORE_1970  477
+// Wall time = base_wall_us + (monotonic now - base_mono_us). The resync
+// timer is the only writer; readers retry while `base_seq` is odd or moved.
+static seqcount_t        base_seq     = SEQCOUNT_INIT;
+static uint64_t          base_wall_us = 0;
+static uint64_t          base_mono_us = 0;
 
-uint32_t getdate(dateval *date_struct)
-{
-    static uint32_t day_arr[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}; // Initialize only once
+static struct ktimer     resync_timer;
 
-    if (date_struct != NULL)
-    {
-        uint32_t since_epoch = RTCDR;
+static void datetime_set_base(uint64_t wall_us, uint64_t mono_us)
+{
+  write_seqcount_begin(&base_seq);
+  base_wall_us = wall_us;
+  base_mono_us = mono_us;
+  write_seqcount_end(&base_seq);
+}
 
-        date_struct->year  = 1970 + since_epoch / SECONDS_IN_YEAR;
-        date_struct->month = 1 + (since_epoch / SECONDS_IN_MONTH) % 12;
+static void datetime_resync_timer(struct ktimer *timer, void *arg)
+{
+  (void)timer;
+  (void)arg;
+  datetime_resync();
+}
 
-        uint32_t days_since_epoch       = since_epoch / SECONDS_IN_DAY;
-        uint32_t leap_years_since_epoch = (date_struct->year / 4) - (date_struct->year / 100) + (date_struct->year / 400) - LEAP_YEARS_BEFORE_1970;
-        uint32_t not_leap_years         = date_struct->year - 1970 - leap_years_since_epoch;
-        
-        date_struct->day = days_since_epoch - (leap_years_since_epoch * 366) - (not_leap_years * 365);
+void datetime_init(void)
+{
+  datetime_set_base((uint64_t)RTCDR * USEC_PER_SEC, clock_monotonic_us());
 
-        uint32_t is_leap_year = ((date_struct->year % 4 == 0) && (date_struct->year % 100 != 0)) || (date_struct->year % 400 == 0);
-        day_arr[1] += is_leap_year; // Extra day if leap year
+  ktimer_init(&resync_timer, datetime_resync_timer, NULL);
+  ktimer_add_periodic(&resync_timer, DATETIME_RESYNC_S * KTIMER_HZ);
+}
 
-        for (uint32_t i = 0; i < 12; i++)
-        {
-            if (date_struct->day > day_arr[i])
-            {
-                date_struct->day -= day_arr[i];
-            }
-        }
+void datetime_resync(void)
+{
+  const uint32_t flags   = irq_save(); // the timer may resync concurrently
+  const uint64_t mono    = clock_monotonic_us();
+  const uint64_t rtc_us  = (uint64_t)RTCDR * USEC_PER_SEC;
+  const uint64_t predict = base_wall_us + (mono - base_mono_us);
+
+  // The RTC second started at most 1 s ago: step up to its start if we are
+  // behind, or back to its last microsecond if we ran ahead.
+  if (predict < rtc_us)
+  {
+    datetime_set_base(rtc_us, mono);
+  }
+  else if (predict >= rtc_us + USEC_PER_SEC)
+  {
+    datetime_set_base(rtc_us + USEC_PER_SEC - 1, mono);
+  }
+
+  irq_restore(flags);
+}
 
-        day_arr[1] -= is_leap_year; // Undo the leap year effect, if any
-    }
+uint64_t datetime_now_us(void)
+{
+  uint32_t seq;
+  uint64_t wall;
+  uint64_t mono;
+
+  do
+  {
+    seq  = read_seqcount_begin(&base_seq);
+    wall = base_wall_us;
+    mono = base_mono_us;
+  } while (read_seqcount_retry(&base_seq, seq));
+
+  return wall + (clock_monotonic_us() - mono);
+}
 
-    return RTCDR;
+uint32_t datetime_now(void)
+{
+  return (uint32_t)udiv64(datetime_now_us(), USEC_PER_SEC);
 }
 
-uint32_t gettime(timeval *time_struct)
+// Days since 1970-01-01 to a civil date, in O(1) without tables.
+// Counts in 400-year eras starting on March 1st, so the leap day is the
+// last day of its year and months have a closed form.
+// ref: H. Hinnant, "chrono-Compatible Low-Level Date Algorithms", civil_from_days
+static void civil_from_days(uint32_t days, dateval *date)
 {
-    if (time_struct != NULL)
-    {
-        uint32_t since_epoch = RTCDR;
+  const uint32_t z   = days + 719468u;       // days since 0000-03-01
+  const uint32_t era = z / 146097u;          // 400-year eras
+  const uint32_t doe = z - era * 146097u;                                 // [0, 146096]
+  const uint32_t yoe = (doe - doe / 1460u + doe / 36524u - doe / 146096u) / 365u; // [0, 399]
+  const uint32_t doy = doe - (365u * yoe + yoe / 4u - yoe / 100u);        // [0, 365]
+  const uint32_t mp  = (5u * doy + 2u) / 153u;                            // [0, 11], March = 0
+  const uint32_t m   = mp < 10u ? mp + 3u : mp - 9u;
+
+  date->day   = doy - (153u * mp + 2u) / 5u + 1u;
+  date->month = m;
+  date->year  = yoe + era * 400u + (m <= 2u);
+}
 
-        time_struct->secs = since_epoch % 60;
-        since_epoch /= 60;
+void datetime_from_epoch(uint32_t since_epoch, dateval *date, timeval *time)
+{
+  const uint32_t days = since_epoch / SECONDS_IN_DAY;
+
+  if (date != NULL)
+  {
+    civil_from_days(days, date);
+  }
+
+  if (time != NULL)
+  {
+    const uint32_t secs = since_epoch - days * SECONDS_IN_DAY;
+    time->hrs  = secs / 3600u;
+    time->mins = (secs / 60u) % 60u;
+    time->secs = secs % 60u;
+  }
+}
 
-        time_struct->mins = since_epoch % 60;
-        since_epoch /= 60;
+uint32_t getdatetime(dateval *date, timeval *time)
+{
+  const uint32_t now = datetime_now();
+  datetime_from_epoch(now, date, time);
+  return now;
+}
 
-        time_struct->hrs = since_epoch % 24;
-    }
+uint32_t getdate(dateval *date_struct)
+{
+  return getdatetime(date_struct, NULL);
+}
 
-    return RTCDR;
+uint32_t gettime(timeval *time_struct)
+{
+  return getdatetime(NULL, time_struct);
 }
@@ -0,0 +1,674 @@
+/**
+ * @file format.c
+ * @brief Formatting core shared by printf, snprintf and KLOG.
+ *
+ * Output is staged in a small on-stack chunk and handed to the sink when
+ * the chunk fills up and once at the end, so sinks see a few large writes
+ * instead of one call per character.
+ */
+#include "format.h"
+#include "ringbuf.h"
+#include "uart.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @internal
+ * @brief Staging state of one vsnformat() call.
+ */
+typedef struct
+{
+    fmt_sink_t *sink;
+    size_t      len;              /**< Bytes staged in `chunk`. */
+    int         total;            /**< Bytes produced so far. */
+    char        chunk[FMT_CHUNK];
+} fmt_out_t;
+
+static void out_flush(fmt_out_t *out)
+{
+    if (out->len)
+    {
+        out->sink->write(out->sink, out->chunk, out->len);
+        out->len = 0;
+    }
+}
+
+static inline void out_putc(fmt_out_t *out, char c)
+{
+    if (out->len == FMT_CHUNK)
+    {
+        out_flush(out);
+    }
+    out->chunk[out->len++] = c;
+    out->total++;
+}
+
+static void out_write(fmt_out_t *out, const char *s, size_t len)
+{
+    // Long runs bypass the chunk once it has been flushed
+    if (len >= FMT_CHUNK)
+    {
+        out_flush(out);
+        out->sink->write(out->sink, s, len);
+        out->total += (int)len;
+        return;
+    }
+
+    while (len--)
+    {
+        out_putc(out, *s++);
+    }
+}
+
+static void out_pad(fmt_out_t *out, char c, uint32_t n)
+{
+    while (n--)
+    {
+        out_putc(out, c);
+    }
+}
+
+// --- Integer to text ---
+//
+// No digit goes through a division: the core has no hardware divider and
+// a 64-bit `/` or `%` would end up in a slow shift-subtract libgcc routine.
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * @internal
+ * @brief 32-bit decimal: two digits per step, `v / 100` as a multiply.
+ */
+static char *u32_dec_rev(char *p, uint32_t v)
+{
+    while (v >= 100)
+    {
+        // 0x51EB851F / 2^37 rounds 1/100 up just enough to be exact for all of uint32_t
+        const uint32_t q = (uint32_t)(((uint64_t)v * 0x51EB851Fu) >> 37);
+        const uint32_t r = v - q * 100;
+        p -= 2;
+        p[0] = digit_pairs[2 * r];
+        p[1] = digit_pairs[2 * r + 1];
+        v = q;
+    }
+
+    if (v >= 10)
+    {
+        p -= 2;
+        p[0] = digit_pairs[2 * v];
+        p[1] = digit_pairs[2 * v + 1];
+    }
+    else
+    {
+        *--p = (char)('0' + v);
+    }
+    return p;
+}
+
+/**
+ * @internal
+ * @brief 64-bit `v / 10` with shifts and adds (Hacker's Delight, divu10).
+ */
+static inline uint64_t u64_div10(uint64_t v, uint32_t *rem)
+{
+    uint64_t q = (v >> 1) + (v >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q += q >> 32;
+    q >>= 3;
+
+    uint32_t r = (uint32_t)(v - q * 10); // estimate is low by at most one
+    if (r > 9)
+    {
+        q++;
+        r -= 10;
+    }
+    *rem = r;
+    return q;
+}
+
+static char *hex_rev(char *p, unsigned long long v, bool uppercase)
+{
+    const char *digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+    uint32_t lo = (uint32_t)v;
+    uint32_t hi = (uint32_t)(v >> 32);
+
+    if (hi)
+    {
+        for (int i = 0; i < 8; i++) // low word is all digits, zeros included
+        {
+            *--p = digits[lo & 0xF];
+            lo >>= 4;
+        }
+        lo = hi;
+    }
+
+    do
+    {
+        *--p = digits[lo & 0xF];
+        lo >>= 4;
+    } while (lo);
+
+    return p;
+}
+
+char *fmt_utoa(char *end, unsigned long long value, unsigned base, bool uppercase)
+{
+    if (base == 16)
+    {
+        return hex_rev(end, value, uppercase);
+    }
+
+    char *p = end;
+    while (value >> 32) // peel digits until the rest fits the 32-bit path
+    {
+        uint32_t r;
+        value = u64_div10(value, &r);
+        *--p  = (char)('0' + r);
+    }
+    return u32_dec_rev(p, (uint32_t)value);
+}
+
+/**
+ * @internal
+ * @brief Emit a number with its sign/prefix, precision zeros and field padding.
+ */
+static void put_number(fmt_out_t *out, const fmt_spec_t *spec, unsigned long long value,
+                       unsigned base, const char *prefix)
+{
+    char  buf[24];
+    char *end    = buf + sizeof(buf);
+    char *digits = end;
+
+    // "%.0d" with a zero value prints no digits at all
+    if (value != 0 || !(spec->flags & FLAG_PRECISION) || spec->precision != 0)
+    {
+        digits = fmt_utoa(end, value, base, spec->flags & FLAG_UPPERCASE);
+    }
+
+    const uint32_t ndigits = (uint32_t)(end - digits);
+    uint32_t nprefix = 0;
+    while (prefix[nprefix])
+    {
+        nprefix++;
+    }
+
+    uint32_t zeros = 0;
+    if ((spec->flags & FLAG_PRECISION) && spec->precision > ndigits)
+    {
+        zeros = spec->precision - ndigits;
+    }
+
+    uint32_t       len    = nprefix + zeros + ndigits;
+    const uint32_t fill   = spec->width > len ? spec->width - len : 0;
+    const bool     zfill  = (spec->flags & (FLAG_ZERO | FLAG_LEFT | FLAG_PRECISION)) == FLAG_ZERO;
+
+    if (zfill)
+    {
+        zeros += fill;
+    }
+    else if (!(spec->flags & FLAG_LEFT))
+    {
+        out_pad(out, ' ', fill);
+    }
+
+    out_write(out, prefix, nprefix);
+    out_pad(out, '0', zeros);
+    out_write(out, digits, ndigits);
+
+    if (spec->flags & FLAG_LEFT)
+    {
+        out_pad(out, ' ', fill);
+    }
+}
+
+static void put_string(fmt_out_t *out, const fmt_spec_t *spec, const char *s)
+{
+    if (s == NULL)
+    {
+        s = "(null)";
+    }
+
+    uint32_t len = 0;
+    const uint32_t max = (spec->flags & FLAG_PRECISION) ? spec->precision : UINT32_MAX;
+    while (len < max && s[len])
+    {
+        len++;
+    }
+
+    const uint32_t fill = spec->width > len ? spec->width - len : 0;
+
+    if (!(spec->flags & FLAG_LEFT))
+    {
+        out_pad(out, ' ', fill);
+    }
+    out_write(out, s, len);
+    if (spec->flags & FLAG_LEFT)
+    {
+        out_pad(out, ' ', fill);
+    }
+}
+
+// --- Argument sources ---
+//
+// Arguments come either from a va_list or from an array of raw 32-bit
+// words recorded earlier (deferred logging). 64-bit arguments take two
+// words, low word first. A third mode fetches nothing and only records
+// which arguments are 64-bit; it computes the word layout of a format.
+
+/**
+ * @internal
+ * @brief Where conversion arguments come from.
+ */
+typedef struct
+{
+    va_list        *ap;     /**< Variadic arguments, or NULL. */
+    const uint32_t *words;  /**< Raw words when `ap` is NULL (NULL: layout pass). */
+    uint32_t        nwords; /**< Number of raw words. */
+    uint32_t        next;   /**< Next raw word. */
+    uint32_t        nargs;  /**< Arguments consumed so far. */
+    uint32_t        wide;   /**< Bit i set if argument i is 64-bit. */
+} fmt_src_t;
+
+static uint64_t src_word(fmt_src_t *src, size_t size)
+{
+    uint64_t v = 0;
+
+    if (size > 4 && src->nargs < 32)
+    {
+        src->wide |= 1u << src->nargs;
+    }
+    src->nargs++;
+
+    if (src->words)
+    {
+        // Reads past the recorded words yield 0 rather than garbage
+        v = src->next < src->nwords ? src->words[src->next] : 0;
+        src->next++;
+        if (size > 4)
+        {
+            const uint64_t hi = src->next < src->nwords ? src->words[src->next] : 0;
+            v |= hi << 32;
+            src->next++;
+        }
+    }
+    return v;
+}
+
+#define SRC_ARG(src, type) \
+    ((src)->ap ? (type)va_arg(*(src)->ap, type) : (type)src_word((src), sizeof(type)))
+
+#define SRC_PTR(src, type) \
+    ((src)->ap ? va_arg(*(src)->ap, type) : (type)(uintptr_t)src_word((src), sizeof(type)))
+
+static long long arg_signed(const fmt_spec_t *spec, fmt_src_t *src)
+{
+    if (spec->flags & FLAG_LONGLONG)
+    {
+        return SRC_ARG(src, long long);
+    }
+    if (spec->flags & FLAG_LONG)
+    {
+        return SRC_ARG(src, long);
+    }
+    if (spec->flags & FLAG_SIZE)
+    {
+        return SRC_ARG(src, ptrdiff_t);
+    }
+
+    const int v = SRC_ARG(src, int);
+    if (spec->flags & FLAG_CHAR)
+    {
+        return (signed char)v;
+    }
+    if (spec->flags & FLAG_SHORT)
+    {
+        return (short)v;
+    }
+    return v;
+}
+
+static unsigned long long arg_unsigned(const fmt_spec_t *spec, fmt_src_t *src)
+{
+    if (spec->flags & FLAG_LONGLONG)
+    {
+        return SRC_ARG(src, unsigned long long);
+    }
+    if (spec->flags & FLAG_LONG)
+    {
+        return SRC_ARG(src, unsigned long);
+    }
+    if (spec->flags & FLAG_SIZE)
+    {
+        return SRC_ARG(src, size_t);
+    }
+
+    const unsigned int v = SRC_ARG(src, unsigned int);
+    if (spec->flags & FLAG_CHAR)
+    {
+        return (unsigned char)v;
+    }
+    if (spec->flags & FLAG_SHORT)
+    {
+        return (unsigned short)v;
+    }
+    return v;
+}
+
+/**
+ * @internal
+ * @brief Parse flags, width, precision and length of one specification.
+ *
+ * @return Pointer to the conversion character.
+ */
+static const char *parse_spec(const char *fmt, fmt_spec_t *spec, fmt_src_t *src)
+{
+    *spec = (fmt_spec_t){ 0 };
+
+    for (;; fmt++)
+    {
+        if (*fmt == '-')
+        {
+            spec->flags |= FLAG_LEFT;
+        }
+        else if (*fmt == '0')
+        {
+            spec->flags |= FLAG_ZERO;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (*fmt == '*')
+    {
+        const int w = SRC_ARG(src, int);
+        if (w < 0)
+        {
+            spec->flags |= FLAG_LEFT;
+            spec->width  = (uint32_t)-w;
+        }
+        else
+        {
+            spec->width = (uint32_t)w;
+        }
+        fmt++;
+    }
+    else
+    {
+        while (*fmt >= '0' && *fmt <= '9')
+        {
+            spec->width = spec->width * 10 + (uint32_t)(*fmt++ - '0');
+        }
+    }
+
+    if (*fmt == '.')
+    {
+        fmt++;
+        spec->flags |= FLAG_PRECISION;
+        if (*fmt == '*')
+        {
+            const int p = SRC_ARG(src, int);
+            if (p < 0)
+            {
+                spec->flags &= ~FLAG_PRECISION; // negative means "none"
+            }
+            else
+            {
+                spec->precision = (uint32_t)p;
+            }
+            fmt++;
+        }
+        else
+        {
+            while (*fmt >= '0' && *fmt <= '9')
+            {
+                spec->precision = spec->precision * 10 + (uint32_t)(*fmt++ - '0');
+            }
+        }
+    }
+
+    switch (*fmt)
+    {
+        case 'h':
+            fmt++;
+            if (*fmt == 'h')
+            {
+                spec->flags |= FLAG_CHAR;
+                fmt++;
+            }
+            else
+            {
+                spec->flags |= FLAG_SHORT;
+            }
+            break;
+
+        case 'l':
+            fmt++;
+            if (*fmt == 'l')
+            {
+                spec->flags |= FLAG_LONGLONG;
+                fmt++;
+            }
+            else
+            {
+                spec->flags |= FLAG_LONG;
+            }
+            break;
+
+        case 'z':
+        case 't':
+            spec->flags |= FLAG_SIZE;
+            fmt++;
+            break;
+
+        default:
+            break;
+    }
+
+    return fmt;
+}
+
+/**
+ * @internal
+ * @brief The formatter proper, shared by every entry point.
+ */
+static int format_core(fmt_sink_t *sink, const char *fmt, fmt_src_t *src)
+{
+    fmt_out_t out;
+    out.sink  = sink;
+    out.len   = 0;
+    out.total = 0;
+
+    while (*fmt)
+    {
+        // Copy the literal run up to the next '%' in one go
+        const char *run = fmt;
+        while (*fmt && *fmt != '%')
+        {
+            fmt++;
+        }
+        out_write(&out, run, (size_t)(fmt - run));
+
+        if (*fmt == '\0')
+        {
+            break;
+        }
+
+        fmt_spec_t  spec;
+        const char *start = fmt;
+        fmt = parse_spec(fmt + 1, &spec, src);
+
+        switch (*fmt)
+        {
+            case 'd':
+            case 'i':
+            {
+                const long long v = arg_signed(&spec, src);
+                const unsigned long long mag =
+                    v < 0 ? (unsigned long long)(-(v + 1)) + 1 : (unsigned long long)v;
+                put_number(&out, &spec, mag, 10, v < 0 ? "-" : "");
+                break;
+            }
+
+            case 'u':
+                put_number(&out, &spec, arg_unsigned(&spec, src), 10, "");
+                break;
+
+            case 'X':
+                spec.flags |= FLAG_UPPERCASE;
+                [[fallthrough]];
+            case 'x':
+                put_number(&out, &spec, arg_unsigned(&spec, src), 16, "");
+                break;
+
+            case 'p':
+                put_number(&out, &spec, (uintptr_t)SRC_PTR(src, void *), 16, "0x");
+                break;
+
+            case 's':
+                put_string(&out, &spec, SRC_PTR(src, const char *));
+                break;
+
+            case 'c':
+            {
+                const char c = (char)SRC_ARG(src, int);
+                const uint32_t fill = spec.width > 1 ? spec.width - 1 : 0;
+                if (!(spec.flags & FLAG_LEFT))
+                {
+                    out_pad(&out, ' ', fill);
+                }
+                out_putc(&out, c);
+                if (spec.flags & FLAG_LEFT)
+                {
+                    out_pad(&out, ' ', fill);
+                }
+                break;
+            }
+
+            case '%':
+                out_putc(&out, '%');
+                break;
+
+            case '\0':
+                // Truncated specification: print what was there
+                out_write(&out, start, (size_t)(fmt - start));
+                fmt--;
+                break;
+
+            default:
+                // Unrecognized conversion: print it verbatim
+                out_write(&out, start, (size_t)(fmt + 1 - start));
+                break;
+        }
+        fmt++;
+    }
+
+    out_flush(&out);
+    return out.total;
+}
+
+int vsnformat(fmt_sink_t *sink, const char *fmt, va_list args)
+{
+    va_list ap;
+    va_copy(ap, args);
+
+    fmt_src_t src = { .ap = &ap };
+    const int n   = format_core(sink, fmt, &src);
+
+    va_end(ap);
+    return n;
+}
+
+int vsnformat_words(fmt_sink_t *sink, const char *fmt, const uint32_t *words, uint32_t nwords)
+{
+    static const uint32_t none[1] = { 0 };
+
+    fmt_src_t src = { .words = words ? words : none, .nwords = words ? nwords : 0 };
+    return format_core(sink, fmt, &src);
+}
+
+static void sink_null_write(fmt_sink_t *sink, const char *data, size_t len)
+{
+    (void)sink;
+    (void)data;
+    (void)len;
+}
+
+uint32_t fmt_arg_layout(const char *fmt, uint32_t *wide_mask)
+{
+    fmt_sink_t sink = { .write = sink_null_write };
+    fmt_src_t  src  = { 0 };
+
+    format_core(&sink, fmt, &src);
+    *wide_mask = src.wide;
+    return src.nargs;
+}
+
+int snformat(fmt_sink_t *sink, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnformat(sink, fmt, args);
+    va_end(args);
+    return n;
+}
+
+// --- Sinks ---
+
+static void sink_buffer_write(fmt_sink_t *sink, const char *data, size_t len)
+{
+    char  *buf  = (char *)sink->ctx;
+    size_t room = sink->size ? sink->size - 1 - sink->pos : 0;
+    size_t n    = len < room ? len : room;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        buf[sink->pos + i] = data[i];
+    }
+    sink->pos     += n;
+    sink->dropped += len - n;
+}
+
+static void sink_uart_write(fmt_sink_t *sink, const char *data, size_t len)
+{
+    (void)sink;
+    uart_write(data, len);
+}
+
+static void sink_ring_write(fmt_sink_t *sink, const char *data, size_t len)
+{
+    if (!ringbuf_mp_write((struct ringbuf *)sink->ctx, data, (uint32_t)len))
+    {
+        sink->dropped += len;
+    }
+}
+
+fmt_sink_t fmt_sink_buffer(char *buf, size_t size)
+{
+    return (fmt_sink_t){ .write = sink_buffer_write, .ctx = buf, .size = size };
+}
+
+fmt_sink_t fmt_sink_uart(void)
+{
+    return (fmt_sink_t){ .write = sink_uart_write };
+}
+
+fmt_sink_t fmt_sink_ring(struct ringbuf *ring)
+{
+    return (fmt_sink_t){ .write = sink_ring_write, .ctx = ring };
+}
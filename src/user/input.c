@@ -10,21 +10,17 @@
 
 static inline void putc(char c)
 {
-    // Wait until UART transmit FIFO is not full
-    while (UART0_FR & UART_FR_TXFF) {}
-    UART0_DR = (uint32_t)c;
+    uart_putc(c);
 }
 
 /**
- * @brief Blocking UART character input.
+ * @brief Blocking UART character input, sleeps until the RX interrupt fires.
  *
  * @return The next character read from UART.
  */
 static inline char getc(void)
 {
-    // Wait until UART receive FIFO is not empty
-    while (UART0_FR & UART_FR_RXFE) {}
-    return (char)(UART0_DR & 0xFF);
+    return uart_getc();
 }
 
 void getlines(char *restrict buffer, size_t length)
@@ -0,0 +1,136 @@
+#include "lib/math.h"
+
+// Shift-subtract long division, starting at the highest quotient bit that
+// can be set: the divisor is shifted up until its top bit lines up with
+// the dividend's, which leaves clz(d) - clz(n) + 1 steps instead of 32/64.
+
+uint32_t udivmod32(uint32_t n, uint32_t d, uint32_t *rem)
+{
+  if (d == 0)
+  {
+    kernel_panic("udivmod32: Division by zero", KERR_INVAL);
+  }
+
+  uint32_t q = 0;
+  if (n >= d)
+  {
+    const int shift = __builtin_clz(d) - __builtin_clz(n);
+    d <<= shift;
+    for (int i = shift; i >= 0; i--)
+    {
+      q <<= 1;
+      if (n >= d)
+      {
+        n -= d;
+        q |= 1;
+      }
+      d >>= 1;
+    }
+  }
+
+  if (rem)
+  {
+    *rem = n;
+  }
+  return q;
+}
+
+uint64_t udivmod64(uint64_t n, uint64_t d, uint64_t *rem)
+{
+  if ((n >> 32) == 0 && (d >> 32) == 0)
+  {
+    uint32_t r32;
+    const uint32_t q32 = udivmod32((uint32_t)n, (uint32_t)d, &r32);
+    if (rem)
+    {
+      *rem = r32;
+    }
+    return q32;
+  }
+
+  if (d == 0)
+  {
+    kernel_panic("udivmod64: Division by zero", KERR_INVAL);
+  }
+
+  uint64_t q = 0;
+  if (n >= d)
+  {
+    const int shift = __builtin_clzll(d) - __builtin_clzll(n);
+    d <<= shift;
+    for (int i = shift; i >= 0; i--)
+    {
+      q <<= 1;
+      if (n >= d)
+      {
+        n -= d;
+        q |= 1;
+      }
+      d >>= 1;
+    }
+  }
+
+  if (rem)
+  {
+    *rem = n;
+  }
+  return q;
+}
+
+uint32_t __aeabi_uidiv(uint32_t n, uint32_t d)
+{
+  return udivmod32(n, d, NULL);
+}
+
+uint64_t __aeabi_uidivmod(uint32_t n, uint32_t d)
+{
+  uint32_t r;
+  const uint32_t q = udivmod32(n, d, &r);
+  return ((uint64_t)r << 32) | q;
+}
+
+// C semantics: the quotient truncates toward zero, the remainder takes the
+// dividend's sign.
+static uint32_t idivmod(int32_t n, int32_t d, int32_t *rem)
+{
+  const uint32_t un = n < 0 ? -(uint32_t)n : (uint32_t)n;
+  const uint32_t ud = d < 0 ? -(uint32_t)d : (uint32_t)d;
+  uint32_t r;
+  uint32_t q = udivmod32(un, ud, &r);
+
+  if ((n < 0) != (d < 0))
+  {
+    q = -q;
+  }
+  *rem = n < 0 ? -(int32_t)r : (int32_t)r;
+  return q;
+}
+
+int32_t __aeabi_idiv(int32_t n, int32_t d)
+{
+  int32_t r;
+  return (int32_t)idivmod(n, d, &r);
+}
+
+uint64_t __aeabi_idivmod(int32_t n, int32_t d)
+{
+  int32_t r;
+  const uint32_t q = idivmod(n, d, &r);
+  return ((uint64_t)(uint32_t)r << 32) | q;
+}
+
+// Called with the dividend in r0:r1 and the divisor in r2:r3; returns the
+// quotient in r0:r1 and the remainder in r2:r3, which no C signature can
+// express. Pass udivmod64() a stack slot for the remainder and load it.
+__attribute__((naked)) void __aeabi_uldivmod(void)
+{
+  __asm__ volatile(
+      "push   {r4, lr}\n"
+      "sub    sp, sp, #16\n"        // [sp] = 5th argument, [sp + 8] = remainder
+      "add    r4, sp, #8\n"
+      "str    r4, [sp]\n"
+      "bl     udivmod64\n"
+      "ldrd   r2, r3, [sp, #8]\n"
+      "add    sp, sp, #16\n"
+      "pop    {r4, pc}\n");
+}
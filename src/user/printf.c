@@ -1,281 +1,60 @@
 /**
  * @file printf.c
- * @brief UART-backed minimal printf implementation for a freestanding kernel.
+ * @brief printf/snprintf front ends over the vsnformat() core.
  *
- * This file implements formatted output and simple line input using
- * the QEMU VersatileAB UART0. It is designed for early boot and debugging.
- *
- * @todo Refactor this file for cleaner function implementation.
+ * printf() formats into the UART sink, which queues whole chunks on the
+ * UART0 TX ring; snprintf() formats into caller memory.
  */
 #include "printf.h"
-#include "panic.h"
-#include "lib/math.h"
+#include "format.h"
 #include "uart.h"
+#include "string.h"
 
-#include <stdint.h>
-#include <stdbool.h>
 #include <stdarg.h>
 #include <stddef.h>
 
-_Static_assert(sizeof(uint32_t) == 4, "uint32_t must be 4 bytes");
-
-/**
- * @brief Send a single character over UART, waiting if the FIFO is full
- *
- * @param c Character to transmit
-*/
-static inline void putc(char c)
-{
-    // Wait until UART transmit FIFO is not full
-    while (UART0_FR & UART_FR_TXFF) {}
-    UART0_DR = (uint32_t)c;
-}
-
-/**
- * @brief Print an unsigned integer in the given base.
- *
- * @param num Unsigned integer to print.
- * @param base Number base (10 for decimal, 16 for hex).
- * @param uppercase Use uppercase hex digits if true.
- */
-static void put_unsigned(unsigned long long num, unsigned base, bool uppercase)
+void puts(const char *s)
 {
-    static const char digits_l[] = "0123456789abcdef";
-    static const char digits_u[] = "0123456789ABCDEF";
-    const char *digits = uppercase ? digits_u : digits_l;
-
-    char buf[32];
-    size_t len = 0;
-
-    do
-    {
-        unsigned long long rem;
-        num         = _divmod(num, base, &rem);
-        buf[len++]  = digits[rem];
-    } while (num);
-
-    while (len--)
+    if (s == NULL)
     {
-        putc(buf[len]);
+        return;
     }
+
+    uart_write(s, strlen(s));
 }
 
-/**
- * @brief Print a signed integer in decimal form.
- *
- * @param num Signed integer to print.
- */
-static inline void put_signed(long long num)
+int vprintf(const char *fmt, va_list args)
 {
-    if (num < 0)
-    {
-        putc('-');
-        unsigned long long mag = (unsigned long long)(-(num + 1)) + 1;
-        put_unsigned(mag, 10, false);
-        return;
-    }
-    put_unsigned((unsigned long long)num, 10, false);
+    fmt_sink_t sink = fmt_sink_uart();
+    return vsnformat(&sink, fmt, args);
 }
 
-/**
- * @brief Format and print an unsigned integer based on the format specifier.
- *
- * Handles %u, %x, %X using the provided format state.
- *
- * @param control Format specifier character ('u', 'x', or 'X').
- * @param fs Pointer to the current format state.
- */
-static inline void put_integers(char control, const fmt_args_t *restrict fs)
+int printf(const char *fmt, ...)
 {
-    bool uppercase           = fs->flags & FLAG_UPPERCASE;
-    unsigned long long value = fs->num;
-
-    switch (control)
-    {
-        case 'u': // unsigned decimal
-            put_unsigned(value, 10, false);
-            break;
-
-        case 'x': // lowercase hex
-        case 'X': // uppercase hex
-            if (uppercase)
-            {
-                put_unsigned(value, 16, true);
-            }
-            else
-            {
-                put_unsigned(value, 16, false);
-            }
-            break;
-
-        default:
-            // Optional: add kernel diagnostic for unknown format
-            break;
-    }
+    va_list args;
+    va_start(args, fmt);
+    const int n = vprintf(fmt, args);
+    va_end(args);
+    return n;
 }
 
-void puts(const char *s)
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list args)
 {
-    if (s == NULL)
-    {
-        return;
-    }
+    fmt_sink_t sink = fmt_sink_buffer(buf, size);
+    const int  n    = vsnformat(&sink, fmt, args);
 
-    while (*s)
+    if (size)
     {
-        putc(*s++);
+        buf[sink.pos] = '\0';
     }
+    return n;
 }
 
-void printf(const char *fmt, ...)
+int snprintf(char *buf, size_t size, const char *fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-
-    fmt_state_t state   = FMT_TEXT;
-    fmt_args_t  fs      = {0};
-
-    while (*fmt)
-    {
-        char c = *fmt++;
-
-        switch (state)
-        {
-            case FMT_TEXT:
-            {
-                if (c == '%')
-                {
-                    state = FMT_PERCENT;
-                }
-                else
-                {
-                    putc(c);
-                }
-                break;
-            }
-
-            case FMT_PERCENT:
-            {
-                switch (c)
-                {
-                    case '%':
-                    {
-                        putc('%');
-                        state = FMT_TEXT;
-                        break;
-                    }
-
-                    case 'l':
-                    {
-                        fs.flags |= FLAG_LONG;
-                        state     = FMT_LONG;
-                        break;
-                    }
-
-                    case 'c':
-                    {
-                        putc((char)va_arg(args, int));
-                        state = FMT_TEXT;
-                        break;
-                    }
-
-                    case 's':
-                    {
-                        const char *s = va_arg(args, const char *);
-                        puts(s ? s : "(null)");
-                        state = FMT_TEXT;
-                        break;
-                    }
-
-                    case 'p':
-                    {
-                        uintptr_t addr = (uintptr_t)va_arg(args, void *);
-                        puts("0x");
-                        put_unsigned(addr, 16, false);
-                        fs.flags = 0; // reset for next
-                        state = FMT_TEXT;
-                        break;
-                    }
-
-                    case 'd':
-                    {
-                        put_signed(va_arg(args, int));
-                        fs.flags = 0; // reset for next
-                        state = FMT_TEXT;
-                        break;
-                    }
-
-                    case 'u':
-                    case 'x':
-                    case 'X':
-                    {
-                        fs.num = (unsigned long long)va_arg(args, unsigned int);
-                        if (c == 'X')
-                        {
-                            fs.flags |= FLAG_UPPERCASE;
-                        }
-
-                        put_integers(c, &fs);
-                        fs.flags = 0; // reset for next
-                        state    = FMT_TEXT;
-                        break;
-                    }
-
-                    default:
-                    {
-                        // unrecognized specifier
-                        putc('%');
-                        putc(c);
-                        fs.flags = 0; // reset for next
-                        state    = FMT_TEXT;
-                        break;
-                    }
-                }
-                break;
-            }
-
-            case FMT_LONG:
-            {
-                // only handles "%ld", "%lu", "%lx", "%lX" for now
-                switch (c)
-                {
-                    case 'd':
-                    {
-                        put_signed(va_arg(args, long));
-                        fs.flags = 0; // reset for next
-                        state    = FMT_TEXT;
-                        break;
-                    }
-
-                    case 'u':
-                    case 'x':
-                    case 'X':
-                    {
-                        fs.num = (unsigned long long)va_arg(args, unsigned long);
-                        if (c == 'X')
-                        {
-                            fs.flags |= FLAG_UPPERCASE;
-                        }
-
-                        put_integers(c, &fs);
-                        fs.flags = 0;
-                        state    = FMT_TEXT;
-                        break;
-                    }
-
-                    default:
-                        // fallback if 'l' wasn't followed by known type
-                        putc('%');
-                        putc('l');
-                        putc(c);
-                        fs.flags = 0; // reset for next
-                        state    = FMT_TEXT;
-                        break;
-                }
-                break;
-            }
-        }
-    }
-
+    const int n = vsnprintf(buf, size, fmt, args);
     va_end(args);
+    return n;
 }
@@ -29,3 +29,64 @@ size_t strlen(const char *str)
   }
   return s - str;
 }
+
+// GCC may turn these loops back into calls to themselves; keep them as loops.
+#define NO_LOOP_PATTERNS __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+NO_LOOP_PATTERNS void *memset(void *dst, int value, size_t n)
+{
+  unsigned char *d = dst;
+  while (n--)
+  {
+    *d++ = (unsigned char)value;
+  }
+  return dst;
+}
+
+NO_LOOP_PATTERNS void *memcpy(void *restrict dst, const void *restrict src, size_t n)
+{
+  unsigned char *d = dst;
+  const unsigned char *s = src;
+  while (n--)
+  {
+    *d++ = *s++;
+  }
+  return dst;
+}
+
+NO_LOOP_PATTERNS void *memmove(void *dst, const void *src, size_t n)
+{
+  unsigned char *d = dst;
+  const unsigned char *s = src;
+  if (d < s)
+  {
+    while (n--)
+    {
+      *d++ = *s++;
+    }
+  }
+  else
+  {
+    d += n;
+    s += n;
+    while (n--)
+    {
+      *--d = *--s;
+    }
+  }
+  return dst;
+}
+
+int memcmp(const void *a, const void *b, size_t n)
+{
+  const unsigned char *p = a;
+  const unsigned char *q = b;
+  for (; n; n--, p++, q++)
+  {
+    if (*p != *q)
+    {
+      return *p < *q ? -1 : 1;
+    }
+  }
+  return 0;
+}